@@ -33,6 +33,7 @@
 #include <mash-utils/declarations.h>
 #include <vector>
 #include <map>
+#include <memory.h>
 
 
 namespace Mash
@@ -181,6 +182,38 @@ namespace Mash
         virtual unsigned char* getView(const std::string& view, size_t &nbBytes,
                                        std::string &mimetype) = 0;
 
+        //----------------------------------------------------------------------
+        /// @brief Writes one of the views in a buffer provided by the caller
+        ///        (like a shared memory slot)
+        ///
+        /// @param[in]  view        The name of the view
+        /// @param[in]  pBuffer     The buffer
+        /// @param[in]  maxNbBytes  Size of the buffer, in bytes
+        /// @param[out] nbBytes     The size of the data, in bytes
+        /// @param[out] mimetype    The MIME type of the data (see getView())
+        /// @return                 'false' in case of error, or if the buffer
+        ///                         is too small
+        ///
+        /// The default implementation copies the buffer returned by getView():
+        /// override it to avoid the copy.
+        //----------------------------------------------------------------------
+        virtual bool getViewInto(const std::string& view, unsigned char* pBuffer,
+                                 size_t maxNbBytes, size_t &nbBytes,
+                                 std::string &mimetype)
+        {
+            unsigned char* pImage = getView(view, nbBytes, mimetype);
+            if (!pImage)
+                return false;
+
+            bool bResult = (nbBytes <= maxNbBytes);
+            if (bResult)
+                memcpy(pBuffer, pImage, nbBytes);
+
+            delete[] pImage;
+
+            return bResult;
+        }
+
         //----------------------------------------------------------------------
         /// @brief Performs an action
         ///
@@ -220,6 +253,19 @@ namespace Mash
         /// @brief  Called when a timeout occured while waiting for a command
         //----------------------------------------------------------------------
         virtual void onTimeout() {}
+
+        //----------------------------------------------------------------------
+        /// @brief  Called when the responses to a command were sent, and the
+        ///         next command isn't there yet
+        ///
+        /// Can be used to prepare some work in advance (like the next episode
+        /// of the task), one step at a time: it is called again until it
+        /// returns 'false' or the next command arrives. Keep the steps short:
+        /// the next command waits for the current one.
+        ///
+        /// @return 'true' if some work remains
+        //----------------------------------------------------------------------
+        virtual bool onIdle() { return false; }
     };
 
 
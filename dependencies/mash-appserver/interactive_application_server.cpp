@@ -64,6 +64,42 @@ bool InteractiveApplicationServer::listen(const std::string& host, unsigned int
 }
 
 
+bool InteractiveApplicationServer::listenUnix(const std::string& strPath,
+                tApplicationServerConstructor* applicationServerConstructor,
+                bool bVerbose, struct timeval* pTimeout)
+{
+    // Initialize the listener
+    InteractiveListener::initialize(bVerbose, applicationServerConstructor, pTimeout);
+
+    OutStream::verbosityLevel = (bVerbose ? 1 : 0);
+
+    // Start handling requests from clients
+    return _server.listenUnix(strPath, InteractiveListener::createListener);
+}
+
+
+bool InteractiveApplicationServer::listenOnSocket(int socket,
+                tApplicationServerConstructor* applicationServerConstructor,
+                bool bVerbose, struct timeval* pTimeout)
+{
+    // Initialize the listener
+    InteractiveListener::initialize(bVerbose, applicationServerConstructor, pTimeout);
+
+    OutStream::verbosityLevel = (bVerbose ? 1 : 0);
+
+    // Start handling requests from clients
+    return _server.listenOnSocket(socket, InteractiveListener::createListener);
+}
+
+
+void InteractiveApplicationServer::setWorkerPool(unsigned int nbWorkers,
+                                                 unsigned int maxSessionsPerWorker,
+                                                 tWorkerInitializer* workerInitializer)
+{
+    _server.setWorkerPool(nbWorkers, maxSessionsPerWorker, workerInitializer);
+}
+
+
 std::string InteractiveApplicationServer::getProtocol() const
 {
     return InteractiveListener::getProtocol();
@@ -91,6 +91,62 @@ namespace Mash
                     tApplicationServerConstructor* applicationServerConstructor,
                     bool bVerbose = false, struct timeval* pTimeout = 0);
 
+        //----------------------------------------------------------------------
+        /// @brief  Start to listen for incoming communications on a Unix domain
+        ///         socket
+        ///
+        /// @param  strPath                         Path of the socket
+        /// @param  applicationServerConstructor    Pointer to the function to
+        ///                                         use to create the application
+        ///                                         server implementation that
+        ///                                         will handle the incoming
+        ///                                         connections
+        /// @param  bVerbose                        Verbose mode
+        /// @return                                 'false' if failed
+        ///
+        /// @remark Blocking call
+        //----------------------------------------------------------------------
+        bool listenUnix(const std::string& strPath,
+                        tApplicationServerConstructor* applicationServerConstructor,
+                        bool bVerbose = false, struct timeval* pTimeout = 0);
+
+        //----------------------------------------------------------------------
+        /// @brief  Use a socket inherited from the parent process (listening,
+        ///         or already connected, see Server::listenOnSocket())
+        ///
+        /// @param  socket                          The socket
+        /// @param  applicationServerConstructor    Pointer to the function to
+        ///                                         use to create the application
+        ///                                         server implementation that
+        ///                                         will handle the connection(s)
+        /// @param  bVerbose                        Verbose mode
+        /// @return                                 'false' if failed
+        ///
+        /// @remark Blocking call
+        //----------------------------------------------------------------------
+        bool listenOnSocket(int socket,
+                            tApplicationServerConstructor* applicationServerConstructor,
+                            bool bVerbose = false, struct timeval* pTimeout = 0);
+
+
+        //----------------------------------------------------------------------
+        /// @brief  Enable the pool of pre-forked workers
+        ///
+        /// @param  nbWorkers               Number of workers (0 to disable
+        ///                                 the pool)
+        /// @param  maxSessionsPerWorker    Maximum number of sessions handled
+        ///                                 by one worker. 0 means 'no limit'
+        /// @param  workerInitializer       Function called by each worker
+        ///                                 right after its creation, used to
+        ///                                 initialize the application server
+        ///                                 implementation ahead of time
+        ///                                 (optional)
+        ///
+        /// @remark Must be called before listen()
+        //----------------------------------------------------------------------
+        void setWorkerPool(unsigned int nbWorkers,
+                           unsigned int maxSessionsPerWorker = 0,
+                           tWorkerInitializer* workerInitializer = 0);
 
         //----------------------------------------------------------------------
         /// @brief  Returns the version of the protocol supported
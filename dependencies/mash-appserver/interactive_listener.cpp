@@ -29,10 +29,14 @@
 #include "interactive_listener.h"
 #include <mash-network/server.h>
 #include <mash-utils/stringutils.h>
+#include <mash-utils/statistics.h>
+#include <mash-utils/tracer.h>
+#include <algorithm>
 #include <sstream>
 #include <iostream>
 #include <sys/stat.h>
 #include <stdlib.h>
+#include <unistd.h>
 #include <assert.h>
 
 
@@ -70,6 +74,11 @@ InteractiveListener::InteractiveListener(int socket)
 
     _timeout = InteractiveListener::timeout;
 
+    // A worker of the pool handles several sessions: the latencies and spans
+    // reported by STATS, TRACE and DONE only cover this one
+    Statistics::reset();
+    Tracer::clear();
+
     _pApplicationServer = pConstructor();
 }
 
@@ -90,6 +99,8 @@ ServerListener::tAction InteractiveListener::handleCommand(
     if (iter != handlers.end())
     {
         tCommandHandler handler = iter->second;
+
+        ScopedLatency latency(Statistics::histogram("command." + strCommand));
         return (this->*handler)(arguments);
     }
 
@@ -116,6 +127,12 @@ void InteractiveListener::onTimeout()
 }
 
 
+bool InteractiveListener::onIdle()
+{
+    return _pApplicationServer->onIdle();
+}
+
+
 /******************************* STATIC METHODS *******************************/
 
 void InteractiveListener::initialize(bool bVerbose,
@@ -124,8 +141,11 @@ void InteractiveListener::initialize(bool bVerbose,
 {
     handlers["STATUS"]                  = &InteractiveListener::handleStatusCommand;
     handlers["INFO"]                    = &InteractiveListener::handleInfoCommand;
+    handlers["PIPELINING"]              = &InteractiveListener::handlePipeliningCommand;
     handlers["DONE"]                    = &InteractiveListener::handleDoneCommand;
     handlers["LOGS"]                    = &InteractiveListener::handleLogsCommand;
+    handlers["STATS"]                   = &InteractiveListener::handleStatsCommand;
+    handlers["TRACE"]                   = &InteractiveListener::handleTraceCommand;
     handlers["SLEEP"]                   = &InteractiveListener::handleSleepCommand;
     handlers["RESET"]                   = &InteractiveListener::handleResetCommand;
     handlers["USE_GLOBAL_SEED"]         = &InteractiveListener::handleUseGlobalSeedCommand;
@@ -139,6 +159,7 @@ void InteractiveListener::initialize(bool bVerbose,
     handlers["GET_TRAJECTORIES_COUNT"]  = &InteractiveListener::handleGetNbTrajectoriesCommand;
     handlers["GET_TRAJECTORY_LENGTH"]   = &InteractiveListener::handleGetTrajectoryLengthCommand;
     handlers["GET_VIEW"]                = &InteractiveListener::handleGetViewCommand;
+    handlers["USE_SHARED_FRAMES"]       = &InteractiveListener::handleUseSharedFramesCommand;
     handlers["ACTION"]                  = &InteractiveListener::handleActionCommand;
 
     InteractiveListener::bVerbose      = bVerbose;
@@ -194,8 +215,31 @@ ServerListener::tAction InteractiveListener::handleInfoCommand(const ArgumentsLi
 }
 
 
+ServerListener::tAction InteractiveListener::handlePipeliningCommand(const ArgumentsList& arguments)
+{
+    if (!sendResponse("PIPELINING", ArgumentsList((int) MAX_PIPELINED_COMMANDS)))
+        return ACTION_CLOSE_CONNECTION;
+
+    return ACTION_NONE;
+}
+
+
 ServerListener::tAction InteractiveListener::handleDoneCommand(const ArgumentsList& arguments)
 {
+    logStatistics();
+
+    // Save the trace of the session (if any)
+    if (Tracer::isEnabled())
+    {
+        string strFileName = Server::strLogFolder + "trace_" +
+                             StringUtils::toString((unsigned int) getpid()) + ".json";
+
+        if (Tracer::write(strFileName))
+            _outStream << "Trace written in '" << strFileName << "'" << endl;
+        else
+            _outStream << "ERROR - Failed to write the trace in '" << strFileName << "'" << endl;
+    }
+
     sendResponse("GOODBYE", ArgumentsList());
     return ACTION_CLOSE_CONNECTION;
 }
@@ -226,6 +270,105 @@ ServerListener::tAction InteractiveListener::handleLogsCommand(const ArgumentsLi
 }
 
 
+ServerListener::tAction InteractiveListener::handleStatsCommand(const ArgumentsList& arguments)
+{
+    // Check the arguments
+    if ((arguments.size() > 1) || ((arguments.size() == 1) && (arguments.getString(0) != "RESET")))
+    {
+        if (!sendResponse("INVALID_ARGUMENTS", arguments))
+            return ACTION_CLOSE_CONNECTION;
+
+        return ACTION_NONE;
+    }
+
+    // Send the statistics of each histogram (in microseconds)
+    const Statistics::tHistogramsList& histograms = Statistics::histograms();
+
+    Statistics::tHistogramsIterator iter, iterEnd;
+    for (iter = histograms.begin(), iterEnd = histograms.end(); iter != iterEnd; ++iter)
+    {
+        const LatencyHistogram* pHistogram = iter->second;
+
+        if (pHistogram->count() == 0)
+            continue;
+
+        ArgumentsList args;
+        args.add(iter->first);
+        args.add(StringUtils::toString((unsigned int) pHistogram->count()));
+        args.add(StringUtils::toString((unsigned int) pHistogram->mean()));
+        args.add(StringUtils::toString((unsigned int) pHistogram->percentile(50.0)));
+        args.add(StringUtils::toString((unsigned int) pHistogram->percentile(90.0)));
+        args.add(StringUtils::toString((unsigned int) pHistogram->percentile(99.0)));
+        args.add(StringUtils::toString((unsigned int) pHistogram->max()));
+
+        if (!sendResponse("STAT", args))
+            return ACTION_CLOSE_CONNECTION;
+    }
+
+    if (arguments.size() == 1)
+        Statistics::reset();
+
+    if (!sendResponse("END_STATS", ArgumentsList()))
+        return ACTION_CLOSE_CONNECTION;
+
+    return ACTION_NONE;
+}
+
+
+ServerListener::tAction InteractiveListener::handleTraceCommand(const ArgumentsList& arguments)
+{
+    // Check the arguments
+    string strAction = (arguments.size() >= 1 ? arguments.getString(0) : "");
+
+    if (((strAction == "START") && (arguments.size() <= 2)) ||
+        ((strAction == "STOP") && (arguments.size() == 1)))
+    {
+        if (strAction == "START")
+        {
+            int capacity = (arguments.size() == 2 ? arguments.getInt(1) : 100000);
+
+            if ((capacity <= 0) || (capacity > (int) Tracer::MAX_CAPACITY))
+            {
+                if (!sendResponse("ERROR", ArgumentsList("Invalid capacity")))
+                    return ACTION_CLOSE_CONNECTION;
+
+                return ACTION_NONE;
+            }
+
+            Tracer::enable((unsigned int) capacity);
+        }
+        else
+        {
+            Tracer::disable();
+        }
+
+        if (!sendResponse("OK", ArgumentsList()))
+            return ACTION_CLOSE_CONNECTION;
+    }
+    else if ((strAction == "DUMP") && (arguments.size() == 1))
+    {
+        string strTrace = Tracer::toJSON();
+
+        ArgumentsList args;
+        args.add("trace.json");
+        args.add((int) strTrace.size());
+
+        if (!sendResponse("TRACE_FILE", args))
+            return ACTION_CLOSE_CONNECTION;
+
+        if (!sendData((const unsigned char*) strTrace.c_str(), strTrace.size()))
+            return ACTION_CLOSE_CONNECTION;
+    }
+    else
+    {
+        if (!sendResponse("INVALID_ARGUMENTS", arguments))
+            return ACTION_CLOSE_CONNECTION;
+    }
+
+    return ACTION_NONE;
+}
+
+
 ServerListener::tAction InteractiveListener::handleSleepCommand(const ArgumentsList& arguments)
 {
     sendResponse("OK", ArgumentsList());
@@ -748,10 +891,62 @@ ServerListener::tAction InteractiveListener::handleGetViewCommand(const Argument
         return ACTION_NONE;
     }
 
-    // Send the view to the client
+    // Write the view directly in a slot of the shared memory segment if
+    // possible (the client must release it once read). If the client is too
+    // slow and no slot is free, the view is sent through the socket.
     size_t data_size = 0;
     string mime_type;
     bool bRaw = false;
+
+    int slot = (_sharedFrames.isOpen() ? _sharedFrames.acquire() : -1);
+    if (slot >= 0)
+    {
+        unsigned char* pSlot = _sharedFrames.data(slot);
+
+        // Leave room for the header of the raw images
+        if (_pApplicationServer->getViewInto(iter->name, pSlot + 8, _sharedFrames.slotSize() - 8,
+                                             data_size, mime_type))
+        {
+            if ((mime_type == "raw") || (mime_type == "image/rgb"))
+            {
+                mime_type = "image/mif";
+                data_size = 8 + 3 * iter->width * iter->height;
+
+                pSlot[0] = 'M';
+                pSlot[1] = 'I';
+                pSlot[2] = 'F';
+                pSlot[3] = 1;
+                pSlot[4] = iter->width % 256;
+                pSlot[5] = iter->width / 256;
+                pSlot[6] = iter->height % 256;
+                pSlot[7] = iter->height / 256;
+            }
+            else
+            {
+                memmove(pSlot, pSlot + 8, data_size);
+            }
+
+            _sharedFrames.publish(slot, data_size);
+
+            ArgumentsList responseArgs;
+            responseArgs.add(iter->name);
+            responseArgs.add(mime_type);
+            responseArgs.add((int) data_size);
+            responseArgs.add(slot);
+
+            if (!sendResponse("VIEW_IN_SLOT", responseArgs))
+                return ACTION_CLOSE_CONNECTION;
+
+            return ACTION_NONE;
+        }
+
+        // The slot is too small, use the socket
+        _sharedFrames.release(slot);
+        data_size = 0;
+        mime_type = "";
+    }
+
+    // Send the view to the client
     unsigned char* pImage = _pApplicationServer->getView(iter->name, data_size, mime_type);
     if (!pImage)
         return ACTION_CLOSE_CONNECTION;
@@ -813,6 +1008,55 @@ ServerListener::tAction InteractiveListener::handleGetViewCommand(const Argument
 }
 
 
+ServerListener::tAction InteractiveListener::handleUseSharedFramesCommand(const ArgumentsList& arguments)
+{
+    // Check the arguments
+    if ((arguments.size() != 1) || (arguments.getInt(0) <= 0) ||
+        (arguments.getInt(0) > MAX_SHARED_FRAMES))
+    {
+        if (!sendResponse("INVALID_ARGUMENTS", arguments))
+            return ACTION_CLOSE_CONNECTION;
+
+        return ACTION_NONE;
+    }
+
+    // Check that a task was selected (the size of the slots depends on the
+    // views)
+    if (_strGoalName.empty() || _strEnvironmentName.empty())
+    {
+        if (!sendResponse("NO_TASK_SELECTED", ArgumentsList()))
+            return ACTION_CLOSE_CONNECTION;
+
+        return ACTION_NONE;
+    }
+
+    // Each slot can hold the biggest view (in raw format, with its header)
+    unsigned int slotSize = 0;
+
+    tViewsIterator iter, iterEnd;
+    for (iter = _views.begin(), iterEnd = _views.end(); iter != iterEnd; ++iter)
+        slotSize = max(slotSize, 8 + 3 * iter->width * iter->height);
+
+    if ((slotSize == 0) || !_sharedFrames.create(arguments.getInt(0), slotSize))
+    {
+        if (!sendResponse("NOT_SUPPORTED", ArgumentsList()))
+            return ACTION_CLOSE_CONNECTION;
+
+        return ACTION_NONE;
+    }
+
+    ArgumentsList responseArgs;
+    responseArgs.add(_sharedFrames.path());
+    responseArgs.add((int) _sharedFrames.nbSlots());
+    responseArgs.add((int) _sharedFrames.slotSize());
+
+    if (!sendResponse("SHARED_FRAMES", responseArgs))
+        return ACTION_CLOSE_CONNECTION;
+
+    return ACTION_NONE;
+}
+
+
 ServerListener::tAction InteractiveListener::handleActionCommand(const ArgumentsList& arguments)
 {
     // Check the arguments
@@ -943,3 +1187,25 @@ void InteractiveListener::chooseGlobalSeed()
         _bGlobalSeedSelected = true;
     }
 }
+
+
+void InteractiveListener::logStatistics()
+{
+    const Statistics::tHistogramsList& histograms = Statistics::histograms();
+
+    Statistics::tHistogramsIterator iter, iterEnd;
+    for (iter = histograms.begin(), iterEnd = histograms.end(); iter != iterEnd; ++iter)
+    {
+        const LatencyHistogram* pHistogram = iter->second;
+
+        if (pHistogram->count() == 0)
+            continue;
+
+        _outStream << "Latency of '" << iter->first << "' (" << pHistogram->count()
+                   << " sample(s), in us): mean=" << pHistogram->mean()
+                   << ", p50=" << pHistogram->percentile(50.0)
+                   << ", p90=" << pHistogram->percentile(90.0)
+                   << ", p99=" << pHistogram->percentile(99.0)
+                   << ", max=" << pHistogram->max() << endl;
+    }
+}
@@ -31,6 +31,7 @@
 
 #include "application_server_interface.h"
 #include <mash-network/server_listener.h>
+#include <mash-network/shared_frames.h>
 #include <mash-utils/declarations.h>
 #include <map>
 
@@ -58,6 +59,8 @@ namespace Mash
 
         virtual void onTimeout();
 
+        virtual bool onIdle();
+
 
         //_____ Static methods __________
     public:
@@ -71,8 +74,11 @@ namespace Mash
     private:
         tAction handleStatusCommand(const Mash::ArgumentsList& arguments);
         tAction handleInfoCommand(const Mash::ArgumentsList& arguments);
+        tAction handlePipeliningCommand(const Mash::ArgumentsList& arguments);
         tAction handleDoneCommand(const Mash::ArgumentsList& arguments);
         tAction handleLogsCommand(const Mash::ArgumentsList& arguments);
+        tAction handleStatsCommand(const Mash::ArgumentsList& arguments);
+        tAction handleTraceCommand(const Mash::ArgumentsList& arguments);
         tAction handleSleepCommand(const Mash::ArgumentsList& arguments);
         tAction handleResetCommand(const Mash::ArgumentsList& arguments);
         tAction handleUseGlobalSeedCommand(const Mash::ArgumentsList& arguments);
@@ -86,9 +92,11 @@ namespace Mash
         tAction handleGetNbTrajectoriesCommand(const Mash::ArgumentsList& arguments);
         tAction handleGetTrajectoryLengthCommand(const Mash::ArgumentsList& arguments);
         tAction handleGetViewCommand(const Mash::ArgumentsList& arguments);
+        tAction handleUseSharedFramesCommand(const Mash::ArgumentsList& arguments);
         tAction handleActionCommand(const Mash::ArgumentsList& arguments);
 
         void chooseGlobalSeed();
+        void logStatistics();
 
 
         //_____ Internal types __________
@@ -99,6 +107,11 @@ namespace Mash
         typedef tCommandHandlersList::iterator          tCommandHandlersIterator;
 
 
+        //_____ Constants __________
+    private:
+        static const int MAX_SHARED_FRAMES = 64;
+
+
         //_____ Attributes __________
     private:
         static tCommandHandlersList             handlers;
@@ -115,6 +128,7 @@ namespace Mash
         tStringList                     _actions;
         tViewsList                      _views;
         tIASCapabilities                _capabilities;
+        Mash::SharedFrames              _sharedFrames;
     };
 
 
@@ -28,9 +28,11 @@
 
 #include "client.h"
 #include "networkutils.h"
+#include "server_listener.h"
 #include <mash-utils/stringutils.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/un.h>
 #include <netinet/in.h>
 #include <netdb.h>
 #include <arpa/inet.h>
@@ -45,7 +47,8 @@ using namespace Mash;
 /************************* CONSTRUCTION / DESTRUCTION *************************/
 
 Client::Client(OutStream* pOutStream)
-: _socket(-1)
+: _socket(-1), _nbPendingCommands(0),
+  _maxPipelinedCommands(ServerListener::MAX_PIPELINED_COMMANDS)
 {
     if (pOutStream)
         _outStream = *pOutStream;
@@ -119,26 +122,141 @@ bool Client::connect(const std::string& strAddress, unsigned int port)
 
     freeaddrinfo(servinfo);
 
+    NetworkUtils::disableNagle(_socket);
+
+    _buffer.reset();
+    _pipeline.clear();
+    _nbPendingCommands = 0;
+
+    return true;
+}
+
+
+bool Client::connectUnix(const std::string& strPath)
+{
+    // Assertions
+    assert(!strPath.empty());
+
+    // Declarations
+    struct sockaddr_un address;
+
+    _outStream << "Trying to establish a connection to '" << strPath << "'" << endl;
+
+    if (strPath.size() >= sizeof(address.sun_path))
+    {
+        _outStream << "ERROR - The path of the Unix socket is too long" << endl;
+        return false;
+    }
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, strPath.c_str(), sizeof(address.sun_path) - 1);
+
+    if ((_socket = socket(AF_UNIX, SOCK_STREAM, 0)) == -1)
+    {
+        _outStream << "ERROR - Failed to create a socket" << endl;
+        return false;
+    }
+
+    if (::connect(_socket, (struct sockaddr*) &address, sizeof(address)) == -1)
+    {
+        ::close(_socket);
+        _socket = -1;
+
+        _outStream << "ERROR - Failed to establish a connection with the server" << endl;
+        return false;
+    }
+
+    _outStream << "Connection established with the server at '" << strPath << "'" << endl;
+
     _buffer.reset();
+    _pipeline.clear();
+    _nbPendingCommands = 0;
 
     return true;
 }
 
 
+void Client::attach(int socket)
+{
+    // Assertions
+    assert(socket >= 0);
+
+    _socket = socket;
+
+    if (NetworkUtils::isTcpSocket(_socket))
+        NetworkUtils::disableNagle(_socket);
+
+    _buffer.reset();
+    _pipeline.clear();
+    _nbPendingCommands = 0;
+}
+
+
 bool Client::sendCommand(const std::string& strCommand,
                          const ArgumentsList& arguments)
 {
-    _outStream << "> " << strCommand;
+    if (_outStream.isEnabled())
+    {
+        _outStream << "> " << strCommand;
 
-    for (unsigned int i = 0; i < arguments.size(); ++i)
-        _outStream << " " << arguments.getString(i);
+        for (unsigned int i = 0; i < arguments.size(); ++i)
+            _outStream << " " << arguments.getString(i);
 
-    _outStream << endl;
+        _outStream << endl;
+    }
 
     return NetworkUtils::sendMessage(_socket, strCommand, arguments);
 }
 
 
+bool Client::pipelineCommand(const std::string& strCommand,
+                             const ArgumentsList& arguments)
+{
+    if (_nbPendingCommands >= _maxPipelinedCommands)
+    {
+        _outStream << "ERROR - Too many pipelined commands" << endl;
+        return false;
+    }
+
+    if (_outStream.isEnabled())
+    {
+        _outStream << "> " << strCommand;
+
+        for (unsigned int i = 0; i < arguments.size(); ++i)
+            _outStream << " " << arguments.getString(i);
+
+        _outStream << " (pipelined)" << endl;
+    }
+
+    NetworkUtils::encodeMessage(strCommand, arguments, &_pipeline);
+    ++_nbPendingCommands;
+
+    return true;
+}
+
+
+bool Client::flush()
+{
+    if (_pipeline.empty())
+        return true;
+
+    bool bResult = NetworkUtils::sendData(_socket, (const unsigned char*) _pipeline.c_str(),
+                                          _pipeline.size());
+
+    _pipeline.clear();
+
+    return bResult;
+}
+
+
+void Client::commandCompleted()
+{
+    if (_nbPendingCommands > 0)
+        --_nbPendingCommands;
+}
+
+
 bool Client::sendData(const unsigned char* data, int size)
 {
     _outStream << "> <" << size << " bytes of data>" << endl;
@@ -149,9 +267,13 @@ bool Client::sendData(const unsigned char* data, int size)
 
 bool Client::waitResponse(std::string* strResponse, ArgumentsList* arguments)
 {
+    // The responses of the pipelined commands can't arrive before they are sent
+    if (!_pipeline.empty() && !flush())
+        return false;
+
     bool bResult = NetworkUtils::waitMessage(_socket, &_buffer, strResponse, arguments);
 
-    if (bResult)
+    if (bResult && _outStream.isEnabled())
     {
         _outStream << "< " << strResponse->c_str();
 
@@ -180,4 +302,7 @@ void Client::close()
 {
     ::close(_socket);
     _socket = -1;
+
+    _pipeline.clear();
+    _nbPendingCommands = 0;
 }
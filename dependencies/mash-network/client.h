@@ -41,6 +41,10 @@ namespace Mash
     ///
     /// The client sends commands to the server, which sends responses back. The
     /// server never spontaneously sends data to the client.
+    ///
+    /// The commands can be pipelined: several commands are sent together, and
+    /// the responses are read afterwards, in the same order (see
+    /// ServerListener for the guarantees offered by the server).
     //--------------------------------------------------------------------------
     class MASH_SYMBOL Client
     {
@@ -71,6 +75,23 @@ namespace Mash
         //----------------------------------------------------------------------
         bool connect(const std::string& strAddress, unsigned int port);
 
+        //----------------------------------------------------------------------
+        /// @brief  Initiate a connection to a server listening on a Unix domain
+        ///         socket
+        ///
+        /// @param  strPath     Path of the socket
+        /// @return             'false' if failed
+        //----------------------------------------------------------------------
+        bool connectUnix(const std::string& strPath);
+
+        //----------------------------------------------------------------------
+        /// @brief  Use a socket already connected to a server (like one end of
+        ///         a socketpair given to a server started with '--fd')
+        ///
+        /// @param  socket      The socket (closed by close())
+        //----------------------------------------------------------------------
+        void attach(int socket);
+
         //----------------------------------------------------------------------
         /// @brief  Send a command to the server
         ///
@@ -93,6 +114,64 @@ namespace Mash
         //----------------------------------------------------------------------
         bool sendData(const unsigned char* data, int size);
 
+        //----------------------------------------------------------------------
+        /// @brief  Add a command to the pipeline, without waiting for the
+        ///         responses to the previous commands
+        ///
+        /// The pipelined commands are sent together by flush() (or by the
+        /// next call to waitResponse()). All the responses of each command
+        /// must then be read in order, and commandCompleted() must be called
+        /// after the last one.
+        /// @param  strCommand  The command
+        /// @param  arguments   The arguments of the command
+        /// @return             'false' if the maximum number of commands
+        ///                     without a complete response is reached
+        //----------------------------------------------------------------------
+        bool pipelineCommand(const std::string& strCommand,
+                             const ArgumentsList& arguments);
+
+        //----------------------------------------------------------------------
+        /// @brief  Send the pipelined commands to the server (with one system
+        ///         call)
+        ///
+        /// @return 'false' if failed
+        //----------------------------------------------------------------------
+        bool flush();
+
+        //----------------------------------------------------------------------
+        /// @brief  Indicates that all the responses to the oldest pipelined
+        ///         command were read
+        //----------------------------------------------------------------------
+        void commandCompleted();
+
+        //----------------------------------------------------------------------
+        /// @brief  Returns the number of pipelined commands without a
+        ///         complete response
+        //----------------------------------------------------------------------
+        inline unsigned int nbPendingCommands() const
+        {
+            return _nbPendingCommands;
+        }
+
+        //----------------------------------------------------------------------
+        /// @brief  Set the maximum number of pipelined commands without a
+        ///         complete response (by default:
+        ///         ServerListener::MAX_PIPELINED_COMMANDS)
+        //----------------------------------------------------------------------
+        inline void setMaxPipelinedCommands(unsigned int max)
+        {
+            _maxPipelinedCommands = (max > 0 ? max : 1);
+        }
+
+        //----------------------------------------------------------------------
+        /// @brief  Returns the maximum number of pipelined commands without a
+        ///         complete response
+        //----------------------------------------------------------------------
+        inline unsigned int maxPipelinedCommands() const
+        {
+            return _maxPipelinedCommands;
+        }
+
         //----------------------------------------------------------------------
         /// @brief  Wait for a response from the server
         ///
@@ -121,9 +200,12 @@ namespace Mash
 
         //_____ Attributes __________
     private:
-        int         _socket;
-        DataBuffer  _buffer;
-        OutStream   _outStream;
+        int             _socket;
+        DataBuffer      _buffer;
+        OutStream       _outStream;
+        std::string     _pipeline;              ///< The commands not sent yet
+        unsigned int    _nbPendingCommands;
+        unsigned int    _maxPipelinedCommands;
     };
 }
 
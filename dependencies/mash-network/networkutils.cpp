@@ -28,6 +28,8 @@
 
 #include "networkutils.h"
 #include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
 #include <memory.h>
 #include <assert.h>
 #include <iostream>
@@ -55,13 +57,24 @@ bool NetworkUtils::sendMessage(int socket, const std::string& strMessage,
     assert(socket >= 0);
     assert(!strMessage.empty());
 
-    // Declarations
-    int total;
-    int bytesleft;
-    const char* pSrc;
-
     // Build the line that will be sent
-    string data = strMessage;
+    string data;
+    encodeMessage(strMessage, arguments, &data);
+
+    // Send the response to the client
+    return sendData(socket, (const unsigned char*) data.c_str(), data.length());
+}
+
+
+void NetworkUtils::encodeMessage(const std::string& strMessage,
+                                 const ArgumentsList& arguments, std::string* pDest)
+{
+    // Assertions
+    assert(!strMessage.empty());
+    assert(pDest);
+
+    pDest->append(strMessage);
+
     for (int i = 0; i < arguments.size(); ++i)
     {
         string arg = arguments.getString(i);
@@ -77,31 +90,11 @@ bool NetworkUtils::sendMessage(int socket, const std::string& strMessage,
         if (bMustQuote || (arg.find(' ') != string::npos))
             arg = "'" + arg + "'";
 
-        data += " " + arg;
+        pDest->append(" ");
+        pDest->append(arg);
     }
-    data += "\n";
-    pSrc = data.c_str();
 
-    // Send the response to the client
-    total = 0;
-    bytesleft = data.length();
-    while (total < data.length())
-    {
-        errno = 0;
-        int n = send(socket, pSrc + total, bytesleft, 0);
-        if (n == -1)
-        {
-            if (errno == EINTR)
-                continue;
-
-            return false;
-        }
-
-        total += n;
-        bytesleft -= n;
-    }
-
-    return true;
+    pDest->append("\n");
 }
 
 
@@ -149,10 +142,11 @@ bool NetworkUtils::waitMessage(int socket, DataBuffer* pBuffer,
     assert(strMessage);
     assert(arguments);
 
-    const int MAXDATASIZE = 256;
+    // Read as much data as possible at once (several pipelined messages can be
+    // received by a single call)
+    const int READ_SIZE = 64 * 1024;
 
     // Declarations
-    char buf[MAXDATASIZE];
     fd_set readfds;
     int nbBytes;
 
@@ -179,11 +173,10 @@ bool NetworkUtils::waitMessage(int socket, DataBuffer* pBuffer,
 
         if (FD_ISSET(socket, &readfds))
         {
-            nbBytes = recv(socket, buf, MAXDATASIZE - 1, 0);
+            nbBytes = recv(socket, pBuffer->reserve(READ_SIZE), READ_SIZE, 0);
             if (nbBytes > 0)
             {
-                buf[nbBytes] = 0;
-                pBuffer->add((const unsigned char*) buf, nbBytes);
+                pBuffer->commit(nbBytes);
 
                 if (pBuffer->extractMessage(strMessage, arguments))
                     return true;
@@ -261,3 +254,61 @@ bool NetworkUtils::waitData(int socket, DataBuffer* pBuffer, unsigned char* data
         }
     }
 }
+
+
+bool NetworkUtils::isTcpSocket(int socket)
+{
+    // Assertions
+    assert(socket >= 0);
+
+    struct sockaddr_storage address;
+    socklen_t size = sizeof(address);
+
+    if (getsockname(socket, (struct sockaddr*) &address, &size) == -1)
+        return false;
+
+    return (address.ss_family == AF_INET) || (address.ss_family == AF_INET6);
+}
+
+
+bool NetworkUtils::hasPendingData(int socket)
+{
+    // Assertions
+    assert(socket >= 0);
+
+    struct pollfd fd;
+    fd.fd = socket;
+    fd.events = POLLIN;
+    fd.revents = 0;
+
+    // A closed connection is reported as readable too
+    return (poll(&fd, 1, 0) > 0);
+}
+
+
+void NetworkUtils::disableNagle(int socket)
+{
+    // Assertions
+    assert(socket >= 0);
+
+    // Fails silently on the sockets that aren't using TCP
+    int yes = 1;
+    setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+}
+
+
+void NetworkUtils::cork(int socket, bool bCorked)
+{
+    // Assertions
+    assert(socket >= 0);
+
+    // While corked, the data sent is accumulated by the kernel, and sent in
+    // as few packets as possible once uncorked
+#ifdef TCP_CORK
+    int value = (bCorked ? 1 : 0);
+    setsockopt(socket, IPPROTO_TCP, TCP_CORK, &value, sizeof(value));
+#elif defined(TCP_NOPUSH)
+    int value = (bCorked ? 1 : 0);
+    setsockopt(socket, IPPROTO_TCP, TCP_NOPUSH, &value, sizeof(value));
+#endif
+}
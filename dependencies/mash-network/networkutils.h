@@ -47,6 +47,9 @@ namespace Mash
         static bool sendMessage(int socket, const std::string& strMessage,
                                 const ArgumentsList& arguments);
 
+        static void encodeMessage(const std::string& strMessage,
+                                  const ArgumentsList& arguments, std::string* pDest);
+
         static bool sendData(int socket, const unsigned char* data, int size);
 
         static bool waitMessage(int socket, DataBuffer* pBuffer,
@@ -54,6 +57,14 @@ namespace Mash
                                 struct timeval* pTimeout = 0);
 
         static bool waitData(int socket, DataBuffer* pBuffer, unsigned char* data, int size);
+
+        static bool isTcpSocket(int socket);
+
+        static bool hasPendingData(int socket);
+
+        static void disableNagle(int socket);
+
+        static void cork(int socket, bool bCorked);
     };
 }
 
@@ -31,7 +31,13 @@
 #include "busy_listener.h"
 #include <mash-utils/stringutils.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
 #include <sys/wait.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
 #include <netdb.h>
 #include <arpa/inet.h>
 #include <signal.h>
@@ -40,16 +46,41 @@
 #include <memory.h>
 #include <stdlib.h>
 #include <assert.h>
+#include <errno.h>
 
 using namespace std;
 using namespace Mash;
 
 
+/********************************** CONSTANTS *********************************/
+
+// Maximum length of the queue of pending connections (silently truncated by
+// the kernel to the value of /proc/sys/net/core/somaxconn)
+const int LISTEN_BACKLOG = 4096;
+
+// Maximum number of events retrieved at once
+const int MAX_EVENTS = 64;
+
+// Exit status of a process whose listener received a 'SLEEP' command
+const int EXIT_STATUS_SLEEP = 3;
+
+
 /********************************** FUNCTIONS *********************************/
 
-void sigchld_handler(int s)
+static unsigned int elapsedMicroseconds(const struct timeval& start, const struct timeval& end)
+{
+    return (unsigned int) ((end.tv_sec - start.tv_sec) * 1000000 + (end.tv_usec - start.tv_usec));
+}
+
+
+// The pending responses are still sent when the socket of a client is closed
+// (for at most 100 seconds)
+static void enableLinger(int socket)
 {
-    while (waitpid(-1, NULL, WNOHANG) > 0);
+    struct linger lingerOpt;
+    lingerOpt.l_onoff = 1;
+    lingerOpt.l_linger = 100;
+    setsockopt(socket, SOL_SOCKET, SO_LINGER, &lingerOpt, sizeof(lingerOpt));
 }
 
 
@@ -62,7 +93,9 @@ string Server::strLogFolder = "logs/";
 
 Server::Server(unsigned int nbMaxClients, unsigned int logLimit,
                const std::string& strName)
-: _state(STATE_NORMAL), _nbMaxClients(nbMaxClients), _logLimit(logLimit)
+: _state(STATE_NORMAL), _nbMaxClients(nbMaxClients), _logLimit(logLimit),
+  _epoll(-1), _signals(-1), _nbWorkers(0), _maxSessionsPerWorker(0),
+  _workerInitializer(0), _pSleepFlag(0), _overflowProcess(0)
 {
     _outStream.open(strName, strLogFolder + strName + "-$TIMESTAMP.log", 200 * 1024);
 }
@@ -70,6 +103,9 @@ Server::Server(unsigned int nbMaxClients, unsigned int logLimit,
 
 Server::~Server()
 {
+    // Remove the Unix socket
+    if (!_strUnixPath.empty())
+        unlink(_strUnixPath.c_str());
 }
 
 
@@ -84,23 +120,15 @@ bool Server::listen(const std::string& host, unsigned int port,
     // Declarations
     int listen_socket;
     struct addrinfo hints, *servinfo, *p;
-    struct sockaddr_storage their_addr; // connector's address information
-    socklen_t sin_size;
-    struct sigaction sa;
     int yes = 1;
-    char s[INET6_ADDRSTRLEN];
     int rv;
-    unsigned int clients_counter = 0;
 
     if (!host.empty())
-        _outStream << "Start to listen for incoming connections on '" << host << ":" << port << "'" << endl;
+        _strAddress = "on '" + host + ":" + StringUtils::toString(port) + "'";
     else
-        _outStream << "Start to listen for incoming connections on port " << port << endl;
+        _strAddress = "on port " + StringUtils::toString(port);
 
-    if (_nbMaxClients > 0)
-        _outStream << "This server only supports " << _nbMaxClients << " client(s) at the same time" << endl;
-    else
-        _outStream << "This server supports an unlimited amount of clients" << endl;
+    logAddress("Start to listen for incoming connections");
 
     // Retrieve a list of our addresses
     memset(&hints, 0, sizeof hints);
@@ -117,7 +145,7 @@ bool Server::listen(const std::string& host, unsigned int port,
     // Loop through all the results and bind to the first we can
     for (p = servinfo; p != NULL; p = p->ai_next)
     {
-        if ((listen_socket = socket(p->ai_family, p->ai_socktype, p->ai_protocol)) == -1)
+        if ((listen_socket = socket(p->ai_family, p->ai_socktype | SOCK_CLOEXEC, p->ai_protocol)) == -1)
         {
             _outStream << "ERROR - Failed to create a socket" << endl;
             continue;
@@ -125,6 +153,8 @@ bool Server::listen(const std::string& host, unsigned int port,
 
         if (setsockopt(listen_socket, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(int)) == -1)
         {
+            close(listen_socket);
+            freeaddrinfo(servinfo);
             _outStream << "ERROR - Failed to set the socket options" << endl;
             return false;
         }
@@ -139,66 +169,198 @@ bool Server::listen(const std::string& host, unsigned int port,
         break;
     }
 
+    freeaddrinfo(servinfo);
+
     if (p == NULL)
     {
         _outStream << "ERROR - Failed to create the socket of the server" << endl;
         return false;
     }
 
-    freeaddrinfo(servinfo);
 
+    // Start listening
+    if (::listen(listen_socket, LISTEN_BACKLOG) == -1)
+    {
+        close(listen_socket);
+        _outStream << "ERROR - Failed to listen for incoming connections" << endl;
+        return false;
+    }
+
+    return run(listen_socket, listenerConstructor);
+}
+
+
+bool Server::listenUnix(const std::string& strPath,
+                        tServerListenerConstructor* listenerConstructor)
+{
+    // Assertions
+    assert(!strPath.empty());
+    assert(listenerConstructor);
+
+    // Declarations
+    int listen_socket;
+    struct sockaddr_un address;
+    struct stat infos;
+
+    _strAddress = "on the Unix socket '" + strPath + "'";
+
+    logAddress("Start to listen for incoming connections");
+
+    if (strPath.size() >= sizeof(address.sun_path))
+    {
+        _outStream << "ERROR - The path of the Unix socket is too long" << endl;
+        return false;
+    }
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, strPath.c_str(), sizeof(address.sun_path) - 1);
+
+    if ((listen_socket = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) == -1)
+    {
+        _outStream << "ERROR - Failed to create a socket" << endl;
+        return false;
+    }
+
+    // Remove the socket left by a previous instance of the server (but nothing
+    // else)
+    if ((lstat(strPath.c_str(), &infos) == 0) && S_ISSOCK(infos.st_mode))
+        unlink(strPath.c_str());
+
+    if (bind(listen_socket, (struct sockaddr*) &address, sizeof(address)) == -1)
+    {
+        close(listen_socket);
+        _outStream << "ERROR - Failed to bind the socket" << endl;
+        return false;
+    }
 
     // Start listening
-    if (::listen(listen_socket, 10) == -1)
+    if (::listen(listen_socket, LISTEN_BACKLOG) == -1)
     {
+        close(listen_socket);
+        unlink(strPath.c_str());
         _outStream << "ERROR - Failed to listen for incoming connections" << endl;
         return false;
     }
 
-    // Reap all dead processes
-    sa.sa_handler = sigchld_handler;
-    sigemptyset(&sa.sa_mask);
-    sa.sa_flags = SA_RESTART;
-    if (sigaction(SIGCHLD, &sa, NULL) == -1)
+    _strUnixPath = strPath;
+
+    return run(listen_socket, listenerConstructor);
+}
+
+
+bool Server::listenOnSocket(int socket,
+                            tServerListenerConstructor* listenerConstructor)
+{
+    // Assertions
+    assert(socket >= 0);
+    assert(listenerConstructor);
+
+    // Declarations
+    int listening = 0;
+    socklen_t size = sizeof(listening);
+
+    if (getsockopt(socket, SOL_SOCKET, SO_ACCEPTCONN, &listening, &size) == -1)
     {
-        _outStream << "ERROR - Failed to setup the dead processes destruction mecanism" << endl;
+        _outStream << "ERROR - The file descriptor " << socket << " isn't a valid socket" << endl;
         return false;
     }
 
-    while (true)
+    // Don't leak the socket in the processes that might be executed later
+    fcntl(socket, F_SETFD, fcntl(socket, F_GETFD) | FD_CLOEXEC);
+
+    _strAddress = "on the file descriptor " + StringUtils::toString(socket);
+
+    // Listening socket: handle the incoming connections as usual
+    if (listening)
     {
-        // Delete the log file and starts a new one when the limit is reached
-        if ((clients_counter >= _logLimit) && _pipesList.empty())
-        {
-            _outStream << "--------------------------------------------------------------------------------" << endl;
+        logAddress("Start to listen for incoming connections");
+        return run(socket, listenerConstructor);
+    }
 
-            string strLogName = _outStream.getName();
-            string strLogFileName = _outStream.getFileName();
+    // Connected socket (for instance one end of a socketpair): handle that
+    // connection only, in this process
+    _outStream << "Handle the connection " << _strAddress << endl;
 
-            _outStream.deleteFile();
-            _outStream.open(strLogName, strLogFileName);
+    int flags = fcntl(socket, F_GETFL, 0);
+    fcntl(socket, F_SETFL, flags & ~O_NONBLOCK);
 
-            time_t t;
-            struct tm* timeinfo;
-            char buffer[20];
+    ServerListener* pListener = listenerConstructor(socket);
 
-            time(&t);
-            timeinfo = localtime(&t);
+    pListener->process();
 
-            strftime(buffer, 20, "%d/%m/%Y %H:%M:%S", timeinfo);
+    delete pListener;
 
-            _outStream << "Reset of the log file: " << buffer << endl;
+    close(socket);
 
-            if (!host.empty())
-                _outStream << "Listen for incoming connections on '" << host << ":" << port << "'" << endl;
-            else
-                _outStream << "Listen for incoming connections on port " << port << endl;
+    _outStream << "The client is done" << endl;
 
-            if (_nbMaxClients > 0)
-                _outStream << "This server only supports " << _nbMaxClients << " client(s) at the same time" << endl;
-            else
-                _outStream << "This server supports an unlimited amount of clients" << endl;
+    return true;
+}
+
+
+bool Server::run(int listen_socket, tServerListenerConstructor* listenerConstructor)
+{
+    // Assertions
+    assert(listen_socket >= 0);
+    assert(listenerConstructor);
+
+    // Declarations
+    sigset_t mask;
+    unsigned int clients_counter = 0;
+
+    // The dead processes are reaped when the server is notified through a
+    // file descriptor (instead of a signal handler)
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+
+    if (sigprocmask(SIG_BLOCK, &mask, NULL) == -1)
+    {
+        _outStream << "ERROR - Failed to setup the dead processes destruction mecanism" << endl;
+        return false;
+    }
+
+    _signals = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (_signals == -1)
+    {
+        _outStream << "ERROR - Failed to setup the dead processes destruction mecanism" << endl;
+        return false;
+    }
+
+    _epoll = epoll_create1(EPOLL_CLOEXEC);
+    if (_epoll == -1)
+    {
+        _outStream << "ERROR - Failed to create the epoll instance" << endl;
+        return false;
+    }
+
+    if (!watch(_signals))
+        return false;
+
+    // Use the pool of workers if requested (the classic mode takes over when
+    // the server goes to sleep)
+    if (_nbWorkers > 0)
+    {
+        if (!runWorkerPool(listen_socket, listenerConstructor))
+        {
+            close(listen_socket);
+            return false;
+        }
+    }
+
+    // All the pending connections are accepted at once when notified
+    int flags = fcntl(listen_socket, F_GETFL, 0);
+    fcntl(listen_socket, F_SETFL, flags | O_NONBLOCK);
 
+    if (!watch(listen_socket))
+        return false;
+
+    while (true)
+    {
+        // Delete the log file and starts a new one when the limit is reached
+        if ((clients_counter >= _logLimit) && _clientsList.empty())
+        {
+            resetLogFile();
             clients_counter = 0;
         }
 
@@ -208,111 +370,127 @@ bool Server::listen(const std::string& host, unsigned int port,
 
 
         // Wait for some events
-        fd_set readfds;
-        std::vector<int>::iterator iter, iterEnd;
-        int max = 0;
+        struct epoll_event events[MAX_EVENTS];
+
+        int nb = epoll_wait(_epoll, events, MAX_EVENTS, -1);
+        if (nb <= 0)
+            continue;
 
-        FD_ZERO(&readfds);
-        for (iter = _pipesList.begin(), iterEnd = _pipesList.end(); iter != iterEnd; ++iter)
+        for (int i = 0; i < nb; ++i)
         {
-            FD_SET(*iter, &readfds);
+            // Process the events coming from the listeners
+            if (events[i].data.fd == _signals)
+                reapClients();
 
-            if (*iter > max)
-                max = *iter;
+            // Process the incoming connections
+            else if (events[i].data.fd == listen_socket)
+                clients_counter += acceptClients(listen_socket, listenerConstructor);
         }
+    }
 
-        FD_SET(listen_socket, &readfds);
+    close(listen_socket);
+    clearClientsList();
 
-        if (listen_socket > max)
-            max = listen_socket;
+    return true;
+}
 
-        int nb = 0;
-        while (nb <= 0)
-            nb = select(max + 1, &readfds, 0, 0, 0);
 
-        // Process the events coming from the listeners
-        std::vector<int> tmp = _pipesList;
-        _pipesList.clear();
+void Server::setWorkerPool(unsigned int nbWorkers, unsigned int maxSessionsPerWorker,
+                           tWorkerInitializer* workerInitializer)
+{
+    _nbWorkers              = nbWorkers;
+    _maxSessionsPerWorker   = maxSessionsPerWorker;
+    _workerInitializer      = workerInitializer;
 
-        for (iter = tmp.begin(), iterEnd = tmp.end(); iter != iterEnd; ++iter)
-        {
-            if (FD_ISSET(*iter, &readfds))
-            {
-                char buffer[6] = { 0 };
-                ssize_t count = read(*iter, buffer, 6);
+    // The workers replace the maximum number of clients
+    if (nbWorkers > 0)
+        _nbMaxClients = nbWorkers;
+}
 
-                if (strcmp("SLEEP", buffer) == 0)
-                {
-                    _outStream << "Going to sleep..." << endl;
-                    _state = STATE_GOING_TO_SLEEP;
-                }
 
-                close(*iter);
-            }
-            else
-            {
-                _pipesList.push_back(*iter);
-            }
-        }
+bool Server::watch(int fd)
+{
+    struct epoll_event event;
 
-        if (tmp.size() != _pipesList.size())
-        {
-            unsigned int diff = tmp.size() - _pipesList.size();
-            if (diff > 1)
-                _outStream << diff << " client(s) are done" << endl;
-            else
-                _outStream << "One client is done" << endl;
-        }
+    event.events = EPOLLIN | EPOLLET;
+    event.data.fd = fd;
 
-        if ((_state == STATE_GOING_TO_SLEEP) && _pipesList.empty())
-        {
-            _outStream << "Sleeping..." << endl;
-            _state = STATE_SLEEPING;
-        }
+    if (epoll_ctl(_epoll, EPOLL_CTL_ADD, fd, &event) == -1)
+    {
+        _outStream << "ERROR - Failed to watch a file descriptor" << endl;
+        return false;
+    }
 
-        // Process the incoming connections
-        if (!FD_ISSET(listen_socket, &readfds))
-            continue;
+    return true;
+}
+
+
+unsigned int Server::acceptClients(int listen_socket,
+                                   tServerListenerConstructor* listenerConstructor)
+{
+    // Assertions
+    assert(listenerConstructor);
 
-        ++clients_counter;
+    // Declarations
+    struct sockaddr_storage their_addr; // connector's address information
+    socklen_t sin_size;
+    char s[INET6_ADDRSTRLEN];
+    unsigned int nbAccepted = 0;
 
+    while (true)
+    {
+        // The sockets of the clients stay in blocking mode, since that's what
+        // the listeners expect
         sin_size = sizeof(their_addr);
-        int child_socket = accept(listen_socket, (struct sockaddr*) &their_addr, &sin_size);
+        int child_socket = accept4(listen_socket, (struct sockaddr*) &their_addr, &sin_size, SOCK_CLOEXEC);
         if (child_socket == -1)
         {
-            _outStream << "ERROR - Failed to accept an incoming connection" << endl;
-            continue;
+            if (errno == EINTR)
+                continue;
+
+            if ((errno != EAGAIN) && (errno != EWOULDBLOCK))
+                _outStream << "ERROR - Failed to accept an incoming connection" << endl;
+
+            break;
         }
 
-        inet_ntop(their_addr.ss_family, NetworkUtils::getNetworkAddress((struct sockaddr*) &their_addr),
-                  s, sizeof(s));
+        ++nbAccepted;
 
-        if (their_addr.ss_family == AF_INET)
-            _outStream << "Incoming connection from " << s << ":" << ((struct sockaddr_in*) &their_addr)->sin_port << endl;
+        if (their_addr.ss_family == AF_UNIX)
+        {
+            _outStream << "Incoming local connection" << endl;
+        }
         else
-            _outStream << "Incoming connection from " << s << ":" << ((struct sockaddr_in6*) &their_addr)->sin6_port << endl;
+        {
+            inet_ntop(their_addr.ss_family, NetworkUtils::getNetworkAddress((struct sockaddr*) &their_addr),
+                      s, sizeof(s));
+
+            if (their_addr.ss_family == AF_INET)
+                _outStream << "Incoming connection from " << s << ":" << ((struct sockaddr_in*) &their_addr)->sin_port << endl;
+            else
+                _outStream << "Incoming connection from " << s << ":" << ((struct sockaddr_in6*) &their_addr)->sin6_port << endl;
+        }
 
 
         // Determine if we can handle this client
         bool bBusy = false;
-        int serverPipe, listenerPipe;
         if (_state == STATE_SLEEPING)
         {
             bBusy = true;
-            unsigned int nb = (unsigned int) _pipesList.size() + 1;
+            unsigned int nb = (unsigned int) _clientsList.size() + 1;
             _outStream << "The server is sleeping, there is currently " << nb << " clients connected" << endl;
         }
         else if (_state == STATE_GOING_TO_SLEEP)
         {
             bBusy = true;
-            unsigned int nb = (unsigned int) _pipesList.size() + 1;
+            unsigned int nb = (unsigned int) _clientsList.size() + 1;
             _outStream << "The server is going to sleep, there is still " << nb << " clients connected" << endl;
         }
         else if (_nbMaxClients > 0)
         {
-            bBusy = (_pipesList.size() >= _nbMaxClients);
+            bBusy = (_clientsList.size() >= _nbMaxClients);
 
-            unsigned int nb = (unsigned int) _pipesList.size();
+            unsigned int nb = (unsigned int) _clientsList.size();
 
             if (bBusy)
                 _outStream << "The server is busy (" << nb << "/" << _nbMaxClients << " client(s) connected)" << endl;
@@ -321,23 +499,27 @@ bool Server::listen(const std::string& host, unsigned int port,
         }
         else
         {
-            unsigned int nb = (unsigned int) _pipesList.size() + 1;
+            unsigned int nb = (unsigned int) _clientsList.size() + 1;
             _outStream << "There is currently " << nb << " clients connected" << endl;
         }
 
-        addClient(&serverPipe, &listenerPipe);
 
+        pid_t pid = fork();
+        if (pid == -1)
+        {
+            _outStream << "ERROR - Failed to fork a process to handle the client" << endl;
+            close(child_socket);
+            continue;
+        }
 
-        if (!fork())
+        if (pid == 0)
         {
             // This is the child process
             close(listen_socket);
             clearClientsList();
+            leaveEventLoop();
 
-            struct linger lingerOpt;
-            lingerOpt.l_onoff = 1;
-            lingerOpt.l_onoff = 100;
-            setsockopt(child_socket, SOL_SOCKET, SO_LINGER, &lingerOpt, sizeof(lingerOpt));
+            enableLinger(child_socket);
 
             ServerListener* pListener;
 
@@ -352,54 +534,592 @@ bool Server::listen(const std::string& host, unsigned int port,
 
             close(child_socket);
 
-            // Notify the server that the listener is done
-            int flags = fcntl(listenerPipe, F_GETFD, 0);
-            fcntl(listenerPipe, F_SETFD, flags | O_NONBLOCK);
+            // Notify the server that the listener is done (through the exit
+            // status of the process)
+            exit(action == ServerListener::ACTION_SLEEP ? EXIT_STATUS_SLEEP : 0);
+        }
 
-            if (action == ServerListener::ACTION_SLEEP)
-                write(listenerPipe, "SLEEP", 6);
-            else
-                write(listenerPipe, "DONE", 5);
+        addClient(pid);
 
-            close(listenerPipe);
+        // Parent doesn't need this one
+        close(child_socket);
+    }
 
-            exit(0);
+    return nbAccepted;
+}
+
+
+void Server::reapClients()
+{
+    // Declarations
+    pid_t pid;
+    int status;
+    unsigned int nbDone = 0;
+
+    // Several processes can be reported by one notification
+    discardSignals();
+
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0)
+    {
+        if (_clientsList.erase(pid) == 0)
+            continue;
+
+        ++nbDone;
+
+        if (WIFEXITED(status) && (WEXITSTATUS(status) == EXIT_STATUS_SLEEP))
+        {
+            _outStream << "Going to sleep..." << endl;
+            _state = STATE_GOING_TO_SLEEP;
         }
+    }
 
+    if (nbDone > 1)
+        _outStream << nbDone << " client(s) are done" << endl;
+    else if (nbDone == 1)
+        _outStream << "One client is done" << endl;
 
-        // Parent doesn't need those
-        close(child_socket);
-        close(listenerPipe);
+    if ((_state == STATE_GOING_TO_SLEEP) && _clientsList.empty())
+    {
+        _outStream << "Sleeping..." << endl;
+        _state = STATE_SLEEPING;
     }
+}
 
-    close(listen_socket);
-    clearClientsList();
 
-    return true;
+void Server::discardSignals()
+{
+    struct signalfd_siginfo info;
+
+    while (read(_signals, &info, sizeof(info)) == sizeof(info));
+}
+
+
+void Server::leaveEventLoop()
+{
+    sigset_t mask;
+
+    close(_epoll);
+    close(_signals);
+
+    _epoll = -1;
+    _signals = -1;
+
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    sigprocmask(SIG_UNBLOCK, &mask, NULL);
 }
 
 
-void Server::addClient(int* serverPipe, int* listenerPipe)
+bool Server::runWorkerPool(int listen_socket,
+                           tServerListenerConstructor* listenerConstructor)
 {
     // Assertions
-    assert(serverPipe);
-    assert(listenerPipe);
+    assert(_nbWorkers > 0);
+    assert(listenerConstructor);
+
+    // Declarations
+    unsigned int clients_counter = 0;
+    tWorkersIterator iter, iterEnd;
+    pid_t pid;
+
+    _outStream << "Using a pool of " << _nbWorkers << " pre-forked worker(s)";
+    if (_maxSessionsPerWorker > 0)
+        _outStream << ", each one handling at most " << _maxSessionsPerWorker << " session(s)";
+    _outStream << endl;
+
+    // The flag used to tell the workers that the server is going to sleep must
+    // be shared with them
+    _pSleepFlag = (volatile int*) mmap(0, sizeof(int), PROT_READ | PROT_WRITE,
+                                       MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (_pSleepFlag == MAP_FAILED)
+    {
+        _pSleepFlag = 0;
+        _outStream << "ERROR - Failed to allocate the memory shared with the workers" << endl;
+        return false;
+    }
+
+    *_pSleepFlag = 0;
+
+    for (unsigned int i = 0; i < _nbWorkers; ++i)
+    {
+        if (!spawnWorker(listen_socket, listenerConstructor))
+        {
+            stopWorkers();
+            return false;
+        }
+    }
+
+    while (!_workers.empty())
+    {
+        // Delete the log file and starts a new one when the limit is reached
+        if (clients_counter >= _logLimit)
+        {
+            resetLogFile();
+            _outStream << "Using a pool of " << _nbWorkers << " pre-forked worker(s)" << endl;
+            clients_counter = 0;
+        }
+
+        // Wait for some events
+        struct epoll_event events[MAX_EVENTS];
+
+        int nb = epoll_wait(_epoll, events, MAX_EVENTS, -1);
+        if (nb <= 0)
+            continue;
+
+        unsigned int nbDeadWorkers = 0;
+
+        for (int i = 0; i < nb; ++i)
+        {
+            // Process the messages sent by the workers
+            if (events[i].data.fd != _signals)
+            {
+                for (iter = _workers.begin(), iterEnd = _workers.end(); iter != iterEnd; ++iter)
+                {
+                    if (iter->second.pipe == events[i].data.fd)
+                    {
+                        clients_counter += readWorkerMessages(iter->first, iter->second);
+                        break;
+                    }
+                }
+
+                continue;
+            }
+
+            // Process the workers that are gone
+            discardSignals();
+
+            while ((pid = waitpid(-1, 0, WNOHANG)) > 0)
+            {
+                if (pid == _overflowProcess)
+                    _overflowProcess = 0;
+
+                iter = _workers.find(pid);
+                if (iter == _workers.end())
+                    continue;
+
+                // Some messages might still be waiting in the pipe
+                clients_counter += readWorkerMessages(iter->first, iter->second);
+                close(iter->second.pipe);
+
+                if (!iter->second.bReady)
+                {
+                    _outStream << "ERROR - The worker #" << pid << " failed to initialize itself" << endl;
+                    _workers.erase(iter);
+                    stopWorkers();
+                    return false;
+                }
+
+                _outStream << "Worker #" << pid << " stopped" << endl;
+                _workers.erase(iter);
+                ++nbDeadWorkers;
+            }
+        }
+
+        // When going to sleep, stop the idle workers (the busy ones will stop
+        // by themselves once done with their client)
+        if (_state == STATE_GOING_TO_SLEEP)
+        {
+            stopOverflowProcess();
+
+            for (iter = _workers.begin(), iterEnd = _workers.end(); iter != iterEnd; ++iter)
+            {
+                if (iter->second.bReady && !iter->second.bBusy)
+                    kill(iter->first, SIGTERM);
+            }
+
+            continue;
+        }
+
+        // Replace the workers that were recycled
+        for (unsigned int i = 0; i < nbDeadWorkers; ++i)
+        {
+            if (!spawnWorker(listen_socket, listenerConstructor))
+            {
+                stopWorkers();
+                return false;
+            }
+        }
+
+        // When all the workers are busy, the new clients must be told so
+        // instead of waiting in the backlog of the listening socket
+        unsigned int nbBusyWorkers = 0;
+        for (iter = _workers.begin(), iterEnd = _workers.end(); iter != iterEnd; ++iter)
+        {
+            if (iter->second.bBusy)
+                ++nbBusyWorkers;
+        }
+
+        if (nbBusyWorkers >= _nbMaxClients)
+        {
+            if (!startOverflowProcess(listen_socket, listenerConstructor))
+            {
+                stopWorkers();
+                return false;
+            }
+        }
+        else
+        {
+            stopOverflowProcess();
+        }
+    }
+
+    munmap((void*) _pSleepFlag, sizeof(int));
+    _pSleepFlag = 0;
+
+    _outStream << "Sleeping..." << endl;
+    _state = STATE_SLEEPING;
+
+    return true;
+}
 
+
+bool Server::spawnWorker(int listen_socket,
+                         tServerListenerConstructor* listenerConstructor)
+{
     int pipes[2];
-    pipe(pipes);
+    if (pipe2(pipes, O_CLOEXEC) == -1)
+    {
+        _outStream << "ERROR - Failed to create the pipe of a worker" << endl;
+        return false;
+    }
+
+    pid_t pid = fork();
+    if (pid == -1)
+    {
+        close(pipes[0]);
+        close(pipes[1]);
+        _outStream << "ERROR - Failed to fork a worker" << endl;
+        return false;
+    }
+
+    if (pid == 0)
+    {
+        // This is the child process
+        close(pipes[0]);
+        runWorker(listen_socket, pipes[1], listenerConstructor);
+    }
+
+    // Parent doesn't need this one
+    close(pipes[1]);
+
+    int flags = fcntl(pipes[0], F_GETFL, 0);
+    fcntl(pipes[0], F_SETFL, flags | O_NONBLOCK);
+
+    tWorker worker;
+    worker.pipe     = pipes[0];
+    worker.bReady   = false;
+    worker.bBusy    = false;
+
+    _workers[pid] = worker;
+
+    return watch(pipes[0]);
+}
+
+
+void Server::stopWorkers()
+{
+    stopOverflowProcess();
+
+    tWorkersIterator iter, iterEnd;
+    for (iter = _workers.begin(), iterEnd = _workers.end(); iter != iterEnd; ++iter)
+    {
+        kill(iter->first, SIGTERM);
+        close(iter->second.pipe);
+    }
+
+    _workers.clear();
+
+    munmap((void*) _pSleepFlag, sizeof(int));
+    _pSleepFlag = 0;
+}
+
+
+bool Server::startOverflowProcess(int listen_socket,
+                                  tServerListenerConstructor* listenerConstructor)
+{
+    if (_overflowProcess > 0)
+        return true;
+
+    pid_t pid = fork();
+    if (pid == -1)
+    {
+        _outStream << "ERROR - Failed to fork the process handling the clients in excess" << endl;
+        return false;
+    }
+
+    if (pid == 0)
+        runOverflowProcess(listen_socket, listenerConstructor);
+
+    _overflowProcess = pid;
+
+    _outStream << "All the workers are busy (" << _nbMaxClients << "/" << _nbMaxClients
+               << " client(s) connected)" << endl;
+
+    return true;
+}
+
+
+void Server::stopOverflowProcess()
+{
+    if (_overflowProcess <= 0)
+        return;
+
+    kill(_overflowProcess, SIGTERM);
+    _overflowProcess = 0;
+
+    _outStream << "Some workers are available again" << endl;
+}
 
-    *serverPipe = pipes[0];
-    *listenerPipe = pipes[1];
 
-    _pipesList.push_back(*serverPipe);
+void Server::runOverflowProcess(int listen_socket,
+                                tServerListenerConstructor* listenerConstructor)
+{
+    // Declarations
+    struct sockaddr_storage their_addr;
+    socklen_t sin_size;
+
+    // The pipes of the workers are of no use here
+    for (tWorkersIterator iter = _workers.begin(); iter != _workers.end(); ++iter)
+        close(iter->second.pipe);
+    _workers.clear();
+
+    leaveEventLoop();
+
+    // The processes handling the clients are reaped automatically
+    signal(SIGCHLD, SIG_IGN);
+
+    while (true)
+    {
+        // The workers that become available compete for the clients until
+        // this process is stopped
+        sin_size = sizeof(their_addr);
+        int child_socket = accept4(listen_socket, (struct sockaddr*) &their_addr, &sin_size, SOCK_CLOEXEC);
+        if (child_socket == -1)
+        {
+            if (errno == EINTR)
+                continue;
+
+            break;
+        }
+
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            close(listen_socket);
+
+            enableLinger(child_socket);
+
+            BusyListener listener(child_socket, listenerConstructor);
+            listener.process();
+
+            close(child_socket);
+            exit(0);
+        }
+
+        // Parent doesn't need this one
+        close(child_socket);
+    }
+
+    close(listen_socket);
+
+    exit(0);
+}
+
+
+unsigned int Server::readWorkerMessages(pid_t pid, tWorker& worker)
+{
+    tWorkerMessage message;
+    unsigned int nbSessions = 0;
+
+    while (read(worker.pipe, &message, sizeof(message)) == sizeof(message))
+    {
+        switch (message.type)
+        {
+            case WORKER_READY:
+                worker.bReady = true;
+                _warmupLatencies.record(message.value);
+                _outStream << "Worker #" << pid << " ready (initialization: " << message.value / 1000 << " ms)" << endl;
+
+                if (_warmupLatencies.count() % _nbWorkers == 0)
+                    logLatencies("Workers initialization", _warmupLatencies);
+                break;
+
+            case WORKER_SESSION_STARTED:
+                worker.bBusy = true;
+                ++nbSessions;
+                _startupLatencies.record(message.value);
+                _outStream << "Worker #" << pid << " handles a new client (startup: " << message.value / 1000 << " ms)" << endl;
+
+                if (_startupLatencies.count() % 10 == 0)
+                    logLatencies("Sessions startup", _startupLatencies);
+                break;
+
+            case WORKER_SESSION_DONE:
+                worker.bBusy = false;
+                _outStream << "Worker #" << pid << " is done with its client (" << message.value
+                           << " session(s) handled)" << endl;
+                break;
+
+            case WORKER_SESSION_SLEEP:
+                worker.bBusy = false;
+                _outStream << "Going to sleep..." << endl;
+                _state = STATE_GOING_TO_SLEEP;
+                *_pSleepFlag = 1;
+                break;
+        }
+    }
+
+    return nbSessions;
+}
+
+
+void Server::runWorker(int listen_socket, int workerPipe,
+                       tServerListenerConstructor* listenerConstructor)
+{
+    // Declarations
+    struct timeval start, end;
+    struct sockaddr_storage their_addr;
+    socklen_t sin_size;
+    tWorkerMessage message;
+    unsigned int nbSessions = 0;
+
+    gettimeofday(&start, 0);
+
+    // The pipes of the other workers are of no use here
+    for (tWorkersIterator iter = _workers.begin(); iter != _workers.end(); ++iter)
+        close(iter->second.pipe);
+    _workers.clear();
+
+    leaveEventLoop();
+
+    // Perform the expensive initializations before any client is waiting
+    if (_workerInitializer && !_workerInitializer())
+    {
+        close(workerPipe);
+        exit(-1);
+    }
+
+    gettimeofday(&end, 0);
+
+    message.type  = WORKER_READY;
+    message.value = elapsedMicroseconds(start, end);
+    write(workerPipe, &message, sizeof(message));
+
+    while ((_maxSessionsPerWorker == 0) || (nbSessions < _maxSessionsPerWorker))
+    {
+        if (*_pSleepFlag)
+            break;
+
+        // Wait for a client (the kernel wakes up only one of the workers)
+        sin_size = sizeof(their_addr);
+        int child_socket = accept4(listen_socket, (struct sockaddr*) &their_addr, &sin_size, SOCK_CLOEXEC);
+        if (child_socket == -1)
+        {
+            if (errno == EINTR)
+                continue;
+
+            break;
+        }
+
+        gettimeofday(&start, 0);
+
+        ++nbSessions;
+
+        enableLinger(child_socket);
+
+        ServerListener* pListener;
+
+        if (*_pSleepFlag)
+            pListener = new BusyListener(child_socket, listenerConstructor);
+        else
+            pListener = listenerConstructor(child_socket);
+
+        gettimeofday(&end, 0);
+
+        message.type  = WORKER_SESSION_STARTED;
+        message.value = elapsedMicroseconds(start, end);
+        write(workerPipe, &message, sizeof(message));
+
+        ServerListener::tAction action = pListener->process();
+
+        delete pListener;
+
+        close(child_socket);
+
+        // Notify the server that the listener is done
+        message.type  = (action == ServerListener::ACTION_SLEEP ? WORKER_SESSION_SLEEP : WORKER_SESSION_DONE);
+        message.value = nbSessions;
+        write(workerPipe, &message, sizeof(message));
+
+        if (action == ServerListener::ACTION_SLEEP)
+            break;
+    }
+
+    close(workerPipe);
+    close(listen_socket);
+
+    exit(0);
+}
+
+
+void Server::addClient(pid_t pid)
+{
+    _clientsList.insert(pid);
 }
 
 
 void Server::clearClientsList()
 {
-    std::vector<int>::iterator iter, iterEnd;
-    for (iter = _pipesList.begin(), iterEnd = _pipesList.end(); iter != iterEnd; ++iter)
-        close(*iter);
+    _clientsList.clear();
+}
+
+
+void Server::logLatencies(const std::string& strTitle,
+                          const LatencyHistogram& latencies)
+{
+    if (latencies.count() == 0)
+        return;
+
+    _outStream << strTitle << " (" << latencies.count() << " sample(s)): "
+               << "min=" << latencies.min() / 1000 << " ms, "
+               << "p50=" << latencies.percentile(50.0) / 1000 << " ms, "
+               << "p90=" << latencies.percentile(90.0) / 1000 << " ms, "
+               << "p99=" << latencies.percentile(99.0) / 1000 << " ms, "
+               << "max=" << latencies.max() / 1000 << " ms" << endl;
+}
+
+
+void Server::resetLogFile()
+{
+    _outStream << "--------------------------------------------------------------------------------" << endl;
+
+    string strLogName = _outStream.getName();
+    string strLogFileName = _outStream.getFileName();
+
+    _outStream.deleteFile();
+    _outStream.open(strLogName, strLogFileName);
+
+    time_t t;
+    struct tm* timeinfo;
+    char buffer[20];
+
+    time(&t);
+    timeinfo = localtime(&t);
+
+    strftime(buffer, 20, "%d/%m/%Y %H:%M:%S", timeinfo);
+
+    _outStream << "Reset of the log file: " << buffer << endl;
+
+    logAddress("Listen for incoming connections");
+}
+
+
+void Server::logAddress(const std::string& strPrefix)
+{
+    _outStream << strPrefix << " " << _strAddress << endl;
 
-    _pipesList.clear();
+    if (_nbMaxClients > 0)
+        _outStream << "This server only supports " << _nbMaxClients << " client(s) at the same time" << endl;
+    else
+        _outStream << "This server supports an unlimited amount of clients" << endl;
 }
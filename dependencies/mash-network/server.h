@@ -31,17 +31,35 @@
 
 #include <mash-utils/arguments_list.h>
 #include <mash-utils/outstream.h>
+#include <mash-utils/latency_histogram.h>
 #include "server_listener.h"
+#include <sys/types.h>
 #include <vector>
+#include <map>
+#include <set>
 
 
 namespace Mash
 {
+    //--------------------------------------------------------------------------
+    /// @brief  Function called by each pre-forked worker before it starts to
+    ///         accept connections, to perform the expensive initializations
+    ///         ahead of time
+    ///
+    /// @return 'false' if failed (the worker is then stopped)
+    //--------------------------------------------------------------------------
+    typedef bool tWorkerInitializer();
+
+
     //--------------------------------------------------------------------------
     /// @brief  Manages the server side of a TCP/IP communication
     ///
     /// A 'listener' is created to handle each incoming connection (see
     /// ServerListener).
+    ///
+    /// The server can also listen on a Unix domain socket (for the clients
+    /// running on the same machine), or use a socket inherited from its parent
+    /// process.
     //--------------------------------------------------------------------------
     class MASH_SYMBOL Server
     {
@@ -87,23 +105,70 @@ namespace Mash
         bool listen(const std::string& host, unsigned int port,
                     tServerListenerConstructor* listenerConstructor);
 
+        //----------------------------------------------------------------------
+        /// @brief  Start to listen for incoming communications on a Unix domain
+        ///         socket
+        ///
+        /// @param  strPath                 Path of the socket (a socket left
+        ///                                 there by a previous server is
+        ///                                 replaced)
+        /// @param  listenerConstructor     Pointer to the function to use to
+        ///                                 create the listener that will handle
+        ///                                 the incoming connections
+        /// @return                         'false' if failed
+        ///
+        /// @remark Blocking call
+        //----------------------------------------------------------------------
+        bool listenUnix(const std::string& strPath,
+                        tServerListenerConstructor* listenerConstructor);
 
-    private:
         //----------------------------------------------------------------------
-        /// @brief  Add a client to the list
+        /// @brief  Use a socket inherited from the parent process
+        ///
+        /// If the socket is listening, the incoming connections are handled
+        /// like with listen(). Otherwise the socket is already connected (for
+        /// instance one end of a socketpair created by the parent process):
+        /// that connection is handled in this process, and the method returns
+        /// once it is closed.
+        ///
+        /// @param  socket                  The socket
+        /// @param  listenerConstructor     Pointer to the function to use to
+        ///                                 create the listener that will handle
+        ///                                 the connection(s)
+        /// @return                         'false' if failed
         ///
-        /// @param[out] serverPipe      Pipe that must be used by the server to
-        ///                             test if the client is done
-        /// @param[out] listenerPipe    Pipe that must be used by the listener to
-        ///                             indicate to the server that the client
-        ///                             is done
+        /// @remark Blocking call
         //----------------------------------------------------------------------
-        void addClient(int* serverPipe, int* listenerPipe);
+        bool listenOnSocket(int socket,
+                            tServerListenerConstructor* listenerConstructor);
 
         //----------------------------------------------------------------------
-        /// @brief  Clear the internal list of connected clients
+        /// @brief  Enable the pool of pre-forked workers
+        ///
+        /// By default, a new process is forked each time a connection is
+        /// accepted. When a pool is used, the workers are forked (and
+        /// initialized) when the server starts, and each of them blocks on
+        /// the listening socket until a client connects. Once a worker has
+        /// handled the maximum number of sessions, it is replaced by a new
+        /// one.
+        ///
+        /// @param  nbWorkers               Number of workers (0 to disable
+        ///                                 the pool). When the pool is used,
+        ///                                 it also defines the maximum number
+        ///                                 of simultaneous clients: while all
+        ///                                 the workers are busy, the new
+        ///                                 clients are told that the server
+        ///                                 is busy.
+        /// @param  maxSessionsPerWorker    Maximum number of sessions handled
+        ///                                 by one worker. 0 means 'no limit'
+        /// @param  workerInitializer       Function called by each worker
+        ///                                 right after its creation (optional)
+        ///
+        /// @remark Must be called before listen()
         //----------------------------------------------------------------------
-        void clearClientsList();
+        void setWorkerPool(unsigned int nbWorkers,
+                           unsigned int maxSessionsPerWorker = 0,
+                           tWorkerInitializer* workerInitializer = 0);
 
 
         //_____ Internal types __________
@@ -115,6 +180,181 @@ namespace Mash
             STATE_SLEEPING
         };
 
+        enum tWorkerMessageType
+        {
+            WORKER_READY,
+            WORKER_SESSION_STARTED,
+            WORKER_SESSION_DONE,
+            WORKER_SESSION_SLEEP
+        };
+
+        struct tWorkerMessage
+        {
+            tWorkerMessageType  type;
+            unsigned int        value;
+        };
+
+        struct tWorker
+        {
+            int             pipe;
+            bool            bReady;
+            bool            bBusy;
+        };
+
+        typedef std::map<pid_t, tWorker>    tWorkersList;
+        typedef tWorkersList::iterator      tWorkersIterator;
+
+
+        //_____ Internal methods __________
+    private:
+        //----------------------------------------------------------------------
+        /// @brief  Register a file descriptor in the event loop (edge-triggered)
+        ///
+        /// @return 'false' if failed
+        //----------------------------------------------------------------------
+        bool watch(int fd);
+
+        //----------------------------------------------------------------------
+        /// @brief  Handle the incoming connections of a listening socket
+        ///
+        /// @param  listen_socket           The listening socket
+        /// @param  listenerConstructor     Pointer to the function to use to
+        ///                                 create the listeners
+        /// @return                         'false' if failed
+        //----------------------------------------------------------------------
+        bool run(int listen_socket, tServerListenerConstructor* listenerConstructor);
+
+        //----------------------------------------------------------------------
+        /// @brief  Accept all the pending connections, and fork a process to
+        ///         handle each of them
+        ///
+        /// @param  listen_socket           The listening socket (non-blocking)
+        /// @param  listenerConstructor     Pointer to the function to use to
+        ///                                 create the listeners
+        /// @return                         The number of accepted connections
+        //----------------------------------------------------------------------
+        unsigned int acceptClients(int listen_socket,
+                                   tServerListenerConstructor* listenerConstructor);
+
+        //----------------------------------------------------------------------
+        /// @brief  Reap the processes of the clients that are done
+        //----------------------------------------------------------------------
+        void reapClients();
+
+        //----------------------------------------------------------------------
+        /// @brief  Empty the queue of pending SIGCHLD notifications
+        //----------------------------------------------------------------------
+        void discardSignals();
+
+        //----------------------------------------------------------------------
+        /// @brief  Release the resources of the event loop (called in the
+        ///         child processes)
+        //----------------------------------------------------------------------
+        void leaveEventLoop();
+
+        //----------------------------------------------------------------------
+        /// @brief  Handle the incoming connections using the pool of workers
+        ///
+        /// @param  listen_socket           The listening socket
+        /// @param  listenerConstructor     Pointer to the function to use to
+        ///                                 create the listeners
+        /// @return                         'false' if failed
+        ///
+        /// @remark Returns 'true' once all the workers are stopped because
+        ///         the server went to sleep
+        //----------------------------------------------------------------------
+        bool runWorkerPool(int listen_socket,
+                           tServerListenerConstructor* listenerConstructor);
+
+        //----------------------------------------------------------------------
+        /// @brief  Fork a new worker
+        ///
+        /// @return 'false' if failed
+        //----------------------------------------------------------------------
+        bool spawnWorker(int listen_socket,
+                         tServerListenerConstructor* listenerConstructor);
+
+        //----------------------------------------------------------------------
+        /// @brief  Stop all the workers
+        //----------------------------------------------------------------------
+        void stopWorkers();
+
+        //----------------------------------------------------------------------
+        /// @brief  Fork the process telling the new clients that the server
+        ///         is busy, while all the workers are busy (if not already
+        ///         done)
+        ///
+        /// @return 'false' if failed
+        //----------------------------------------------------------------------
+        bool startOverflowProcess(int listen_socket,
+                                  tServerListenerConstructor* listenerConstructor);
+
+        //----------------------------------------------------------------------
+        /// @brief  Stop the process telling the new clients that the server is
+        ///         busy (if any)
+        //----------------------------------------------------------------------
+        void stopOverflowProcess();
+
+        //----------------------------------------------------------------------
+        /// @brief  Main loop of the process telling the new clients that the
+        ///         server is busy (executed in the child process)
+        ///
+        /// @remark Never returns
+        //----------------------------------------------------------------------
+        void runOverflowProcess(int listen_socket,
+                                tServerListenerConstructor* listenerConstructor);
+
+        //----------------------------------------------------------------------
+        /// @brief  Process all the messages sent by a worker
+        ///
+        /// @param  pid     Process ID of the worker
+        /// @param  worker  The worker
+        /// @return         The number of sessions started by the worker
+        //----------------------------------------------------------------------
+        unsigned int readWorkerMessages(pid_t pid, tWorker& worker);
+
+        //----------------------------------------------------------------------
+        /// @brief  Main loop of a worker (executed in the child process)
+        ///
+        /// @remark Never returns
+        //----------------------------------------------------------------------
+        void runWorker(int listen_socket, int workerPipe,
+                       tServerListenerConstructor* listenerConstructor);
+
+        //----------------------------------------------------------------------
+        /// @brief  Write some statistics about a list of latencies in the log
+        ///
+        /// @param  strTitle    Title of the statistics
+        /// @param  latencies   The latencies, in microseconds
+        //----------------------------------------------------------------------
+        void logLatencies(const std::string& strTitle,
+                          const LatencyHistogram& latencies);
+
+        //----------------------------------------------------------------------
+        /// @brief  Delete the log file and starts a new one
+        //----------------------------------------------------------------------
+        void resetLogFile();
+
+        //----------------------------------------------------------------------
+        /// @brief  Write the address the server listens on (and the maximum
+        ///         number of clients) in the log
+        ///
+        /// @param  strPrefix   Text preceding the address
+        //----------------------------------------------------------------------
+        void logAddress(const std::string& strPrefix);
+
+        //----------------------------------------------------------------------
+        /// @brief  Add a client to the list
+        ///
+        /// @param  pid     Process handling the client
+        //----------------------------------------------------------------------
+        void addClient(pid_t pid);
+
+        //----------------------------------------------------------------------
+        /// @brief  Clear the internal list of connected clients
+        //----------------------------------------------------------------------
+        void clearClientsList();
+
 
         //_____ Static attributes __________
     public:
@@ -126,8 +366,21 @@ namespace Mash
         tState              _state;
         unsigned int        _nbMaxClients;
         unsigned int        _logLimit;
-        std::vector<int>    _pipesList;
+        std::set<pid_t>     _clientsList;
         OutStream           _outStream;
+        std::string         _strAddress;    ///< Description of the address, for the logs
+        std::string         _strUnixPath;   ///< Path of the Unix socket, if any
+        int                 _epoll;
+        int                 _signals;
+
+        unsigned int                _nbWorkers;
+        unsigned int                _maxSessionsPerWorker;
+        tWorkerInitializer*         _workerInitializer;
+        tWorkersList                _workers;
+        volatile int*               _pSleepFlag;
+        pid_t                       _overflowProcess;   ///< 0 if none
+        LatencyHistogram            _warmupLatencies;
+        LatencyHistogram            _startupLatencies;
     };
 }
 
@@ -28,6 +28,8 @@
 
 #include "server.h"
 #include "networkutils.h"
+#include <mash-utils/statistics.h>
+#include <mash-utils/tracer.h>
 #include <assert.h>
 
 using namespace std;
@@ -63,8 +65,28 @@ ServerListener::tAction ServerListener::process()
     if ((_timeout.tv_sec > 0) || (_timeout.tv_usec > 0))
         pTimeout = &_timeout;
 
-    while (NetworkUtils::waitMessage(_socket, &_buffer, &strCommand, &arguments, pTimeout))
+    // The responses are sent as soon as they are complete (see cork()). Not
+    // needed with the other kinds of sockets (like Unix domain ones).
+    bool bTcp = NetworkUtils::isTcpSocket(_socket);
+    if (bTcp)
+        NetworkUtils::disableNagle(_socket);
+
+    // Number of commands extracted from the buffer since the last time data
+    // was received. All the commands in the buffer are waiting for a response,
+    // so a client can't send more than MAX_PIPELINED_COMMANDS of them at once.
+    unsigned int nbPipelinedCommands = 0;
+
+    // Note: the commands pipelined by the client are already in the buffer,
+    // they are processed one after the other (in order) without waiting for
+    // the network
+    while (true)
     {
+        if (!_buffer.hasMessage())
+            nbPipelinedCommands = 0;
+
+        if (!NetworkUtils::waitMessage(_socket, &_buffer, &strCommand, &arguments, pTimeout))
+            break;
+
         // Timeout ?
         if (pTimeout && strCommand.empty())
         {
@@ -72,17 +94,47 @@ ServerListener::tAction ServerListener::process()
             continue;
         }
 
-        _outStream << "< " << strCommand;
+        if (_outStream.isEnabled())
+        {
+            _outStream << "< " << strCommand;
 
-        for (unsigned int i = 0; i < arguments.size(); ++i)
-            _outStream << " " << arguments.getString(i);
+            for (unsigned int i = 0; i < arguments.size(); ++i)
+                _outStream << " " << arguments.getString(i);
 
-        _outStream << endl;
+            _outStream << endl;
+        }
+
+        // Reject the commands exceeding the advertised limit
+        if (++nbPipelinedCommands > MAX_PIPELINED_COMMANDS)
+        {
+            _outStream << "ERROR - Too many pipelined commands" << endl;
+
+            if (!sendResponse("ERROR", ArgumentsList("Too many pipelined commands")))
+                return ACTION_CLOSE_CONNECTION;
+
+            continue;
+        }
+
+        // All the responses to the command are sent together
+        if (bTcp)
+            NetworkUtils::cork(_socket, true);
 
         tAction action = handleCommand(strCommand, arguments);
 
+        if (bTcp)
+            NetworkUtils::cork(_socket, false);
+
+        // The commands pipelined after this one are discarded
         if (action != ACTION_NONE)
             return action;
+
+        // The idle work is done in small steps, and stops as soon as the
+        // next command arrives
+        if (_buffer.size() == 0)
+        {
+            while (!NetworkUtils::hasPendingData(_socket) && onIdle())
+                ;
+        }
     }
 
     return ACTION_NONE;
@@ -92,12 +144,19 @@ ServerListener::tAction ServerListener::process()
 bool ServerListener::sendResponse(const std::string& strResponse,
                                   const ArgumentsList& arguments)
 {
-    _outStream << "> " << strResponse;
+    if (_outStream.isEnabled())
+    {
+        _outStream << "> " << strResponse;
 
-    for (unsigned int i = 0; i < arguments.size(); ++i)
-        _outStream << " " << arguments.getString(i);
+        for (unsigned int i = 0; i < arguments.size(); ++i)
+            _outStream << " " << arguments.getString(i);
+
+        _outStream << endl;
+    }
 
-    _outStream << endl;
+    static LatencyHistogram& histogram = Statistics::histogram("phase.send");
+    ScopedLatency latency(histogram);
+    ScopedTrace trace("ServerListener::sendResponse");
 
     return NetworkUtils::sendMessage(_socket, strResponse, arguments);
 }
@@ -107,6 +166,10 @@ bool ServerListener::sendData(const unsigned char* data, int size)
 {
     _outStream << "> <" << size << " bytes of data>" << endl;
 
+    static LatencyHistogram& histogram = Statistics::histogram("phase.send");
+    ScopedLatency latency(histogram);
+    ScopedTrace trace("ServerListener::sendData");
+
     return NetworkUtils::sendData(_socket, data, size);
 }
 
@@ -41,6 +41,16 @@ namespace Mash
     //--------------------------------------------------------------------------
     /// @brief  Base class for a listener that handle an incoming connection
     ///         (see Server)
+    ///
+    /// The client can pipeline its commands (send several of them without
+    /// waiting for the responses), as long as there is never more than
+    /// MAX_PIPELINED_COMMANDS commands without a complete response (the
+    /// commands exceeding this limit are rejected with an ERROR response). The
+    /// commands are processed in the order they were sent, and the responses
+    /// (and data) of a command are all sent before the ones of the next
+    /// command. A command that fails doesn't stop the processing of the next
+    /// ones, but the ones following a command that closes the connection are
+    /// discarded.
     //--------------------------------------------------------------------------
     class MASH_SYMBOL ServerListener
     {
@@ -57,6 +67,18 @@ namespace Mash
         };
 
 
+        //_____ Constants __________
+    public:
+        //----------------------------------------------------------------------
+        /// @brief  Maximum number of commands that a client can send without
+        ///         waiting for their responses
+        ///
+        /// Beyond that, the responses that the client isn't reading could fill
+        /// the network buffers in both directions, and block both sides.
+        //----------------------------------------------------------------------
+        static const unsigned int MAX_PIPELINED_COMMANDS = 16;
+
+
         //_____ Construction / Destruction __________
     public:
         //----------------------------------------------------------------------
@@ -136,6 +158,19 @@ namespace Mash
         //----------------------------------------------------------------------
         virtual void onTimeout() {}
 
+        //----------------------------------------------------------------------
+        /// @brief  Called when the responses to the last command were sent,
+        ///         and no other command is waiting in the buffer
+        ///
+        /// Overriden classes can use it to do some work while the client is
+        /// busy with the responses, one step at a time: it is called again
+        /// until it returns 'false' or the next command arrives. The next
+        /// command waits for the current step, so keep them short.
+        ///
+        /// @return 'true' if some work remains
+        //----------------------------------------------------------------------
+        virtual bool onIdle() { return false; }
+
 
         //_____ Attributes __________
     protected:
@@ -0,0 +1,306 @@
+/*******************************************************************************
+* MASH 3D simulator
+* 
+* Copyright (c) 2014 Idiap Research Institute, http://www.idiap.ch/
+* Written by Philip Abbet <philip.abbet@idiap.ch>
+* 
+* This file is part of mash-simulator.
+* 
+* mash-simulator is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 3 as
+* published by the Free Software Foundation.
+* 
+* mash-simulator is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+* 
+* You should have received a copy of the GNU General Public License
+* along with mash-simulator. If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+
+
+/** @file   shared_frames.cpp
+    @author Philip Abbet (philip.abbet@idiap.ch)
+
+    Implementation of the class 'SharedFrames'
+*/
+
+#include "shared_frames.h"
+#include <mash-utils/stringutils.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <memory.h>
+#include <assert.h>
+
+#ifdef __linux__
+    #include <sys/syscall.h>
+#endif
+
+
+using namespace Mash;
+using namespace std;
+
+
+/********************************** CONSTANTS *********************************/
+
+static const char MAGIC[8] = { 'M', 'A', 'S', 'H', 'F', 'R', 'M', '1' };
+
+
+/************************* CONSTRUCTION / DESTRUCTION *************************/
+
+SharedFrames::SharedFrames()
+: _pMemory(0), _size(0), _fd(-1), _nextSlot(0)
+{
+}
+
+
+SharedFrames::~SharedFrames()
+{
+    close();
+}
+
+
+/*********************************** METHODS **********************************/
+
+bool SharedFrames::create(unsigned int nbSlots, unsigned int slotSize)
+{
+    // Assertions
+    assert(nbSlots > 0);
+    assert(slotSize > 0);
+
+    close();
+
+    // The data of each slot is aligned on 64 bytes
+    slotSize = (slotSize + 63) & ~63;
+
+    _size = sizeof(tHeader) + nbSlots * (sizeof(tSlot) + slotSize);
+
+    // Create an anonymous file when possible: it disappears with the last
+    // process using it, and the client can open it through /proc
+#if defined(__linux__) && defined(SYS_memfd_create)
+    _fd = syscall(SYS_memfd_create, "mash-frames", 1 /* MFD_CLOEXEC */);
+    if (_fd >= 0)
+        _strPath = "/proc/" + StringUtils::toString(getpid()) + "/fd/" + StringUtils::toString(_fd);
+#endif
+
+    // Otherwise use a named POSIX shared memory object, removed by close()
+    if (_fd < 0)
+    {
+        static unsigned int counter = 0;
+
+        _strName = "/mash-frames-" + StringUtils::toString(getpid()) + "-" +
+                   StringUtils::toString(counter++);
+
+        _fd = shm_open(_strName.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (_fd < 0)
+        {
+            _strName = "";
+            return false;
+        }
+
+        _strPath = _strName;
+    }
+
+    if ((ftruncate(_fd, _size) != 0) ||
+        ((_pMemory = (unsigned char*) mmap(0, _size, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0)) == MAP_FAILED))
+    {
+        _pMemory = 0;
+        close();
+        return false;
+    }
+
+    // The content of the file is already filled with zeros, so all the slots
+    // are free
+    tHeader* pHeader = (tHeader*) _pMemory;
+    memcpy(pHeader->magic, MAGIC, sizeof(MAGIC));
+    pHeader->nbSlots = nbSlots;
+    pHeader->slotSize = slotSize;
+
+    return true;
+}
+
+
+bool SharedFrames::open(const std::string& strPath)
+{
+    close();
+
+    if (strPath.substr(0, 1) != "/")
+        return false;
+
+    // A path in the file system (memfd) or the name of a POSIX shared memory
+    // object
+    if (strPath.substr(0, 6) == "/proc/")
+        _fd = ::open(strPath.c_str(), O_RDWR);
+    else
+        _fd = shm_open(strPath.c_str(), O_RDWR, 0600);
+
+    if (_fd < 0)
+        return false;
+
+    struct stat infos;
+    if ((fstat(_fd, &infos) != 0) || (infos.st_size < (off_t) sizeof(tHeader)))
+    {
+        close();
+        return false;
+    }
+
+    _size = infos.st_size;
+
+    _pMemory = (unsigned char*) mmap(0, _size, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+    if (_pMemory == MAP_FAILED)
+    {
+        _pMemory = 0;
+        close();
+        return false;
+    }
+
+    // Check the content
+    tHeader* pHeader = (tHeader*) _pMemory;
+    if ((memcmp(pHeader->magic, MAGIC, sizeof(MAGIC)) != 0) || (pHeader->nbSlots == 0) ||
+        (sizeof(tHeader) + pHeader->nbSlots * (sizeof(tSlot) + (size_t) pHeader->slotSize) > _size))
+    {
+        close();
+        return false;
+    }
+
+    _strPath = strPath;
+
+    return true;
+}
+
+
+void SharedFrames::close()
+{
+    if (_pMemory)
+        munmap(_pMemory, _size);
+
+    if (_fd >= 0)
+        ::close(_fd);
+
+    if (!_strName.empty())
+        shm_unlink(_strName.c_str());
+
+    _pMemory    = 0;
+    _size       = 0;
+    _fd         = -1;
+    _nextSlot   = 0;
+    _strPath    = "";
+    _strName    = "";
+}
+
+
+unsigned int SharedFrames::nbSlots() const
+{
+    return (_pMemory ? ((tHeader*) _pMemory)->nbSlots : 0);
+}
+
+
+unsigned int SharedFrames::slotSize() const
+{
+    return (_pMemory ? ((tHeader*) _pMemory)->slotSize : 0);
+}
+
+
+int SharedFrames::acquire()
+{
+    // Assertions
+    assert(_pMemory);
+
+    // Declarations
+    tSlot* pSlots = (tSlot*) (_pMemory + sizeof(tHeader));
+    unsigned int nb = nbSlots();
+
+    for (unsigned int i = 0; i < nb; ++i)
+    {
+        unsigned int slot = (_nextSlot + i) % nb;
+
+        if (__sync_bool_compare_and_swap(&pSlots[slot].state, SLOT_FREE, SLOT_WRITING))
+        {
+            _nextSlot = (slot + 1) % nb;
+            return (int) slot;
+        }
+    }
+
+    return -1;
+}
+
+
+void SharedFrames::publish(unsigned int slot, unsigned int size)
+{
+    // Assertions
+    assert(_pMemory);
+    assert(slot < nbSlots());
+    assert(size <= slotSize());
+
+    tSlot* pSlot = (tSlot*) (_pMemory + sizeof(tHeader)) + slot;
+
+    assert(pSlot->state == SLOT_WRITING);
+
+    pSlot->size = size;
+
+    // The content of the slot must be visible before its new state
+    __sync_synchronize();
+    pSlot->state = SLOT_READY;
+}
+
+
+void SharedFrames::release(unsigned int slot)
+{
+    // Assertions
+    assert(_pMemory);
+
+    if (slot >= nbSlots())
+        return;
+
+    tSlot* pSlot = (tSlot*) (_pMemory + sizeof(tHeader)) + slot;
+
+    // The content of the slot must not be read after its new state
+    __sync_synchronize();
+    pSlot->state = SLOT_FREE;
+}
+
+
+unsigned char* SharedFrames::data(unsigned int slot)
+{
+    // Assertions
+    assert(_pMemory);
+    assert(slot < nbSlots());
+
+    return _pMemory + sizeof(tHeader) + nbSlots() * sizeof(tSlot) +
+           (size_t) slot * slotSize();
+}
+
+
+unsigned int SharedFrames::frameSize(unsigned int slot) const
+{
+    // Assertions
+    assert(_pMemory);
+    assert(slot < nbSlots());
+
+    const tSlot* pSlot = (const tSlot*) (_pMemory + sizeof(tHeader)) + slot;
+
+    __sync_synchronize();
+    return pSlot->size;
+}
+
+
+unsigned int SharedFrames::nbReadySlots() const
+{
+    if (!_pMemory)
+        return 0;
+
+    const tSlot* pSlots = (const tSlot*) (_pMemory + sizeof(tHeader));
+    unsigned int nb = 0;
+
+    for (unsigned int i = 0; i < nbSlots(); ++i)
+    {
+        if (pSlots[i].state == SLOT_READY)
+            ++nb;
+    }
+
+    return nb;
+}
@@ -0,0 +1,208 @@
+/*******************************************************************************
+* MASH 3D simulator
+* 
+* Copyright (c) 2014 Idiap Research Institute, http://www.idiap.ch/
+* Written by Philip Abbet <philip.abbet@idiap.ch>
+* 
+* This file is part of mash-simulator.
+* 
+* mash-simulator is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 3 as
+* published by the Free Software Foundation.
+* 
+* mash-simulator is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+* 
+* You should have received a copy of the GNU General Public License
+* along with mash-simulator. If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+
+
+/** @file   shared_frames.h
+    @author Philip Abbet (philip.abbet@idiap.ch)
+
+    Declaration of the 'SharedFrames' class
+*/
+
+#ifndef _MASH_SHAREDFRAMES_H_
+#define _MASH_SHAREDFRAMES_H_
+
+#include <mash-utils/platform.h>
+#include <stdint.h>
+#include <string>
+
+
+namespace Mash
+{
+    //--------------------------------------------------------------------------
+    /// @brief  Ring of frame slots stored in a shared memory segment, used to
+    ///         transfer the views to a client running on the same machine
+    ///         without sending them through the socket
+    ///
+    /// The server creates the segment, and announces its path to the client,
+    /// which maps it too. Each slot is owned either by the server or by the
+    /// client, as indicated by its state:
+    ///
+    ///   - SLOT_FREE:    the server can write in it
+    ///   - SLOT_WRITING: the server is writing in it
+    ///   - SLOT_READY:   the client owns it, until it releases the slot
+    ///
+    /// The state transitions are atomic, so no lock is needed. The server never
+    /// overwrites a slot that wasn't released: when the client is too slow and
+    /// no slot is free, acquire() fails and the frame must be sent through the
+    /// socket instead.
+    //--------------------------------------------------------------------------
+    class MASH_SYMBOL SharedFrames
+    {
+        //_____ Public internal types __________
+    public:
+        enum tSlotState
+        {
+            SLOT_FREE,
+            SLOT_WRITING,
+            SLOT_READY,
+        };
+
+
+        //_____ Construction / Destruction __________
+    public:
+        //----------------------------------------------------------------------
+        /// @brief  Constructor
+        //----------------------------------------------------------------------
+        SharedFrames();
+
+        //----------------------------------------------------------------------
+        /// @brief  Destructor
+        //----------------------------------------------------------------------
+        ~SharedFrames();
+
+
+        //_____ Methods __________
+    public:
+        //----------------------------------------------------------------------
+        /// @brief  Create the shared memory segment (server side)
+        ///
+        /// @param  nbSlots     Number of slots
+        /// @param  slotSize    Size of one slot, in bytes
+        /// @return             'false' if failed
+        //----------------------------------------------------------------------
+        bool create(unsigned int nbSlots, unsigned int slotSize);
+
+        //----------------------------------------------------------------------
+        /// @brief  Map the shared memory segment created by the server (client
+        ///         side)
+        ///
+        /// @param  strPath     The path announced by the server
+        /// @return             'false' if failed
+        //----------------------------------------------------------------------
+        bool open(const std::string& strPath);
+
+        //----------------------------------------------------------------------
+        /// @brief  Unmap the shared memory segment
+        //----------------------------------------------------------------------
+        void close();
+
+        //----------------------------------------------------------------------
+        /// @brief  Indicates if the shared memory segment is mapped
+        //----------------------------------------------------------------------
+        inline bool isOpen() const
+        {
+            return (_pMemory != 0);
+        }
+
+        //----------------------------------------------------------------------
+        /// @brief  Returns the path to give to open() to map the segment
+        //----------------------------------------------------------------------
+        inline const std::string& path() const
+        {
+            return _strPath;
+        }
+
+        //----------------------------------------------------------------------
+        /// @brief  Returns the number of slots
+        //----------------------------------------------------------------------
+        unsigned int nbSlots() const;
+
+        //----------------------------------------------------------------------
+        /// @brief  Returns the size of one slot, in bytes
+        //----------------------------------------------------------------------
+        unsigned int slotSize() const;
+
+        //----------------------------------------------------------------------
+        /// @brief  Take the ownership of a free slot (server side)
+        ///
+        /// The slots are used in a round-robin fashion.
+        /// @return The index of the slot, -1 if no slot is free
+        //----------------------------------------------------------------------
+        int acquire();
+
+        //----------------------------------------------------------------------
+        /// @brief  Give a slot filled by the server to the client (server side)
+        ///
+        /// @param  slot    Index of the slot (returned by acquire())
+        /// @param  size    Size of the frame, in bytes
+        //----------------------------------------------------------------------
+        void publish(unsigned int slot, unsigned int size);
+
+        //----------------------------------------------------------------------
+        /// @brief  Give a slot back to the server (client side, or server side
+        ///         if the frame couldn't be published)
+        ///
+        /// @param  slot    Index of the slot
+        //----------------------------------------------------------------------
+        void release(unsigned int slot);
+
+        //----------------------------------------------------------------------
+        /// @brief  Returns the content of a slot
+        ///
+        /// @param  slot    Index of the slot
+        //----------------------------------------------------------------------
+        unsigned char* data(unsigned int slot);
+
+        //----------------------------------------------------------------------
+        /// @brief  Returns the size of the frame stored in a published slot
+        ///
+        /// @param  slot    Index of the slot
+        //----------------------------------------------------------------------
+        unsigned int frameSize(unsigned int slot) const;
+
+        //----------------------------------------------------------------------
+        /// @brief  Returns the number of slots owned by the client
+        //----------------------------------------------------------------------
+        unsigned int nbReadySlots() const;
+
+
+        //_____ Internal types __________
+    private:
+        struct tHeader
+        {
+            char        magic[8];
+            uint32_t    nbSlots;
+            uint32_t    slotSize;
+            uint64_t    reserved[6];
+        };
+
+        struct tSlot
+        {
+            volatile uint32_t   state;
+            uint32_t            size;
+            uint64_t            reserved[7];
+        };
+
+
+        //_____ Attributes __________
+    private:
+        unsigned char*  _pMemory;
+        size_t          _size;
+        std::string     _strPath;
+        std::string     _strName;   ///< Name of the POSIX shared memory object
+                                    ///  (only when memfd isn't available)
+        int             _fd;
+        unsigned int    _nextSlot;
+    };
+}
+
+#endif
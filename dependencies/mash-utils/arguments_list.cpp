@@ -28,6 +28,7 @@
 
 #include "arguments_list.h"
 #include "stringutils.h"
+#include <stdlib.h>
 #include <assert.h>
 
 using namespace std;
@@ -74,10 +75,8 @@ ArgumentsList::~ArgumentsList()
 
 void ArgumentsList::append(const ArgumentsList& list)
 {
-    tArgumentsVector::const_iterator iter, iterEnd;
-
-    for (iter = list._arguments.begin(), iterEnd = list._arguments.end(); iter != iterEnd; ++iter)
-        _arguments.push_back(*iter);
+    for (int i = 0; i < list.size(); ++i)
+        add(list.getCString(i), list.length(i));
 }
 
 
@@ -86,59 +85,88 @@ void ArgumentsList::add(const std::string& value)
     // Assertions
     assert(!value.empty());
 
-    _arguments.push_back(value);
+    add(value.c_str(), value.size());
+}
+
+
+void ArgumentsList::add(const char* pValue, unsigned int length)
+{
+    // Assertions
+    assert(pValue);
+    assert(length > 0);
+
+    _offsets.push_back(_storage.size());
+    _storage.append(pValue, length);
+    _storage.push_back('\0');
 }
 
 
 void ArgumentsList::add(int value)
 {
-    _arguments.push_back(StringUtils::toString(value));
+    add(StringUtils::toString(value));
 }
 
 
 void ArgumentsList::add(float value)
 {
-    _arguments.push_back(StringUtils::toString(value));
+    add(StringUtils::toString(value));
 }
 
 
 void ArgumentsList::add(const struct timeval& value)
 {
-    _arguments.push_back(StringUtils::toString(value));
+    add(StringUtils::toString(value));
 }
 
 
 std::string ArgumentsList::getString(unsigned int index) const
 {
     // Assertions
-    assert(index < _arguments.size());
+    assert(index < _offsets.size());
+
+    return std::string(_storage.data() + _offsets[index], length(index));
+}
+
+
+const char* ArgumentsList::getCString(unsigned int index) const
+{
+    // Assertions
+    assert(index < _offsets.size());
 
-    return _arguments[index];
+    return _storage.c_str() + _offsets[index];
 }
 
 
 int ArgumentsList::getInt(unsigned int index) const
 {
     // Assertions
-    assert(index < _arguments.size());
+    assert(index < _offsets.size());
 
-    return StringUtils::parseInt(_arguments[index]);
+    return (int) strtol(getCString(index), 0, 10);
 }
 
 
 float ArgumentsList::getFloat(unsigned int index) const
 {
     // Assertions
-    assert(index < _arguments.size());
+    assert(index < _offsets.size());
 
-    return StringUtils::parseFloat(_arguments[index]);
+    return strtof(getCString(index), 0);
 }
 
 
 struct timeval ArgumentsList::getTimeval(unsigned int index) const
 {
     // Assertions
-    assert(index < _arguments.size());
+    assert(index < _offsets.size());
+
+    return StringUtils::parseTimeval(getString(index));
+}
+
+
+unsigned int ArgumentsList::length(unsigned int index) const
+{
+    unsigned int end = (index + 1 < _offsets.size() ? _offsets[index + 1] : _storage.size());
 
-    return StringUtils::parseTimeval(_arguments[index]);
+    return end - _offsets[index] - 1;
 }
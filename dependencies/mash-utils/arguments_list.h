@@ -39,6 +39,10 @@ namespace Mash
 {
     //--------------------------------------------------------------------------
     /// @brief  Represents a list of arguments for a command
+    ///
+    /// All the arguments are stored one after the other in a single string, so
+    /// a list that is cleared and filled again (like the one used to receive
+    /// the messages) doesn't allocate memory once it is large enough.
     //--------------------------------------------------------------------------
     class MASH_SYMBOL ArgumentsList
     {
@@ -87,6 +91,15 @@ namespace Mash
         //----------------------------------------------------------------------
         void add(const std::string& value);
 
+        //----------------------------------------------------------------------
+        /// @brief  Add a string argument to the list, without building a
+        ///         temporary std::string
+        ///
+        /// @param  pValue  The characters of the argument
+        /// @param  length  Number of characters
+        //----------------------------------------------------------------------
+        void add(const char* pValue, unsigned int length);
+
         //----------------------------------------------------------------------
         /// @brief  Add an integer argument to the list
         //----------------------------------------------------------------------
@@ -107,6 +120,19 @@ namespace Mash
         //----------------------------------------------------------------------
         std::string getString(unsigned int index) const;
 
+        //----------------------------------------------------------------------
+        /// @brief  Returns one of the argument as a null-terminated string,
+        ///         without copying it
+        ///
+        /// The pointer is valid until the list is modified.
+        //----------------------------------------------------------------------
+        const char* getCString(unsigned int index) const;
+
+        //----------------------------------------------------------------------
+        /// @brief  Returns the length of one of the argument
+        //----------------------------------------------------------------------
+        unsigned int length(unsigned int index) const;
+
         //----------------------------------------------------------------------
         /// @brief  Returns one of the argument as an integer
         //----------------------------------------------------------------------
@@ -127,7 +153,7 @@ namespace Mash
         //----------------------------------------------------------------------
         inline int size() const
         {
-            return _arguments.size();
+            return _offsets.size();
         }
 
         //----------------------------------------------------------------------
@@ -135,19 +161,20 @@ namespace Mash
         //----------------------------------------------------------------------
         inline void clear()
         {
-            _arguments.clear();
+            _storage.clear();
+            _offsets.clear();
         }
 
 
         //_____ Internal types __________
     private:
-        typedef std::vector<std::string>    tArgumentsVector;
-        typedef tArgumentsVector::iterator  tArgumentsIterator;
+        typedef std::vector<unsigned int>   tOffsetsList;
 
 
         //_____ Attributes __________
     private:
-        tArgumentsVector _arguments;
+        std::string     _storage;   ///< The arguments, each one followed by a '\0'
+        tOffsetsList    _offsets;   ///< Position of each argument in the storage
     };
 }
 
@@ -0,0 +1,335 @@
+/*******************************************************************************
+* MASH 3D simulator
+* 
+* Copyright (c) 2014 Idiap Research Institute, http://www.idiap.ch/
+* Written by Philip Abbet <philip.abbet@idiap.ch>
+* 
+* This file is part of mash-simulator.
+* 
+* mash-simulator is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 3 as
+* published by the Free Software Foundation.
+* 
+* mash-simulator is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+* 
+* You should have received a copy of the GNU General Public License
+* along with mash-simulator. If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+
+
+/** @file   async_writer.cpp
+    @author Philip Abbet (philip.abbet@idiap.ch)
+
+    Implementation of the 'AsyncWriter' class
+*/
+
+#include "async_writer.h"
+#include <string>
+#include <stdlib.h>
+#include <memory.h>
+#include <sched.h>
+#include <time.h>
+#include <assert.h>
+
+using namespace std;
+using namespace Mash;
+
+
+/****************************** STATIC ATTRIBUTES *****************************/
+
+char*               AsyncWriter::_pBuffer   = 0;
+volatile uint64_t   AsyncWriter::_head      = 0;
+volatile uint64_t   AsyncWriter::_tail      = 0;
+volatile bool       AsyncWriter::_bRunning  = false;
+bool                AsyncWriter::_bStopped  = false;
+pthread_t           AsyncWriter::_thread;
+pthread_mutex_t     AsyncWriter::_mutex     = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t      AsyncWriter::_condition = PTHREAD_COND_INITIALIZER;
+
+
+/********************************** FUNCTIONS *********************************/
+
+static inline uint64_t recordLength(uint32_t size, size_t headerSize)
+{
+    // Records are aligned on 8 bytes
+    return (headerSize + size + 7) & ~((uint64_t) 7);
+}
+
+
+/******************************* STATIC METHODS *******************************/
+
+void AsyncWriter::write(tWriteFunction* pFunction, void* pDestination,
+                        const char* pData, int64_t size)
+{
+    // Assertions
+    assert(pFunction);
+    assert(pData);
+
+    if (size <= 0)
+        return;
+
+    uint64_t length = recordLength((uint32_t) size, sizeof(tRecord));
+
+    if ((length > CAPACITY / 2) || (!_bRunning && !start()))
+    {
+        writeNow(pFunction, pDestination, pData, size);
+        return;
+    }
+
+    // Reserve some space in the buffer
+    uint64_t head;
+    uint64_t offset;
+
+    while (true)
+    {
+        head = _head;
+        offset = head % CAPACITY;
+
+        // A record never wraps around the end of the buffer: the remaining
+        // space is skipped (with a padding marker) if necessary
+        uint64_t reserved = length;
+        if (offset + length > CAPACITY)
+            reserved += CAPACITY - offset;
+
+        if (head + reserved - _tail > CAPACITY)
+        {
+            // The buffer is full: write its content ourselves
+            flush();
+            continue;
+        }
+
+        if (__sync_bool_compare_and_swap(&_head, head, head + reserved))
+        {
+            if (reserved != length)
+            {
+                ((tRecord*) (_pBuffer + offset))->size = PADDING;
+                offset = 0;
+            }
+
+            break;
+        }
+    }
+
+    // Copy the data, and commit the record
+    tRecord* pRecord = (tRecord*) (_pBuffer + offset);
+    pRecord->pFunction      = pFunction;
+    pRecord->pDestination   = pDestination;
+    memcpy(pRecord + 1, pData, size);
+
+    __sync_synchronize();
+    pRecord->size = (uint32_t) size;
+
+    if (_head - _tail > CAPACITY / 2)
+        pthread_cond_signal(&_condition);
+}
+
+
+void AsyncWriter::flush()
+{
+    pthread_mutex_lock(&_mutex);
+    drain();
+    pthread_mutex_unlock(&_mutex);
+}
+
+
+bool AsyncWriter::start()
+{
+    static bool bHandlersInstalled = false;
+
+    pthread_mutex_lock(&_mutex);
+
+    if (!_bRunning && !_bStopped)
+    {
+        if (!_pBuffer)
+        {
+            _pBuffer = new char[CAPACITY];
+            memset(_pBuffer, 0, CAPACITY);
+        }
+
+        if (!bHandlersInstalled)
+        {
+            pthread_atfork(prepareFork, parentAfterFork, childAfterFork);
+            atexit(stop);
+            bHandlersInstalled = true;
+        }
+
+        _bRunning = true;
+
+        if (pthread_create(&_thread, 0, writerThread, 0) != 0)
+            _bRunning = false;
+    }
+
+    bool bResult = _bRunning;
+
+    pthread_mutex_unlock(&_mutex);
+
+    return bResult;
+}
+
+
+void AsyncWriter::stop()
+{
+    pthread_mutex_lock(&_mutex);
+
+    bool bRunning = _bRunning;
+
+    _bRunning = false;
+    _bStopped = true;
+
+    pthread_cond_signal(&_condition);
+    pthread_mutex_unlock(&_mutex);
+
+    if (bRunning)
+        pthread_join(_thread, 0);
+
+    flush();
+}
+
+
+void AsyncWriter::drain()
+{
+    // Note: the mutex must be locked
+
+    if (!_pBuffer)
+        return;
+
+    // Declarations
+    string batch;
+    tWriteFunction* pFunction = 0;
+    void* pDestination = 0;
+    uint64_t tail = _tail;
+
+    while (tail != _head)
+    {
+        uint64_t offset = tail % CAPACITY;
+        tRecord* pRecord = (tRecord*) (_pBuffer + offset);
+
+        uint32_t size = pRecord->size;
+        if (size == 0)
+        {
+            // Reserved by another thread, but not committed yet
+            sched_yield();
+            continue;
+        }
+
+        __sync_synchronize();
+
+        uint64_t length;
+
+        if (size == PADDING)
+        {
+            length = CAPACITY - offset;
+        }
+        else
+        {
+            // Consecutive records of the same destination are written at once
+            if ((pRecord->pFunction != pFunction) || (pRecord->pDestination != pDestination))
+            {
+                if (!batch.empty())
+                    pFunction(pDestination, batch.data(), batch.size());
+
+                batch.clear();
+                pFunction = pRecord->pFunction;
+                pDestination = pRecord->pDestination;
+            }
+
+            batch.append((const char*) (pRecord + 1), size);
+
+            length = recordLength(size, sizeof(tRecord));
+        }
+
+        // The space must be zeroed before being reused, since the size of a
+        // record is used as its commit flag
+        memset(pRecord, 0, length);
+        tail += length;
+    }
+
+    if (!batch.empty())
+        pFunction(pDestination, batch.data(), batch.size());
+
+    batch.clear();
+
+    __sync_synchronize();
+    _tail = tail;
+}
+
+
+void AsyncWriter::writeNow(tWriteFunction* pFunction, void* pDestination,
+                           const char* pData, int64_t size)
+{
+    pthread_mutex_lock(&_mutex);
+
+    // Preserve the order of the data
+    drain();
+
+    pFunction(pDestination, pData, size);
+
+    pthread_mutex_unlock(&_mutex);
+}
+
+
+void* AsyncWriter::writerThread(void*)
+{
+    pthread_mutex_lock(&_mutex);
+
+    while (_bRunning)
+    {
+        drain();
+
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+
+        deadline.tv_nsec += WAKEUP_DELAY * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L)
+        {
+            deadline.tv_sec += 1;
+            deadline.tv_nsec -= 1000000000L;
+        }
+
+        pthread_cond_timedwait(&_condition, &_mutex, &deadline);
+    }
+
+    drain();
+
+    pthread_mutex_unlock(&_mutex);
+
+    return 0;
+}
+
+
+void AsyncWriter::prepareFork()
+{
+    // The pending data is written by the parent process only
+    pthread_mutex_lock(&_mutex);
+    drain();
+}
+
+
+void AsyncWriter::parentAfterFork()
+{
+    pthread_mutex_unlock(&_mutex);
+}
+
+
+void AsyncWriter::childAfterFork()
+{
+    // The thread doesn't exist in the child process, it will be started again
+    // when needed
+    _bRunning = false;
+
+    // Data added by another thread of the parent process after the flush is
+    // written by the parent process
+    if (_pBuffer && (_head != _tail))
+    {
+        memset(_pBuffer, 0, CAPACITY);
+        _head = 0;
+        _tail = 0;
+    }
+
+    pthread_mutex_init(&_mutex, 0);
+    pthread_cond_init(&_condition, 0);
+}
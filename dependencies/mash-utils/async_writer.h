@@ -0,0 +1,132 @@
+/*******************************************************************************
+* MASH 3D simulator
+* 
+* Copyright (c) 2014 Idiap Research Institute, http://www.idiap.ch/
+* Written by Philip Abbet <philip.abbet@idiap.ch>
+* 
+* This file is part of mash-simulator.
+* 
+* mash-simulator is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 3 as
+* published by the Free Software Foundation.
+* 
+* mash-simulator is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+* 
+* You should have received a copy of the GNU General Public License
+* along with mash-simulator. If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+
+
+/** @file   async_writer.h
+    @author Philip Abbet (philip.abbet@idiap.ch)
+
+    Declaration of the 'AsyncWriter' class
+*/
+
+#ifndef _MASH_ASYNCWRITER_H_
+#define _MASH_ASYNCWRITER_H_
+
+#include "platform.h"
+#include <stdint.h>
+#include <pthread.h>
+
+
+namespace Mash
+{
+    //--------------------------------------------------------------------------
+    /// @brief  Per-process ring buffer in which the data to write in the log
+    ///         files is stored, and written by a background thread
+    ///
+    /// Adding some data doesn't take any lock: space is reserved in the buffer
+    /// with an atomic operation, and the record is marked as committed once
+    /// copied. The background thread wakes up periodically (or when the buffer
+    /// is half full), and gives all the consecutive records of a destination
+    /// to its write function in one call.
+    ///
+    /// Threads don't survive a fork(): the buffer is flushed before a fork, and
+    /// the child process starts its own thread when needed. The buffer is also
+    /// flushed when the process exits.
+    //--------------------------------------------------------------------------
+    class MASH_SYMBOL AsyncWriter
+    {
+        //_____ Public internal types __________
+    public:
+        //----------------------------------------------------------------------
+        /// @brief  Function called by the background thread to write some
+        ///         data into a destination
+        //----------------------------------------------------------------------
+        typedef void tWriteFunction(void* pDestination, const char* pData,
+                                    int64_t size);
+
+
+        //_____ Static methods __________
+    public:
+        //----------------------------------------------------------------------
+        /// @brief  Add some data to write
+        ///
+        /// @param  pFunction       The function that will write the data
+        /// @param  pDestination    The destination (given to the function)
+        /// @param  pData           The data (copied)
+        /// @param  size            Size of the data, in bytes
+        //----------------------------------------------------------------------
+        static void write(tWriteFunction* pFunction, void* pDestination,
+                          const char* pData, int64_t size);
+
+        //----------------------------------------------------------------------
+        /// @brief  Write all the pending data (synchronously)
+        ///
+        /// Must be called before a destination is destroyed, or before its
+        /// content is read.
+        //----------------------------------------------------------------------
+        static void flush();
+
+
+    private:
+        static bool start();
+        static void stop();
+        static void drain();
+        static void writeNow(tWriteFunction* pFunction, void* pDestination,
+                             const char* pData, int64_t size);
+        static void* writerThread(void* pArgument);
+
+        static void prepareFork();
+        static void parentAfterFork();
+        static void childAfterFork();
+
+
+        //_____ Internal types __________
+    private:
+        struct tRecord
+        {
+            volatile uint32_t   size;           ///< 0 while not committed
+            uint32_t            reserved;
+            tWriteFunction*     pFunction;
+            void*               pDestination;
+        };
+
+
+        //_____ Constants __________
+    private:
+        static const uint64_t   CAPACITY        = 1024 * 1024;
+        static const uint32_t   PADDING         = 0xFFFFFFFF;
+        static const int        WAKEUP_DELAY    = 20;       ///< In milliseconds
+
+
+        //_____ Static attributes __________
+    private:
+        static char*                _pBuffer;
+        static volatile uint64_t    _head;      ///< End of the reserved space
+        static volatile uint64_t    _tail;      ///< End of the written data
+        static volatile bool        _bRunning;  ///< Is the thread running?
+        static bool                 _bStopped;  ///< Set when the process exits
+        static pthread_t            _thread;
+        static pthread_mutex_t      _mutex;     ///< Held by the writing thread
+        static pthread_cond_t       _condition;
+    };
+}
+
+#endif
@@ -43,7 +43,7 @@ const unsigned int BUFFER_INCREMENT = 1024;
 /****************************** CONSTRUCTION / DESTRUCTION ******************************/
 
 DataBuffer::DataBuffer()
-: _data(0), _size(0), _allocated(BUFFER_INCREMENT)
+: _data(0), _start(0), _size(0), _scanned(0), _allocated(BUFFER_INCREMENT)
 {
     _data = new unsigned char[_allocated];
 }
@@ -51,7 +51,8 @@ DataBuffer::DataBuffer()
 //-----------------------------------------------------------------------
 
 DataBuffer::DataBuffer(const std::string& str)
-: _data(0), _size(str.size()), _allocated(((str.size() / BUFFER_INCREMENT) + 1) * BUFFER_INCREMENT)
+: _data(0), _start(0), _size(str.size()), _scanned(0),
+  _allocated(((str.size() / BUFFER_INCREMENT) + 1) * BUFFER_INCREMENT)
 {
     _data = new unsigned char[_allocated];
     memcpy(_data, str.c_str(), _size);
@@ -60,7 +61,8 @@ DataBuffer::DataBuffer(const std::string& str)
 //-----------------------------------------------------------------------
 
 DataBuffer::DataBuffer(const unsigned char* pData, unsigned int dataSize)
-: _data(0), _size(dataSize), _allocated(((dataSize / BUFFER_INCREMENT) + 1) * BUFFER_INCREMENT)
+: _data(0), _start(0), _size(dataSize), _scanned(0),
+  _allocated(((dataSize / BUFFER_INCREMENT) + 1) * BUFFER_INCREMENT)
 {
     assert(pData);
     assert(dataSize > 0);
@@ -81,10 +83,10 @@ DataBuffer::~DataBuffer()
 
 void DataBuffer::add(const std::string& str)
 {
-    if (_size + str.size() > _allocated)
-        reallocate(str.size());
+    if (str.empty())
+        return;
 
-    memcpy(_data + _size, str.c_str(), str.size());
+    memcpy(reserve(str.size()), str.c_str(), str.size());
 
     _size += str.size();
 }
@@ -95,78 +97,128 @@ void DataBuffer::add(const unsigned char* pData, unsigned int dataSize)
     assert(pData);
     assert(dataSize > 0);
 
-    if (_size + dataSize > _allocated)
-        reallocate(dataSize);
-
-    memcpy(_data + _size, pData, dataSize);
+    memcpy(reserve(dataSize), pData, dataSize);
 
     _size += dataSize;
 }
 
 
-void DataBuffer::extract(unsigned char* pDest, unsigned int nbBytes)
+unsigned char* DataBuffer::reserve(unsigned int nbBytes)
 {
-    assert(pDest);
-    assert(nbBytes <= _size);
-
-    memcpy(pDest, _data, nbBytes);
+    if (_start + _size + nbBytes > _allocated)
+    {
+        if (_size + nbBytes <= _allocated)
+        {
+            // Enough space once the remaining data is moved at the beginning
+            memmove(_data, _data + _start, _size);
+            _start = 0;
+        }
+        else
+        {
+            reallocate(nbBytes);
+        }
+    }
 
-    unsigned char* previous = _data;
+    return _data + _start + _size;
+}
 
-    _size -= nbBytes;
 
-    _data = new unsigned char[_allocated];
-    memcpy(_data, previous + nbBytes, _size);
+void DataBuffer::commit(unsigned int nbBytes)
+{
+    assert(_start + _size + nbBytes <= _allocated);
 
-    delete[] previous;
+    _size += nbBytes;
 }
 
 
-bool DataBuffer::extractLine(std::string &strLine)
+void DataBuffer::extract(unsigned char* pDest, unsigned int nbBytes)
 {
-    for (unsigned int i = 0; i < _size; ++i)
-    {
-        if (_data[i] == '\n')
-        {
-            _data[i] = 0;
-            strLine = (char*) _data;
+    assert(pDest);
+    assert(nbBytes <= _size);
 
-            unsigned char* previous = _data;
+    memcpy(pDest, _data + _start, nbBytes);
 
-            _size -= i + 1;
+    consume(nbBytes);
+}
 
-            _data = new unsigned char[_allocated];
-            memcpy(_data, previous + i + 1, _size);
 
-            delete[] previous;
+bool DataBuffer::extractLine(std::string &strLine)
+{
+    unsigned int length;
 
-            return true;
-        }
-    }
+    if (!findLine(&length))
+        return false;
 
-    return false;
+    strLine.assign((const char*) _data + _start, length);
+
+    consume(length + 1);
+
+    return true;
 }
 
 
 void DataBuffer::reset()
 {
+    _start = 0;
     _size = 0;
+    _scanned = 0;
 }
 
 
 void DataBuffer::reallocate(unsigned int nbBytesToAdd)
 {
-    if (nbBytesToAdd <= _allocated - _size)
+    if (nbBytesToAdd <= _allocated - _start - _size)
         return;
 
-    _allocated = (((_size + nbBytesToAdd) / BUFFER_INCREMENT) + 1) * BUFFER_INCREMENT;
+    // Grow geometrically, to keep the cost of large inputs linear
+    unsigned int allocated = _allocated * 2;
+    if (allocated < _size + nbBytesToAdd)
+        allocated = (((_size + nbBytesToAdd) / BUFFER_INCREMENT) + 1) * BUFFER_INCREMENT;
 
     unsigned char* previous = _data;
 
-    _data = new unsigned char[_allocated];
-    memcpy(_data, previous, _size);
+    _data = new unsigned char[allocated];
+    memcpy(_data, previous + _start, _size);
 
     delete[] previous;
+
+    _allocated = allocated;
+    _start = 0;
+}
+
+
+void DataBuffer::consume(unsigned int nbBytes)
+{
+    _start += nbBytes;
+    _size -= nbBytes;
+    _scanned = (_scanned > nbBytes ? _scanned - nbBytes : 0);
+
+    if (_size == 0)
+        _start = 0;
+}
+
+
+bool DataBuffer::findLine(unsigned int* length)
+{
+    // Only search the bytes received since the last call
+    unsigned char* pEnd = (unsigned char*) memchr(_data + _start + _scanned, '\n', _size - _scanned);
+    if (!pEnd)
+    {
+        _scanned = _size;
+        return false;
+    }
+
+    *length = pEnd - (_data + _start);
+
+    return true;
+}
+
+
+bool DataBuffer::hasMessage()
+{
+    unsigned int length;
+
+    return findLine(&length);
 }
 
 
@@ -177,52 +229,103 @@ bool DataBuffer::extractMessage(std::string* strMessage, ArgumentsList* argument
     assert(arguments);
 
     // Declarations
-    size_t offset;
-    tStringList parts;
-    tStringIterator iter, iterEnd;
-    string strLine;
+    unsigned int length;
 
-    while (extractLine(strLine))
+    while (findLine(&length))
     {
-        if (strLine.empty())
+        // The line is tokenized (and decoded) in place: it stays in memory
+        // until the next call to add() or reserve()
+        char* pLine = (char*) _data + _start;
+        char* pEnd = pLine + length;
+        char* p = pLine;
+
+        consume(length + 1);
+
+        while ((p < pEnd) && (*p == ' '))
+            ++p;
+
+        if (p == pEnd)
             continue;
 
-        parts = StringUtils::split(strLine, " ");
+        // Command
+        char* pToken = p;
+        while ((p < pEnd) && (*p != ' '))
+            ++p;
+
+        strMessage->assign(pToken, p - pToken);
 
-        bool bQuotedString = false;
-        string quotedString = "";
-        for (iter = ++(parts.begin()), iterEnd = parts.end(); iter != iterEnd; ++iter)
+        // Arguments
+        while (p < pEnd)
         {
-            if (!bQuotedString)
+            while ((p < pEnd) && (*p == ' '))
+                ++p;
+
+            if (p == pEnd)
+                break;
+
+            pToken = p;
+            while ((p < pEnd) && (*p != ' '))
+                ++p;
+
+            unsigned int tokenLength = p - pToken;
+
+            if (*pToken != '\'')
             {
-                if (iter->at(0) == '\'')
-                {
-                    quotedString = iter->substr(1);
-                    bQuotedString = true;
-                }
-                else
-                {
-                    arguments->add(decodeArgument(*iter));
-                }
+                decodeInPlace(pToken, &tokenLength);
+                arguments->add(pToken, tokenLength);
+                continue;
+            }
+
+            // Quoted string: the tokens are joined (with one space) until the
+            // one ending with a non-escaped quote
+            char* pWrite = pToken;
+            char* pRead = pToken + 1;
+            char* pTokenEnd = p;
+            bool bFirst = true;
+            bool bClosed = false;
+
+            while (true)
+            {
+                unsigned int n = pTokenEnd - pRead;
+
+                bClosed = (n > 0) && (pRead[n - 1] == '\'') &&
+                          (((n == 1) && !bFirst) || ((n >= 2) && (pRead[n - 2] != '\\')));
+
+                if (!bFirst)
+                    *pWrite++ = ' ';
+
+                if (bClosed)
+                    --n;
+
+                memmove(pWrite, pRead, n);
+                pWrite += n;
+
+                if (bClosed)
+                    break;
+
+                while ((p < pEnd) && (*p == ' '))
+                    ++p;
+
+                if (p == pEnd)
+                    break;
+
+                pRead = p;
+                while ((p < pEnd) && (*p != ' '))
+                    ++p;
+
+                pTokenEnd = p;
+                bFirst = false;
             }
-            else
+
+            // Note: an unterminated quoted string is ignored
+            unsigned int argumentLength = pWrite - pToken;
+            if (bClosed && (argumentLength > 0))
             {
-                if ((iter->at(iter->size() - 1) == '\'') and ((iter->size() == 1) || (iter->at(iter->size() - 2) != '\\')))
-                {
-                    quotedString += " " + iter->substr(0, iter->size() - 1);
-                    arguments->add(decodeArgument(quotedString));
-                    bQuotedString = false;
-                    quotedString = "";
-                }
-                else
-                {
-                    quotedString += " " + *iter;
-                }
+                decodeInPlace(pToken, &argumentLength);
+                arguments->add(pToken, argumentLength);
             }
         }
 
-        (*strMessage) = parts[0];
-
         return true;
     }
 
@@ -246,3 +349,26 @@ std::string DataBuffer::decodeArgument(const std::string& strArgument)
 
     return strResult;
 }
+
+
+void DataBuffer::decodeInPlace(char* pArgument, unsigned int* length)
+{
+    char* pRead = pArgument;
+    char* pWrite = pArgument;
+    char* pEnd = pArgument + *length;
+
+    while (pRead < pEnd)
+    {
+        if ((*pRead == '\\') && (pRead + 1 < pEnd) && ((pRead[1] == '\'') || (pRead[1] == 'n')))
+        {
+            *pWrite++ = (pRead[1] == 'n' ? '\n' : '\'');
+            pRead += 2;
+        }
+        else
+        {
+            *pWrite++ = *pRead++;
+        }
+    }
+
+    *length = pWrite - pArgument;
+}
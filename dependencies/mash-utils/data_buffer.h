@@ -37,6 +37,11 @@ namespace Mash
 {
     //--------------------------------------------------------------------------
     /// @brief  Buffer of data
+    ///
+    /// The extracted data isn't removed from the memory: a read offset is
+    /// moved instead, and the remaining data is only moved to the beginning
+    /// of the memory when some space is needed at the end. The messages are
+    /// tokenized in place.
     //--------------------------------------------------------------------------
     class DataBuffer
     {
@@ -53,6 +58,23 @@ namespace Mash
         void add(const std::string& str);
         void add(const unsigned char* pData, unsigned int dataSize);
 
+        //----------------------------------------------------------------------
+        /// @brief  Returns a pointer to some free space at the end of the
+        ///         buffer, in which some data can be written directly (for
+        ///         instance by recv())
+        ///
+        /// @param  nbBytes     Number of bytes needed
+        /// @return             Pointer to the free space
+        /// @see    commit()
+        //----------------------------------------------------------------------
+        unsigned char* reserve(unsigned int nbBytes);
+
+        //----------------------------------------------------------------------
+        /// @brief  Indicates how many bytes were written in the space returned
+        ///         by reserve()
+        //----------------------------------------------------------------------
+        void commit(unsigned int nbBytes);
+
         void extract(unsigned char* pDest, unsigned int nbBytes);
         bool extractLine(std::string &strLine);
 
@@ -65,17 +87,28 @@ namespace Mash
 
         bool extractMessage(std::string* strMessage, ArgumentsList* arguments);
 
+        //----------------------------------------------------------------------
+        /// @brief  Indicates if a complete message can be extracted without
+        ///         receiving more data
+        //----------------------------------------------------------------------
+        bool hasMessage();
+
         static std::string encodeArgument(const std::string& strArgument);
         static std::string decodeArgument(const std::string& strArgument);
 
     private:
         void reallocate(unsigned int nbBytesToAdd);
+        void consume(unsigned int nbBytes);
+        bool findLine(unsigned int* length);
+        static void decodeInPlace(char* pArgument, unsigned int* length);
 
 
         //_____ Attributes __________
     private:
         unsigned char*  _data;
-        unsigned int    _size;
+        unsigned int    _start;     ///< Offset of the first byte not extracted yet
+        unsigned int    _size;      ///< Number of bytes not extracted yet
+        unsigned int    _scanned;   ///< Number of bytes already searched for a '\n'
         unsigned int    _allocated;
     };
 }
@@ -0,0 +1,157 @@
+/*******************************************************************************
+* MASH 3D simulator
+* 
+* Copyright (c) 2014 Idiap Research Institute, http://www.idiap.ch/
+* Written by Philip Abbet <philip.abbet@idiap.ch>
+* 
+* This file is part of mash-simulator.
+* 
+* mash-simulator is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 3 as
+* published by the Free Software Foundation.
+* 
+* mash-simulator is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+* 
+* You should have received a copy of the GNU General Public License
+* along with mash-simulator. If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+
+/** @file   latency_histogram.cpp
+    @author Philip Abbet (philip.abbet@idiap.ch)
+
+    Implementation of the 'LatencyHistogram' class
+*/
+
+#include "latency_histogram.h"
+#include <memory.h>
+
+using namespace Mash;
+
+
+/************************* CONSTRUCTION / DESTRUCTION *************************/
+
+LatencyHistogram::LatencyHistogram()
+{
+    reset();
+}
+
+
+LatencyHistogram::~LatencyHistogram()
+{
+}
+
+
+/*********************************** METHODS **********************************/
+
+void LatencyHistogram::record(unsigned long long value)
+{
+    ++_buckets[bucketOf(value)];
+
+    if ((_count == 0) || (value < _min))
+        _min = value;
+
+    if (value > _max)
+        _max = value;
+
+    ++_count;
+    _sum += value;
+}
+
+
+void LatencyHistogram::reset()
+{
+    memset(_buckets, 0, sizeof(_buckets));
+
+    _count  = 0;
+    _sum    = 0;
+    _min    = 0;
+    _max    = 0;
+}
+
+
+void LatencyHistogram::merge(const LatencyHistogram& histogram)
+{
+    if (histogram._count == 0)
+        return;
+
+    for (unsigned int i = 0; i < NB_BUCKETS; ++i)
+        _buckets[i] += histogram._buckets[i];
+
+    if ((_count == 0) || (histogram._min < _min))
+        _min = histogram._min;
+
+    if (histogram._max > _max)
+        _max = histogram._max;
+
+    _count += histogram._count;
+    _sum += histogram._sum;
+}
+
+
+unsigned long long LatencyHistogram::percentile(double percentile) const
+{
+    if (_count == 0)
+        return 0;
+
+    unsigned long long target = (unsigned long long) (percentile * 0.01 * _count + 0.5);
+    if (target == 0)
+        target = 1;
+    else if (target > _count)
+        target = _count;
+
+    unsigned long long total = 0;
+    for (unsigned int i = 0; i < NB_BUCKETS; ++i)
+    {
+        total += _buckets[i];
+        if (total >= target)
+        {
+            unsigned long long value = valueOf(i);
+            if (value < _min)
+                return _min;
+            if (value > _max)
+                return _max;
+            return value;
+        }
+    }
+
+    return _max;
+}
+
+
+/******************************* STATIC METHODS *******************************/
+
+unsigned int LatencyHistogram::bucketOf(unsigned long long value)
+{
+    if (value < NB_EXACT_BUCKETS)
+        return (unsigned int) value;
+
+    // Position of the most significant bit (at least 6, since value >= 64)
+    unsigned int msb = 63 - __builtin_clzll(value);
+
+    unsigned int octave = msb - 6;
+    if (octave >= NB_OCTAVES)
+        return NB_BUCKETS - 1;
+
+    unsigned int sub = (unsigned int) (value >> (msb - 5)) & (NB_SUB_BUCKETS - 1);
+
+    return NB_EXACT_BUCKETS + octave * NB_SUB_BUCKETS + sub;
+}
+
+
+unsigned long long LatencyHistogram::valueOf(unsigned int bucket)
+{
+    if (bucket < NB_EXACT_BUCKETS)
+        return bucket;
+
+    unsigned int octave = (bucket - NB_EXACT_BUCKETS) / NB_SUB_BUCKETS;
+    unsigned int sub = (bucket - NB_EXACT_BUCKETS) % NB_SUB_BUCKETS;
+    unsigned int shift = octave + 1;
+
+    // Middle of the bucket
+    return (((unsigned long long) (NB_SUB_BUCKETS + sub)) << shift) +
+           (1ULL << shift) / 2;
+}
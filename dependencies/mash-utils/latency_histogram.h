@@ -0,0 +1,146 @@
+/*******************************************************************************
+* MASH 3D simulator
+* 
+* Copyright (c) 2014 Idiap Research Institute, http://www.idiap.ch/
+* Written by Philip Abbet <philip.abbet@idiap.ch>
+* 
+* This file is part of mash-simulator.
+* 
+* mash-simulator is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 3 as
+* published by the Free Software Foundation.
+* 
+* mash-simulator is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+* 
+* You should have received a copy of the GNU General Public License
+* along with mash-simulator. If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+
+/** @file   latency_histogram.h
+    @author Philip Abbet (philip.abbet@idiap.ch)
+
+    Declaration of the 'LatencyHistogram' class
+*/
+
+#ifndef _MASH_LATENCYHISTOGRAM_H_
+#define _MASH_LATENCYHISTOGRAM_H_
+
+#include "platform.h"
+
+
+namespace Mash
+{
+    //--------------------------------------------------------------------------
+    /// @brief  Histogram of latencies (in microseconds) with a bounded
+    ///         relative error
+    ///
+    /// The values below 64 are stored exactly. Above, each power of two is
+    /// divided into 32 buckets, which gives a relative error of at most ~3%
+    /// over the whole range, with a fixed memory footprint and an O(1)
+    /// recording cost.
+    //--------------------------------------------------------------------------
+    class MASH_SYMBOL LatencyHistogram
+    {
+        //_____ Construction / Destruction __________
+    public:
+        //----------------------------------------------------------------------
+        /// @brief  Constructor
+        //----------------------------------------------------------------------
+        LatencyHistogram();
+
+        //----------------------------------------------------------------------
+        /// @brief  Destructor
+        //----------------------------------------------------------------------
+        ~LatencyHistogram();
+
+
+        //_____ Methods __________
+    public:
+        //----------------------------------------------------------------------
+        /// @brief  Record a value
+        ///
+        /// @param  value   The latency, in microseconds
+        //----------------------------------------------------------------------
+        void record(unsigned long long value);
+
+        //----------------------------------------------------------------------
+        /// @brief  Remove all the recorded values
+        //----------------------------------------------------------------------
+        void reset();
+
+        //----------------------------------------------------------------------
+        /// @brief  Add all the values recorded by another histogram
+        ///
+        /// @param  histogram   The other histogram
+        //----------------------------------------------------------------------
+        void merge(const LatencyHistogram& histogram);
+
+        //----------------------------------------------------------------------
+        /// @brief  Returns the number of recorded values
+        //----------------------------------------------------------------------
+        inline unsigned long long count() const
+        {
+            return _count;
+        }
+
+        //----------------------------------------------------------------------
+        /// @brief  Returns the smallest recorded value
+        //----------------------------------------------------------------------
+        inline unsigned long long min() const
+        {
+            return (_count > 0 ? _min : 0);
+        }
+
+        //----------------------------------------------------------------------
+        /// @brief  Returns the largest recorded value
+        //----------------------------------------------------------------------
+        inline unsigned long long max() const
+        {
+            return _max;
+        }
+
+        //----------------------------------------------------------------------
+        /// @brief  Returns the mean of the recorded values
+        //----------------------------------------------------------------------
+        inline unsigned long long mean() const
+        {
+            return (_count > 0 ? _sum / _count : 0);
+        }
+
+        //----------------------------------------------------------------------
+        /// @brief  Returns the value below which a given percentage of the
+        ///         recorded values fall
+        ///
+        /// @param  percentile  The percentile, in the range [0, 100]
+        //----------------------------------------------------------------------
+        unsigned long long percentile(double percentile) const;
+
+
+    private:
+        static unsigned int bucketOf(unsigned long long value);
+        static unsigned long long valueOf(unsigned int bucket);
+
+
+        //_____ Constants __________
+    private:
+        static const unsigned int   NB_EXACT_BUCKETS    = 64;
+        static const unsigned int   NB_SUB_BUCKETS      = 32;
+        static const unsigned int   NB_OCTAVES          = 38;
+        static const unsigned int   NB_BUCKETS          = NB_EXACT_BUCKETS + NB_OCTAVES * NB_SUB_BUCKETS;
+
+
+        //_____ Attributes __________
+    private:
+        unsigned int        _buckets[NB_BUCKETS];
+        unsigned long long  _count;
+        unsigned long long  _sum;
+        unsigned long long  _min;
+        unsigned long long  _max;
+    };
+}
+
+#endif
@@ -27,8 +27,10 @@
 */
 
 #include "outstream.h"
+#include "async_writer.h"
 #include <iostream>
 #include <iomanip>
+#include <iterator>
 #include <dirent.h>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -48,10 +50,7 @@ using namespace Mash;
 OPERATOR                                                    \
 {                                                           \
     if (_pStream && _pStream->bCanWrite)                    \
-    {                                                       \
-        _pStream->stream << val;                            \
-        _pStream->stream.flush();                           \
-    }                                                       \
+        _pStream->formatter << val;                         \
                                                             \
     if (_verbosityLevel <= verbosityLevel)                  \
     {                                                       \
@@ -75,7 +74,7 @@ OPERATOR                                                    \
 OutStream& OutStream::operator<< (const Mash::MANIPULATOR& manip) \
 {                                                           \
     if (_pStream && _pStream->bCanWrite)                    \
-        _pStream->stream << std::MANIPULATOR(manip.val);    \
+        _pStream->formatter << std::MANIPULATOR(manip.val); \
                                                             \
     if (_verbosityLevel <= verbosityLevel)                  \
         cout << std::MANIPULATOR(manip.val);                \
@@ -89,6 +88,20 @@ OutStream& OutStream::operator<< (const Mash::MANIPULATOR& manip) \
 unsigned char OutStream::verbosityLevel = 0;
 
 
+/********************************** FUNCTIONS *********************************/
+
+static bool readFile(const std::string& strFileName, std::string& content)
+{
+    ifstream file(strFileName.c_str(), ios_base::in | ios_base::binary);
+    if (!file.is_open())
+        return false;
+
+    content.append(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+
+    return true;
+}
+
+
 
 /************************* CONSTRUCTION / DESTRUCTION *************************/
 
@@ -200,10 +213,15 @@ void OutStream::close()
 {
     if (_pStream)
     {
+        commit();
+
         --_pStream->refCounter;
 
         if (_pStream->refCounter == 0)
         {
+            // The pending data must be written before the destruction
+            AsyncWriter::flush();
+
             _pStream->stream << "---------------- End of the log file ----------------" << endl;
             _pStream->stream.close();
             delete _pStream;
@@ -230,7 +248,10 @@ void OutStream::deleteFile()
     close();
 
     if (!strFileName.empty())
+    {
         remove(strFileName.c_str());
+        remove((strFileName + ".1").c_str());
+    }
 }
 
 
@@ -239,17 +260,23 @@ int64_t OutStream::dump(unsigned char** pBuffer, int64_t max_size)
     if (!pBuffer || !_pStream || _pStream->strFileName.empty() || !_pStream->bCanReopen)
         return 0;
 
-    ifstream inFile;
-    inFile.open(_pStream->strFileName.c_str());
-    if (!inFile.is_open())
-        return 0;
+    commit();
+    AsyncWriter::flush();
+
+    // Retrieve the content of the previous file (if the stream was rotated)
+    // and of the current one
+    string content;
+
+    readFile(_pStream->strFileName + ".1", content);
 
-    inFile.seekg(0, ios_base::end);
-    int size = inFile.tellg();
+    if (!readFile(_pStream->strFileName, content))
+        return 0;
 
-    if (size <= 0)
+    int64_t size = content.size();
+    if (size == 0)
         return 0;
 
+    int64_t offset = 0;
     bool bTruncated = false;
 
     if ((max_size > 0) && (max_size < 100))
@@ -257,14 +284,10 @@ int64_t OutStream::dump(unsigned char** pBuffer, int64_t max_size)
 
     if ((max_size > 0) && (size > max_size))
     {
-        inFile.seekg(size - (max_size - 4), ios_base::beg);
+        offset = size - (max_size - 4);
         size = max_size;
         bTruncated = true;
     }
-    else
-    {
-        inFile.seekg(0, ios_base::beg);
-    }
 
     (*pBuffer) = new unsigned char[size+1];
     memset(*pBuffer, 0, (size + 1) * sizeof(unsigned char));
@@ -277,14 +300,7 @@ int64_t OutStream::dump(unsigned char** pBuffer, int64_t max_size)
         pDest += 4;
     }
 
-    while (size - (pDest - (*pBuffer)) > 0)
-    {
-        inFile.read((char*) pDest, size - (pDest - (*pBuffer)));
-        unsigned int nb = inFile.gcount();
-        pDest += nb;
-    }
-
-    inFile.close();
+    memcpy(pDest, content.data() + offset, content.size() - offset);
 
     return size;
 }
@@ -314,55 +330,10 @@ void OutStream::write(const char* pData, int64_t size)
 
     if (_pStream && _pStream->bCanWrite)
     {
-        int64_t offset = 0;
-
-        if ((_pStream->maxSize > 0) && (_pStream->currentSize + size >= _pStream->maxSize * 2))
-        {
-            if (_pStream->bCanReopen)
-            {
-                if (size >= _pStream->maxSize)
-                {
-                    _pStream->stream.close();
-                    remove(_pStream->strFileName.c_str());
-
-                    _pStream->stream.open(_pStream->strFileName.c_str());
-
-                    offset = size - _pStream->maxSize;
-
-                    _pStream->currentSize = 0;
-                }
-                else
-                {
-                    unsigned char* pBuffer = 0;
-                    int nb = dump(&pBuffer, _pStream->maxSize - size);
-
-                    _pStream->stream.close();
-                    remove(_pStream->strFileName.c_str());
-
-                    _pStream->stream.open(_pStream->strFileName.c_str());
-                    _pStream->stream.write((const char*) pBuffer, nb);
-
-                    _pStream->currentSize = nb;
-
-                    delete[] pBuffer;
-                }
-            }
-            else
-            {
-                _pStream->bCanWrite = false;
-
-                _pStream->stream << "-------- Log file size limit reached -----------" << endl;
-                _pStream->stream.flush();
-            }
-        }
-
-        if (_pStream->bCanWrite)
-        {
-            _pStream->stream.write(pData + offset, size - offset);
-            _pStream->stream.flush();
+        _pStream->formatter.write(pData, size);
 
-            _pStream->currentSize += size - offset;
-        }
+        if (_pStream->formatter.tellp() >= MAX_PENDING_SIZE)
+            commit();
     }
 
     if (_verbosityLevel <= verbosityLevel)
@@ -385,8 +356,9 @@ OutStream& OutStream::operator<< (std::ostream& (*val)(std::ostream&))
 {
     if (_pStream && _pStream->bCanWrite)
     {
-        _pStream->stream << val;
-        _pStream->stream.flush();
+        // End of line (or explicit flush): send the data to the writing thread
+        _pStream->formatter << val;
+        commit();
     }
 
     if (_verbosityLevel <= verbosityLevel)
@@ -412,55 +384,10 @@ OutStream& OutStream::operator<< (const std::string& s)
 {
     if (_pStream && _pStream->bCanWrite)
     {
-        int offset = 0;
-
-        if ((_pStream->maxSize > 0) && (_pStream->currentSize + s.size() >= _pStream->maxSize * 2))
-        {
-            if (_pStream->bCanReopen)
-            {
-                if (s.size() >= _pStream->maxSize)
-                {
-                    _pStream->stream.close();
-                    remove(_pStream->strFileName.c_str());
-
-                    _pStream->stream.open(_pStream->strFileName.c_str());
+        _pStream->formatter.write(s.data(), s.size());
 
-                    offset = s.size() - _pStream->maxSize;
-
-                    _pStream->currentSize = 0;
-                }
-                else
-                {
-                    unsigned char* pBuffer = 0;
-                    int64_t nb = dump(&pBuffer, _pStream->maxSize - s.size());
-
-                    _pStream->stream.close();
-                    remove(_pStream->strFileName.c_str());
-
-                    _pStream->stream.open(_pStream->strFileName.c_str());
-                    _pStream->stream.write((const char*) pBuffer, nb);
-
-                    _pStream->currentSize = nb;
-
-                    delete[] pBuffer;
-                }
-            }
-            else
-            {
-                _pStream->bCanWrite = false;
-
-                _pStream->stream << "-------- Log file size limit reached -----------" << endl;
-                _pStream->stream.flush();
-            }
-        }
-
-        if (_pStream->bCanWrite)
-        {
-            _pStream->stream << s.substr(offset).c_str();
-            _pStream->stream.flush();
-
-            _pStream->currentSize += s.size() - offset;
-        }
+        if (_pStream->formatter.tellp() >= MAX_PENDING_SIZE)
+            commit();
     }
 
     if (_verbosityLevel <= verbosityLevel)
@@ -484,3 +411,62 @@ IMPLEMENT_OPERATOR_FOR_MANIPULATOR(setbase);
 IMPLEMENT_OPERATOR_FOR_MANIPULATOR(setfill);
 IMPLEMENT_OPERATOR_FOR_MANIPULATOR(setprecision);
 IMPLEMENT_OPERATOR_FOR_MANIPULATOR(setw);
+
+
+/****************************** PRIVATE METHODS *******************************/
+
+void OutStream::commit()
+{
+    if (!_pStream || (_pStream->formatter.tellp() <= 0))
+        return;
+
+    const string& data = _pStream->formatter.str();
+
+    if (_pStream->bCanWrite)
+        AsyncWriter::write(&OutStream::writeToFile, _pStream, data.data(), data.size());
+
+    _pStream->formatter.str("");
+}
+
+
+void OutStream::writeToFile(void* pDestination, const char* pData, int64_t size)
+{
+    // Note: called by the writing thread
+
+    tStream* pStream = (tStream*) pDestination;
+
+    if (!pStream->bCanWrite || !pStream->stream.is_open())
+        return;
+
+    if ((pStream->maxSize > 0) && pStream->bCanReopen &&
+        (pStream->currentSize + size > pStream->maxSize))
+    {
+        // Rotation: the current file becomes the previous one (the content of
+        // the file is never read back)
+        pStream->stream.close();
+        rename(pStream->strFileName.c_str(), (pStream->strFileName + ".1").c_str());
+        pStream->stream.open(pStream->strFileName.c_str());
+
+        pStream->currentSize = 0;
+
+        if (size > pStream->maxSize)
+        {
+            pData += size - pStream->maxSize;
+            size = pStream->maxSize;
+        }
+    }
+    else if ((pStream->maxSize > 0) && !pStream->bCanReopen &&
+             (pStream->currentSize + size >= pStream->maxSize * 2))
+    {
+        pStream->bCanWrite = false;
+
+        pStream->stream << "-------- Log file size limit reached -----------" << endl;
+        pStream->stream.flush();
+        return;
+    }
+
+    pStream->stream.write(pData, size);
+    pStream->stream.flush();
+
+    pStream->currentSize += size;
+}
@@ -34,6 +34,7 @@
 #include "stringutils.h"
 #include <string>
 #include <fstream>
+#include <sstream>
 #include <stdint.h>
 #include <string.h>
 
@@ -48,6 +49,11 @@ namespace Mash
     ///
     /// Each output stream can write into its own file (and optionally to the
     /// console), or write into the same file than another output stream.
+    ///
+    /// The data is accumulated until the end of the line, and then written in
+    /// the file by a background thread (see AsyncWriter). When the file
+    /// exceeds its maximum size, it is renamed (with a '.1' suffix) and a new
+    /// one is started.
     //--------------------------------------------------------------------------
     class MASH_SYMBOL OutStream
     {
@@ -79,8 +85,8 @@ namespace Mash
         ///                         '$TIMESTAMP' format string, which will be
         ///                         replaced by the current timestamp
         /// @param  maxSize         If greater than 0: maximum size of the file
-        ///                         (if necessary, the beginning of the file is
-        ///                         truncated, unless bCanReopen is false)
+        ///                         (if necessary, the file is rotated, unless
+        ///                         bCanReopen is false)
         /// @param  bCanReopen      Indicates if the file can be closed and
         ///                         opened again at will by the stream
         /// @return                 'true' if successful
@@ -119,41 +125,10 @@ namespace Mash
         {
             if (_pStream && _pStream->bCanWrite)
             {
-                bool bCanWrite = true;
-
-                if ((_pStream->maxSize > 0) && (_pStream->currentSize >= _pStream->maxSize * 2))
-                {
-                    if (_pStream->bCanReopen)
-                    {
-                        unsigned char* pBuffer = 0;
-                        int64_t nb = dump(&pBuffer, _pStream->maxSize);
-
-                        _pStream->stream.close();
-                        remove(_pStream->strFileName.c_str());
-
-                        _pStream->stream.open(_pStream->strFileName.c_str());
-                        _pStream->stream.write((const char*) pBuffer, nb);
-
-                        _pStream->currentSize = nb;
+                _pStream->formatter << val;
 
-                        delete[] pBuffer;
-                    }
-                    else
-                    {
-                        _pStream->bCanWrite = false;
-
-                        _pStream->stream << "-------- Log file size limit reached -----------" << std::endl;
-                        _pStream->stream.flush();
-                    }
-                }
-
-                if (_pStream->bCanWrite)
-                {
-                    _pStream->stream << val;
-                    _pStream->stream.flush();
-
-                    _pStream->currentSize = _pStream->stream.tellp();
-                }
+                if (_pStream->formatter.tellp() >= MAX_PENDING_SIZE)
+                    commit();
             }
 
             if (_verbosityLevel <= verbosityLevel)
@@ -242,6 +217,23 @@ namespace Mash
             _verbosityLevel = level;
         }
 
+        //----------------------------------------------------------------------
+        /// @brief  Indicates if the data written in the stream goes somewhere
+        ///         (in the log file or on the console)
+        ///
+        /// Use it to skip the formatting of the messages entirely when they
+        /// would be discarded anyway.
+        //----------------------------------------------------------------------
+        inline bool isEnabled() const
+        {
+            return (_pStream && _pStream->bCanWrite) || (_verbosityLevel <= verbosityLevel);
+        }
+
+
+    private:
+        void commit();
+        static void writeToFile(void* pDestination, const char* pData, int64_t size);
+
 
         //_____ Internal types __________
     private:
@@ -249,7 +241,8 @@ namespace Mash
         {
             std::string     strName;
             std::string     strFileName;
-            std::ofstream   stream;
+            std::ofstream   stream;         ///< Written by the writing thread
+            std::ostringstream formatter;   ///< The data not yet sent to the writing thread
             bool            newline;
             unsigned int    refCounter;
             bool            bCanReopen;
@@ -259,6 +252,11 @@ namespace Mash
         };
 
 
+        //_____ Constants __________
+    private:
+        static const int64_t MAX_PENDING_SIZE = 4096;
+
+
         //_____ Static attributes __________
     public:
         static unsigned char verbosityLevel;
@@ -0,0 +1,77 @@
+/*******************************************************************************
+* MASH 3D simulator
+* 
+* Copyright (c) 2014 Idiap Research Institute, http://www.idiap.ch/
+* Written by Philip Abbet <philip.abbet@idiap.ch>
+* 
+* This file is part of mash-simulator.
+* 
+* mash-simulator is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 3 as
+* published by the Free Software Foundation.
+* 
+* mash-simulator is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+* 
+* You should have received a copy of the GNU General Public License
+* along with mash-simulator. If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+
+/** @file   statistics.cpp
+    @author Philip Abbet (philip.abbet@idiap.ch)
+
+    Implementation of the 'Statistics' class
+*/
+
+#include "statistics.h"
+#include <time.h>
+
+using namespace std;
+using namespace Mash;
+
+
+/****************************** STATIC ATTRIBUTES *****************************/
+
+bool                        Statistics::enabled = true;
+Statistics::tHistogramsList Statistics::_histograms;
+
+
+/******************************* STATIC METHODS *******************************/
+
+LatencyHistogram& Statistics::histogram(const std::string& strName)
+{
+    tHistogramsList::iterator iter = _histograms.find(strName);
+    if (iter != _histograms.end())
+        return *iter->second;
+
+    LatencyHistogram* pHistogram = new LatencyHistogram();
+    _histograms[strName] = pHistogram;
+
+    return *pHistogram;
+}
+
+
+const Statistics::tHistogramsList& Statistics::histograms()
+{
+    return _histograms;
+}
+
+
+void Statistics::reset()
+{
+    tHistogramsList::iterator iter, iterEnd;
+    for (iter = _histograms.begin(), iterEnd = _histograms.end(); iter != iterEnd; ++iter)
+        iter->second->reset();
+}
+
+
+unsigned long long Statistics::now()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+
+    return (unsigned long long) t.tv_sec * 1000000ULL + t.tv_nsec / 1000;
+}
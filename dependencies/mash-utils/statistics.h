@@ -0,0 +1,124 @@
+/*******************************************************************************
+* MASH 3D simulator
+* 
+* Copyright (c) 2014 Idiap Research Institute, http://www.idiap.ch/
+* Written by Philip Abbet <philip.abbet@idiap.ch>
+* 
+* This file is part of mash-simulator.
+* 
+* mash-simulator is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 3 as
+* published by the Free Software Foundation.
+* 
+* mash-simulator is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+* 
+* You should have received a copy of the GNU General Public License
+* along with mash-simulator. If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+
+/** @file   statistics.h
+    @author Philip Abbet (philip.abbet@idiap.ch)
+
+    Declaration of the 'Statistics' and 'ScopedLatency' classes
+*/
+
+#ifndef _MASH_STATISTICS_H_
+#define _MASH_STATISTICS_H_
+
+#include "platform.h"
+#include "latency_histogram.h"
+#include <string>
+#include <map>
+
+
+namespace Mash
+{
+    //--------------------------------------------------------------------------
+    /// @brief  Process-wide registry of named latency histograms
+    ///
+    /// Since each client is handled by its own process, the statistics are
+    /// those of the current session.
+    //--------------------------------------------------------------------------
+    class MASH_SYMBOL Statistics
+    {
+        //_____ Internal types __________
+    public:
+        typedef std::map<std::string, LatencyHistogram*>    tHistogramsList;
+        typedef tHistogramsList::const_iterator             tHistogramsIterator;
+
+
+        //_____ Static methods __________
+    public:
+        //----------------------------------------------------------------------
+        /// @brief  Returns the histogram with the given name (created if
+        ///         necessary)
+        ///
+        /// @remark The returned reference stays valid until the end of the
+        ///         process, so it can be cached by the callers
+        //----------------------------------------------------------------------
+        static LatencyHistogram& histogram(const std::string& strName);
+
+        //----------------------------------------------------------------------
+        /// @brief  Returns all the histograms, sorted by name
+        //----------------------------------------------------------------------
+        static const tHistogramsList& histograms();
+
+        //----------------------------------------------------------------------
+        /// @brief  Remove all the values recorded in the histograms
+        //----------------------------------------------------------------------
+        static void reset();
+
+        //----------------------------------------------------------------------
+        /// @brief  Returns the current time, in microseconds (monotonic clock)
+        //----------------------------------------------------------------------
+        static unsigned long long now();
+
+
+        //_____ Static attributes __________
+    public:
+        static bool enabled;    ///< Indicates if the latencies must be recorded
+
+    private:
+        static tHistogramsList _histograms;
+    };
+
+
+    //--------------------------------------------------------------------------
+    /// @brief  Records the time spent in a scope into a latency histogram
+    //--------------------------------------------------------------------------
+    class MASH_SYMBOL ScopedLatency
+    {
+        //_____ Construction / Destruction __________
+    public:
+        //----------------------------------------------------------------------
+        /// @brief  Constructor
+        ///
+        /// @param  histogram   The histogram in which the latency is recorded
+        //----------------------------------------------------------------------
+        inline ScopedLatency(LatencyHistogram& histogram)
+        : _histogram(histogram), _start(Statistics::enabled ? Statistics::now() : 0)
+        {
+        }
+
+        //----------------------------------------------------------------------
+        /// @brief  Destructor
+        //----------------------------------------------------------------------
+        inline ~ScopedLatency()
+        {
+            if (Statistics::enabled && (_start > 0))
+                _histogram.record(Statistics::now() - _start);
+        }
+
+
+        //_____ Attributes __________
+    private:
+        LatencyHistogram&   _histogram;
+        unsigned long long  _start;
+    };
+}
+
+#endif
@@ -0,0 +1,171 @@
+/*******************************************************************************
+* MASH 3D simulator
+* 
+* Copyright (c) 2014 Idiap Research Institute, http://www.idiap.ch/
+* Written by Philip Abbet <philip.abbet@idiap.ch>
+* 
+* This file is part of mash-simulator.
+* 
+* mash-simulator is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 3 as
+* published by the Free Software Foundation.
+* 
+* mash-simulator is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+* 
+* You should have received a copy of the GNU General Public License
+* along with mash-simulator. If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+
+/** @file   tracer.cpp
+    @author Philip Abbet (philip.abbet@idiap.ch)
+
+    Implementation of the 'Tracer' class
+*/
+
+#include "tracer.h"
+#include <fstream>
+#include <sstream>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+using namespace std;
+using namespace Mash;
+
+
+/****************************** STATIC ATTRIBUTES *****************************/
+
+bool                    Tracer::_bEnabled   = false;
+Tracer::tSpan*          Tracer::_spans      = 0;
+unsigned int            Tracer::_capacity   = 0;
+unsigned int            Tracer::_allocated  = 0;
+volatile unsigned long  Tracer::_next       = 0;
+
+
+/********************************** FUNCTIONS *********************************/
+
+static unsigned int currentThread()
+{
+    static __thread unsigned int thread = 0;
+
+    if (thread == 0)
+        thread = (unsigned int) syscall(SYS_gettid);
+
+    return thread;
+}
+
+
+/******************************* STATIC METHODS *******************************/
+
+void Tracer::enable(unsigned int capacity)
+{
+    if (capacity == 0)
+        return;
+
+    if (capacity > MAX_CAPACITY)
+        capacity = MAX_CAPACITY;
+
+    // No span was ever recorded before the first call, so nobody can be using
+    // the buffer yet. Afterwards, a thread might be writing in it at any time:
+    // it is kept, and the new capacity can't exceed its size.
+    if (!_spans)
+    {
+        _spans = new tSpan[capacity];
+        _allocated = capacity;
+    }
+    else if (capacity > _allocated)
+    {
+        capacity = _allocated;
+    }
+
+    if (capacity != _capacity)
+    {
+        _capacity = capacity;
+        _next = 0;
+    }
+
+    __sync_synchronize();
+
+    _bEnabled = true;
+}
+
+
+void Tracer::disable()
+{
+    _bEnabled = false;
+}
+
+
+void Tracer::record(const char* strName, unsigned long long start,
+                    unsigned long long duration)
+{
+    if (!_bEnabled)
+        return;
+
+    unsigned long index = __sync_fetch_and_add(&_next, 1);
+
+    tSpan& span = _spans[index % _capacity];
+    span.strName    = strName;
+    span.start      = start;
+    span.duration   = (unsigned int) duration;
+    span.thread     = currentThread();
+}
+
+
+void Tracer::clear()
+{
+    _next = 0;
+}
+
+
+std::string Tracer::toJSON()
+{
+    ostringstream stream;
+
+    unsigned long next = _next;
+    unsigned long first = (next > _capacity ? next - _capacity : 0);
+    unsigned int pid = (unsigned int) getpid();
+
+    stream << "{\"traceEvents\":[";
+
+    for (unsigned long i = first; i < next; ++i)
+    {
+        const tSpan& span = _spans[i % _capacity];
+
+        if (i > first)
+            stream << ",";
+
+        stream << endl << "{\"name\":\"" << span.strName << "\",\"ph\":\"X\",\"ts\":" << span.start
+               << ",\"dur\":" << span.duration << ",\"pid\":" << pid << ",\"tid\":" << span.thread << "}";
+    }
+
+    stream << endl << "],\"displayTimeUnit\":\"ms\"}" << endl;
+
+    return stream.str();
+}
+
+
+bool Tracer::write(const std::string& strFileName)
+{
+    ofstream file(strFileName.c_str());
+    if (!file.is_open())
+        return false;
+
+    file << toJSON();
+    file.close();
+
+    return true;
+}
+
+
+unsigned long long Tracer::now()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+
+    return (unsigned long long) t.tv_sec * 1000000ULL + t.tv_nsec / 1000;
+}
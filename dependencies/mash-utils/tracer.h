@@ -0,0 +1,172 @@
+/*******************************************************************************
+* MASH 3D simulator
+* 
+* Copyright (c) 2014 Idiap Research Institute, http://www.idiap.ch/
+* Written by Philip Abbet <philip.abbet@idiap.ch>
+* 
+* This file is part of mash-simulator.
+* 
+* mash-simulator is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 3 as
+* published by the Free Software Foundation.
+* 
+* mash-simulator is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+* 
+* You should have received a copy of the GNU General Public License
+* along with mash-simulator. If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+
+/** @file   tracer.h
+    @author Philip Abbet (philip.abbet@idiap.ch)
+
+    Declaration of the 'Tracer' and 'ScopedTrace' classes
+*/
+
+#ifndef _MASH_TRACER_H_
+#define _MASH_TRACER_H_
+
+#include "platform.h"
+#include <string>
+
+
+namespace Mash
+{
+    //--------------------------------------------------------------------------
+    /// @brief  Records timed spans into a ring buffer, and exports them in the
+    ///         Chrome trace format (readable by chrome://tracing or Perfetto)
+    ///
+    /// The buffer is per-process (each client is handled by its own process).
+    /// Recording a span doesn't take any lock: a slot is reserved with an
+    /// atomic increment, and the oldest spans are overwritten once the
+    /// buffer is full.
+    //--------------------------------------------------------------------------
+    class MASH_SYMBOL Tracer
+    {
+        //_____ Static methods __________
+    public:
+        //----------------------------------------------------------------------
+        /// @brief  Start to record the spans
+        ///
+        /// @param  capacity    Maximum number of spans kept in the buffer
+        ///                     (between 1 and MAX_CAPACITY)
+        ///
+        /// The buffer is allocated by the first call and never released,
+        /// since other threads may be recording a span at any time: later
+        /// calls can only keep fewer spans than the first one.
+        //----------------------------------------------------------------------
+        static void enable(unsigned int capacity = 100000);
+
+        //----------------------------------------------------------------------
+        /// @brief  Stop to record the spans (the ones already recorded are
+        ///         kept)
+        //----------------------------------------------------------------------
+        static void disable();
+
+        //----------------------------------------------------------------------
+        /// @brief  Indicates if the spans are recorded
+        //----------------------------------------------------------------------
+        static inline bool isEnabled()
+        {
+            return _bEnabled;
+        }
+
+        //----------------------------------------------------------------------
+        /// @brief  Record a span
+        ///
+        /// @param  strName     Name of the span (must be a string literal,
+        ///                     only the pointer is stored)
+        /// @param  start       Start time, in microseconds (see now())
+        /// @param  duration    Duration, in microseconds
+        //----------------------------------------------------------------------
+        static void record(const char* strName, unsigned long long start,
+                           unsigned long long duration);
+
+        //----------------------------------------------------------------------
+        /// @brief  Remove all the recorded spans
+        //----------------------------------------------------------------------
+        static void clear();
+
+        //----------------------------------------------------------------------
+        /// @brief  Returns the recorded spans in the Chrome trace format (JSON)
+        //----------------------------------------------------------------------
+        static std::string toJSON();
+
+        //----------------------------------------------------------------------
+        /// @brief  Write the recorded spans in a file, in the Chrome trace
+        ///         format (JSON)
+        ///
+        /// @return 'false' if failed
+        //----------------------------------------------------------------------
+        static bool write(const std::string& strFileName);
+
+        //----------------------------------------------------------------------
+        /// @brief  Returns the current time, in microseconds (monotonic clock)
+        //----------------------------------------------------------------------
+        static unsigned long long now();
+
+
+        //_____ Constants __________
+    public:
+        static const unsigned int MAX_CAPACITY = 1000000;
+
+
+        //_____ Internal types __________
+    private:
+        struct tSpan
+        {
+            const char*         strName;
+            unsigned long long  start;
+            unsigned int        duration;
+            unsigned int        thread;
+        };
+
+
+        //_____ Static attributes __________
+    private:
+        static bool                     _bEnabled;
+        static tSpan*                   _spans;
+        static unsigned int             _capacity;
+        static unsigned int             _allocated;
+        static volatile unsigned long   _next;
+    };
+
+
+    //--------------------------------------------------------------------------
+    /// @brief  Records the time spent in a scope as a span of the tracer
+    //--------------------------------------------------------------------------
+    class MASH_SYMBOL ScopedTrace
+    {
+        //_____ Construction / Destruction __________
+    public:
+        //----------------------------------------------------------------------
+        /// @brief  Constructor
+        ///
+        /// @param  strName     Name of the span (must be a string literal)
+        //----------------------------------------------------------------------
+        inline ScopedTrace(const char* strName)
+        : _strName(strName), _start(Tracer::isEnabled() ? Tracer::now() : 0)
+        {
+        }
+
+        //----------------------------------------------------------------------
+        /// @brief  Destructor
+        //----------------------------------------------------------------------
+        inline ~ScopedTrace()
+        {
+            if (_start > 0)
+                Tracer::record(_strName, _start, Tracer::now() - _start);
+        }
+
+
+        //_____ Attributes __________
+    private:
+        const char*         _strName;
+        unsigned long long  _start;
+    };
+}
+
+#endif
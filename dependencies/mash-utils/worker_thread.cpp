@@ -0,0 +1,174 @@
+/*******************************************************************************
+* MASH 3D simulator
+* 
+* Copyright (c) 2014 Idiap Research Institute, http://www.idiap.ch/
+* Written by Philip Abbet <philip.abbet@idiap.ch>
+* 
+* This file is part of mash-simulator.
+* 
+* mash-simulator is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 3 as
+* published by the Free Software Foundation.
+* 
+* mash-simulator is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+* 
+* You should have received a copy of the GNU General Public License
+* along with mash-simulator. If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+
+
+/** @file   worker_thread.cpp
+    @author Philip Abbet (philip.abbet@idiap.ch)
+
+    Implementation of the 'WorkerThread' class
+*/
+
+#include "worker_thread.h"
+#include <unistd.h>
+#include <assert.h>
+
+using namespace Mash;
+
+
+/************************* CONSTRUCTION / DESTRUCTION *************************/
+
+WorkerThread::WorkerThread()
+: _pid(0), _bRunning(false), _bStop(false), _pJob(0), _pArgument(0)
+{
+    pthread_mutex_init(&_mutex, 0);
+    pthread_cond_init(&_condition, 0);
+}
+
+
+WorkerThread::~WorkerThread()
+{
+    stop();
+
+    pthread_cond_destroy(&_condition);
+    pthread_mutex_destroy(&_mutex);
+}
+
+
+/*********************************** METHODS **********************************/
+
+void WorkerThread::post(tJob* pJob, void* pArgument)
+{
+    // Assertions
+    assert(pJob);
+
+    wait();
+
+    if (!start())
+    {
+        pJob(pArgument);
+        return;
+    }
+
+    pthread_mutex_lock(&_mutex);
+
+    _pJob = pJob;
+    _pArgument = pArgument;
+
+    pthread_cond_broadcast(&_condition);
+    pthread_mutex_unlock(&_mutex);
+}
+
+
+void WorkerThread::wait()
+{
+    if (!_bRunning || (_pid != getpid()))
+        return;
+
+    pthread_mutex_lock(&_mutex);
+
+    while (_pJob)
+        pthread_cond_wait(&_condition, &_mutex);
+
+    pthread_mutex_unlock(&_mutex);
+}
+
+
+bool WorkerThread::isBusy() const
+{
+    return _bRunning && (_pid == getpid()) && (_pJob != 0);
+}
+
+
+bool WorkerThread::start()
+{
+    // The thread of the parent process doesn't exist in a child process
+    if (_bRunning && (_pid != getpid()))
+    {
+        pthread_mutex_init(&_mutex, 0);
+        pthread_cond_init(&_condition, 0);
+
+        _bRunning = false;
+        _pJob = 0;
+    }
+
+    if (_bRunning)
+        return true;
+
+    _bStop = false;
+    _pid = getpid();
+
+    _bRunning = (pthread_create(&_thread, 0, &WorkerThread::run, this) == 0);
+
+    return _bRunning;
+}
+
+
+void WorkerThread::stop()
+{
+    if (!_bRunning || (_pid != getpid()))
+        return;
+
+    pthread_mutex_lock(&_mutex);
+
+    _bStop = true;
+
+    pthread_cond_broadcast(&_condition);
+    pthread_mutex_unlock(&_mutex);
+
+    pthread_join(_thread, 0);
+
+    _bRunning = false;
+}
+
+
+void* WorkerThread::run(void* pArgument)
+{
+    WorkerThread* pWorker = (WorkerThread*) pArgument;
+
+    pthread_mutex_lock(&pWorker->_mutex);
+
+    while (true)
+    {
+        // The current job is finished before stopping
+        while (!pWorker->_pJob && !pWorker->_bStop)
+            pthread_cond_wait(&pWorker->_condition, &pWorker->_mutex);
+
+        if (!pWorker->_pJob)
+            break;
+
+        tJob* pJob = pWorker->_pJob;
+        void* pJobArgument = pWorker->_pArgument;
+
+        pthread_mutex_unlock(&pWorker->_mutex);
+
+        pJob(pJobArgument);
+
+        pthread_mutex_lock(&pWorker->_mutex);
+
+        pWorker->_pJob = 0;
+        pthread_cond_broadcast(&pWorker->_condition);
+    }
+
+    pthread_mutex_unlock(&pWorker->_mutex);
+
+    return 0;
+}
@@ -0,0 +1,115 @@
+/*******************************************************************************
+* MASH 3D simulator
+* 
+* Copyright (c) 2014 Idiap Research Institute, http://www.idiap.ch/
+* Written by Philip Abbet <philip.abbet@idiap.ch>
+* 
+* This file is part of mash-simulator.
+* 
+* mash-simulator is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 3 as
+* published by the Free Software Foundation.
+* 
+* mash-simulator is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+* 
+* You should have received a copy of the GNU General Public License
+* along with mash-simulator. If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+
+
+/** @file   worker_thread.h
+    @author Philip Abbet (philip.abbet@idiap.ch)
+
+    Declaration of the 'WorkerThread' class
+*/
+
+#ifndef _MASH_WORKERTHREAD_H_
+#define _MASH_WORKERTHREAD_H_
+
+#include "platform.h"
+#include <pthread.h>
+#include <sys/types.h>
+
+
+namespace Mash
+{
+    //--------------------------------------------------------------------------
+    /// @brief  Thread executing one job at a time in the background, while
+    ///         the calling thread does something else
+    ///
+    /// The thread is started by the first job. A job must be waited for (see
+    /// wait()) before its results are used: posting a new job also waits for
+    /// the previous one, so the jobs are always executed in order.
+    ///
+    /// Threads don't survive a fork(): a child process starts its own thread
+    /// when needed.
+    //--------------------------------------------------------------------------
+    class MASH_SYMBOL WorkerThread
+    {
+        //_____ Public internal types __________
+    public:
+        //----------------------------------------------------------------------
+        /// @brief  Function executed by the thread
+        //----------------------------------------------------------------------
+        typedef void tJob(void* pArgument);
+
+
+        //_____ Construction / Destruction __________
+    public:
+        //----------------------------------------------------------------------
+        /// @brief  Constructor
+        //----------------------------------------------------------------------
+        WorkerThread();
+
+        //----------------------------------------------------------------------
+        /// @brief  Destructor (waits for the current job, and stops the thread)
+        //----------------------------------------------------------------------
+        ~WorkerThread();
+
+
+        //_____ Methods __________
+    public:
+        //----------------------------------------------------------------------
+        /// @brief  Execute a job in the background
+        ///
+        /// If the thread can't be started, the job is executed immediately.
+        /// @param  pJob        The function to execute
+        /// @param  pArgument   Argument given to the function
+        //----------------------------------------------------------------------
+        void post(tJob* pJob, void* pArgument);
+
+        //----------------------------------------------------------------------
+        /// @brief  Wait until the current job (if any) is done
+        //----------------------------------------------------------------------
+        void wait();
+
+        //----------------------------------------------------------------------
+        /// @brief  Indicates if a job was posted and not waited for yet
+        //----------------------------------------------------------------------
+        bool isBusy() const;
+
+
+    private:
+        bool start();
+        void stop();
+        static void* run(void* pArgument);
+
+
+        //_____ Attributes __________
+    private:
+        pthread_t           _thread;
+        pthread_mutex_t     _mutex;
+        pthread_cond_t      _condition;
+        pid_t               _pid;       ///< Process owning the thread
+        bool                _bRunning;
+        bool                _bStop;
+        tJob*               _pJob;      ///< Current job, 0 when done
+        void*               _pArgument;
+    };
+}
+
+#endif
@@ -23,6 +23,9 @@
 #ifndef _DECLARATIONS_H_
 #define _DECLARATIONS_H_
 
+#include <string>
+
+
 enum tAction
 {
     ACTION_GO_FORWARD,
@@ -34,6 +37,92 @@ enum tAction
 };
 
 
+enum tRenderer
+{
+    RENDERER_OGRE,
+    RENDERER_RAYCAST,
+};
+
+
+// What the 'topdown' view shows (see TopDownView)
+enum tTopDownSource
+{
+    TOPDOWN_MAP,
+    TOPDOWN_TEACHER,
+};
+
+// Dimensions of the 'topdown' view (in pixels, one per cell in egocentric mode)
+const unsigned int TOPDOWN_SIZE = 100;
+
+
+// Limits of the physics world, read from the 'physics' section of 'athena.cfg'
+// (Athena applies them to the whole process): each step of the engine
+// integrates at most 'nbMaxSubSteps' fixed steps of 'fixedTimeStep'
+// milliseconds, Bullet drops the remaining time
+struct tPhysicsLimits
+{
+    tPhysicsLimits()
+    : fixedTimeStep(1000.0f / 60.0f), nbMaxSubSteps(1)
+    {
+    }
+
+    // Maximum time that one step of the engine can simulate, in milliseconds
+    float maxStepDuration() const
+    {
+        return fixedTimeStep * nbMaxSubSteps;
+    }
+
+    float           fixedTimeStep;      // In milliseconds
+    unsigned int    nbMaxSubSteps;
+};
+
+
+// Timing of the simulation of the actions. By default, an action lasts 100ms
+// for the goal, and is simulated by one step of the engine given 100ms (of
+// which the physics world only integrates one fixed step, 16.667ms with
+// 'athena.cfg'). This approximation is kept for compatibility: to simulate the
+// whole action with 'athena.cfg', use 6 steps of 16.667ms.
+struct tTiming
+{
+    tTiming()
+    : actionDuration(100.0f), nbSteps(1), stepDuration(100.0f), bFastForward(false)
+    {
+    }
+
+    // Indicates if the physics world simulates the whole duration of the
+    // actions: each step fits in the sub-steps of the physics world, and the
+    // steps add up to the duration of an action
+    bool isExact(const tPhysicsLimits& limits) const
+    {
+        const float tolerance = 0.01f * nbSteps;
+        float error = nbSteps * stepDuration - actionDuration;
+
+        return (stepDuration <= limits.maxStepDuration() + 0.001f) &&
+               (error >= -tolerance) && (error <= tolerance);
+    }
+
+    // Indicates if the timing can be used: either the default one, or an exact
+    // one (see isExact())
+    bool isValid(const tPhysicsLimits& limits) const
+    {
+        tTiming defaultTiming;
+
+        if ((actionDuration <= 0.0f) || (nbSteps == 0) || (stepDuration <= 0.0f))
+            return false;
+
+        return isExact(limits) ||
+               ((actionDuration == defaultTiming.actionDuration) &&
+                (nbSteps == defaultTiming.nbSteps) &&
+                (stepDuration == defaultTiming.stepDuration));
+    }
+
+    float           actionDuration;     // Duration of an action, in milliseconds
+    unsigned int    nbSteps;            // Number of steps of the engine per action
+    float           stepDuration;       // Time elapsed during one step, in milliseconds
+    bool            bFastForward;       // Only render the last step of each action
+};
+
+
 enum tKeys
 {
     VKEY_EXIT    = 1,
@@ -53,6 +142,20 @@ enum tResult
 };
 
 
+// Layout of the 'state' view, a vector of STATE_SIZE floats (positions in
+// meters, in the frame of the world unless stated otherwise):
+//   - 0-2:   position of the avatar
+//   - 3-4:   direction of the avatar (x and z components)
+//   - 5-7:   linear velocity of the avatar (in meters per second)
+//   - 8-10:  color of the ambient light (r, g, b)
+//   - 11:    distance to the nearest spot, -1 if there is none
+//   - 12-:   STATE_MAX_TARGETS slots of 4 values: type of the target (-1 if
+//            there is no target in the slot), goal-specific value, and
+//            position relative to the avatar (to its right, to its front)
+const unsigned int STATE_MAX_TARGETS = 4;
+const unsigned int STATE_SIZE        = 12 + 4 * STATE_MAX_TARGETS;
+
+
 extern unsigned int VIEW_WIDTH;
 extern unsigned int VIEW_HEIGHT;
 extern unsigned int RTT_WIDTH;
@@ -61,4 +164,8 @@ extern unsigned int RTT_HEIGHT;
 
 void setResolution(unsigned int width, unsigned int height);
 
+// Converts the name of a renderer ('ogre' or 'raycast'), returns 'false' if
+// it is unknown
+bool parseRenderer(const std::string& strName, tRenderer &renderer);
+
 #endif
@@ -0,0 +1,119 @@
+/*******************************************************************************
+* MASH 3D simulator
+* 
+* Copyright (c) 2014 Idiap Research Institute, http://www.idiap.ch/
+* Written by Philip Abbet <philip.abbet@idiap.ch>
+* 
+* This file is part of mash-simulator.
+* 
+* mash-simulator is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 3 as
+* published by the Free Software Foundation.
+* 
+* mash-simulator is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+* 
+* You should have received a copy of the GNU General Public License
+* along with mash-simulator. If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+
+#ifndef _LAYOUTSFILE_H_
+#define _LAYOUTSFILE_H_
+
+#include <MapBuilder.h>
+#include <stdio.h>
+#include <string>
+
+
+//------------------------------------------------------------------------------
+/// @brief  File containing precomputed layouts of a task (see
+///         MapBuilder::tLayout), generated by 'mash-simulator-layouts'
+///
+/// Layout n was generated from the map of seed n: it can always be generated
+/// again from its index. The file is memory-mapped when read, so only the
+/// layouts used are loaded from the disk.
+///
+/// Format (in the byte order of the machine):
+///   - header (128 bytes): "MASHLAY1", number of layouts (uint32), number of
+///     targets (uint32), name of the goal (char[56]) and of the environment
+///     (char[56])
+///   - for each layout: the seed of the map (uint32), then the placement of
+///     the avatar and of each target: x, y (int16), orientation (4 floats:
+///     w, x, y, z)
+//------------------------------------------------------------------------------
+class LayoutsFile
+{
+    //_____ Construction / Destruction __________
+public:
+    LayoutsFile();
+    ~LayoutsFile();
+
+
+    //_____ Methods __________
+public:
+    bool open(const std::string& strFileName);
+
+    bool create(const std::string& strFileName, const std::string& strGoal,
+                const std::string& strEnvironment, unsigned int nbTargets);
+
+    bool append(unsigned int seed, const MapBuilder::tLayout& layout);
+
+    void close();
+
+    inline bool isOpen() const
+    {
+        return (m_pData != 0);
+    }
+
+    inline unsigned int nbLayouts() const
+    {
+        return m_nbLayouts;
+    }
+
+    inline unsigned int nbTargets() const
+    {
+        return m_nbTargets;
+    }
+
+    inline std::string goal() const
+    {
+        return m_strGoal;
+    }
+
+    inline std::string environment() const
+    {
+        return m_strEnvironment;
+    }
+
+    bool getLayout(unsigned int index, unsigned int &seed,
+                   MapBuilder::tLayout &layout) const;
+
+private:
+    inline unsigned int recordSize() const
+    {
+        return 4 + PLACEMENT_SIZE * (m_nbTargets + 1);
+    }
+
+
+    //_____ Constants __________
+private:
+    static const unsigned int HEADER_SIZE       = 128;
+    static const unsigned int NAME_SIZE         = 56;
+    static const unsigned int PLACEMENT_SIZE    = 20;
+
+
+    //_____ Attributes __________
+private:
+    unsigned char*  m_pData;        // Memory-mapped file (reading)
+    size_t          m_size;
+    FILE*           m_pFile;        // Writing
+    unsigned int    m_nbLayouts;
+    unsigned int    m_nbTargets;
+    std::string     m_strGoal;
+    std::string     m_strEnvironment;
+};
+
+#endif
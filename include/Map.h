@@ -27,8 +27,10 @@
 #include <Athena-Core/Utils/Iterators.h>
 #include <Athena-Core/Utils/PropertiesList.h>
 #include <Athena-Math/RandomNumberGenerator.h>
+#include <Athena-Math/Vector3.h>
 #include <Athena-Entities/Entity.h>
 #include <Ogre/OgreEntity.h>
+#include <Ogre/OgreAxisAlignedBox.h>
 
 
 enum tCellType
@@ -68,15 +70,113 @@ typedef Athena::Utils::VectorIterator<tTargetsList>       tTargetsIterator;
 typedef Athena::Utils::ConstVectorIterator<tTargetsList>  tConstTargetsIterator;
 
 
-struct tCell
+// Informations about a cell that only a few cells have (see Grid)
+struct tCellInfos
 {
-    tCellType       type;
-    unsigned int    room;           // CELL_FLOOR only
+    tCellInfos()
+    : main_x(-1), main_y(-1), infos_index(0)
+    {
+    }
+
     int             main_x;         // CELL_WAYPOINT or CELL_TARGET
     int             main_y;         // CELL_WAYPOINT or CELL_TARGET
     unsigned int    infos_index;    // CELL_TARGET or CELL_SPOT
 };
 
+typedef std::map<unsigned int, tCellInfos>          tCellInfosList;
+typedef Athena::Utils::MapIterator<tCellInfosList>  tCellInfosIterator;
+
+
+//------------------------------------------------------------------------------
+/// @brief  Grid of the map, stored as one plane per attribute
+///
+/// The type and the room of the cells (needed by all the scans of the grid)
+/// are stored in planes of one byte per cell. The positions and indices only
+/// used by the targets, waypoints and spots are kept in a sparse table, indexed
+/// by the index of the cell (y * width + x).
+//------------------------------------------------------------------------------
+class Grid
+{
+    //_____ Construction / Destruction __________
+public:
+    Grid(unsigned int width, unsigned int height);
+    ~Grid();
+
+
+    //_____ Methods __________
+public:
+    inline unsigned int index(unsigned int x, unsigned int y) const
+    {
+        return y * m_width + x;
+    }
+
+    inline unsigned int size() const
+    {
+        return m_width * m_height;
+    }
+
+    inline tCellType type(unsigned int index) const
+    {
+        return (tCellType) m_types[index];
+    }
+
+    inline tCellType type(unsigned int x, unsigned int y) const
+    {
+        return (tCellType) m_types[y * m_width + x];
+    }
+
+    inline void setType(unsigned int index, tCellType type)
+    {
+        m_types[index] = (unsigned char) type;
+    }
+
+    inline void setType(unsigned int x, unsigned int y, tCellType type)
+    {
+        m_types[y * m_width + x] = (unsigned char) type;
+    }
+
+    // CELL_FLOOR only (the room of a cell isn't modified when its type change)
+    inline unsigned int room(unsigned int index) const
+    {
+        return m_rooms[index];
+    }
+
+    inline void setRoom(unsigned int index, unsigned int room)
+    {
+        m_rooms[index] = (unsigned char) room;
+    }
+
+    // The plane of the types, to scan the grid
+    inline const unsigned char* types() const
+    {
+        return m_types;
+    }
+
+    // Returns default informations (main_x = main_y = -1, infos_index = 0) if
+    // the cell has none
+    const tCellInfos& infos(unsigned int index) const;
+
+    tCellInfos& editInfos(unsigned int index);
+
+    void removeInfos(unsigned int index);
+
+    inline tCellInfosIterator getInfosIterator()
+    {
+        return tCellInfosIterator(m_infos.begin(), m_infos.end());
+    }
+
+
+    //_____ Attributes __________
+private:
+    unsigned int    m_width;
+    unsigned int    m_height;
+    unsigned char*  m_types;
+    unsigned char*  m_rooms;
+    tCellInfosList  m_infos;
+
+    static const tCellInfos DEFAULT_INFOS;
+};
+
 
 struct tZone
 {
@@ -119,6 +219,48 @@ typedef Athena::Utils::VectorIterator<tSpotsList>       tSpotsIterator;
 typedef Athena::Utils::ConstVectorIterator<tSpotsList>  tConstSpotsIterator;
 
 
+// Textured rectangle of the scene, created by the map builder (kept to render
+// the map without Ogre, see RaycastRenderer). The rectangle spans 'width'
+// meters along its X axis and 'height' meters along its Z axis, from 'origin'.
+struct tSurface
+{
+    std::string                 material;
+    Athena::Math::Vector3       origin;
+    Athena::Math::Quaternion    orientation;
+    float                       width;
+    float                       height;
+    float                       uTile;
+    float                       vTile;
+};
+
+typedef std::vector<tSurface>   tSurfacesList;
+
+
+// Room of the map, created by the map builder. The rectangle (in cells)
+// includes the walls. The objects (walls, floor, ceiling, decals and lights)
+// are only rendered when the room is visible (see Map::updateVisibility()).
+struct tRoom
+{
+    tZone                               rectangle;
+    std::vector<Ogre::MovableObject*>   objects;
+    std::vector<unsigned int>           portals;
+    bool                                visible;
+};
+
+typedef std::vector<tRoom>      tRoomsList;
+
+
+// Opening between two rooms (a door): the box (in meters) surrounds the
+// boundary between the rooms, over the width of the door
+struct tPortal
+{
+    unsigned int            rooms[2];
+    Ogre::AxisAlignedBox    box;
+};
+
+typedef std::vector<tPortal>    tPortalsList;
+
+
 typedef std::map<std::string, Athena::Utils::Variant>   tSettingsList;
 typedef Athena::Utils::MapIterator<tSettingsList>       tSettingsIterator;
 
@@ -137,8 +279,29 @@ public:
 
     void moveTarget(tTarget* pTarget, Athena::Entities::Entity* pAvatar);
 
+    //--------------------------------------------------------------------------
+    /// @brief Sets the type of the cells of a disk
+    ///
+    /// @param pChangedCells    If not 0, the indices of the cells whose type
+    ///                         changed are appended to it
+    //--------------------------------------------------------------------------
     void putDisk(unsigned int center_x, unsigned int center_y, bool present,
-                 unsigned int infos_index);
+                 unsigned int infos_index, std::vector<unsigned int>* pChangedCells = 0);
+
+    //--------------------------------------------------------------------------
+    /// @brief Returns the index of the room containing a cell, or -1
+    //--------------------------------------------------------------------------
+    int getRoomAt(unsigned int x, unsigned int y) const;
+
+    //--------------------------------------------------------------------------
+    /// @brief Shows the rooms seen by the camera and hides the other ones
+    ///
+    /// The room containing the camera is visible, and a neighbour room is
+    /// visible if the portal leading to it (from a visible room) is in the
+    /// frustum of the camera. The lights of the hidden rooms are hidden too,
+    /// so they don't cast shadows.
+    //--------------------------------------------------------------------------
+    void updateVisibility(Ogre::Camera* pCamera);
 
 
     //_____ Attributes __________
@@ -149,7 +312,8 @@ public:
     unsigned int                            cell_size;
     unsigned int                            width;
     unsigned int                            height;
-    tCell*                                  grid;
+    Grid                                    grid;
+    std::vector<unsigned int>               changed_cells;  // Cells whose type was changed by moveTarget()
 
     // Zones
     std::vector<tZone>                      start_zones;
@@ -163,6 +327,11 @@ public:
     Athena::Entities::Scene*                pScene;
     Athena::Entities::Entity*               pEntity;
     Athena::Entities::Entity::tEntitiesList lights;
+    tSurfacesList                           surfaces;       // Walls, floors and ceilings
+    tSurfacesList                           decals;
+    tRoomsList                              rooms;
+    tPortalsList                            portals;
+    std::vector<std::string>                meshes;         // Created for the map, destroyed with it
     Athena::Utils::PropertiesList           properties;
 
 
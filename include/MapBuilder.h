@@ -98,10 +98,32 @@ public:
     };
 
 
+    // Position (cell) and orientation of the avatar and of the targets, the
+    // part of the map found by rejection sampling (see computeLayout())
+    struct tPlacement
+    {
+        tPoint                   position;
+        Athena::Math::Quaternion orientation;
+    };
+
+    typedef std::vector<tPlacement> tPlacementList;
+
+    struct tLayout
+    {
+        tPlacement      start;
+        tPlacementList  targets;
+    };
+
+
+    // Attenuation of the lights of the rooms (range, constant, linear and
+    // quadratic factors)
+    static const float LIGHT_ATTENUATION[4];
+
+
     //_____ Construction / Destruction __________
 public:
     MapBuilder(unsigned int cell_size, unsigned int map_width,
-               unsigned int map_height);
+               unsigned int map_height, unsigned int seed);
     ~MapBuilder();
 
 
@@ -139,7 +161,19 @@ public:
 
     void addSpot(unsigned int left, unsigned int top, unsigned int goal_specific);
 
-    void finalize();
+    //--------------------------------------------------------------------------
+    /// @brief Generates the positions and orientations of the avatar and the
+    ///        targets (must be called after the goal was set up)
+    //--------------------------------------------------------------------------
+    void computeLayout(tLayout &layout);
+
+    //--------------------------------------------------------------------------
+    /// @brief Creates the targets and places the avatar
+    ///
+    /// @param pLayout  The layout to use (precomputed by computeLayout()). If
+    ///                 0, it is computed now.
+    //--------------------------------------------------------------------------
+    void finalize(const tLayout* pLayout = 0);
 
 private:
     Ogre::Entity* createPlane(const std::string& strPrefix, const std::string& strMaterial,
@@ -152,11 +186,17 @@ private:
                      const Athena::Math::Vector3& position,
                      const Athena::Math::Quaternion& orientation);
 
+    void createDecalsBatches();
+
     tDoorList filterDoors(const tDoorList* doors, tLocation location);
     tDecalList filterDecals(const tDecalList* decals, tLocation location);
 
     void createLight(const std::string& strName, const Athena::Math::Vector3& position);
 
+    void addPortal(const tRoomAttributes& attributes, const tDoor& door);
+
+    void connectPortals();
+
     Athena::Entities::Entity* createTarget(tTargetType type,
                                            const std::string& strName,
                                            const std::string& strMaterial,
@@ -166,12 +206,38 @@ private:
                                            const Athena::Math::Quaternion& orientation);
 
 
+    //_____ Internal types __________
+private:
+    // Portal of a room, whose other room is only known once all the rooms
+    // were added: it's the one containing the 'outside' cell
+    struct tDoorway
+    {
+        tPortal portal;
+        tPoint  outside;
+    };
+
+    typedef std::vector<tDoorway> tDoorwaysList;
+
+    // Decals of a room using the same material, merged in one mesh
+    struct tDecalsBatch
+    {
+        unsigned int    room;
+        std::string     material;
+        tSurfacesList   decals;
+    };
+
+    typedef std::vector<tDecalsBatch> tDecalsBatchesList;
+
+
     //_____ Attributes __________
 private:
     Map*                     m_pMap;
+    unsigned int             m_seed;
     Athena::Math::Vector3    m_startPosition;
     Athena::Math::Quaternion m_startOrientation;
     unsigned int             m_nbRooms;
+    tDoorwaysList            m_doorways;
+    tDecalsBatchesList       m_decalsBatches;
 };
 
 #endif
@@ -0,0 +1,262 @@
+/*******************************************************************************
+* MASH 3D simulator
+* 
+* Copyright (c) 2014 Idiap Research Institute, http://www.idiap.ch/
+* Written by Philip Abbet <philip.abbet@idiap.ch>
+* 
+* This file is part of mash-simulator.
+* 
+* mash-simulator is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 3 as
+* published by the Free Software Foundation.
+* 
+* mash-simulator is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+* 
+* You should have received a copy of the GNU General Public License
+* along with mash-simulator. If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+
+#ifndef _RAYCASTRENDERER_H_
+#define _RAYCASTRENDERER_H_
+
+#include <Map.h>
+#include <Ogre/OgreCamera.h>
+#include <Ogre/OgreAxisAlignedBox.h>
+#include <map>
+#include <vector>
+
+
+//------------------------------------------------------------------------------
+/// @brief  Renders the view of the avatar on the CPU, without Ogre
+///
+/// All the environments are made of axis-aligned walls on the grid of the map,
+/// flat floors and ceilings, decals and a few targets, seen by a camera that
+/// only turns around the vertical axis. So each column of the view is rendered
+/// by walking along the grid until a wall is hit, each row of the floor and
+/// the ceiling is at a constant depth, and the targets are approximated by
+/// oriented boxes (one per sub-mesh).
+///
+/// The materials and textures are the ones used by Ogre (mipmapped, without
+/// filtering). The lighting approximates the fixed-function pipeline: ambient
+/// light and point lights (precomputed on the grid, the lights of a room
+/// don't light the other ones), but no shadows. All the lights must have the
+/// same color.
+///
+/// The renderer doesn't modify the scene, and nothing is shared between the
+/// instances.
+//------------------------------------------------------------------------------
+class RaycastRenderer
+{
+    //_____ Construction / Destruction __________
+public:
+    RaycastRenderer();
+    ~RaycastRenderer();
+
+
+    //_____ Methods __________
+public:
+    //--------------------------------------------------------------------------
+    /// @brief Sets the map to render
+    ///
+    /// Must be called at the beginning of each episode, once the map is
+    /// finalized: the static parts of the scene are processed here.
+    //--------------------------------------------------------------------------
+    void setMap(Map* pMap);
+
+    inline Map* getMap() const
+    {
+        return m_pMap;
+    }
+
+    //--------------------------------------------------------------------------
+    /// @brief Renders the view of a camera in a buffer of (at least)
+    ///        VIEW_WIDTH * VIEW_HEIGHT * 3 bytes (RGB, like the views
+    ///        rendered by Ogre)
+    //--------------------------------------------------------------------------
+    void render(Ogre::Camera* pCamera, unsigned char* pBuffer);
+
+
+private:
+    struct tMaterial;
+    struct tMappedSurface;
+
+    unsigned short getMaterial(const std::string& strName);
+    int getTexture(const std::string& strName);
+    const Ogre::AxisAlignedBox& getSubMeshBounds(Ogre::Entity* pEntity, unsigned int index);
+
+    void mapSurface(const tSurface& surface, tMappedSurface &mapped);
+    void addDecal(std::vector<int> &heads, unsigned int index, int decal);
+    void computeLights();
+    float computeLight(const Athena::Math::Vector3& point,
+                       const Athena::Math::Vector3& normal, int room) const;
+    int getRoom(float x, float z) const;
+
+    void prepareMaterials();
+    void collectTargets();
+
+    void renderColumns();
+    void renderRows();
+    void renderBoxes();
+
+    unsigned int sample(const tMaterial& material, float u, float v, int level) const;
+    unsigned int blendDecal(const tMappedSurface& decal, unsigned int texel,
+                            float x, float y, float z, float logMetersPerPixel) const;
+
+    inline void addPixel(unsigned int offset, unsigned int texel, float light,
+                         unsigned short material)
+    {
+        if (m_batch.count == m_batch.offsets.size())
+            shadeBatch();
+
+        m_batch.offsets[m_batch.count]   = offset;
+        m_batch.texels[m_batch.count]    = texel;
+        m_batch.lights[m_batch.count]    = light;
+        m_batch.materials[m_batch.count] = material;
+        ++m_batch.count;
+    }
+
+    void shadeBatch();
+
+
+    //_____ Internal types __________
+private:
+    enum tAddressMode
+    {
+        ADDRESS_WRAP,
+        ADDRESS_MIRROR,
+        ADDRESS_CLAMP,
+    };
+
+    struct tTextureLevel
+    {
+        int                         width;
+        int                         height;
+        std::vector<unsigned int>   texels;     // RGBA, one byte per component
+    };
+
+    typedef std::vector<tTextureLevel> tTexture;
+
+    struct tMaterial
+    {
+        int             texture;
+        tAddressMode    addressMode;
+        unsigned int    color;          // Average color of the texture
+        bool            bBlend;
+        bool            bLighting;
+        float           ambient[3];
+        float           diffuse[3];
+        float           emissive[3];
+
+        // Lighting of the current frame: ambient + diffuse * light
+        float           frameAmbient[3];
+        float           frameDiffuse[3];
+    };
+
+    // A surface of the scene, with the parameters of the mapping:
+    // u = uOffset + dot(uAxis, P), v = vOffset + dot(vAxis, P)
+    struct tMappedSurface
+    {
+        unsigned short          material;
+        Athena::Math::Vector3   origin;
+        Athena::Math::Vector3   xAxis;
+        Athena::Math::Vector3   zAxis;
+        Athena::Math::Vector3   normal;
+        float                   width;
+        float                   height;
+        Athena::Math::Vector3   uAxis;
+        Athena::Math::Vector3   vAxis;
+        float                   uOffset;
+        float                   vOffset;
+        float                   logTexelsPerMeter;
+        float                   bottom;
+        float                   top;
+    };
+
+    struct tDecalNode
+    {
+        int decal;
+        int next;
+    };
+
+    struct tLight
+    {
+        Athena::Math::Vector3   position;
+        int                     room;
+    };
+
+    // A target (or a part of it), seen as a box
+    struct tBox
+    {
+        unsigned short  material;
+        float           center[2];      // On the floor (x, z)
+        float           axes[2][2];     // Unit vectors
+        float           extents[2];     // Half sizes along the axes
+        float           bottom;
+        float           top;
+        float           lights[6];      // -axes[0], +axes[0], -axes[1], +axes[1],
+                                        // top, bottom
+        float           distance;       // To the camera
+
+        inline bool operator<(const tBox& box) const
+        {
+            return distance > box.distance;
+        }
+    };
+
+    // The pixels waiting to be shaded
+    struct tBatch
+    {
+        unsigned int                count;
+        std::vector<unsigned int>   offsets;
+        std::vector<unsigned int>   texels;
+        std::vector<float>          lights;
+        std::vector<unsigned short> materials;
+    };
+
+
+    //_____ Attributes __________
+private:
+    Map*                                m_pMap;
+
+    // Resources (kept for all the maps)
+    std::vector<tTexture>               m_textures;
+    std::map<std::string, int>          m_textureIndices;
+    std::vector<tMaterial>              m_materials;
+    std::map<std::string, int>          m_materialIndices;
+    std::map<std::string, std::vector<Ogre::AxisAlignedBox> > m_meshBounds;
+
+    // Static scene (indexed by cell, or by face of cell: 4 * cell + face)
+    std::vector<tMappedSurface>         m_surfaces;
+    std::vector<tMappedSurface>         m_decals;
+    std::vector<int>                    m_floors;
+    std::vector<int>                    m_ceilings;
+    std::vector<int>                    m_walls;
+    std::vector<int>                    m_floorDecals;
+    std::vector<int>                    m_wallDecals;
+    std::vector<tDecalNode>             m_decalNodes;
+    std::vector<tLight>                 m_lights;
+    std::vector<float>                  m_floorLights;
+    std::vector<float>                  m_ceilingLights;
+    std::vector<float>                  m_wallLights;       // 4 heights per face
+    unsigned short                      m_defaultWallMaterial;
+    float                               m_ceilingHeight;
+
+    // Current frame
+    Athena::Math::Vector3               m_position;
+    float                               m_forward[2];
+    float                               m_right[2];
+    float                               m_tanX;
+    float                               m_tanY;
+    float                               m_farDistance;
+    std::vector<float>                  m_depths;           // Per column
+    std::vector<tMappedSurface>         m_disks;
+    std::vector<tBox>                   m_boxes;
+    unsigned char*                      m_pBuffer;
+    tBatch                              m_batch;
+};
+
+#endif
@@ -25,8 +25,13 @@
 
 #include <Athena/GameStates/IGameState.h>
 #include <Map.h>
+#include <MapBuilder.h>
+#include <LayoutsFile.h>
+#include <RaycastRenderer.h>
+#include <TopDownView.h>
 #include <goals/Goal.h>
 #include <teachers/Teacher.h>
+#include <mash-utils/worker_thread.h>
 #include <Ogre/OgreTexture.h>
 
 
@@ -53,9 +58,84 @@ public:
         return m_pGoal;
     }
 
+    inline Athena::Entities::Entity* getAvatar() const
+    {
+        return m_pAvatar;
+    }
+
     void reset();
     void resetTask();
 
+    //--------------------------------------------------------------------------
+    /// @brief Builds the next episode of the task in a hidden scene, so the
+    ///        next call to resetTask() only has to swap the scenes
+    ///
+    /// The episodes are generated from a sequence of seeds derived from the
+    /// global one: an episode is the same, built in advance or not.
+    ///
+    /// @return 'false' if there is no task, or if the next episode is
+    ///         already built
+    //--------------------------------------------------------------------------
+    bool prepareNextEpisode();
+
+    //--------------------------------------------------------------------------
+    /// @brief Performs the next stage of the build of the next episode (see
+    ///        prepareNextEpisode())
+    ///
+    /// The stages are: the generation of the map, the setup of the goal and
+    /// the placement of the objects. Used to interleave the build with other
+    /// work.
+    ///
+    /// @return 'true' if some stages remain
+    //--------------------------------------------------------------------------
+    bool prepareNextEpisodeStage();
+
+    //--------------------------------------------------------------------------
+    /// @brief Enables the update of the teacher in a background thread, while
+    ///        the frame is rendered and read back
+    ///
+    /// The teacher is always up-to-date when it is used, so the actions it
+    /// returns are the same in both modes.
+    //--------------------------------------------------------------------------
+    inline void setAsyncTeacher(bool bEnabled)
+    {
+        m_bAsyncTeacher = bEnabled;
+    }
+
+    //--------------------------------------------------------------------------
+    /// @brief Sets the folder containing the precomputed layouts of the tasks
+    ///
+    /// The file '<goal>-<environment>.layouts' is used if it exists (see
+    /// LayoutsFile): the episodes use layouts picked from it instead of
+    /// searching new ones.
+    //--------------------------------------------------------------------------
+    inline void setLayoutsFolder(const std::string& strFolder)
+    {
+        m_strLayoutsFolder = strFolder;
+    }
+
+    //--------------------------------------------------------------------------
+    /// @brief Selects the renderer used for the view of the avatar
+    ///
+    /// With RENDERER_RAYCAST, the view is rendered on the CPU (see
+    /// RaycastRenderer) and Ogre doesn't render the frames anymore.
+    //--------------------------------------------------------------------------
+    void setRenderer(tRenderer renderer);
+
+    inline tRenderer getRenderer() const
+    {
+        return m_renderer;
+    }
+
+    //--------------------------------------------------------------------------
+    /// @brief Enables or disables the rendering of the next frames by Ogre
+    ///        (never enabled with RENDERER_RAYCAST)
+    ///
+    /// If the last frame wasn't rendered, the view is rendered when it is
+    /// retrieved.
+    //--------------------------------------------------------------------------
+    void enableRendering(bool bEnabled);
+
     bool performAction(tAction action, float elapsedMilliseconds);
 
     inline tResult result() const
@@ -73,8 +153,52 @@ public:
         return m_strEvent;
     }
 
+    //--------------------------------------------------------------------------
+    /// @brief Returns the time spent in the last call to process(), in
+    ///        microseconds (0 if the statistics are disabled)
+    //--------------------------------------------------------------------------
+    inline unsigned long long getLastProcessDuration() const
+    {
+        return m_lastProcessDuration;
+    }
+
     unsigned char* getAvatarView(size_t &nbBytes);
 
+    //--------------------------------------------------------------------------
+    /// @brief Writes the current view in a buffer of (at least)
+    ///        VIEW_WIDTH * VIEW_HEIGHT * 3 bytes, without caching it
+    //--------------------------------------------------------------------------
+    bool getAvatarViewInto(unsigned char* pBuffer);
+
+    //--------------------------------------------------------------------------
+    /// @brief Renders the current view with the raycasting renderer in a
+    ///        buffer of (at least) VIEW_WIDTH * VIEW_HEIGHT * 3 bytes,
+    ///        whatever the selected renderer is (used to compare both)
+    //--------------------------------------------------------------------------
+    bool getRaycastViewInto(unsigned char* pBuffer);
+
+    //--------------------------------------------------------------------------
+    /// @brief Writes the ground-truth state of the task in a buffer of
+    ///        STATE_SIZE floats (see Declarations.h), without rendering
+    ///        anything
+    //--------------------------------------------------------------------------
+    bool getStateInto(float* pBuffer);
+
+    //--------------------------------------------------------------------------
+    /// @brief Selects what the 'topdown' view shows (see TopDownView)
+    //--------------------------------------------------------------------------
+    inline void setTopDownOptions(tTopDownSource source, bool bEgocentric)
+    {
+        m_topdown.setSource(source);
+        m_topdown.setEgocentric(bEgocentric);
+    }
+
+    //--------------------------------------------------------------------------
+    /// @brief Draws the top-down view of the grid in a buffer of (at least)
+    ///        TOPDOWN_SIZE * TOPDOWN_SIZE * 3 bytes (RGB)
+    //--------------------------------------------------------------------------
+    bool getTopDownViewInto(unsigned char* pBuffer);
+
     tAction getTeacherAction();
 
     Mash::tActionsList getNotRecommendedActions();
@@ -82,6 +206,15 @@ public:
 
 protected:
     bool retrieveCurrentView();
+    bool readView(unsigned char* pBuffer);
+
+    void waitForTeacher();
+    static void updateTeacher(void* pArgument);
+
+    void buildNextEpisode();
+    void buildNextEpisodeStage();
+    void destroyNextEpisode();
+    void endEpisode();
 
 
     //_____ Methods to be overriden by each state __________
@@ -105,16 +238,39 @@ public:
         COUNT_SEEDS
     };
 
+    enum tBuildStage
+    {
+        BUILD_MAP,
+        BUILD_GOAL,
+        BUILD_FINALIZE,
+        BUILD_DONE
+    };
+
 
     //_____ Attributes __________
 private:
     unsigned int                      m_seeds[COUNT_SEEDS];
+    unsigned int                      m_globalSeed;
+    unsigned int                      m_nbEpisodes;
+    MapBuilder*                       m_pNextMapBuilder;
+    Goal*                             m_pNextGoal;
+    tBuildStage                       m_nextEpisodeStage;
+    MapBuilder::tLayout               m_nextLayout;
+    bool                              m_bUseNextLayout;
+    std::string                       m_strLayoutsFolder;
+    LayoutsFile                       m_layouts;
     Ogre::TexturePtr                  m_texture;
     Ogre::RenderTexture*              m_pRenderTexture;
     Athena::Entities::Entity*         m_pAvatar;
     Athena::Physics::Body*            m_pAvatarBody;
     Athena::Physics::GhostObject*     m_pAvatarGhost;
     Ogre::Overlay*                    m_pOverlay;
+    Athena::Graphics::Visual::Camera* m_pCamera;
+    tRenderer                         m_renderer;
+    bool                              m_bRenderingEnabled;
+    bool                              m_bViewOutdated;
+    RaycastRenderer                   m_raycaster;
+    TopDownView                       m_topdown;
     std::string                       m_selectedMap;
     std::string                       m_selectedGoal;
     Teacher*                          m_pTeacher;
@@ -125,6 +281,12 @@ private:
     float                             m_fReward;
     std::string                       m_strEvent;
     unsigned char*                    m_pCurrentView;
+    unsigned long long                m_lastProcessDuration;
+    bool                              m_bAsyncTeacher;
+    Mash::WorkerThread                m_teacherThread;
+    bool                              m_bTeacherJobPending;
+    Athena::Math::Vector3             m_teacherPosition;
+    unsigned long long                m_teacherDuration;
 };
 
 #endif
@@ -55,6 +55,15 @@ public:
 public:
     static IApplicationServer* create();
 
+    //--------------------------------------------------------------------------
+    /// @brief Creates and initializes the simulator ahead of time (to be used
+    ///        by the pre-forked workers of the server)
+    ///
+    /// The simulator is then reused by all the sessions handled by the
+    /// process.
+    //--------------------------------------------------------------------------
+    static bool warmUp();
+
 
     //_____ Methods __________
 public:
@@ -174,6 +183,15 @@ public:
     virtual unsigned char* getView(const std::string& view, size_t &nbBytes,
                                    std::string &mimetype);
 
+    //--------------------------------------------------------------------------
+    /// @brief Writes one of the views in a buffer provided by the caller
+    ///
+    /// The image is read back from the GPU directly into the buffer.
+    //--------------------------------------------------------------------------
+    virtual bool getViewInto(const std::string& view, unsigned char* pBuffer,
+                             size_t maxNbBytes, size_t &nbBytes,
+                             std::string &mimetype);
+
     //--------------------------------------------------------------------------
     /// @brief Performs an action
     ///
@@ -214,14 +232,34 @@ public:
     //--------------------------------------------------------------------------
     virtual void onTimeout();
 
+    //--------------------------------------------------------------------------
+    /// @brief  Called when the responses to a command were sent, and the next
+    ///         command isn't there yet
+    ///
+    /// @return 'true' if some work remains
+    //--------------------------------------------------------------------------
+    virtual bool onIdle();
+
+
+private:
+    void useAvatarView();
+
 
     //_____ Attributes __________
 protected:
     Simulator*      m_pSimulator;
     unsigned int    m_globalSeed;
+    bool            m_bAvatarViewUsed;
 
 public:
     static bool bEnableSecrets;
+    static bool bAsyncTeacher;
+    static bool bPrebuildEpisodes;
+    static std::string strLayoutsFolder;
+    static tRenderer renderer;
+
+private:
+    static Simulator* pWarmSimulator;
 };
 
 #endif
@@ -32,14 +32,19 @@
 #include <Athena/Prerequisites.h>
 #include <Athena/Engine.h>
 #include <Athena-Inputs/Declarations.h>
+#include <Athena-Entities/Transforms.h>
 #include <mash-utils/declarations.h>
 #include <ServerState.h>
+#include <Ogre/OgreFrameListener.h>
 
 
 //---------------------------------------------------------------------------------------
 /// @brief  Main class of the simulator
+///
+/// In server mode, the simulator listens to the frames rendered by Ogre to
+/// measure the time spent in rendering.
 //---------------------------------------------------------------------------------------
-class Simulator
+class Simulator: public Ogre::FrameListener
 {
     //_____ Construction / Destruction __________
 public:
@@ -103,25 +108,143 @@ public:
         m_pServerState->reset();
     }
 
+    inline bool prepareNextEpisode()
+    {
+        assert(m_pServerState);
+
+        return m_pServerState->prepareNextEpisode();
+    }
+
+    inline bool prepareNextEpisodeStage()
+    {
+        assert(m_pServerState);
+
+        return m_pServerState->prepareNextEpisodeStage();
+    }
+
+    inline void setAsyncTeacher(bool bEnabled)
+    {
+        assert(m_pServerState);
+
+        m_pServerState->setAsyncTeacher(bEnabled);
+    }
+
+    inline void setLayoutsFolder(const std::string& strFolder)
+    {
+        assert(m_pServerState);
+
+        m_pServerState->setLayoutsFolder(strFolder);
+    }
+
+    inline void setRenderer(tRenderer renderer)
+    {
+        assert(m_pServerState);
+
+        m_pServerState->setRenderer(renderer);
+        m_pServerState->enableRendering(!m_bOnDemandRendering);
+    }
+
+    //--------------------------------------------------------------------------
+    /// @brief Sets the timing of the simulation of the actions (see tTiming)
+    ///
+    /// Each action is simulated by 'nbSteps' steps of the engine. In fast-
+    /// forward mode, only the frame of the last one is rendered.
+    //--------------------------------------------------------------------------
+    inline void setTiming(const tTiming& timing)
+    {
+        m_timing = timing;
+    }
+
+    inline const tTiming& getTiming() const
+    {
+        return m_timing;
+    }
+
+    //--------------------------------------------------------------------------
+    /// @brief Returns the limits of the physics world, as read from the
+    ///        configuration of Athena by init()
+    //--------------------------------------------------------------------------
+    inline const tPhysicsLimits& getPhysicsLimits() const
+    {
+        return m_physicsLimits;
+    }
+
+    inline Athena::Math::Vector3 getAvatarPosition() const
+    {
+        assert(m_pServerState);
+
+        return m_pServerState->getAvatar()->getTransforms()->getWorldPosition();
+    }
+
     inline void restart()
     {
         assert(m_pServerState);
 
         m_pServerState->resetTask();
-        stepOneFrame();
+
+        // Initialization of the goal (the view is only rendered if retrieved)
+        stepOneFrame(false);
     }
 
     tResult performAction(tAction action, float &fReward, std::string &strEvent);
 
     unsigned char* getAvatarView(size_t &nbBytes);
 
+    bool getAvatarViewInto(unsigned char* pBuffer);
+
+    inline bool getRaycastViewInto(unsigned char* pBuffer)
+    {
+        assert(m_pServerState);
+
+        return m_pServerState->getRaycastViewInto(pBuffer);
+    }
+
+    inline bool getStateInto(float* pBuffer)
+    {
+        assert(m_pServerState);
+
+        return m_pServerState->getStateInto(pBuffer);
+    }
+
+    inline void setTopDownOptions(tTopDownSource source, bool bEgocentric)
+    {
+        assert(m_pServerState);
+
+        m_pServerState->setTopDownOptions(source, bEgocentric);
+    }
+
+    inline bool getTopDownViewInto(unsigned char* pBuffer)
+    {
+        assert(m_pServerState);
+
+        return m_pServerState->getTopDownViewInto(pBuffer);
+    }
+
+    //--------------------------------------------------------------------------
+    /// @brief Only renders the frames when the view of the avatar is retrieved
+    ///        (for the clients that don't use it)
+    //--------------------------------------------------------------------------
+    inline void setOnDemandRendering(bool bEnabled)
+    {
+        assert(m_pServerState);
+
+        m_bOnDemandRendering = bEnabled;
+        m_pServerState->enableRendering(!bEnabled);
+    }
+
     tAction getTeacherAction();
 
     Mash::tActionsList getNotRecommendedActions();
 
 
 private:
-    bool stepOneFrame();
+    bool stepOneFrame(bool bRender = true);
+
+
+    //_____ Implementation of Ogre::FrameListener __________
+public:
+    virtual bool frameStarted(const Ogre::FrameEvent& evt);
+    virtual bool frameEnded(const Ogre::FrameEvent& evt);
 
 
     //_____ Attributes __________
@@ -130,6 +253,11 @@ private:
     Athena::Engine                      m_engine;
     Athena::Inputs::VirtualController*  m_pController;
     ServerState*                        m_pServerState;
+    unsigned long long                  m_renderStart;
+    unsigned long long                  m_renderDuration;
+    tTiming                             m_timing;
+    tPhysicsLimits                      m_physicsLimits;
+    bool                                m_bOnDemandRendering;
 
     static const Athena::Utils::tID     STATE_FPS       = 0;
     static const Athena::Utils::tID     STATE_SERVER    = 1;
@@ -0,0 +1,105 @@
+/*******************************************************************************
+* MASH 3D simulator
+* 
+* Copyright (c) 2014 Idiap Research Institute, http://www.idiap.ch/
+* Written by Philip Abbet <philip.abbet@idiap.ch>
+* 
+* This file is part of mash-simulator.
+* 
+* mash-simulator is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 3 as
+* published by the Free Software Foundation.
+* 
+* mash-simulator is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+* 
+* You should have received a copy of the GNU General Public License
+* along with mash-simulator. If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+
+#ifndef _TOPDOWNVIEW_H_
+#define _TOPDOWNVIEW_H_
+
+#include <Declarations.h>
+#include <Map.h>
+#include <teachers/Teacher.h>
+#include <vector>
+
+
+//------------------------------------------------------------------------------
+/// @brief  Top-down view of the grid of the map (or of the part of it known by
+///         the teacher), one pixel per cell
+///
+/// The image of the whole grid is kept between the calls: only the cells
+/// modified since the last call are recolored (the ones moved by
+/// Map::moveTarget(), and the ones explored or forgotten by the teacher).
+/// The cell of the avatar is drawn on top of it.
+//------------------------------------------------------------------------------
+class TopDownView
+{
+    //_____ Construction / Destruction __________
+public:
+    TopDownView();
+    ~TopDownView();
+
+
+    //_____ Methods __________
+public:
+    //--------------------------------------------------------------------------
+    /// @brief Sets the map (and the teacher, optional) to draw
+    ///
+    /// Must be called at the beginning of each episode: the whole image is
+    /// drawn here.
+    //--------------------------------------------------------------------------
+    void setMap(Map* pMap, Teacher* pTeacher);
+
+    inline Map* getMap() const
+    {
+        return m_pMap;
+    }
+
+    //--------------------------------------------------------------------------
+    /// @brief Selects what is drawn: the grid of the map, or the part of it
+    ///        explored by the teacher (if there is a teacher)
+    //--------------------------------------------------------------------------
+    void setSource(tTopDownSource source);
+
+    //--------------------------------------------------------------------------
+    /// @brief Enables the egocentric mode: the view shows the TOPDOWN_SIZE x
+    ///        TOPDOWN_SIZE cells around the avatar, instead of the whole map
+    ///        scaled to TOPDOWN_SIZE x TOPDOWN_SIZE pixels
+    //--------------------------------------------------------------------------
+    inline void setEgocentric(bool bEnabled)
+    {
+        m_bEgocentric = bEnabled;
+    }
+
+    //--------------------------------------------------------------------------
+    /// @brief Draws the view in a buffer of (at least) TOPDOWN_SIZE *
+    ///        TOPDOWN_SIZE * 3 bytes (RGB)
+    ///
+    /// @param x    X coordinate of the cell of the avatar
+    /// @param y    Y coordinate of the cell of the avatar
+    //--------------------------------------------------------------------------
+    void render(int x, int y, unsigned char* pBuffer);
+
+private:
+    void update();
+    void drawCell(unsigned int index);
+
+
+    //_____ Attributes __________
+private:
+    Map*                        m_pMap;
+    Teacher*                    m_pTeacher;
+    tTopDownSource              m_source;
+    bool                        m_bEgocentric;
+    std::vector<unsigned char>  m_image;
+    unsigned int                m_nbKnownMapChanges;
+    unsigned int                m_nbKnownTeacherChanges;
+};
+
+#endif
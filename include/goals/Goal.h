@@ -37,6 +37,8 @@ protected:
     typedef Athena::Utils::VectorIterator<tContactsList>        tContactsIterator;
     typedef tContactsList::iterator                             tContactsNativeIterator;
 
+    typedef std::map<Athena::Entities::Entity*, tTarget*>       tTargetsIndex;
+
 
     //_____ Construction / Destruction __________
 public:
@@ -62,6 +64,8 @@ public:
         return m_bFalling;
     }
 
+    bool isAvatarOnGround() const;
+
 
     //_____ Methods to implement __________
 public:
@@ -83,7 +87,8 @@ protected:
     Athena::Physics::GhostObject*       m_pAvatarGhost;
     Athena::Physics::Body*              m_pAvatarBody;
     Map*                                m_pMap;
-    tContactsList                       m_contacts;
+    tContactsList                       m_contacts;         // Sorted
+    tTargetsIndex                       m_targetsIndex;     // Entity -> target
     bool                                m_bFalling;
     bool                                m_bInitialized;
     float                               m_fTimeout;
@@ -26,6 +26,13 @@
 #include <MapBuilder.h>
 #include <string>
 
-MapBuilder* createMap(const std::string& strName);
+//------------------------------------------------------------------------------
+/// @brief  Create the map builder of an environment
+///
+/// @param  strName     Name of the environment
+/// @param  seed        Seed of the random number generator of the map: the
+///                     same seed always gives the same map
+//------------------------------------------------------------------------------
+MapBuilder* createMap(const std::string& strName, unsigned int seed);
 
 #endif
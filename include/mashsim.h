@@ -0,0 +1,252 @@
+/*******************************************************************************
+* MASH 3D simulator
+* 
+* Copyright (c) 2014 Idiap Research Institute, http://www.idiap.ch/
+* Written by Philip Abbet <philip.abbet@idiap.ch>
+* 
+* This file is part of mash-simulator.
+* 
+* mash-simulator is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 3 as
+* published by the Free Software Foundation.
+* 
+* mash-simulator is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+* 
+* You should have received a copy of the GNU General Public License
+* along with mash-simulator. If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+
+
+/** @file   mashsim.h
+    @author Philip Abbet (philip.abbet@idiap.ch)
+
+    C interface of the 'mashsim' library, used to embed the simulator in
+    another process (no server, no sockets)
+
+    Typical usage:
+
+        mashsim_simulator* sim = mashsim_create(0, 0);
+
+        mashsim_init_task(sim, "reach_1_flag", "SingleRoom", 42);
+
+        while (mashsim_step(sim, MASHSIM_GO_FORWARD, &reward) == MASHSIM_RESULT_NONE)
+            mashsim_get_view(sim, buffer, size);
+
+        mashsim_destroy(sim);
+
+    Only one simulator can exist at a time in a process (the 3D engine is
+    shared), and all the functions must be called from the same thread.
+*/
+
+#ifndef _MASHSIM_H_
+#define _MASHSIM_H_
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(_WIN32)
+    #define MASHSIM_API __declspec(dllexport)
+#else
+    #define MASHSIM_API __attribute__ ((visibility("default")))
+#endif
+
+
+/********************************** TYPES *************************************/
+
+/// Opaque handle to a simulator
+typedef struct mashsim_simulator mashsim_simulator;
+
+/// The actions
+enum
+{
+    MASHSIM_GO_FORWARD      = 0,
+    MASHSIM_GO_BACKWARD     = 1,
+    MASHSIM_TURN_LEFT       = 2,
+    MASHSIM_TURN_RIGHT      = 3,
+    MASHSIM_NB_ACTIONS      = 4,
+};
+
+/// The results of a step
+enum
+{
+    MASHSIM_RESULT_ERROR    = -1,   ///< See mashsim_last_error()
+    MASHSIM_RESULT_NONE     = 0,    ///< The episode continues
+    MASHSIM_RESULT_SUCCESS  = 1,    ///< The goal was reached
+    MASHSIM_RESULT_FAILED   = 2,    ///< The goal can't be reached anymore
+};
+
+/// The renderers of the views
+enum
+{
+    MASHSIM_RENDERER_OGRE     = 0,  ///< The 3D engine (default)
+    MASHSIM_RENDERER_RAYCAST  = 1,  ///< Raycasting on the CPU
+};
+
+
+/******************************** FUNCTIONS ***********************************/
+
+//------------------------------------------------------------------------------
+/// @brief  Set the size of the views
+///
+/// Must be called before mashsim_create() (default: 320x240)
+/// @return 0 if successful, -1 if a simulator already exists
+//------------------------------------------------------------------------------
+MASHSIM_API int mashsim_set_view_size(unsigned int width, unsigned int height);
+
+//------------------------------------------------------------------------------
+/// @brief  Retrieve the size of the views
+//------------------------------------------------------------------------------
+MASHSIM_API void mashsim_get_view_size(unsigned int* width, unsigned int* height);
+
+//------------------------------------------------------------------------------
+/// @brief  Create the simulator, and initialize the 3D engine
+///
+/// @param  data_folder     Folder containing 'athena.cfg' and the media files
+///                         (the current directory of the process is changed).
+///                         If 0, the current directory is used.
+/// @param  enable_secrets  Allow the secret goals and environments
+/// @return                 The simulator, 0 if failed
+//------------------------------------------------------------------------------
+MASHSIM_API mashsim_simulator* mashsim_create(const char* data_folder, int enable_secrets);
+
+//------------------------------------------------------------------------------
+/// @brief  Destroy the simulator
+//------------------------------------------------------------------------------
+MASHSIM_API void mashsim_destroy(mashsim_simulator* sim);
+
+//------------------------------------------------------------------------------
+/// @brief  Update the teacher in a background thread while the frames are
+///         rendered (disabled by default). The returned actions don't change.
+//------------------------------------------------------------------------------
+MASHSIM_API void mashsim_set_async_teacher(mashsim_simulator* sim, int enabled);
+
+//------------------------------------------------------------------------------
+/// @brief  Set the folder containing the layouts precomputed by
+///         'mash-simulator-layouts' (used by the tasks initialized after)
+//------------------------------------------------------------------------------
+MASHSIM_API void mashsim_set_layouts_folder(mashsim_simulator* sim, const char* folder);
+
+//------------------------------------------------------------------------------
+/// @brief  Select the renderer of the views (MASHSIM_RENDERER_OGRE or
+///         MASHSIM_RENDERER_RAYCAST)
+///
+/// @return 0 if successful, -1 if the renderer is unknown
+//------------------------------------------------------------------------------
+MASHSIM_API int mashsim_set_renderer(mashsim_simulator* sim, int renderer);
+
+//------------------------------------------------------------------------------
+/// @brief  Set the timing of the actions (used from the next action)
+///
+/// @param  action_duration  Duration of an action for the goal, in milliseconds
+///                          (default: 100)
+/// @param  nb_steps         Number of steps of the engine simulating an action
+///                          (default: 1)
+/// @param  step_duration    Time elapsed during one step, in milliseconds
+///                          (default: 100)
+/// @param  fast_forward     If not 0, only the last step of each action is
+///                          rendered
+/// @return 0 if successful, -1 if the values are invalid
+///
+/// Apart from the defaults (kept for compatibility), the steps must last at
+/// most the fixed steps of the physics world (see the 'physics' section of
+/// 'athena.cfg') and add up to the duration of an action, for instance 6 steps
+/// of 16.667ms for 100ms with the provided 'athena.cfg'.
+//------------------------------------------------------------------------------
+MASHSIM_API int mashsim_set_timing(mashsim_simulator* sim, float action_duration,
+                                   unsigned int nb_steps, float step_duration,
+                                   int fast_forward);
+
+//------------------------------------------------------------------------------
+/// @brief  Initialize a task (like the INITIALIZE_TASK command of the network
+///         protocol), and start its first episode
+///
+/// @param  goal            Name of the goal
+/// @param  environment     Name of the environment
+/// @param  seed            Seed used to generate the environments
+/// @return                 0 if successful, -1 otherwise
+//------------------------------------------------------------------------------
+MASHSIM_API int mashsim_init_task(mashsim_simulator* sim, const char* goal,
+                                  const char* environment, unsigned int seed);
+
+//------------------------------------------------------------------------------
+/// @brief  Start a new episode of the current task
+///
+/// @return 0 if successful, -1 otherwise
+//------------------------------------------------------------------------------
+MASHSIM_API int mashsim_reset(mashsim_simulator* sim);
+
+//------------------------------------------------------------------------------
+/// @brief  Build the next episode of the task in advance (in a hidden scene),
+///         so the next call to mashsim_reset() is almost instantaneous
+///
+/// Call it when the simulator would be idle otherwise (for instance, while the
+/// trainer learns from the last episode). The episodes don't depend on it.
+///
+/// @return 0 if successful (or already built), -1 otherwise
+//------------------------------------------------------------------------------
+MASHSIM_API int mashsim_prepare_next_episode(mashsim_simulator* sim);
+
+//------------------------------------------------------------------------------
+/// @brief  Perform an action
+///
+/// @param  action      The action (MASHSIM_GO_FORWARD, ...)
+/// @param[out] reward  The reward (optional)
+/// @return             The result (MASHSIM_RESULT_NONE, ...)
+//------------------------------------------------------------------------------
+MASHSIM_API int mashsim_step(mashsim_simulator* sim, int action, float* reward);
+
+//------------------------------------------------------------------------------
+/// @brief  Returns the description of what happened during the last step
+///         (empty string if nothing special)
+///
+/// @remark The string is valid until the next step
+//------------------------------------------------------------------------------
+MASHSIM_API const char* mashsim_last_event(mashsim_simulator* sim);
+
+//------------------------------------------------------------------------------
+/// @brief  Write the current view in a buffer provided by the caller
+///
+/// The image is read back from the GPU directly into the buffer: width x height
+/// pixels, 3 bytes per pixel (RGB), row by row from the top.
+/// @param  buffer  The buffer
+/// @param  size    Size of the buffer, in bytes (at least width x height x 3)
+/// @return         0 if successful, -1 otherwise
+//------------------------------------------------------------------------------
+MASHSIM_API int mashsim_get_view(mashsim_simulator* sim, unsigned char* buffer,
+                                 size_t size);
+
+//------------------------------------------------------------------------------
+/// @brief  Returns the action suggested by the teacher of the task
+///
+/// @return The action, -1 if the task has no teacher
+//------------------------------------------------------------------------------
+MASHSIM_API int mashsim_teacher_action(mashsim_simulator* sim);
+
+//------------------------------------------------------------------------------
+/// @brief  Retrieve the actions not recommended by the teacher of the task
+///
+/// @param[out] actions     Array receiving the actions
+/// @param  max_actions     Size of the array
+/// @return                 The number of actions written in the array
+//------------------------------------------------------------------------------
+MASHSIM_API int mashsim_not_recommended_actions(mashsim_simulator* sim,
+                                                int* actions, int max_actions);
+
+//------------------------------------------------------------------------------
+/// @brief  Returns the description of the last error
+//------------------------------------------------------------------------------
+MASHSIM_API const char* mashsim_last_error(mashsim_simulator* sim);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -46,17 +46,44 @@ public:
     void update(const Athena::Math::Vector3& position,
                 const Athena::Math::Quaternion& orientation);
 
+    // Split version of update(): captureView() must be called from the thread
+    // owning the scene, processView() can then be called from another one
+    // (before any other method of the teacher)
+    void captureView();
+    void processView(const Athena::Math::Vector3& position);
+
     tAction nextAction();
 
     virtual Mash::tActionsList notRecommendedActions() = 0;
 
     unsigned char* getImageOfGrid(unsigned int &width, unsigned int &height);
 
+    inline bool isExplored(unsigned int index) const
+    {
+        return m_explored[index];
+    }
+
+    // The cells whose state (explored or not) changed since the beginning of
+    // the episode, in order (the users remember how many they already know)
+    inline const std::vector<unsigned int>& getChangedCells() const
+    {
+        return m_changed_cells;
+    }
+
     virtual void onTargetReached(tTarget* pTarget) {}
 
 protected:
     virtual tAction computeNextAction() = 0;
 
+    inline void setExplored(unsigned int index, bool bExplored)
+    {
+        if (m_explored[index] != bExplored)
+        {
+            m_explored[index] = bExplored;
+            m_changed_cells.push_back(index);
+        }
+    }
+
     bool isCellVisible(unsigned int x, unsigned int y);
     float getDistanceToTarget(const tPoint& target);
     Athena::Math::Degree getAngleToTarget(const tPoint& target);
@@ -67,7 +94,9 @@ protected:
     Athena::Graphics::Visual::Camera*   m_pCamera;
 
     Map*                                m_pMap;
-    tCellType*                          m_grid;
+    std::vector<bool>                   m_explored;     // The known cells (the types are
+                                                        // read from the grid of the map)
+    std::vector<unsigned int>           m_changed_cells;
 
     tPoint                              m_robot_position;
     tPointF                             m_robot_position_f;
@@ -77,6 +106,9 @@ protected:
     std::vector<tPoint>                 m_detected_targets;
 
     tAction                             m_nextAction;
+
+    float                               m_frustumPlanes[6][4];
+    bool                                m_bInfiniteFarPlane;
 };
 
 #endif
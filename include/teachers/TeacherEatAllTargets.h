@@ -46,7 +46,8 @@ protected:
 
     //_____ Attributes __________
 protected:
-    int current_target;
+    int             current_target;
+    unsigned int    nb_known_changes;   // Number of entries of Map::changed_cells already processed
 };
 
 #endif
@@ -40,3 +40,16 @@ void setResolution(unsigned int width, unsigned int height)
     RTT_WIDTH   = MathUtils::Pow(2, MathUtils::Ceil(MathUtils::Log2(width)));
     RTT_HEIGHT  = MathUtils::Pow(2, MathUtils::Ceil(MathUtils::Log2(height)));
 }
+
+
+bool parseRenderer(const std::string& strName, tRenderer &renderer)
+{
+    if (strName == "ogre")
+        renderer = RENDERER_OGRE;
+    else if (strName == "raycast")
+        renderer = RENDERER_RAYCAST;
+    else
+        return false;
+
+    return true;
+}
@@ -48,6 +48,7 @@
 #include <Ogre/OgreRenderWindow.h>
 #include <Ogre/OgreSceneManager.h>
 #include <Ogre/OgreOverlayManager.h>
+#include <time.h>
 
 
 using namespace Athena;
@@ -110,7 +111,7 @@ void FPSState::resetTask()
     delete m_pTeacher;
 
 
-    MapBuilder* pMapBuilder = createMap(m_selectedMap);
+    MapBuilder* pMapBuilder = createMap(m_selectedMap, (unsigned int) time(0));
 
     m_pGoal = createGoal(m_selectedGoal);
     m_pGoal->setup(pMapBuilder);
@@ -0,0 +1,237 @@
+/*******************************************************************************
+* MASH 3D simulator
+* 
+* Copyright (c) 2014 Idiap Research Institute, http://www.idiap.ch/
+* Written by Philip Abbet <philip.abbet@idiap.ch>
+* 
+* This file is part of mash-simulator.
+* 
+* mash-simulator is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 3 as
+* published by the Free Software Foundation.
+* 
+* mash-simulator is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+* 
+* You should have received a copy of the GNU General Public License
+* along with mash-simulator. If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+
+#include <LayoutsFile.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <assert.h>
+
+using namespace Athena::Math;
+
+
+static const char* MAGIC = "MASHLAY1";
+
+
+static void writePlacement(unsigned char* pDst, const MapBuilder::tPlacement& placement)
+{
+    short coords[2] = { (short) placement.position.x, (short) placement.position.y };
+    float orientation[4] = { placement.orientation.w, placement.orientation.x,
+                             placement.orientation.y, placement.orientation.z };
+
+    memcpy(pDst, coords, 4);
+    memcpy(pDst + 4, orientation, 16);
+}
+
+
+static void readPlacement(const unsigned char* pSrc, MapBuilder::tPlacement &placement)
+{
+    short coords[2];
+    float orientation[4];
+
+    memcpy(coords, pSrc, 4);
+    memcpy(orientation, pSrc + 4, 16);
+
+    placement.position.x  = coords[0];
+    placement.position.y  = coords[1];
+    placement.orientation = Quaternion(orientation[0], orientation[1], orientation[2], orientation[3]);
+}
+
+
+/***************************** CONSTRUCTION / DESTRUCTION ******************************/
+
+LayoutsFile::LayoutsFile()
+: m_pData(0), m_size(0), m_pFile(0), m_nbLayouts(0), m_nbTargets(0)
+{
+}
+
+
+LayoutsFile::~LayoutsFile()
+{
+    close();
+}
+
+
+/************************************** METHODS ****************************************/
+
+bool LayoutsFile::open(const std::string& strFileName)
+{
+    close();
+
+    int fd = ::open(strFileName.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat infos;
+    if ((fstat(fd, &infos) != 0) || (infos.st_size < HEADER_SIZE))
+    {
+        ::close(fd);
+        return false;
+    }
+
+    void* pData = mmap(0, infos.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+
+    if (pData == MAP_FAILED)
+        return false;
+
+    m_pData = (unsigned char*) pData;
+    m_size  = infos.st_size;
+
+    // Check the header
+    char name[NAME_SIZE + 1];
+    name[NAME_SIZE] = 0;
+
+    memcpy(&m_nbLayouts, m_pData + 8, 4);
+    memcpy(&m_nbTargets, m_pData + 12, 4);
+
+    memcpy(name, m_pData + 16, NAME_SIZE);
+    m_strGoal = name;
+
+    memcpy(name, m_pData + 16 + NAME_SIZE, NAME_SIZE);
+    m_strEnvironment = name;
+
+    if ((memcmp(m_pData, MAGIC, 8) != 0) || (m_nbLayouts == 0) ||
+        (m_size < HEADER_SIZE + (size_t) m_nbLayouts * recordSize()))
+    {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+
+bool LayoutsFile::create(const std::string& strFileName, const std::string& strGoal,
+                         const std::string& strEnvironment, unsigned int nbTargets)
+{
+    close();
+
+    if ((strGoal.size() >= NAME_SIZE) || (strEnvironment.size() >= NAME_SIZE))
+        return false;
+
+    m_pFile = fopen(strFileName.c_str(), "wb");
+    if (!m_pFile)
+        return false;
+
+    m_nbLayouts      = 0;
+    m_nbTargets      = nbTargets;
+    m_strGoal        = strGoal;
+    m_strEnvironment = strEnvironment;
+
+    // The number of layouts is written by close()
+    unsigned char header[HEADER_SIZE];
+    memset(header, 0, HEADER_SIZE);
+
+    memcpy(header, MAGIC, 8);
+    memcpy(header + 12, &m_nbTargets, 4);
+    memcpy(header + 16, strGoal.c_str(), strGoal.size());
+    memcpy(header + 16 + NAME_SIZE, strEnvironment.c_str(), strEnvironment.size());
+
+    if (fwrite(header, HEADER_SIZE, 1, m_pFile) != 1)
+    {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+
+bool LayoutsFile::append(unsigned int seed, const MapBuilder::tLayout& layout)
+{
+    // Assertions
+    assert(m_pFile);
+
+    if (layout.targets.size() != m_nbTargets)
+        return false;
+
+    unsigned char record[4 + PLACEMENT_SIZE * 64];
+    unsigned char* pRecord = record;
+
+    if (recordSize() > sizeof(record))
+        pRecord = new unsigned char[recordSize()];
+
+    memcpy(pRecord, &seed, 4);
+
+    writePlacement(pRecord + 4, layout.start);
+
+    for (unsigned int i = 0; i < m_nbTargets; ++i)
+        writePlacement(pRecord + 4 + PLACEMENT_SIZE * (i + 1), layout.targets[i]);
+
+    bool bResult = (fwrite(pRecord, recordSize(), 1, m_pFile) == 1);
+
+    if (pRecord != record)
+        delete[] pRecord;
+
+    if (bResult)
+        ++m_nbLayouts;
+
+    return bResult;
+}
+
+
+void LayoutsFile::close()
+{
+    if (m_pData)
+    {
+        munmap(m_pData, m_size);
+        m_pData = 0;
+        m_size  = 0;
+    }
+
+    if (m_pFile)
+    {
+        fseek(m_pFile, 8, SEEK_SET);
+        fwrite(&m_nbLayouts, 4, 1, m_pFile);
+        fclose(m_pFile);
+        m_pFile = 0;
+    }
+
+    m_nbLayouts = 0;
+    m_nbTargets = 0;
+    m_strGoal   = "";
+    m_strEnvironment = "";
+}
+
+
+bool LayoutsFile::getLayout(unsigned int index, unsigned int &seed,
+                            MapBuilder::tLayout &layout) const
+{
+    if (!m_pData || (index >= m_nbLayouts))
+        return false;
+
+    const unsigned char* pRecord = m_pData + HEADER_SIZE + (size_t) index * recordSize();
+
+    memcpy(&seed, pRecord, 4);
+
+    readPlacement(pRecord + 4, layout.start);
+
+    layout.targets.resize(m_nbTargets);
+
+    for (unsigned int i = 0; i < m_nbTargets; ++i)
+        readPlacement(pRecord + 4 + PLACEMENT_SIZE * (i + 1), layout.targets[i]);
+
+    return true;
+}
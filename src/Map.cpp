@@ -25,6 +25,9 @@
 #include <Athena-Entities/Entity.h>
 #include <Athena-Entities/Transforms.h>
 #include <Athena-Math/Vector3.h>
+#include <Ogre/OgreCamera.h>
+#include <Ogre/OgreMeshManager.h>
+#include <string.h>
 
 using namespace Athena;
 using namespace Athena::Math;
@@ -46,29 +49,69 @@ Map::tColor Map::COLORS[] = {
     { 0, 255, 255},
 };
 
+const tCellInfos Grid::DEFAULT_INFOS;
+
 
 /***************************** CONSTRUCTION / DESTRUCTION ******************************/
 
-Map::Map(unsigned int cell_size, unsigned int map_width, unsigned int map_height)
-: cell_size(cell_size), width(map_width), height(map_height), grid(0), pScene(0), pEntity(0)
+Grid::Grid(unsigned int width, unsigned int height)
+: m_width(width), m_height(height), m_types(0), m_rooms(0)
 {
-    // Create the grid
-    grid = new tCell[width * height];
+    m_types = new unsigned char[width * height];
+    m_rooms = new unsigned char[width * height];
+
+    memset(m_types, CELL_UNREACHEABLE, width * height);
+    memset(m_rooms, 0, width * height);
+}
+
 
-    for (unsigned int i = 0; i < width * height; ++i)
-        grid[i].type = CELL_UNREACHEABLE;
+Grid::~Grid()
+{
+    delete[] m_types;
+    delete[] m_rooms;
+}
+
+
+Map::Map(unsigned int cell_size, unsigned int map_width, unsigned int map_height)
+: cell_size(cell_size), width(map_width), height(map_height),
+  grid(map_width, map_height), pScene(0), pEntity(0)
+{
 }
 
 
 Map::~Map()
 {
-    delete[] grid;
     delete pScene;
+
+    for (unsigned int i = 0; i < meshes.size(); ++i)
+        Ogre::MeshManager::getSingleton().remove(meshes[i]);
 }
 
 
 /************************************** METHODS ****************************************/
 
+const tCellInfos& Grid::infos(unsigned int index) const
+{
+    tCellInfosList::const_iterator iter = m_infos.find(index);
+    if (iter == m_infos.end())
+        return DEFAULT_INFOS;
+
+    return iter->second;
+}
+
+
+tCellInfos& Grid::editInfos(unsigned int index)
+{
+    return m_infos[index];
+}
+
+
+void Grid::removeInfos(unsigned int index)
+{
+    m_infos.erase(index);
+}
+
+
 unsigned char* Map::getImageOfGrid(unsigned int &width, unsigned int &height)
 {
     width = this->width;
@@ -81,7 +124,7 @@ unsigned char* Map::getImageOfGrid(unsigned int &width, unsigned int &height)
     {
         for (unsigned int x = 0; x < width; ++x)
         {
-            tColor color = COLORS[ grid[y * width + x].type ];
+            tColor color = COLORS[ grid.type(x, y) ];
             pDst[0] = color.r;
             pDst[1] = color.g;
             pDst[2] = color.b;
@@ -166,21 +209,45 @@ void Map::moveTarget(tTarget* pTarget, Athena::Entities::Entity* pAvatar)
 
     delete[] positions;
 
-    for (unsigned int i = 0; i < width * height; ++i)
+    // Retrieve the cells of the target (only the special cells have infos,
+    // and the other kinds of cells use the same indices for other purposes)
+    std::vector<unsigned int> cells;
+
+    tCellInfosIterator iter = grid.getInfosIterator();
+    while (iter.hasMoreElements())
     {
-        if (grid[i].infos_index == target_info_index)
+        if ((iter.peekNextValue().infos_index == target_info_index) &&
+            (grid.type(iter.peekNextKey()) == CELL_TARGET))
         {
-            grid[i].type = CELL_FLOOR;
-            grid[i].infos_index = 0;
+            cells.push_back(iter.peekNextKey());
         }
+
+        iter.moveNext();
     }
 
-    putDisk(new_x, new_y, true, target_info_index);
+    // Draw the target at its new position, then remove the cells of its old
+    // position that weren't overwritten. Only the cells whose type changed are
+    // reported.
+    putDisk(new_x, new_y, true, target_info_index, &changed_cells);
+
+    for (unsigned int i = 0; i < cells.size(); ++i)
+    {
+        const tCellInfos& infos = grid.infos(cells[i]);
+        if ((infos.main_x == (int) new_x) && (infos.main_y == (int) new_y))
+            continue;
+
+        grid.setType(cells[i], CELL_FLOOR);
+        grid.removeInfos(cells[i]);
+        changed_cells.push_back(cells[i]);
+    }
 }
 
 
-void Map::putDisk(unsigned int center_x, unsigned int center_y, bool present, unsigned int infos_index)
+void Map::putDisk(unsigned int center_x, unsigned int center_y, bool present,
+                  unsigned int infos_index, std::vector<unsigned int>* pChangedCells)
 {
+    tCellType type = (present ? CELL_TARGET : CELL_FLOOR);
+
     unsigned int radius = FROM_METERS(1.5f);
 
     for (int y = center_y - radius; y <= center_y + radius; ++y)
@@ -196,11 +263,94 @@ void Map::putDisk(unsigned int center_x, unsigned int center_y, bool present, un
             if ((x - center_x) * (x - center_x) + (y - center_y) * (y - center_y) >= radius * radius)
                 continue;
 
-            tCell* pCell       = &grid[y * width + x];
-            pCell->type        = (present ? CELL_TARGET : CELL_FLOOR);
-            pCell->infos_index = infos_index;
-            pCell->main_x      = (present ? center_x : -1);
-            pCell->main_y      = (present ? center_y : -1);
+            unsigned int index = grid.index(x, y);
+
+            if (pChangedCells && (grid.type(index) != type))
+                pChangedCells->push_back(index);
+
+            grid.setType(index, type);
+
+            tCellInfos& infos = grid.editInfos(index);
+            infos.infos_index = infos_index;
+            infos.main_x      = (present ? center_x : -1);
+            infos.main_y      = (present ? center_y : -1);
         }
     }
 }
+
+
+int Map::getRoomAt(unsigned int x, unsigned int y) const
+{
+    for (unsigned int i = 0; i < rooms.size(); ++i)
+    {
+        const tZone& rectangle = rooms[i].rectangle;
+
+        if ((x >= rectangle.left) && (x < rectangle.left + rectangle.width) &&
+            (y >= rectangle.top) && (y < rectangle.top + rectangle.height))
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+
+void Map::updateVisibility(Ogre::Camera* pCamera)
+{
+    // Assertions
+    assert(pCamera);
+
+    if (rooms.size() <= 1)
+        return;
+
+    const Ogre::Vector3& position = pCamera->getDerivedPosition();
+
+    int room = -1;
+    if ((position.x >= 0.0f) && (position.z >= 0.0f))
+        room = getRoomAt(FROM_METERS(position.x), FROM_METERS(position.z));
+
+    std::vector<bool> visible(rooms.size(), (room < 0));
+
+    // Flood through the portals in the frustum, from the room of the camera
+    if (room >= 0)
+    {
+        std::vector<unsigned int> stack;
+
+        visible[room] = true;
+        stack.push_back(room);
+
+        while (!stack.empty())
+        {
+            unsigned int index = stack.back();
+            const tRoom& current = rooms[index];
+            stack.pop_back();
+
+            for (unsigned int i = 0; i < current.portals.size(); ++i)
+            {
+                const tPortal& portal = portals[current.portals[i]];
+
+                unsigned int neighbour = (portal.rooms[0] == index ? portal.rooms[1] : portal.rooms[0]);
+                if (visible[neighbour] || !pCamera->isVisible(portal.box))
+                    continue;
+
+                visible[neighbour] = true;
+                stack.push_back(neighbour);
+            }
+        }
+    }
+
+    // Only the rooms whose visibility changed are modified
+    for (unsigned int i = 0; i < rooms.size(); ++i)
+    {
+        tRoom& current = rooms[i];
+
+        if (current.visible == visible[i])
+            continue;
+
+        current.visible = visible[i];
+
+        for (unsigned int j = 0; j < current.objects.size(); ++j)
+            current.objects[j]->setVisible(current.visible);
+    }
+}
@@ -40,6 +40,9 @@
 #include <Athena-Physics/Conversions.h>
 #include <Athena-Core/Utils/StringConverter.h>
 #include <Ogre/OgreSubEntity.h>
+#include <Ogre/OgreLight.h>
+#include <Ogre/OgreManualObject.h>
+#include <mash-utils/tracer.h>
 #include <algorithm>
 
 using namespace Athena;
@@ -56,6 +59,16 @@ const char* FLOOR_MATERIAL      = "Floors/Floor5/Basic";
 const char* CEILING_MATERIAL    = "Ceilings/Ceiling1/Basic";
 const char* WALLS_MATERIAL1     = "Walls/Wall10/Basic";
 const float MAP_HEIGHT          = 3.0f;
+const float PORTAL_DEPTH        = 0.5f;     // Distance between the boundary of two rooms
+                                            // and the faces of their portal (larger than
+                                            // the near clip distance of the camera)
+
+const float MapBuilder::LIGHT_ATTENUATION[4] = { 20.0f, 0.8f, 0.1f, 0.05f };
+
+
+// Used to give an unique name to each scene (the next episode is built while
+// the current one still exists)
+static unsigned int gNbScenes = 0;
 
 
 #define TO_METERS(dim)  0.001f * ((dim) * m_pMap->cell_size)
@@ -65,15 +78,16 @@ const float MAP_HEIGHT          = 3.0f;
 /***************************** CONSTRUCTION / DESTRUCTION ******************************/
 
 MapBuilder::MapBuilder(unsigned int cell_size, unsigned int map_width,
-                       unsigned int map_height)
-: m_pMap(0), m_nbRooms(0), m_startOrientation(Quaternion::ZERO)
+                       unsigned int map_height, unsigned int seed)
+: m_pMap(0), m_seed(seed), m_nbRooms(0), m_startOrientation(Quaternion::ZERO)
 {
     // Create the map object
     m_pMap = new Map(cell_size, map_width, map_height);
     m_pMap->properties.set("min_target_squared_distance", new Variant(4.0f));
+    m_pMap->generator.setSeed(seed);
 
     // Create the scene
-    m_pMap->pScene = new Scene("Main");
+    m_pMap->pScene = new Scene("Main" + StringConverter::toString(++gNbScenes));
 
     Visual::World* pVisualWorld = new Visual::World("", m_pMap->pScene->getComponentsList());
 
@@ -136,6 +150,18 @@ void MapBuilder::addRoom(const std::string& strName, const tRoomAttributes& attr
     unsigned int internal_width  = attributes.width - 2 * attributes.wallSize;
     unsigned int internal_height = attributes.height - 2 * attributes.wallSize;
 
+    tRoom room;
+    room.rectangle.left   = attributes.left;
+    room.rectangle.top    = attributes.top;
+    room.rectangle.width  = attributes.width;
+    room.rectangle.height = attributes.height;
+    room.visible          = true;
+
+    m_pMap->rooms.push_back(room);
+
+    for (unsigned int i = 0; i < attributes.doors.size(); ++i)
+        addPortal(attributes, attributes.doors[i]);
+
     unsigned int floor_left   = internal_left;
     unsigned int floor_top    = internal_top;
     unsigned int floor_width  = internal_width;
@@ -193,9 +219,9 @@ void MapBuilder::addRoom(const std::string& strName, const tRoomAttributes& attr
     {
         for (unsigned int x = internal_left; x < internal_left + internal_width; ++x)
         {
-            tCell* pCell = &m_pMap->grid[y * m_pMap->width + x];
-            pCell->type  = CELL_FLOOR;
-            pCell->room  = m_nbRooms;
+            unsigned int index = m_pMap->grid.index(x, y);
+            m_pMap->grid.setType(index, CELL_FLOOR);
+            m_pMap->grid.setRoom(index, m_nbRooms);
         }
     }
 
@@ -257,8 +283,7 @@ void MapBuilder::addRoom(const std::string& strName, const tRoomAttributes& attr
         // Wall - Grid
         for (int x = start; x > start - length; --x)
         {
-            tCell* pCell = &m_pMap->grid[(internal_top - 1) * m_pMap->width + x];
-            pCell->type  = CELL_WALL;
+            m_pMap->grid.setType((internal_top - 1) * m_pMap->width + x, CELL_WALL);
         }
 
         // Door - Grid
@@ -266,17 +291,16 @@ void MapBuilder::addRoom(const std::string& strName, const tRoomAttributes& attr
         {
             for (int x = 0; x < door.width; ++x)
             {
-                tCell* pCell       = &m_pMap->grid[y * m_pMap->width + start - length - x];
-                pCell->type        = CELL_WAYPOINT;
-                pCell->main_x      = start - length - ((door.width - 1) >> 1);
-                pCell->main_y      = y;
-            }
+                unsigned int index = y * m_pMap->width + start - length - x;
+                m_pMap->grid.setType(index, CELL_WAYPOINT);
 
-            tCell* pCell = &m_pMap->grid[y * m_pMap->width + start - length + 1];
-            pCell->type  = CELL_WALL;
+                tCellInfos& infos = m_pMap->grid.editInfos(index);
+                infos.main_x = start - length - ((door.width - 1) >> 1);
+                infos.main_y = y;
+            }
 
-            pCell        = &m_pMap->grid[y * m_pMap->width + start - length - door.width];
-            pCell->type  = CELL_WALL;
+            m_pMap->grid.setType(y * m_pMap->width + start - length + 1, CELL_WALL);
+            m_pMap->grid.setType(y * m_pMap->width + start - length - door.width, CELL_WALL);
         }
 
         start -= length + door.width;
@@ -308,12 +332,11 @@ void MapBuilder::addRoom(const std::string& strName, const tRoomAttributes& attr
     // Grid
     for (int x = start; x > start - length; --x)
     {
-        tCell* pCell = &m_pMap->grid[(internal_top - 1) * m_pMap->width + x];
-        pCell->type  = CELL_WALL;
+        m_pMap->grid.setType((internal_top - 1) * m_pMap->width + x, CELL_WALL);
     }
 
-    m_pMap->grid[(internal_top - 1) * m_pMap->width + internal_left - 1].type = CELL_WALL;
-    m_pMap->grid[(internal_top - 1) * m_pMap->width + internal_left + internal_width].type = CELL_WALL;
+    m_pMap->grid.setType((internal_top - 1) * m_pMap->width + internal_left - 1, CELL_WALL);
+    m_pMap->grid.setType((internal_top - 1) * m_pMap->width + internal_left + internal_width, CELL_WALL);
 
 
     // ________________ South Wall ________________
@@ -347,8 +370,7 @@ void MapBuilder::addRoom(const std::string& strName, const tRoomAttributes& attr
         // Wall - Grid
         for (int x = start; x < start + length; ++x)
         {
-            tCell* pCell = &m_pMap->grid[(internal_top + internal_height) * m_pMap->width + x];
-            pCell->type  = CELL_WALL;
+            m_pMap->grid.setType((internal_top + internal_height) * m_pMap->width + x, CELL_WALL);
         }
 
         // Door - Grid
@@ -356,17 +378,16 @@ void MapBuilder::addRoom(const std::string& strName, const tRoomAttributes& attr
         {
             for (int x = 0; x < door.width; ++x)
             {
-                tCell* pCell  = &m_pMap->grid[y * m_pMap->width + start + length + x];
-                pCell->type   = CELL_WAYPOINT;
-                pCell->main_x = start + length + ((door.width - 1) >> 1);
-                pCell->main_y = y;
-            }
+                unsigned int index = y * m_pMap->width + start + length + x;
+                m_pMap->grid.setType(index, CELL_WAYPOINT);
 
-            tCell* pCell = &m_pMap->grid[y * m_pMap->width + start + length - 1];
-            pCell->type  = CELL_WALL;
+                tCellInfos& infos = m_pMap->grid.editInfos(index);
+                infos.main_x = start + length + ((door.width - 1) >> 1);
+                infos.main_y = y;
+            }
 
-            pCell        = &m_pMap->grid[y * m_pMap->width + start + length + door.width];
-            pCell->type  = CELL_WALL;
+            m_pMap->grid.setType(y * m_pMap->width + start + length - 1, CELL_WALL);
+            m_pMap->grid.setType(y * m_pMap->width + start + length + door.width, CELL_WALL);
         }
 
         start += length + door.width;
@@ -383,12 +404,11 @@ void MapBuilder::addRoom(const std::string& strName, const tRoomAttributes& attr
     // Grid
     for (int x = start; x < start + length; ++x)
     {
-        tCell* pCell = &m_pMap->grid[(internal_top + internal_height) * m_pMap->width + x];
-        pCell->type  = CELL_WALL;
+        m_pMap->grid.setType((internal_top + internal_height) * m_pMap->width + x, CELL_WALL);
     }
 
-    m_pMap->grid[(internal_top + internal_height) * m_pMap->width + internal_left - 1].type = CELL_WALL;
-    m_pMap->grid[(internal_top + internal_height) * m_pMap->width + internal_left + internal_width].type = CELL_WALL;
+    m_pMap->grid.setType((internal_top + internal_height) * m_pMap->width + internal_left - 1, CELL_WALL);
+    m_pMap->grid.setType((internal_top + internal_height) * m_pMap->width + internal_left + internal_width, CELL_WALL);
 
 
     // ________________ West Wall ________________
@@ -422,8 +442,7 @@ void MapBuilder::addRoom(const std::string& strName, const tRoomAttributes& attr
         // Wall - Grid
         for (int y = start; y < start + length; ++y)
         {
-            tCell* pCell = &m_pMap->grid[y * m_pMap->width + internal_left - 1];
-            pCell->type  = CELL_WALL;
+            m_pMap->grid.setType(y * m_pMap->width + internal_left - 1, CELL_WALL);
         }
 
         // Door - Grid
@@ -431,17 +450,16 @@ void MapBuilder::addRoom(const std::string& strName, const tRoomAttributes& attr
         {
             for (int y = 0; y < door.width; ++y)
             {
-                tCell* pCell  = &m_pMap->grid[(start + length + y) * m_pMap->width + x];
-                pCell->type   = CELL_WAYPOINT;
-                pCell->main_x = x;
-                pCell->main_y = start + length + ((door.width - 1) >> 1);
-            }
+                unsigned int index = (start + length + y) * m_pMap->width + x;
+                m_pMap->grid.setType(index, CELL_WAYPOINT);
 
-            tCell* pCell = &m_pMap->grid[(start + length - 1) * m_pMap->width + x];
-            pCell->type  = CELL_WALL;
+                tCellInfos& infos = m_pMap->grid.editInfos(index);
+                infos.main_x = x;
+                infos.main_y = start + length + ((door.width - 1) >> 1);
+            }
 
-            pCell        = &m_pMap->grid[(start + length + door.width) * m_pMap->width + x];
-            pCell->type  = CELL_WALL;
+            m_pMap->grid.setType((start + length - 1) * m_pMap->width + x, CELL_WALL);
+            m_pMap->grid.setType((start + length + door.width) * m_pMap->width + x, CELL_WALL);
         }
 
         start += length + door.width;
@@ -458,8 +476,7 @@ void MapBuilder::addRoom(const std::string& strName, const tRoomAttributes& attr
     // Grid
     for (int y = start; y < start + length; ++y)
     {
-        tCell* pCell = &m_pMap->grid[y * m_pMap->width + internal_left - 1];
-        pCell->type  = CELL_WALL;
+        m_pMap->grid.setType(y * m_pMap->width + internal_left - 1, CELL_WALL);
     }
 
 
@@ -494,8 +511,7 @@ void MapBuilder::addRoom(const std::string& strName, const tRoomAttributes& attr
         // Wall - Grid
         for (int y = start; y > start - length; --y)
         {
-            tCell* pCell = &m_pMap->grid[y * m_pMap->width + internal_left + internal_width];
-            pCell->type  = CELL_WALL;
+            m_pMap->grid.setType(y * m_pMap->width + internal_left + internal_width, CELL_WALL);
         }
 
         // Door - Grid
@@ -503,17 +519,16 @@ void MapBuilder::addRoom(const std::string& strName, const tRoomAttributes& attr
         {
             for (int y = 0; y < door.width; ++y)
             {
-                tCell* pCell  = &m_pMap->grid[(start - length - y) * m_pMap->width + x];
-                pCell->type   = CELL_WAYPOINT;
-                pCell->main_x = x;
-                pCell->main_y = start - length - ((door.width - 1) >> 1);
-            }
+                unsigned int index = (start - length - y) * m_pMap->width + x;
+                m_pMap->grid.setType(index, CELL_WAYPOINT);
 
-            tCell* pCell = &m_pMap->grid[(start - length + 1) * m_pMap->width + x];
-            pCell->type  = CELL_WALL;
+                tCellInfos& infos = m_pMap->grid.editInfos(index);
+                infos.main_x = x;
+                infos.main_y = start - length - ((door.width - 1) >> 1);
+            }
 
-            pCell        = &m_pMap->grid[(start - length - door.width) * m_pMap->width + x];
-            pCell->type  = CELL_WALL;
+            m_pMap->grid.setType((start - length + 1) * m_pMap->width + x, CELL_WALL);
+            m_pMap->grid.setType((start - length - door.width) * m_pMap->width + x, CELL_WALL);
         }
 
         start -= length + door.width;
@@ -530,8 +545,7 @@ void MapBuilder::addRoom(const std::string& strName, const tRoomAttributes& attr
     // Grid
     for (int y = start; y > start - length; --y)
     {
-        tCell* pCell = &m_pMap->grid[y * m_pMap->width + internal_left + internal_width];
-        pCell->type  = CELL_WALL;
+        m_pMap->grid.setType(y * m_pMap->width + internal_left + internal_width, CELL_WALL);
     }
 
     ++m_nbRooms;
@@ -573,20 +587,22 @@ void MapBuilder::addSpot(unsigned int left, unsigned int top, unsigned int goal_
     {
         for (unsigned int x = left - 2; x < left + 2; ++x)
         {
-            tCell* pCell       = &m_pMap->grid[y * m_pMap->width + x];
-            pCell->type        = CELL_SPOT;
-            pCell->infos_index = m_pMap->spots.size() - 1;
+            unsigned int index = m_pMap->grid.index(x, y);
+            m_pMap->grid.setType(index, CELL_SPOT);
+            m_pMap->grid.editInfos(index).infos_index = m_pMap->spots.size() - 1;
         }
     }
 }
 
 
-void MapBuilder::finalize()
+void MapBuilder::computeLayout(tLayout &layout)
 {
     // Assertions
     assert(m_pMap);
     assert(!m_pMap->start_zones.empty());
 
+    Mash::ScopedTrace trace("MapBuilder::computeLayout");
+
     // Generation of the positions of the avatar and the targets
     unsigned int nbPositions = m_pMap->targets.size() + 1;
     tPoint* positions = new tPoint[nbPositions];
@@ -595,8 +611,6 @@ void MapBuilder::finalize()
     int threshold = FROM_METERS(m_pMap->properties.get("min_target_squared_distance")->toFloat());
     while (min_squared_dist <= threshold)
     {
-        Entity* pParent = 0;
-
         for (unsigned int i = 0; i < nbPositions; ++i)
         {
             tZone zone;
@@ -639,10 +653,59 @@ void MapBuilder::finalize()
     }
 
 
-    // Put the avatar in place
-    m_startPosition = Vector3(TO_METERS(positions[0].x), 0.0f, TO_METERS(positions[0].y));
+    // Avatar
+    layout.start.position = positions[0];
+
     if (m_startOrientation == Quaternion::ZERO)
-        m_startOrientation = Quaternion(Degree(m_pMap->generator.randomize(0.0, 360.0f)), Vector3::UNIT_Y);
+        layout.start.orientation = Quaternion(Degree(m_pMap->generator.randomize(0.0, 360.0f)), Vector3::UNIT_Y);
+    else
+        layout.start.orientation = m_startOrientation;
+
+    // Targets
+    layout.targets.resize(m_pMap->targets.size());
+
+    for (unsigned int n = 1; n < nbPositions; ++n)
+    {
+        tPlacement* pPlacement = &layout.targets[n - 1];
+
+        pPlacement->position = positions[n];
+
+        if (m_pMap->targets[n - 1].type == TARGET_FLAG)
+            pPlacement->orientation = Quaternion(Degree(m_pMap->generator.randomize(0.0, 360.0f)), Vector3::UNIT_Y);
+        else
+            pPlacement->orientation = Quaternion::IDENTITY;
+    }
+
+    delete[] positions;
+}
+
+
+void MapBuilder::finalize(const tLayout* pLayout)
+{
+    // Assertions
+    assert(m_pMap);
+    assert(!pLayout || (pLayout->targets.size() == m_pMap->targets.size()));
+
+    Mash::ScopedTrace trace("MapBuilder::finalize");
+
+    tLayout layout;
+
+    if (pLayout)
+        layout = *pLayout;
+    else
+        computeLayout(layout);
+
+    // The random numbers used during the episode don't depend on the way the
+    // layout was obtained
+    m_pMap->generator.setSeed(m_seed ^ 0x9E3779B9);
+
+
+    connectPortals();
+    createDecalsBatches();
+
+    // Put the avatar in place
+    m_startPosition = Vector3(TO_METERS(layout.start.position.x), 0.0f, TO_METERS(layout.start.position.y));
+    m_startOrientation = layout.start.orientation;
 
     // Create the targets
     tTargetsIterator iter(m_pMap->targets.begin(), m_pMap->targets.end());
@@ -650,24 +713,23 @@ void MapBuilder::finalize()
     while (iter.hasMoreElements())
     {
         tTarget* pTarget = iter.peekNextPtr();
+        const tPlacement& placement = layout.targets[n - 1];
 
-        Quaternion orientation = Quaternion::IDENTITY;
+        Quaternion orientation = placement.orientation;
         Vector3 position;
 
         if (pTarget->type == TARGET_FLAG)
         {
-            orientation = Quaternion(Degree(m_pMap->generator.randomize(0.0, 360.0f)), Vector3::UNIT_Y);
-
-            position = Vector3(TO_METERS(0.5f + positions[n].x), 0.0f, TO_METERS(0.5f + positions[n].y));
+            position = Vector3(TO_METERS(0.5f + placement.position.x), 0.0f, TO_METERS(0.5f + placement.position.y));
             position -= orientation * Vector3(0.25f, 0.0f, 0.0f);
         }
         else if (pTarget->type == TARGET_DISK)
         {
-            position = Vector3(TO_METERS(positions[n].x), 0.1f, TO_METERS(positions[n].y));
+            position = Vector3(TO_METERS(placement.position.x), 0.1f, TO_METERS(placement.position.y));
         }
         else if ((pTarget->type == TARGET_PILLAR) || (pTarget->type == TARGET_OBJECT))
         {
-            position = Vector3(TO_METERS(0.5f + positions[n].x), 0.0f, TO_METERS(0.5f + positions[n].y));
+            position = Vector3(TO_METERS(0.5f + placement.position.x), 0.0f, TO_METERS(0.5f + placement.position.y));
         }
 
         pTarget->pEntity = createTarget(pTarget->type, "Target" + StringConverter::toString(n),
@@ -676,23 +738,22 @@ void MapBuilder::finalize()
 
         if ((pTarget->type == TARGET_FLAG) || (pTarget->type == TARGET_PILLAR) || (pTarget->type == TARGET_OBJECT))
         {
-            tCell* pCell       = &m_pMap->grid[positions[n].y * m_pMap->width + positions[n].x];
-            pCell->type        = CELL_TARGET;
-            pCell->infos_index = n - 1;
-            pCell->main_x      = positions[n].x;
-            pCell->main_y      = positions[n].y;
+            unsigned int index = m_pMap->grid.index(placement.position.x, placement.position.y);
+            m_pMap->grid.setType(index, CELL_TARGET);
+
+            tCellInfos& infos = m_pMap->grid.editInfos(index);
+            infos.infos_index = n - 1;
+            infos.main_x      = placement.position.x;
+            infos.main_y      = placement.position.y;
         }
         else if (pTarget->type == TARGET_DISK)
         {
-            m_pMap->putDisk(positions[n].x, positions[n].y, true, n-1);
+            m_pMap->putDisk(placement.position.x, placement.position.y, true, n-1);
         }
 
         ++n;
         iter.moveNext();
     }
-
-
-    delete[] positions;
 }
 
 
@@ -714,12 +775,24 @@ Ogre::Entity* MapBuilder::createPlane(const std::string& strPrefix, const std::s
         uFactor = 1.0f;
     float vFactor = (fDimX / fDimZ) * uFactor;
 
+    tSurface surface;
+    surface.material    = strMaterial;
+    surface.origin      = position;
+    surface.orientation = orientation;
+    surface.width       = fDimX;
+    surface.height      = fDimZ;
+    surface.uTile       = (bWall ? fDimX / fDimZ : vFactor);
+    surface.vTile       = (bWall ? 1.0f : uFactor);
+
+    m_pMap->surfaces.push_back(surface);
+
     Visual::Plane* pPlane = new Visual::Plane(strPrefix + "/Plane", m_pMap->pEntity->getComponentsList());
     if (pPlane->createPlane(strMaterial, Vector3::UNIT_Y, 0.0f, fDimX, fDimZ, std::max(1.0f, fDimX * 4),
-                            std::max(1.0f, fDimZ * 4), true, 1, (bWall ? fDimX / fDimZ : vFactor),
-                            (bWall ? 1.0f : uFactor), Vector3::UNIT_Z))
+                            std::max(1.0f, fDimZ * 4), true, 1, surface.uTile, surface.vTile,
+                            Vector3::UNIT_Z))
     {
         pPlane->setTransforms(pTransforms2);
+        m_pMap->rooms[m_nbRooms].objects.push_back(pPlane->getOgreEntity());
     }
     else
     {
@@ -765,25 +838,36 @@ void MapBuilder::createDecal(const std::string& strPrefix, const std::string& st
                              const Athena::Math::Vector3& position,
                              const Athena::Math::Quaternion& orientation)
 {
-    Transforms* pTransforms = new Transforms(strPrefix + "/Transforms", m_pMap->pEntity->getComponentsList());
-    pTransforms->setTransforms(m_pMap->pEntity->getTransforms());
-    pTransforms->translate(position);
-    pTransforms->rotate(orientation);
-
-    Transforms* pTransforms2 = new Transforms(strPrefix + "/Offset", m_pMap->pEntity->getComponentsList());
-    pTransforms2->setTransforms(pTransforms);
-    pTransforms2->translate(width / 2, 0.0f, height / 2);
-
-    Visual::Plane* pPlane = new Visual::Plane(strPrefix + "/Plane", m_pMap->pEntity->getComponentsList());
-    if (pPlane->createPlane(strMaterial, Vector3::UNIT_Y, 0.0f, width, height, std::max(1.0f, width * 4),
-                            std::max(1.0f, height * 4), true, 1, u, v, Vector3::UNIT_Z))
+    tSurface surface;
+    surface.material    = strMaterial;
+    surface.origin      = position;
+    surface.orientation = orientation;
+    surface.width       = width;
+    surface.height      = height;
+    surface.uTile       = u;
+    surface.vTile       = v;
+
+    m_pMap->decals.push_back(surface);
+
+    // The decals are rendered by one mesh per room and material, created by
+    // finalize() (see createDecalsBatches())
+    tDecalsBatch* pBatch = 0;
+    for (unsigned int i = 0; (i < m_decalsBatches.size()) && !pBatch; ++i)
     {
-        pPlane->setTransforms(pTransforms2);
+        if ((m_decalsBatches[i].room == m_nbRooms) && (m_decalsBatches[i].material == strMaterial))
+            pBatch = &m_decalsBatches[i];
     }
-    else
+
+    if (!pBatch)
     {
-        ComponentsManager::getSingletonPtr()->destroy(pPlane);
+        m_decalsBatches.push_back(tDecalsBatch());
+
+        pBatch = &m_decalsBatches.back();
+        pBatch->room     = m_nbRooms;
+        pBatch->material = strMaterial;
     }
+
+    pBatch->decals.push_back(surface);
 }
 
 
@@ -799,6 +883,12 @@ bool sortByDecalCenter(MapBuilder::tDecal i, MapBuilder::tDecal j)
 }
 
 
+bool sortByHeight(const tSurface& i, const tSurface& j)
+{
+    return (i.origin.y < j.origin.y);
+}
+
+
 MapBuilder::tDoorList MapBuilder::filterDoors(const tDoorList* doors, tLocation location)
 {
     tDoorList filtered;
@@ -839,6 +929,87 @@ MapBuilder::tDecalList MapBuilder::filterDecals(const tDecalList* decals, tLocat
 }
 
 
+void MapBuilder::createDecalsBatches()
+{
+    for (unsigned int n = 0; n < m_decalsBatches.size(); ++n)
+    {
+        tDecalsBatch& batch = m_decalsBatches[n];
+
+        // The decals are blended in the order of their layers
+        std::stable_sort(batch.decals.begin(), batch.decals.end(), sortByHeight);
+
+        std::string strName = "Decals/" + StringConverter::toString(n + 1);
+        std::string strMeshName = m_pMap->pScene->getName() + "/" + strName;
+
+        Ogre::ManualObject* pManualObject = new Ogre::ManualObject(strName);
+        pManualObject->begin(batch.material, Ogre::RenderOperation::OT_TRIANGLE_LIST);
+
+        unsigned int nbVertices = 0;
+
+        for (unsigned int i = 0; i < batch.decals.size(); ++i)
+        {
+            const tSurface& decal = batch.decals[i];
+
+            Vector3 xAxis  = decal.orientation * Vector3::UNIT_X;
+            Vector3 zAxis  = decal.orientation * Vector3::UNIT_Z;
+            Vector3 normal = decal.orientation * Vector3::UNIT_Y;
+
+            // Same tesselation and texture coordinates than the planes created
+            // by Ogre (the vertex lighting must not change)
+            unsigned int nbSegmentsX = (unsigned int) std::max(1.0f, decal.width * 4);
+            unsigned int nbSegmentsZ = (unsigned int) std::max(1.0f, decal.height * 4);
+
+            for (unsigned int z = 0; z <= nbSegmentsZ; ++z)
+            {
+                for (unsigned int x = 0; x <= nbSegmentsX; ++x)
+                {
+                    float fx = float(x) / nbSegmentsX;
+                    float fz = float(z) / nbSegmentsZ;
+
+                    Vector3 position = decal.origin + xAxis * (fx * decal.width) + zAxis * (fz * decal.height);
+
+                    pManualObject->position(position.x, position.y, position.z);
+                    pManualObject->normal(normal.x, normal.y, normal.z);
+                    pManualObject->textureCoord(decal.uTile * (1.0f - fx), 1.0f - decal.vTile * fz);
+                }
+            }
+
+            for (unsigned int z = 0; z < nbSegmentsZ; ++z)
+            {
+                for (unsigned int x = 0; x < nbSegmentsX; ++x)
+                {
+                    unsigned int index = nbVertices + z * (nbSegmentsX + 1) + x;
+
+                    pManualObject->triangle(index, index + nbSegmentsX + 1, index + 1);
+                    pManualObject->triangle(index + 1, index + nbSegmentsX + 1, index + nbSegmentsX + 2);
+                }
+            }
+
+            nbVertices += (nbSegmentsX + 1) * (nbSegmentsZ + 1);
+        }
+
+        pManualObject->end();
+        pManualObject->convertToMesh(strMeshName);
+        delete pManualObject;
+
+        m_pMap->meshes.push_back(strMeshName);
+
+        Visual::Object* pObject = new Visual::Object(strName + "/Object", m_pMap->pEntity->getComponentsList());
+        if (pObject->loadMesh(strMeshName))
+        {
+            pObject->setTransforms(m_pMap->pEntity->getTransforms());
+            m_pMap->rooms[batch.room].objects.push_back(pObject->getOgreEntity());
+        }
+        else
+        {
+            ComponentsManager::getSingletonPtr()->destroy(pObject);
+        }
+    }
+
+    m_decalsBatches.clear();
+}
+
+
 void MapBuilder::createLight(const std::string& strName, const Athena::Math::Vector3& position)
 {
     // Create the target entity
@@ -849,9 +1020,83 @@ void MapBuilder::createLight(const std::string& strName, const Athena::Math::Vec
     Visual::PointLight* pLight = new Visual::PointLight("PointLight", pEntity->getComponentsList());
     pLight->setDiffuseColor(Color(0.7f, 0.7f, 0.7f));
     pLight->setSpecularColor(Color(0.95f, 0.95f, 0.95f));
-    pLight->setAttenuation(20.0f, 0.8f, 0.1f, 0.05f);
+    pLight->setAttenuation(LIGHT_ATTENUATION[0], LIGHT_ATTENUATION[1],
+                           LIGHT_ATTENUATION[2], LIGHT_ATTENUATION[3]);
 
     m_pMap->lights.push_back(pEntity);
+    m_pMap->rooms[m_nbRooms].objects.push_back(pLight->getOgreLight());
+}
+
+
+void MapBuilder::addPortal(const tRoomAttributes& attributes, const tDoor& door)
+{
+    unsigned int start = door.center - ((door.width - 1) >> 1);
+
+    tDoorway doorway;
+    doorway.portal.rooms[0] = m_nbRooms;
+    doorway.portal.rooms[1] = m_nbRooms;
+
+    if ((door.location == WALL_EAST) || (door.location == WALL_WEST))
+    {
+        unsigned int x = (door.location == WALL_EAST ? attributes.left + attributes.width : attributes.left);
+
+        doorway.portal.box.setExtents(TO_METERS(x) - PORTAL_DEPTH, 0.0f, TO_METERS(start),
+                                      TO_METERS(x) + PORTAL_DEPTH, MAP_HEIGHT, TO_METERS(start + door.width));
+
+        doorway.outside = tPoint(door.location == WALL_EAST ? x : (int) x - 1, door.center);
+    }
+    else
+    {
+        unsigned int y = (door.location == WALL_SOUTH ? attributes.top + attributes.height : attributes.top);
+
+        doorway.portal.box.setExtents(TO_METERS(start), 0.0f, TO_METERS(y) - PORTAL_DEPTH,
+                                      TO_METERS(start + door.width), MAP_HEIGHT, TO_METERS(y) + PORTAL_DEPTH);
+
+        doorway.outside = tPoint(door.center, door.location == WALL_SOUTH ? y : (int) y - 1);
+    }
+
+    m_doorways.push_back(doorway);
+}
+
+
+void MapBuilder::connectPortals()
+{
+    for (unsigned int i = 0; i < m_doorways.size(); ++i)
+    {
+        tPortal portal = m_doorways[i].portal;
+        const tPoint& outside = m_doorways[i].outside;
+
+        if ((outside.x < 0) || (outside.x >= (int) m_pMap->width) ||
+            (outside.y < 0) || (outside.y >= (int) m_pMap->height))
+        {
+            continue;
+        }
+
+        int room = m_pMap->getRoomAt(outside.x, outside.y);
+        if ((room < 0) || (room == (int) portal.rooms[0]))
+            continue;
+
+        portal.rooms[1] = room;
+
+        // Both rooms usually declare the door: only one portal is needed
+        bool bDuplicate = false;
+        for (unsigned int j = 0; (j < m_pMap->portals.size()) && !bDuplicate; ++j)
+        {
+            const tPortal& other = m_pMap->portals[j];
+
+            bDuplicate = (other.rooms[0] == portal.rooms[1]) && (other.rooms[1] == portal.rooms[0]) &&
+                         other.box.intersects(portal.box);
+        }
+
+        if (bDuplicate)
+            continue;
+
+        m_pMap->rooms[portal.rooms[0]].portals.push_back(m_pMap->portals.size());
+        m_pMap->rooms[portal.rooms[1]].portals.push_back(m_pMap->portals.size());
+        m_pMap->portals.push_back(portal);
+    }
+
+    m_doorways.clear();
 }
 
 
@@ -0,0 +1,1405 @@
+/*******************************************************************************
+* MASH 3D simulator
+* 
+* Copyright (c) 2014 Idiap Research Institute, http://www.idiap.ch/
+* Written by Philip Abbet <philip.abbet@idiap.ch>
+* 
+* This file is part of mash-simulator.
+* 
+* mash-simulator is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 3 as
+* published by the Free Software Foundation.
+* 
+* mash-simulator is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+* 
+* You should have received a copy of the GNU General Public License
+* along with mash-simulator. If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+
+#include <RaycastRenderer.h>
+#include <MapBuilder.h>
+#include <Declarations.h>
+
+#include <Athena-Entities/Scene.h>
+#include <Athena-Entities/Transforms.h>
+#include <Athena-Entities/tComponentID.h>
+#include <Athena-Graphics/Visual/World.h>
+#include <Athena-Graphics/Visual/PointLight.h>
+#include <Athena-Graphics/Visual/Object.h>
+#include <Athena-Math/Color.h>
+#include <mash-utils/tracer.h>
+#include <Ogre/OgreMaterialManager.h>
+#include <Ogre/OgreTechnique.h>
+#include <Ogre/OgrePass.h>
+#include <Ogre/OgreTextureUnitState.h>
+#include <Ogre/OgreImage.h>
+#include <Ogre/OgrePixelFormat.h>
+#include <Ogre/OgreResourceGroupManager.h>
+#include <Ogre/OgreMesh.h>
+#include <Ogre/OgreSubMesh.h>
+#include <Ogre/OgreSubEntity.h>
+#include <Ogre/OgreSceneNode.h>
+#include <Ogre/OgreHardwareVertexBuffer.h>
+#include <algorithm>
+#include <math.h>
+#include <assert.h>
+#include <string.h>
+
+#ifdef __SSE2__
+    #include <emmintrin.h>
+#endif
+
+using namespace Athena::Entities;
+using namespace Athena::Graphics;
+using namespace Athena::Graphics::Visual;
+using namespace Athena::Math;
+using namespace std;
+
+
+// Number of pixels shaded at once
+static const unsigned int BATCH_SIZE = 4096;
+
+// The components of the targets rendered as boxes
+static const char* TARGET_COMPONENTS[] = { "Mesh", "Pedestal", "Object", 0 };
+
+// Faces of a cell, in the order of the side tables
+enum tFace
+{
+    FACE_WEST,      // -X
+    FACE_EAST,      // +X
+    FACE_NORTH,     // -Z
+    FACE_SOUTH,     // +Z
+};
+
+static const int FACE_DX[4] = { -1, 1, 0, 0 };
+static const int FACE_DZ[4] = { 0, 0, -1, 1 };
+
+
+static inline int clampIndex(int value, int size)
+{
+    return (value < 0 ? 0 : (value >= size ? size - 1 : value));
+}
+
+
+// Returns the light of a point of the floor (or the ceiling), by bilinear
+// interpolation of the values at the centers of the cells (the cells without
+// value use the one of the cell containing the point)
+static float interpolateLight(const vector<float>& lights, unsigned int width,
+                              unsigned int height, float gx, float gz)
+{
+    int cx = clampIndex((int) floorf(gx), width);
+    int cz = clampIndex((int) floorf(gz), height);
+
+    float own = lights[cz * width + cx];
+    if (own < 0.0f)
+        own = 0.0f;
+
+    float fx = gx - 0.5f;
+    float fz = gz - 0.5f;
+    int ix = (int) floorf(fx);
+    int iz = (int) floorf(fz);
+    float wx = fx - ix;
+    float wz = fz - iz;
+
+    float values[4];
+    for (unsigned int i = 0; i < 4; ++i)
+    {
+        int x = clampIndex(ix + (i & 1), width);
+        int z = clampIndex(iz + (i >> 1), height);
+
+        values[i] = lights[z * width + x];
+        if (values[i] < 0.0f)
+            values[i] = own;
+    }
+
+    return (values[0] * (1.0f - wx) + values[1] * wx) * (1.0f - wz) +
+           (values[2] * (1.0f - wx) + values[3] * wx) * wz;
+}
+
+
+/***************************** CONSTRUCTION / DESTRUCTION ******************************/
+
+RaycastRenderer::RaycastRenderer()
+: m_pMap(0), m_defaultWallMaterial(0), m_ceilingHeight(3.0f), m_tanX(1.0f),
+  m_tanY(1.0f), m_farDistance(100.0f), m_pBuffer(0)
+{
+    // Material used when nothing else is available
+    tMaterial material;
+    material.texture     = -1;
+    material.addressMode = ADDRESS_WRAP;
+    material.color       = 0xFF808080;
+    material.bBlend      = false;
+    material.bLighting   = true;
+
+    for (unsigned int c = 0; c < 3; ++c)
+    {
+        material.ambient[c]      = 1.0f;
+        material.diffuse[c]      = 1.0f;
+        material.emissive[c]     = 0.0f;
+        material.frameAmbient[c] = 0.0f;
+        material.frameDiffuse[c] = 0.0f;
+    }
+
+    m_materials.push_back(material);
+    m_materialIndices[""] = 0;
+
+    m_batch.count = 0;
+    m_batch.offsets.resize(BATCH_SIZE);
+    m_batch.texels.resize(BATCH_SIZE);
+    m_batch.lights.resize(BATCH_SIZE);
+    m_batch.materials.resize(BATCH_SIZE);
+}
+
+
+RaycastRenderer::~RaycastRenderer()
+{
+}
+
+
+/************************************** METHODS ****************************************/
+
+void RaycastRenderer::setMap(Map* pMap)
+{
+    Mash::ScopedTrace trace("RaycastRenderer::setMap");
+
+    m_pMap = pMap;
+
+    m_surfaces.clear();
+    m_decals.clear();
+    m_decalNodes.clear();
+    m_lights.clear();
+
+    if (!m_pMap)
+        return;
+
+    const float cs = m_pMap->cell_size * 0.001f;
+    const unsigned int nbCells = m_pMap->width * m_pMap->height;
+
+    m_floors.assign(nbCells, -1);
+    m_ceilings.assign(nbCells, -1);
+    m_walls.assign(4 * nbCells, -1);
+    m_floorDecals.assign(nbCells, -1);
+    m_wallDecals.assign(4 * nbCells, -1);
+
+    m_defaultWallMaterial = 0;
+    m_ceilingHeight       = 0.0f;
+
+    // Walls, floors and ceilings
+    for (unsigned int i = 0; i < m_pMap->surfaces.size(); ++i)
+    {
+        tMappedSurface surface;
+        mapSurface(m_pMap->surfaces[i], surface);
+        m_surfaces.push_back(surface);
+
+        if (MathUtils::Abs(surface.normal.y) > 0.5f)
+        {
+            // Floor or ceiling: all the cells with their center in the rectangle
+            bool bFloor = (surface.normal.y > 0.0f);
+
+            if (!bFloor)
+                m_ceilingHeight = std::max(m_ceilingHeight, surface.origin.y);
+
+            Vector3 corner = surface.origin + surface.xAxis * surface.width + surface.zAxis * surface.height;
+
+            int x1 = clampIndex((int) floorf(std::min(surface.origin.x, corner.x) / cs), m_pMap->width);
+            int x2 = clampIndex((int) ceilf(std::max(surface.origin.x, corner.x) / cs), m_pMap->width);
+            int z1 = clampIndex((int) floorf(std::min(surface.origin.z, corner.z) / cs), m_pMap->height);
+            int z2 = clampIndex((int) ceilf(std::max(surface.origin.z, corner.z) / cs), m_pMap->height);
+
+            for (int z = z1; z <= z2; ++z)
+            {
+                for (int x = x1; x <= x2; ++x)
+                {
+                    Vector3 center((x + 0.5f) * cs, surface.origin.y, (z + 0.5f) * cs);
+                    Vector3 local = center - surface.origin;
+
+                    float lx = local.dotProduct(surface.xAxis);
+                    float lz = local.dotProduct(surface.zAxis);
+
+                    if ((lx < 0.0f) || (lx > surface.width) || (lz < 0.0f) || (lz > surface.height))
+                        continue;
+
+                    if (bFloor)
+                        m_floors[z * m_pMap->width + x] = i;
+                    else
+                        m_ceilings[z * m_pMap->width + x] = i;
+                }
+            }
+        }
+        else
+        {
+            if (m_defaultWallMaterial == 0)
+                m_defaultWallMaterial = surface.material;
+
+            // Wall: the faces of the wall cells behind the rectangle
+            bool bHorizontalX = (MathUtils::Abs(surface.xAxis.y) < 0.5f);
+            Vector3 axis = (bHorizontalX ? surface.xAxis : surface.zAxis);
+            float length = (bHorizontalX ? surface.width : surface.height);
+
+            int face = (MathUtils::Abs(surface.normal.x) > 0.5f ?
+                            (surface.normal.x < 0.0f ? FACE_WEST : FACE_EAST) :
+                            (surface.normal.z < 0.0f ? FACE_NORTH : FACE_SOUTH));
+
+            for (float d = cs * 0.5f; d < length; d += cs)
+            {
+                Vector3 behind = surface.origin + axis * d - surface.normal * (cs * 0.5f);
+
+                int x = (int) floorf(behind.x / cs);
+                int z = (int) floorf(behind.z / cs);
+
+                if ((x < 0) || (x >= (int) m_pMap->width) || (z < 0) || (z >= (int) m_pMap->height))
+                    continue;
+
+                unsigned int cell = z * m_pMap->width + x;
+                if (m_pMap->grid.type(cell) == CELL_WALL)
+                    m_walls[4 * cell + face] = i;
+            }
+        }
+    }
+
+    if (m_ceilingHeight <= 0.0f)
+        m_ceilingHeight = 3.0f;
+
+    // Decals
+    for (unsigned int i = 0; i < m_pMap->decals.size(); ++i)
+    {
+        tMappedSurface decal;
+        mapSurface(m_pMap->decals[i], decal);
+        m_decals.push_back(decal);
+
+        if (decal.normal.y > 0.5f)
+        {
+            // Floor: all the cells overlapped by the rectangle
+            Vector3 corners[4] = {
+                decal.origin,
+                decal.origin + decal.xAxis * decal.width,
+                decal.origin + decal.zAxis * decal.height,
+                decal.origin + decal.xAxis * decal.width + decal.zAxis * decal.height,
+            };
+
+            float minX = corners[0].x, maxX = corners[0].x;
+            float minZ = corners[0].z, maxZ = corners[0].z;
+
+            for (unsigned int j = 1; j < 4; ++j)
+            {
+                minX = std::min(minX, corners[j].x);
+                maxX = std::max(maxX, corners[j].x);
+                minZ = std::min(minZ, corners[j].z);
+                maxZ = std::max(maxZ, corners[j].z);
+            }
+
+            int x1 = clampIndex((int) floorf(minX / cs), m_pMap->width);
+            int x2 = clampIndex((int) floorf(maxX / cs), m_pMap->width);
+            int z1 = clampIndex((int) floorf(minZ / cs), m_pMap->height);
+            int z2 = clampIndex((int) floorf(maxZ / cs), m_pMap->height);
+
+            for (int z = z1; z <= z2; ++z)
+            {
+                for (int x = x1; x <= x2; ++x)
+                    addDecal(m_floorDecals, z * m_pMap->width + x, i);
+            }
+        }
+        else if (MathUtils::Abs(decal.normal.y) < 0.5f)
+        {
+            // Wall: the faces of the wall cells behind the rectangle
+            bool bHorizontalX = (MathUtils::Abs(decal.xAxis.y) < 0.5f);
+            Vector3 axis = (bHorizontalX ? decal.xAxis : decal.zAxis);
+            float length = (bHorizontalX ? decal.width : decal.height);
+
+            int face = (MathUtils::Abs(decal.normal.x) > 0.5f ?
+                            (decal.normal.x < 0.0f ? FACE_WEST : FACE_EAST) :
+                            (decal.normal.z < 0.0f ? FACE_NORTH : FACE_SOUTH));
+
+            int previous = -1;
+            for (float d = 0.0f; d < length + cs; d += cs)
+            {
+                Vector3 behind = decal.origin + axis * std::min(d, length) - decal.normal * (cs * 0.5f);
+
+                int x = (int) floorf(behind.x / cs);
+                int z = (int) floorf(behind.z / cs);
+
+                if ((x < 0) || (x >= (int) m_pMap->width) || (z < 0) || (z >= (int) m_pMap->height))
+                    continue;
+
+                int cell = z * m_pMap->width + x;
+                if ((cell != previous) && (m_pMap->grid.type(cell) == CELL_WALL))
+                    addDecal(m_wallDecals, 4 * cell + face, i);
+
+                previous = cell;
+            }
+        }
+    }
+
+    computeLights();
+}
+
+
+void RaycastRenderer::render(Ogre::Camera* pCamera, unsigned char* pBuffer)
+{
+    // Assertions
+    assert(pCamera);
+    assert(pBuffer);
+
+    Mash::ScopedTrace trace("RaycastRenderer::render");
+
+    memset(pBuffer, 0, VIEW_WIDTH * VIEW_HEIGHT * 3);
+
+    if (!m_pMap)
+        return;
+
+    m_pBuffer = pBuffer;
+
+    // Camera (it only turns around the vertical axis)
+    Ogre::Vector3 position  = pCamera->getDerivedPosition();
+    Ogre::Vector3 direction = pCamera->getDerivedDirection();
+    Ogre::Vector3 right     = pCamera->getDerivedRight();
+
+    m_position = Vector3(position.x, position.y, position.z);
+
+    float length = sqrtf(direction.x * direction.x + direction.z * direction.z);
+    m_forward[0] = direction.x / length;
+    m_forward[1] = direction.z / length;
+
+    length = sqrtf(right.x * right.x + right.z * right.z);
+    m_right[0] = right.x / length;
+    m_right[1] = right.z / length;
+
+    m_tanY = tanf(pCamera->getFOVy().valueRadians() * 0.5f);
+    m_tanX = m_tanY * float(VIEW_WIDTH) / VIEW_HEIGHT;
+
+    m_farDistance = pCamera->getFarClipDistance();
+    if (m_farDistance <= 0.0f)
+        m_farDistance = 1e6f;
+
+    m_depths.resize(VIEW_WIDTH);
+
+    prepareMaterials();
+    collectTargets();
+
+    renderColumns();
+    renderRows();
+    renderBoxes();
+
+    shadeBatch();
+
+    m_pBuffer = 0;
+}
+
+
+unsigned short RaycastRenderer::getMaterial(const std::string& strName)
+{
+    std::map<std::string, int>::iterator iter = m_materialIndices.find(strName);
+    if (iter != m_materialIndices.end())
+        return iter->second;
+
+    m_materialIndices[strName] = 0;
+
+    Ogre::MaterialPtr material = Ogre::MaterialManager::getSingleton().getByName(strName);
+    if (material.isNull())
+        return 0;
+
+    material->load();
+
+    Ogre::Technique* pTechnique = material->getBestTechnique();
+    if (!pTechnique && (material->getNumTechniques() > 0))
+        pTechnique = material->getTechnique(0);
+
+    if (!pTechnique || (pTechnique->getNumPasses() == 0))
+        return 0;
+
+    Ogre::Pass* pPass = pTechnique->getPass(0);
+
+    tMaterial result = m_materials[0];
+    result.bBlend    = (pPass->getDestBlendFactor() != Ogre::SBF_ZERO) ||
+                       (pPass->getAlphaRejectFunction() != Ogre::CMPF_ALWAYS_PASS);
+    result.bLighting = pPass->getLightingEnabled();
+
+    Ogre::ColourValue ambient  = pPass->getAmbient();
+    Ogre::ColourValue diffuse  = pPass->getDiffuse();
+    Ogre::ColourValue emissive = pPass->getSelfIllumination();
+
+    result.ambient[0]  = ambient.r;
+    result.ambient[1]  = ambient.g;
+    result.ambient[2]  = ambient.b;
+    result.diffuse[0]  = diffuse.r;
+    result.diffuse[1]  = diffuse.g;
+    result.diffuse[2]  = diffuse.b;
+    result.emissive[0] = emissive.r;
+    result.emissive[1] = emissive.g;
+    result.emissive[2] = emissive.b;
+
+    result.color = 0xFFFFFFFF;
+
+    if (pPass->getNumTextureUnitStates() > 0)
+    {
+        Ogre::TextureUnitState* pUnit = pPass->getTextureUnitState(0);
+
+        result.texture = getTexture(pUnit->getTextureName());
+
+        switch (pUnit->getTextureAddressingMode().u)
+        {
+            case Ogre::TextureUnitState::TAM_MIRROR: result.addressMode = ADDRESS_MIRROR; break;
+            case Ogre::TextureUnitState::TAM_CLAMP:
+            case Ogre::TextureUnitState::TAM_BORDER: result.addressMode = ADDRESS_CLAMP; break;
+            default:                                 result.addressMode = ADDRESS_WRAP; break;
+        }
+
+        if (result.texture >= 0)
+            result.color = m_textures[result.texture].back().texels[0];
+    }
+
+    m_materials.push_back(result);
+    m_materialIndices[strName] = m_materials.size() - 1;
+
+    return m_materials.size() - 1;
+}
+
+
+int RaycastRenderer::getTexture(const std::string& strName)
+{
+    std::map<std::string, int>::iterator iter = m_textureIndices.find(strName);
+    if (iter != m_textureIndices.end())
+        return iter->second;
+
+    m_textureIndices[strName] = -1;
+
+    Ogre::Image image;
+
+    try
+    {
+        image.load(strName, Ogre::ResourceGroupManager::AUTODETECT_RESOURCE_GROUP_NAME);
+    }
+    catch (Ogre::Exception&)
+    {
+        return -1;
+    }
+
+    tTexture texture(1);
+
+    tTextureLevel* pLevel = &texture[0];
+    pLevel->width  = image.getWidth();
+    pLevel->height = image.getHeight();
+    pLevel->texels.resize(pLevel->width * pLevel->height);
+
+    if (pLevel->texels.empty())
+        return -1;
+
+    Ogre::PixelBox dest(pLevel->width, pLevel->height, 1, Ogre::PF_BYTE_RGBA, &pLevel->texels[0]);
+
+    try
+    {
+        Ogre::PixelUtil::bulkPixelConversion(image.getPixelBox(), dest);
+    }
+    catch (Ogre::Exception&)
+    {
+        return -1;
+    }
+
+    // Mipmaps (box filter), down to 1x1
+    while ((texture.back().width > 1) || (texture.back().height > 1))
+    {
+        const tTextureLevel& source = texture.back();
+
+        tTextureLevel level;
+        level.width  = std::max(source.width / 2, 1);
+        level.height = std::max(source.height / 2, 1);
+        level.texels.resize(level.width * level.height);
+
+        for (int y = 0; y < level.height; ++y)
+        {
+            for (int x = 0; x < level.width; ++x)
+            {
+                int x1 = std::min(2 * x, source.width - 1);
+                int x2 = std::min(2 * x + 1, source.width - 1);
+                int y1 = std::min(2 * y, source.height - 1);
+                int y2 = std::min(2 * y + 1, source.height - 1);
+
+                unsigned int t[4] = {
+                    source.texels[y1 * source.width + x1], source.texels[y1 * source.width + x2],
+                    source.texels[y2 * source.width + x1], source.texels[y2 * source.width + x2],
+                };
+
+                unsigned int texel = 0;
+                for (unsigned int shift = 0; shift < 32; shift += 8)
+                {
+                    unsigned int sum = ((t[0] >> shift) & 0xFF) + ((t[1] >> shift) & 0xFF) +
+                                       ((t[2] >> shift) & 0xFF) + ((t[3] >> shift) & 0xFF);
+                    texel |= ((sum + 2) >> 2) << shift;
+                }
+
+                level.texels[y * level.width + x] = texel;
+            }
+        }
+
+        texture.push_back(level);
+    }
+
+    m_textures.push_back(texture);
+    m_textureIndices[strName] = m_textures.size() - 1;
+
+    return m_textures.size() - 1;
+}
+
+
+const Ogre::AxisAlignedBox& RaycastRenderer::getSubMeshBounds(Ogre::Entity* pEntity, unsigned int index)
+{
+    Ogre::MeshPtr mesh = pEntity->getMesh();
+
+    std::map<std::string, std::vector<Ogre::AxisAlignedBox> >::iterator iter = m_meshBounds.find(mesh->getName());
+    if (iter != m_meshBounds.end())
+        return iter->second[std::min(index, (unsigned int) iter->second.size() - 1)];
+
+    std::vector<Ogre::AxisAlignedBox> bounds;
+
+    for (unsigned int i = 0; i < mesh->getNumSubMeshes(); ++i)
+    {
+        Ogre::SubMesh* pSubMesh = mesh->getSubMesh(i);
+        Ogre::VertexData* pData = (pSubMesh->useSharedVertices ? mesh->sharedVertexData : pSubMesh->vertexData);
+
+        Ogre::AxisAlignedBox box;
+
+        const Ogre::VertexElement* pElement = (pData ? pData->vertexDeclaration->findElementBySemantic(Ogre::VES_POSITION) : 0);
+        if (pElement)
+        {
+            Ogre::HardwareVertexBufferSharedPtr buffer = pData->vertexBufferBinding->getBuffer(pElement->getSource());
+
+            unsigned char* pVertex = static_cast<unsigned char*>(buffer->lock(Ogre::HardwareBuffer::HBL_READ_ONLY));
+            pVertex += pData->vertexStart * buffer->getVertexSize();
+
+            for (size_t j = 0; j < pData->vertexCount; ++j, pVertex += buffer->getVertexSize())
+            {
+                float* pPosition;
+                pElement->baseVertexPointerToElement(pVertex, &pPosition);
+                box.merge(Ogre::Vector3(pPosition[0], pPosition[1], pPosition[2]));
+            }
+
+            buffer->unlock();
+        }
+
+        if (box.isNull())
+            box = mesh->getBounds();
+
+        bounds.push_back(box);
+    }
+
+    if (bounds.empty())
+        bounds.push_back(mesh->getBounds());
+
+    std::vector<Ogre::AxisAlignedBox>& cached = m_meshBounds[mesh->getName()];
+    cached = bounds;
+
+    return cached[std::min(index, (unsigned int) cached.size() - 1)];
+}
+
+
+void RaycastRenderer::mapSurface(const tSurface& surface, tMappedSurface &mapped)
+{
+    mapped.material = getMaterial(surface.material);
+    mapped.origin   = surface.origin;
+    mapped.xAxis    = surface.orientation * Vector3::UNIT_X;
+    mapped.zAxis    = surface.orientation * Vector3::UNIT_Z;
+    mapped.normal   = surface.orientation * Vector3::UNIT_Y;
+    mapped.width    = surface.width;
+    mapped.height   = surface.height;
+
+    // Same texture coordinates than the planes created by Ogre (the X axis of
+    // the texture is reversed, and v goes from 1 to 1 - vTile)
+    float uScale = surface.uTile / surface.width;
+    float vScale = surface.vTile / surface.height;
+
+    mapped.uAxis   = mapped.xAxis * -uScale;
+    mapped.uOffset = surface.uTile + surface.origin.dotProduct(mapped.xAxis) * uScale;
+    mapped.vAxis   = mapped.zAxis * -vScale;
+    mapped.vOffset = 1.0f + surface.origin.dotProduct(mapped.zAxis) * vScale;
+
+    mapped.logTexelsPerMeter = 0.0f;
+
+    const tMaterial& material = m_materials[mapped.material];
+    if (material.texture >= 0)
+    {
+        const tTextureLevel& level = m_textures[material.texture][0];
+        mapped.logTexelsPerMeter = log2f(std::max(level.width * uScale, level.height * vScale));
+    }
+
+    Vector3 corners[3] = {
+        surface.origin + mapped.xAxis * surface.width,
+        surface.origin + mapped.zAxis * surface.height,
+        surface.origin + mapped.xAxis * surface.width + mapped.zAxis * surface.height,
+    };
+
+    mapped.bottom = surface.origin.y;
+    mapped.top    = surface.origin.y;
+
+    for (unsigned int i = 0; i < 3; ++i)
+    {
+        mapped.bottom = std::min(mapped.bottom, corners[i].y);
+        mapped.top    = std::max(mapped.top, corners[i].y);
+    }
+}
+
+
+void RaycastRenderer::addDecal(std::vector<int> &heads, unsigned int index, int decal)
+{
+    tDecalNode node;
+    node.decal = decal;
+    node.next  = heads[index];
+
+    heads[index] = m_decalNodes.size();
+    m_decalNodes.push_back(node);
+}
+
+
+void RaycastRenderer::computeLights()
+{
+    const float cs = m_pMap->cell_size * 0.001f;
+    const unsigned int nbCells = m_pMap->width * m_pMap->height;
+
+    Entity::tEntitiesIterator iter(m_pMap->lights.begin(), m_pMap->lights.end());
+    while (iter.hasMoreElements())
+    {
+        Entity* pEntity = iter.getNext();
+
+        tLight light;
+        light.position = pEntity->getTransforms()->getWorldPosition();
+        light.room     = getRoom(light.position.x, light.position.z);
+
+        m_lights.push_back(light);
+    }
+
+    m_floorLights.assign(nbCells, -1.0f);
+    m_ceilingLights.assign(nbCells, -1.0f);
+    m_wallLights.assign(4 * 4 * nbCells, -1.0f);
+
+    for (unsigned int z = 0; z < m_pMap->height; ++z)
+    {
+        for (unsigned int x = 0; x < m_pMap->width; ++x)
+        {
+            unsigned int cell = z * m_pMap->width + x;
+
+            if (m_pMap->grid.type(cell) != CELL_WALL)
+            {
+                int room = getRoom((x + 0.5f) * cs, (z + 0.5f) * cs);
+
+                if (m_floors[cell] >= 0)
+                {
+                    m_floorLights[cell] = computeLight(Vector3((x + 0.5f) * cs, 0.0f, (z + 0.5f) * cs),
+                                                       Vector3::UNIT_Y, room);
+                }
+
+                if (m_ceilings[cell] >= 0)
+                {
+                    m_ceilingLights[cell] = computeLight(Vector3((x + 0.5f) * cs, m_ceilingHeight, (z + 0.5f) * cs),
+                                                         Vector3::NEGATIVE_UNIT_Y, room);
+                }
+
+                continue;
+            }
+
+            // Only the faces of the walls next to a free cell are visible
+            for (unsigned int face = 0; face < 4; ++face)
+            {
+                int nx = x + FACE_DX[face];
+                int nz = z + FACE_DZ[face];
+
+                if ((nx < 0) || (nx >= (int) m_pMap->width) || (nz < 0) || (nz >= (int) m_pMap->height) ||
+                    (m_pMap->grid.type(nz * m_pMap->width + nx) == CELL_WALL))
+                {
+                    continue;
+                }
+
+                Vector3 normal((float) FACE_DX[face], 0.0f, (float) FACE_DZ[face]);
+                Vector3 center = Vector3((x + 0.5f) * cs, 0.0f, (z + 0.5f) * cs) + normal * (cs * 0.5f);
+                int room = getRoom((nx + 0.5f) * cs, (nz + 0.5f) * cs);
+
+                for (unsigned int h = 0; h < 4; ++h)
+                {
+                    center.y = m_ceilingHeight * h / 3.0f;
+                    m_wallLights[(4 * cell + face) * 4 + h] = computeLight(center, normal, room);
+                }
+            }
+        }
+    }
+}
+
+
+float RaycastRenderer::computeLight(const Vector3& point, const Vector3& normal, int room) const
+{
+    const float* attenuation = MapBuilder::LIGHT_ATTENUATION;
+
+    float result = 0.0f;
+
+    for (unsigned int i = 0; i < m_lights.size(); ++i)
+    {
+        const tLight& light = m_lights[i];
+
+        // The walls cast shadows: the lights of a room don't light the other ones
+        if ((room >= 0) && (light.room >= 0) && (light.room != room))
+            continue;
+
+        Vector3 direction = light.position - point;
+        float distance = direction.length();
+
+        if ((distance >= attenuation[0]) || (distance < 1e-6f))
+            continue;
+
+        float cosine = normal.dotProduct(direction) / distance;
+        if (cosine <= 0.0f)
+            continue;
+
+        result += cosine / (attenuation[1] + attenuation[2] * distance + attenuation[3] * distance * distance);
+    }
+
+    return result;
+}
+
+
+int RaycastRenderer::getRoom(float x, float z) const
+{
+    const float cs = m_pMap->cell_size * 0.001f;
+
+    int cx = (int) floorf(x / cs);
+    int cz = (int) floorf(z / cs);
+
+    if ((cx < 0) || (cx >= (int) m_pMap->width) || (cz < 0) || (cz >= (int) m_pMap->height))
+        return -1;
+
+    unsigned int cell = m_pMap->grid.index(cx, cz);
+
+    switch (m_pMap->grid.type(cell))
+    {
+        case CELL_FLOOR:
+        case CELL_ROBOT:
+        case CELL_TARGET:
+        case CELL_SPOT:
+            return m_pMap->grid.room(cell);
+
+        default:
+            return -1;
+    }
+}
+
+
+void RaycastRenderer::prepareMaterials()
+{
+    Color ambient(0.0f, 0.0f, 0.0f);
+    Color light(0.0f, 0.0f, 0.0f);
+
+    Visual::World* pWorld = Visual::World::cast(m_pMap->pScene->getMainComponent(COMP_VISUAL));
+    if (pWorld)
+        ambient = pWorld->getAmbientLight();
+
+    if (!m_pMap->lights.empty())
+    {
+        Entity* pEntity = m_pMap->lights[0];
+
+        PointLight* pLight = PointLight::cast(pEntity->getComponent(tComponentID(COMP_VISUAL, pEntity->getName(), "PointLight")));
+        if (pLight)
+            light = pLight->getDiffuseColor();
+    }
+
+    float ambientColor[3] = { ambient.r, ambient.g, ambient.b };
+    float lightColor[3]   = { light.r, light.g, light.b };
+
+    for (unsigned int i = 0; i < m_materials.size(); ++i)
+    {
+        tMaterial& material = m_materials[i];
+
+        for (unsigned int c = 0; c < 3; ++c)
+        {
+            if (material.bLighting)
+            {
+                material.frameAmbient[c] = material.emissive[c] + ambientColor[c] * material.ambient[c];
+                material.frameDiffuse[c] = lightColor[c] * material.diffuse[c];
+            }
+            else
+            {
+                material.frameAmbient[c] = 1.0f;
+                material.frameDiffuse[c] = 0.0f;
+            }
+        }
+    }
+}
+
+
+void RaycastRenderer::collectTargets()
+{
+    m_disks.clear();
+    m_boxes.clear();
+
+    tTargetsIterator iter(m_pMap->targets.begin(), m_pMap->targets.end());
+    while (iter.hasMoreElements())
+    {
+        tTarget* pTarget = iter.peekNextPtr();
+        iter.moveNext();
+
+        Entity* pEntity = pTarget->pEntity;
+        if (!pEntity)
+            continue;
+
+        if (pTarget->type == TARGET_DISK)
+        {
+            // Disks are rendered like the decals of the floor (3x3 meters)
+            Quaternion orientation = pEntity->getTransforms()->getWorldOrientation();
+
+            tSurface surface;
+            surface.material    = pTarget->strMaterial;
+            surface.origin      = pEntity->getTransforms()->getWorldPosition() + orientation * Vector3(-1.5f, 0.0f, -1.5f);
+            surface.orientation = orientation;
+            surface.width       = 3.0f;
+            surface.height      = 3.0f;
+            surface.uTile       = 1.0f;
+            surface.vTile       = 1.0f;
+
+            tMappedSurface disk;
+            mapSurface(surface, disk);
+            m_disks.push_back(disk);
+
+            continue;
+        }
+
+        // Other targets: one box per sub-mesh of their visual components
+        for (unsigned int i = 0; TARGET_COMPONENTS[i]; ++i)
+        {
+            Visual::Object* pObject = Visual::Object::cast(pEntity->getComponent(tComponentID(COMP_VISUAL, pEntity->getName(), TARGET_COMPONENTS[i])));
+            if (!pObject)
+                continue;
+
+            Ogre::Entity* pOgreEntity = pObject->getOgreEntity();
+            if (!pOgreEntity || !pOgreEntity->isVisible() || !pOgreEntity->getParentNode())
+                continue;
+
+            const Ogre::Matrix4& transforms = pOgreEntity->getParentNode()->_getFullTransform();
+
+            for (unsigned int j = 0; j < pOgreEntity->getNumSubEntities(); ++j)
+            {
+                const Ogre::AxisAlignedBox& bounds = getSubMeshBounds(pOgreEntity, j);
+                if (bounds.isNull() || bounds.isInfinite())
+                    continue;
+
+                Ogre::Vector3 center = transforms * bounds.getCenter();
+                Ogre::Vector3 halfSize = bounds.getHalfSize();
+
+                tBox box;
+                box.material  = getMaterial(pOgreEntity->getSubEntity(j)->getMaterialName());
+                box.center[0] = center.x;
+                box.center[1] = center.z;
+
+                // Images of the X and Z axes of the mesh (only rotated around
+                // the vertical axis)
+                const unsigned int columns[2] = { 0, 2 };
+                for (unsigned int k = 0; k < 2; ++k)
+                {
+                    float ax = transforms[0][columns[k]];
+                    float az = transforms[2][columns[k]];
+                    float scale = sqrtf(ax * ax + az * az);
+
+                    if (scale < 1e-6f)
+                    {
+                        ax = (k == 0 ? 1.0f : 0.0f);
+                        az = (k == 0 ? 0.0f : 1.0f);
+                        scale = 1e-6f;
+                    }
+
+                    box.axes[k][0] = ax / scale;
+                    box.axes[k][1] = az / scale;
+                    box.extents[k] = halfSize[columns[k]] * scale;
+                }
+
+                float verticalExtent = halfSize.y * MathUtils::Abs(transforms[1][1]);
+                box.bottom = center.y - verticalExtent;
+                box.top    = center.y + verticalExtent;
+
+                float dx = box.center[0] - m_position.x;
+                float dz = box.center[1] - m_position.z;
+                box.distance = dx * dx + dz * dz;
+
+                int room = getRoom(box.center[0], box.center[1]);
+                float middle = (box.bottom + box.top) * 0.5f;
+
+                for (unsigned int face = 0; face < 4; ++face)
+                {
+                    float sign = ((face & 1) ? 1.0f : -1.0f);
+                    const float* axis = box.axes[face >> 1];
+
+                    Vector3 normal(axis[0] * sign, 0.0f, axis[1] * sign);
+                    Vector3 point(box.center[0], middle, box.center[1]);
+                    point += normal * box.extents[face >> 1];
+
+                    box.lights[face] = computeLight(point, normal, room);
+                }
+
+                box.lights[4] = computeLight(Vector3(box.center[0], box.top, box.center[1]), Vector3::UNIT_Y, room);
+                box.lights[5] = computeLight(Vector3(box.center[0], box.bottom, box.center[1]), Vector3::NEGATIVE_UNIT_Y, room);
+
+                m_boxes.push_back(box);
+            }
+        }
+    }
+
+    std::sort(m_boxes.begin(), m_boxes.end());
+}
+
+
+void RaycastRenderer::renderColumns()
+{
+    const float cs = m_pMap->cell_size * 0.001f;
+    const int width = m_pMap->width;
+    const int height = m_pMap->height;
+
+    const float gx = m_position.x / cs;
+    const float gz = m_position.z / cs;
+
+    const tMaterial& defaultMaterial = m_materials[m_defaultWallMaterial];
+
+    for (unsigned int col = 0; col < VIEW_WIDTH; ++col)
+    {
+        m_depths[col] = m_farDistance;
+
+        float sx = m_tanX * (2.0f * (col + 0.5f) / VIEW_WIDTH - 1.0f);
+        float dx = m_forward[0] + sx * m_right[0];
+        float dz = m_forward[1] + sx * m_right[1];
+
+        // Walk along the grid until a wall is found (t is the depth)
+        int cx = (int) floorf(gx);
+        int cz = (int) floorf(gz);
+
+        int stepX = (dx > 0.0f ? 1 : -1);
+        int stepZ = (dz > 0.0f ? 1 : -1);
+
+        float deltaX = (dx != 0.0f ? MathUtils::Abs(cs / dx) : 1e30f);
+        float deltaZ = (dz != 0.0f ? MathUtils::Abs(cs / dz) : 1e30f);
+
+        float tMaxX = (dx != 0.0f ? (dx > 0.0f ? (cx + 1 - gx) : (gx - cx)) * deltaX : 1e30f);
+        float tMaxZ = (dz != 0.0f ? (dz > 0.0f ? (cz + 1 - gz) : (gz - cz)) * deltaZ : 1e30f);
+
+        float t = 0.0f;
+        int face = -1;
+
+        while (true)
+        {
+            if (tMaxX < tMaxZ)
+            {
+                cx += stepX;
+                t = tMaxX;
+                tMaxX += deltaX;
+                face = (stepX > 0 ? FACE_WEST : FACE_EAST);
+            }
+            else
+            {
+                cz += stepZ;
+                t = tMaxZ;
+                tMaxZ += deltaZ;
+                face = (stepZ > 0 ? FACE_NORTH : FACE_SOUTH);
+            }
+
+            if ((cx < 0) || (cx >= width) || (cz < 0) || (cz >= height) || (t >= m_farDistance))
+            {
+                face = -1;
+                break;
+            }
+
+            if (m_pMap->grid.type(cz * width + cx) == CELL_WALL)
+                break;
+        }
+
+        if (face < 0)
+            continue;
+
+        m_depths[col] = t;
+
+        unsigned int cell = cz * width + cx;
+        int surfaceIndex = m_walls[4 * cell + face];
+
+        const tMappedSurface* pSurface = (surfaceIndex >= 0 ? &m_surfaces[surfaceIndex] : 0);
+        const tMaterial& material = (pSurface ? m_materials[pSurface->material] : defaultMaterial);
+        unsigned short materialIndex = (pSurface ? pSurface->material : m_defaultWallMaterial);
+
+        float bottom = (pSurface ? pSurface->bottom : 0.0f);
+        float top    = (pSurface ? pSurface->top : m_ceilingHeight);
+
+        float hx = m_position.x + dx * t;
+        float hz = m_position.z + dz * t;
+
+        // Size of a pixel on the wall
+        float logMetersPerPixel = log2f(std::max(t * 2.0f * m_tanX / VIEW_WIDTH, 1e-6f));
+        float logTexelsPerMeter = (pSurface ? pSurface->logTexelsPerMeter : 0.0f);
+        int level = (int) floorf(logMetersPerPixel + logTexelsPerMeter + 0.5f);
+
+        // Light of the face (interpolated with the next face along the wall)
+        float along = ((face == FACE_WEST) || (face == FACE_EAST) ? hz / cs - cz : hx / cs - cx) - 0.5f;
+
+        int nx = cx, nz = cz;
+        if ((face == FACE_WEST) || (face == FACE_EAST))
+            nz += (along < 0.0f ? -1 : 1);
+        else
+            nx += (along < 0.0f ? -1 : 1);
+
+        const float* lights = &m_wallLights[(4 * cell + face) * 4];
+        const float* neighbourLights = lights;
+
+        if ((nx >= 0) && (nx < width) && (nz >= 0) && (nz < height))
+        {
+            const float* candidate = &m_wallLights[(4 * (nz * width + nx) + face) * 4];
+            if (candidate[0] >= 0.0f)
+                neighbourLights = candidate;
+        }
+
+        float weight = MathUtils::Abs(along);
+        float columnLights[4];
+        for (unsigned int h = 0; h < 4; ++h)
+            columnLights[h] = std::max(lights[h] * (1.0f - weight) + neighbourLights[h] * weight, 0.0f);
+
+        int decals = m_wallDecals[4 * cell + face];
+
+        for (unsigned int row = 0; row < VIEW_HEIGHT; ++row)
+        {
+            float sy = m_tanY * (1.0f - 2.0f * (row + 0.5f) / VIEW_HEIGHT);
+            float hy = m_position.y + t * sy;
+
+            if ((hy < bottom) || (hy > top))
+                continue;
+
+            float u, v;
+            if (pSurface)
+            {
+                u = pSurface->uOffset + pSurface->uAxis.x * hx + pSurface->uAxis.y * hy + pSurface->uAxis.z * hz;
+                v = pSurface->vOffset + pSurface->vAxis.x * hx + pSurface->vAxis.y * hy + pSurface->vAxis.z * hz;
+            }
+            else
+            {
+                u = (hx + hz) / m_ceilingHeight;
+                v = 1.0f - hy / m_ceilingHeight;
+            }
+
+            unsigned int texel = sample(material, u, v, level);
+
+            for (int node = decals; node >= 0; node = m_decalNodes[node].next)
+                texel = blendDecal(m_decals[m_decalNodes[node].decal], texel, hx, hy, hz, logMetersPerPixel);
+
+            float fh = std::min(std::max(hy / m_ceilingHeight * 3.0f, 0.0f), 3.0f);
+            int ih = std::min((int) fh, 2);
+            float wh = fh - ih;
+
+            float light = columnLights[ih] * (1.0f - wh) + columnLights[ih + 1] * wh;
+
+            addPixel((row * VIEW_WIDTH + col) * 3, texel, light, materialIndex);
+        }
+    }
+}
+
+
+void RaycastRenderer::renderRows()
+{
+    const float cs = m_pMap->cell_size * 0.001f;
+    const unsigned int width = m_pMap->width;
+    const unsigned int height = m_pMap->height;
+
+    for (unsigned int row = 0; row < VIEW_HEIGHT; ++row)
+    {
+        float sy = m_tanY * (1.0f - 2.0f * (row + 0.5f) / VIEW_HEIGHT);
+        if (MathUtils::Abs(sy) < 1e-6f)
+            continue;
+
+        // The whole row is at the same depth
+        bool bFloor = (sy < 0.0f);
+        float planeY = (bFloor ? 0.0f : m_ceilingHeight);
+        float t = (planeY - m_position.y) / sy;
+
+        if ((t <= 0.0f) || (t >= m_farDistance))
+            continue;
+
+        const vector<int>& surfaces = (bFloor ? m_floors : m_ceilings);
+        const vector<float>& lights = (bFloor ? m_floorLights : m_ceilingLights);
+
+        // Size of a pixel on the plane (the largest of the two directions)
+        float lateral = t * 2.0f * m_tanX / VIEW_WIDTH;
+        float depth = t * t * (2.0f * m_tanY / VIEW_HEIGHT) / MathUtils::Abs(m_position.y - planeY);
+        float logMetersPerPixel = log2f(std::max(std::max(lateral, depth), 1e-6f));
+
+        for (unsigned int col = 0; col < VIEW_WIDTH; ++col)
+        {
+            if (t >= m_depths[col])
+                continue;
+
+            float sx = m_tanX * (2.0f * (col + 0.5f) / VIEW_WIDTH - 1.0f);
+            float px = m_position.x + t * (m_forward[0] + sx * m_right[0]);
+            float pz = m_position.z + t * (m_forward[1] + sx * m_right[1]);
+
+            float gx = px / cs;
+            float gz = pz / cs;
+
+            int cx = (int) floorf(gx);
+            int cz = (int) floorf(gz);
+
+            if ((cx < 0) || (cx >= (int) width) || (cz < 0) || (cz >= (int) height))
+                continue;
+
+            unsigned int cell = cz * width + cx;
+
+            int surfaceIndex = surfaces[cell];
+            if (surfaceIndex < 0)
+                continue;
+
+            const tMappedSurface& surface = m_surfaces[surfaceIndex];
+            const tMaterial& material = m_materials[surface.material];
+
+            float u = surface.uOffset + surface.uAxis.x * px + surface.uAxis.y * planeY + surface.uAxis.z * pz;
+            float v = surface.vOffset + surface.vAxis.x * px + surface.vAxis.y * planeY + surface.vAxis.z * pz;
+            int level = (int) floorf(logMetersPerPixel + surface.logTexelsPerMeter + 0.5f);
+
+            unsigned int texel = sample(material, u, v, level);
+
+            if (bFloor)
+            {
+                for (int node = m_floorDecals[cell]; node >= 0; node = m_decalNodes[node].next)
+                    texel = blendDecal(m_decals[m_decalNodes[node].decal], texel, px, planeY, pz, logMetersPerPixel);
+
+                for (unsigned int i = 0; i < m_disks.size(); ++i)
+                    texel = blendDecal(m_disks[i], texel, px, planeY, pz, logMetersPerPixel);
+            }
+
+            float light = interpolateLight(lights, width, height, gx, gz);
+
+            addPixel((row * VIEW_WIDTH + col) * 3, texel, light, surface.material);
+        }
+    }
+}
+
+
+void RaycastRenderer::renderBoxes()
+{
+    if (m_boxes.empty())
+        return;
+
+    const float nearDistance = 0.1f;
+
+    for (unsigned int col = 0; col < VIEW_WIDTH; ++col)
+    {
+        float sx = m_tanX * (2.0f * (col + 0.5f) / VIEW_WIDTH - 1.0f);
+        float dx = m_forward[0] + sx * m_right[0];
+        float dz = m_forward[1] + sx * m_right[1];
+
+        // From the farthest box to the nearest one
+        for (unsigned int i = 0; i < m_boxes.size(); ++i)
+        {
+            const tBox& box = m_boxes[i];
+
+            float ox = m_position.x - box.center[0];
+            float oz = m_position.z - box.center[1];
+
+            // Intersection of the ray with the box, seen from above
+            float tNear = -1e30f;
+            float tFar = 1e30f;
+            int face = -1;
+
+            for (unsigned int k = 0; k < 2; ++k)
+            {
+                float o = ox * box.axes[k][0] + oz * box.axes[k][1];
+                float d = dx * box.axes[k][0] + dz * box.axes[k][1];
+
+                if (MathUtils::Abs(d) < 1e-9f)
+                {
+                    if (MathUtils::Abs(o) > box.extents[k])
+                        tNear = 1e30f;
+                    continue;
+                }
+
+                float t1 = (-box.extents[k] - o) / d;
+                float t2 = (box.extents[k] - o) / d;
+
+                // Entering through the face opposite to the direction
+                int entry = 2 * k + (d > 0.0f ? 0 : 1);
+                if (t1 > t2)
+                    std::swap(t1, t2);
+
+                if (t1 > tNear)
+                {
+                    tNear = t1;
+                    face = entry;
+                }
+
+                tFar = std::min(tFar, t2);
+            }
+
+            if ((face < 0) || (tNear > tFar) || (tFar < nearDistance) || (tNear >= m_depths[col]))
+                continue;
+
+            tNear = std::max(tNear, nearDistance);
+
+            for (unsigned int row = 0; row < VIEW_HEIGHT; ++row)
+            {
+                float sy = m_tanY * (1.0f - 2.0f * (row + 0.5f) / VIEW_HEIGHT);
+                float y = m_position.y + tNear * sy;
+
+                float light;
+
+                if ((y >= box.bottom) && (y <= box.top))
+                {
+                    light = box.lights[face];
+                }
+                else if ((y > box.top) && (sy < 0.0f))
+                {
+                    float t = (box.top - m_position.y) / sy;
+                    if ((t > tFar) || (t >= m_depths[col]))
+                        continue;
+
+                    light = box.lights[4];
+                }
+                else if ((y < box.bottom) && (sy > 0.0f))
+                {
+                    float t = (box.bottom - m_position.y) / sy;
+                    if ((t > tFar) || (t >= m_depths[col]))
+                        continue;
+
+                    light = box.lights[5];
+                }
+                else
+                {
+                    continue;
+                }
+
+                addPixel((row * VIEW_WIDTH + col) * 3, m_materials[box.material].color, light, box.material);
+            }
+        }
+    }
+}
+
+
+unsigned int RaycastRenderer::sample(const tMaterial& material, float u, float v, int level) const
+{
+    if (material.texture < 0)
+        return material.color;
+
+    const tTexture& texture = m_textures[material.texture];
+    const tTextureLevel& mipmap = texture[clampIndex(level, texture.size())];
+
+    switch (material.addressMode)
+    {
+        case ADDRESS_MIRROR:
+            u -= 2.0f * floorf(u * 0.5f);
+            v -= 2.0f * floorf(v * 0.5f);
+
+            if (u > 1.0f)
+                u = 2.0f - u;
+
+            if (v > 1.0f)
+                v = 2.0f - v;
+            break;
+
+        case ADDRESS_CLAMP:
+            u = std::min(std::max(u, 0.0f), 1.0f);
+            v = std::min(std::max(v, 0.0f), 1.0f);
+            break;
+
+        default:
+            u -= floorf(u);
+            v -= floorf(v);
+            break;
+    }
+
+    int x = std::min((int) (u * mipmap.width), mipmap.width - 1);
+    int y = std::min((int) (v * mipmap.height), mipmap.height - 1);
+
+    return mipmap.texels[y * mipmap.width + x];
+}
+
+
+unsigned int RaycastRenderer::blendDecal(const tMappedSurface& decal, unsigned int texel,
+                                         float x, float y, float z, float logMetersPerPixel) const
+{
+    float lx = (x - decal.origin.x) * decal.xAxis.x + (y - decal.origin.y) * decal.xAxis.y + (z - decal.origin.z) * decal.xAxis.z;
+    float lz = (x - decal.origin.x) * decal.zAxis.x + (y - decal.origin.y) * decal.zAxis.y + (z - decal.origin.z) * decal.zAxis.z;
+
+    if ((lx < 0.0f) || (lx > decal.width) || (lz < 0.0f) || (lz > decal.height))
+        return texel;
+
+    const tMaterial& material = m_materials[decal.material];
+
+    float u = decal.uOffset + decal.uAxis.x * x + decal.uAxis.y * y + decal.uAxis.z * z;
+    float v = decal.vOffset + decal.vAxis.x * x + decal.vAxis.y * y + decal.vAxis.z * z;
+    int level = (int) floorf(logMetersPerPixel + decal.logTexelsPerMeter + 0.5f);
+
+    unsigned int color = sample(material, u, v, level);
+
+    if (!material.bBlend)
+        return color;
+
+    unsigned int alpha = color >> 24;
+    unsigned int result = 0xFF000000;
+
+    for (unsigned int shift = 0; shift < 24; shift += 8)
+    {
+        unsigned int a = (color >> shift) & 0xFF;
+        unsigned int b = (texel >> shift) & 0xFF;
+        result |= ((a * alpha + b * (255 - alpha) + 127) / 255) << shift;
+    }
+
+    return result;
+}
+
+
+void RaycastRenderer::shadeBatch()
+{
+    // pixel = min(texel * (ambient + diffuse * light), 1)
+    unsigned int i = 0;
+
+#ifdef __SSE2__
+    const __m128i mask = _mm_set1_epi32(0xFF);
+    const __m128 maximum = _mm_set1_ps(255.0f);
+
+    for (; i + 4 <= m_batch.count; i += 4)
+    {
+        __m128i texels = _mm_loadu_si128((const __m128i*) &m_batch.texels[i]);
+        __m128 lights = _mm_loadu_ps(&m_batch.lights[i]);
+
+        const tMaterial* materials[4] = {
+            &m_materials[m_batch.materials[i]], &m_materials[m_batch.materials[i + 1]],
+            &m_materials[m_batch.materials[i + 2]], &m_materials[m_batch.materials[i + 3]],
+        };
+
+        int results[3][4];
+
+        for (unsigned int c = 0; c < 3; ++c)
+        {
+            __m128 ambient = _mm_setr_ps(materials[0]->frameAmbient[c], materials[1]->frameAmbient[c],
+                                         materials[2]->frameAmbient[c], materials[3]->frameAmbient[c]);
+            __m128 diffuse = _mm_setr_ps(materials[0]->frameDiffuse[c], materials[1]->frameDiffuse[c],
+                                         materials[2]->frameDiffuse[c], materials[3]->frameDiffuse[c]);
+
+            __m128 texel = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(texels, 8 * c), mask));
+            __m128 color = _mm_mul_ps(texel, _mm_add_ps(ambient, _mm_mul_ps(diffuse, lights)));
+
+            _mm_storeu_si128((__m128i*) results[c], _mm_cvttps_epi32(_mm_min_ps(color, maximum)));
+        }
+
+        for (unsigned int j = 0; j < 4; ++j)
+        {
+            unsigned char* pDest = m_pBuffer + m_batch.offsets[i + j];
+            pDest[0] = (unsigned char) results[0][j];
+            pDest[1] = (unsigned char) results[1][j];
+            pDest[2] = (unsigned char) results[2][j];
+        }
+    }
+#endif
+
+    for (; i < m_batch.count; ++i)
+    {
+        const tMaterial& material = m_materials[m_batch.materials[i]];
+        unsigned int texel = m_batch.texels[i];
+        float light = m_batch.lights[i];
+
+        unsigned char* pDest = m_pBuffer + m_batch.offsets[i];
+
+        for (unsigned int c = 0; c < 3; ++c)
+        {
+            float color = ((texel >> (8 * c)) & 0xFF) * (material.frameAmbient[c] + material.frameDiffuse[c] * light);
+            pDest[c] = (unsigned char) std::min(color, 255.0f);
+        }
+    }
+
+    m_batch.count = 0;
+}
@@ -42,7 +42,10 @@
 #include <Athena-Physics/Conversions.h>
 #include <Athena-Core/Log/LogManager.h>
 #include <Athena-Math/Vector3.h>
+#include <Athena-Math/Color.h>
 #include <Athena-Math/RandomNumberGenerator.h>
+#include <mash-utils/statistics.h>
+#include <mash-utils/tracer.h>
 #include <Ogre/OgreRoot.h>
 #include <Ogre/OgreRenderTexture.h>
 #include <Ogre/OgreRenderWindow.h>
@@ -69,16 +72,34 @@ using Ogre::Root;
 using Ogre::TextureManager;
 using Ogre::Viewport;
 
+using Mash::LatencyHistogram;
+using Mash::ScopedLatency;
+using Mash::ScopedTrace;
+using Mash::Statistics;
+
 
 static const char* __CONTEXT__ = "Server State";
 
 
+// Returns the seed of an episode of the task (the first one uses the global
+// seed)
+static unsigned int episodeSeed(unsigned int globalSeed, unsigned int index)
+{
+    return globalSeed + index * 2654435761u;
+}
+
+
 /***************************** CONSTRUCTION / DESTRUCTION ******************************/
 
 ServerState::ServerState(bool bEnableSecrets)
-: m_pRenderTexture(0), m_pAvatar(0), m_pAvatarBody(0), m_pAvatarGhost(0), m_pOverlay(0),
+: m_globalSeed(0), m_nbEpisodes(0), m_pNextMapBuilder(0), m_pNextGoal(0),
+  m_nextEpisodeStage(BUILD_MAP), m_bUseNextLayout(false),
+  m_pRenderTexture(0), m_pAvatar(0), m_pAvatarBody(0), m_pAvatarGhost(0), m_pOverlay(0),
+  m_pCamera(0), m_renderer(RENDERER_OGRE), m_bRenderingEnabled(true), m_bViewOutdated(false),
   m_pTeacher(0), m_pMap(0), m_pGoal(0), m_bEnableSecrets(bEnableSecrets),
-  m_result(RESULT_NONE), m_fReward(0.0f), m_strEvent(""), m_pCurrentView(0)
+  m_result(RESULT_NONE), m_fReward(0.0f), m_strEvent(""), m_pCurrentView(0),
+  m_lastProcessDuration(0), m_bAsyncTeacher(false), m_bTeacherJobPending(false),
+  m_teacherDuration(0)
 {
     m_texture = TextureManager::getSingleton().createManual("RttTex", ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME,
                                                             Ogre::TEX_TYPE_2D, RTT_WIDTH, RTT_HEIGHT, 0, Ogre::PF_A8R8G8B8, Ogre::TU_RENDERTARGET);
@@ -105,6 +126,25 @@ void ServerState::setup(const std::string& goal, const std::string& environment,
 
     m_selectedMap = environment;
     m_selectedGoal = goal;
+    m_globalSeed = globalSeed;
+    m_nbEpisodes = 0;
+
+    m_layouts.close();
+
+    if (!m_strLayoutsFolder.empty())
+    {
+        std::string strFileName = m_strLayoutsFolder + "/" + goal + "-" + environment + ".layouts";
+
+        if (m_layouts.open(strFileName))
+        {
+            if ((m_layouts.goal() != goal) || (m_layouts.environment() != environment))
+            {
+                ATHENA_LOG_WARNING("Ignoring the layouts file '" + strFileName +
+                                   "': it was generated for another task");
+                m_layouts.close();
+            }
+        }
+    }
 
     resetTask();
 }
@@ -112,6 +152,132 @@ void ServerState::setup(const std::string& goal, const std::string& environment,
 
 void ServerState::reset()
 {
+    endEpisode();
+    destroyNextEpisode();
+}
+
+
+bool ServerState::prepareNextEpisode()
+{
+    if (!m_pMap || (m_nextEpisodeStage == BUILD_DONE))
+        return false;
+
+    static LatencyHistogram& histogram = Statistics::histogram("phase.prebuild");
+    ScopedLatency latency(histogram);
+
+    buildNextEpisode();
+
+    return true;
+}
+
+
+bool ServerState::prepareNextEpisodeStage()
+{
+    if (!m_pMap || (m_nextEpisodeStage == BUILD_DONE))
+        return false;
+
+    // Each stage is measured separately: that's how long a command arriving
+    // during the build can wait
+    static LatencyHistogram& histogram = Statistics::histogram("phase.prebuild_stage");
+    ScopedLatency latency(histogram);
+
+    buildNextEpisodeStage();
+
+    return (m_nextEpisodeStage != BUILD_DONE);
+}
+
+
+void ServerState::buildNextEpisode()
+{
+    ScopedTrace trace("ServerState::buildNextEpisode");
+
+    while (m_nextEpisodeStage != BUILD_DONE)
+        buildNextEpisodeStage();
+}
+
+
+void ServerState::buildNextEpisodeStage()
+{
+    switch (m_nextEpisodeStage)
+    {
+        case BUILD_MAP:
+        {
+            assert(!m_pNextMapBuilder);
+            assert(!m_pNextGoal);
+
+            ScopedTrace trace("ServerState::buildNextEpisode/map");
+
+            unsigned int seed = episodeSeed(m_globalSeed, m_nbEpisodes);
+
+            // With precomputed layouts, the map is generated from the seed
+            // stored with the layout picked by the episode (the placements
+            // are only valid for that map)
+            m_bUseNextLayout = m_layouts.isOpen() &&
+                               m_layouts.getLayout(seed % m_layouts.nbLayouts(), seed, m_nextLayout);
+
+            // The scene stays hidden until the episode starts. The avatar
+            // isn't created yet: nothing moves in the scene until then.
+            m_pNextMapBuilder = createMap(m_selectedMap, seed);
+            m_nextEpisodeStage = BUILD_GOAL;
+            break;
+        }
+
+        case BUILD_GOAL:
+        {
+            ScopedTrace trace("ServerState::buildNextEpisode/goal");
+
+            m_pNextGoal = createGoal(m_selectedGoal);
+            m_pNextGoal->setup(m_pNextMapBuilder);
+            m_nextEpisodeStage = BUILD_FINALIZE;
+            break;
+        }
+
+        case BUILD_FINALIZE:
+        {
+            ScopedTrace trace("ServerState::buildNextEpisode/finalize");
+
+            // With a precomputed layout, the search of the positions is
+            // skipped
+            if (m_bUseNextLayout &&
+                (m_nextLayout.targets.size() == m_pNextMapBuilder->getMap()->targets.size()))
+            {
+                m_pNextMapBuilder->finalize(&m_nextLayout);
+            }
+            else
+            {
+                m_pNextMapBuilder->finalize();
+            }
+
+            m_nextEpisodeStage = BUILD_DONE;
+            break;
+        }
+
+        case BUILD_DONE:
+            break;
+    }
+}
+
+
+void ServerState::destroyNextEpisode()
+{
+    m_nextEpisodeStage = BUILD_MAP;
+
+    if (!m_pNextMapBuilder)
+        return;
+
+    delete m_pNextGoal;
+    delete m_pNextMapBuilder->getMap();
+    delete m_pNextMapBuilder;
+
+    m_pNextMapBuilder = 0;
+    m_pNextGoal       = 0;
+}
+
+
+void ServerState::endEpisode()
+{
+    waitForTeacher();
+
     if (m_pOverlay)
     {
         m_pOverlay->hide();
@@ -131,9 +297,13 @@ void ServerState::reset()
         delete m_pTeacher;
 
         m_pAvatar     = 0;
+        m_pCamera     = 0;
         m_pMap        = 0;
         m_pGoal       = 0;
         m_pTeacher    = 0;
+
+        m_raycaster.setMap(0);
+        m_topdown.setMap(0, 0);
     }
 
     m_result   = RESULT_NONE;
@@ -153,15 +323,20 @@ void ServerState::resetTask()
     assert(!m_selectedGoal.empty());
     assert(!m_selectedMap.empty());
 
-    reset();
+    endEpisode();
 
+    // Use the episode built in advance if any, or complete the build started
+    // in advance (see prepareNextEpisode())
+    buildNextEpisode();
 
-    MapBuilder* pMapBuilder = createMap(m_selectedMap);
+    MapBuilder* pMapBuilder = m_pNextMapBuilder;
+    m_pGoal = m_pNextGoal;
 
-    m_pGoal = createGoal(m_selectedGoal);
-    m_pGoal->setup(pMapBuilder);
+    m_pNextMapBuilder  = 0;
+    m_pNextGoal        = 0;
+    m_nextEpisodeStage = BUILD_MAP;
+    ++m_nbEpisodes;
 
-    pMapBuilder->finalize();
     m_pMap = pMapBuilder->getMap();
     m_pMap->pScene->show();
 
@@ -218,6 +393,11 @@ void ServerState::resetTask()
 
     m_pGoal->finalize(m_pMap);
 
+    m_pCamera = pCamera;
+
+    if (m_renderer == RENDERER_RAYCAST)
+        m_raycaster.setMap(m_pMap);
+
 
     m_pTeacher = createTeacher(m_selectedGoal, m_selectedMap, m_pMap, pCamera);
     if (m_pTeacher)
@@ -238,11 +418,42 @@ void ServerState::resetTask()
 }
 
 
+void ServerState::setRenderer(tRenderer renderer)
+{
+    m_renderer = renderer;
+
+    enableRendering(true);
+
+    if (m_pCurrentView)
+    {
+        delete[] m_pCurrentView;
+        m_pCurrentView = 0;
+    }
+}
+
+
+void ServerState::enableRendering(bool bEnabled)
+{
+    m_bRenderingEnabled = bEnabled;
+
+    // Ogre keeps rendering the scene only when its images are used
+    bool bOgre = bEnabled && (m_renderer == RENDERER_OGRE);
+
+    m_pRenderTexture->setAutoUpdated(bOgre);
+    Engine::getSingletonPtr()->getMainWindow()->setAutoUpdated(bOgre);
+}
+
+
 bool ServerState::performAction(tAction action, float elapsedMilliseconds)
 {
     assert(m_pGoal);
     assert(m_pMap);
 
+    waitForTeacher();
+
+    // The reward of the action is accumulated over the steps simulating it
+    m_fReward = 0.0f;
+
     if (m_pCurrentView)
     {
         delete[] m_pCurrentView;
@@ -298,8 +509,139 @@ unsigned char* ServerState::getAvatarView(size_t &nbBytes)
 }
 
 
+bool ServerState::getAvatarViewInto(unsigned char* pBuffer)
+{
+    // Use the cached view if it was already retrieved
+    if (m_pCurrentView)
+    {
+        memcpy(pBuffer, m_pCurrentView, VIEW_WIDTH * VIEW_HEIGHT * 3);
+        return true;
+    }
+
+    return readView(pBuffer);
+}
+
+
+bool ServerState::getRaycastViewInto(unsigned char* pBuffer)
+{
+    if (!m_pMap || !m_pCamera)
+        return false;
+
+    // The static parts of the scene are processed once per episode
+    if (m_raycaster.getMap() != m_pMap)
+        m_raycaster.setMap(m_pMap);
+
+    static LatencyHistogram& histogram = Statistics::histogram("phase.raycast");
+    ScopedLatency latency(histogram);
+
+    m_raycaster.render(m_pCamera->getOgreCamera(), pBuffer);
+
+    return true;
+}
+
+
+bool ServerState::getStateInto(float* pBuffer)
+{
+    if (!m_pMap || !m_pAvatar)
+        return false;
+
+    memset(pBuffer, 0, STATE_SIZE * sizeof(float));
+
+    // Avatar
+    Vector3 position = m_pAvatar->getTransforms()->getWorldPosition();
+    Quaternion orientation = m_pAvatar->getTransforms()->getWorldOrientation();
+    Vector3 front = orientation * Vector3::NEGATIVE_UNIT_Z;
+    Vector3 right = orientation * Vector3::UNIT_X;
+    Vector3 velocity = m_pAvatarBody->getLinearVelocity();
+
+    pBuffer[0] = position.x;
+    pBuffer[1] = position.y;
+    pBuffer[2] = position.z;
+    pBuffer[3] = front.x;
+    pBuffer[4] = front.z;
+    pBuffer[5] = velocity.x;
+    pBuffer[6] = velocity.y;
+    pBuffer[7] = velocity.z;
+
+    // Ambient light (its color is the phase of the 'follow_the_light' goal)
+    Visual::World* pWorld = Visual::World::cast(m_pMap->pScene->getMainComponent(COMP_VISUAL));
+    Color color = pWorld->getAmbientLight();
+
+    pBuffer[8]  = color.r;
+    pBuffer[9]  = color.g;
+    pBuffer[10] = color.b;
+
+    // Nearest spot
+    float cell_size = m_pMap->cell_size * 0.001f;
+    float min_squared_dist = -1.0f;
+
+    tSpotsIterator iter(m_pMap->spots.begin(), m_pMap->spots.end());
+    while (iter.hasMoreElements())
+    {
+        const tSpot* pSpot = iter.peekNextPtr();
+
+        float dx = pSpot->position.x * cell_size - position.x;
+        float dz = pSpot->position.y * cell_size - position.z;
+        float squared_dist = dx * dx + dz * dz;
+
+        if ((min_squared_dist < 0.0f) || (squared_dist < min_squared_dist))
+            min_squared_dist = squared_dist;
+
+        iter.moveNext();
+    }
+
+    pBuffer[11] = (min_squared_dist >= 0.0f ? MathUtils::Sqrt(min_squared_dist) : -1.0f);
+
+    // Targets
+    for (unsigned int i = 0; i < STATE_MAX_TARGETS; ++i)
+    {
+        float* pSlot = pBuffer + 12 + 4 * i;
+
+        if ((i >= m_pMap->targets.size()) || !m_pMap->targets[i].pEntity)
+        {
+            pSlot[0] = -1.0f;
+            continue;
+        }
+
+        const tTarget& target = m_pMap->targets[i];
+        Vector3 offset = target.pEntity->getTransforms()->getWorldPosition() - position;
+
+        pSlot[0] = (float) target.type;
+        pSlot[1] = (float) target.goal_specific;
+        pSlot[2] = offset.dotProduct(right);
+        pSlot[3] = offset.dotProduct(front);
+    }
+
+    return true;
+}
+
+
+bool ServerState::getTopDownViewInto(unsigned char* pBuffer)
+{
+    if (!m_pMap || !m_pAvatar)
+        return false;
+
+    // The teacher must be done with the last frame
+    waitForTeacher();
+
+    // The image of the grid is drawn once per episode, then updated
+    if (m_topdown.getMap() != m_pMap)
+        m_topdown.setMap(m_pMap, m_pTeacher);
+
+    Vector3 position = m_pAvatar->getTransforms()->getWorldPosition();
+
+    m_topdown.render((int) (position.x * 1000.0f) / (int) m_pMap->cell_size,
+                     (int) (position.z * 1000.0f) / (int) m_pMap->cell_size,
+                     pBuffer);
+
+    return true;
+}
+
+
 tAction ServerState::getTeacherAction()
 {
+    waitForTeacher();
+
     if (m_pTeacher)
         return m_pTeacher->nextAction();
 
@@ -309,6 +651,8 @@ tAction ServerState::getTeacherAction()
 
 Mash::tActionsList ServerState::getNotRecommendedActions()
 {
+    waitForTeacher();
+
     if (m_pTeacher)
         return m_pTeacher->notRecommendedActions();
 
@@ -325,11 +669,35 @@ bool ServerState::retrieveCurrentView()
 
     m_pCurrentView = new unsigned char[VIEW_WIDTH * VIEW_HEIGHT * 3];
 
+    return readView(m_pCurrentView);
+}
+
+
+bool ServerState::readView(unsigned char* pBuffer)
+{
+    if (m_pRenderTexture->getNumViewports() == 0)
+        return false;
+
+    if (m_renderer == RENDERER_RAYCAST)
+        return getRaycastViewInto(pBuffer);
+
+    // The last frame was simulated without rendering it: render the view now
+    if (m_bViewOutdated)
+    {
+        ScopedTrace trace("RenderTexture::update");
+        m_pRenderTexture->update();
+        m_bViewOutdated = false;
+    }
+
     HardwarePixelBufferSharedPtr ogrePixelBuffer = m_texture->getBuffer();
 
     Image::Box srcBox(0, 0, VIEW_WIDTH, VIEW_HEIGHT);
 
-    PixelBox dstBox(VIEW_WIDTH, VIEW_HEIGHT, 1, Ogre::PF_B8G8R8, m_pCurrentView);
+    PixelBox dstBox(VIEW_WIDTH, VIEW_HEIGHT, 1, Ogre::PF_B8G8R8, pBuffer);
+
+    static LatencyHistogram& histogram = Statistics::histogram("phase.readback");
+    ScopedLatency latency(histogram);
+    ScopedTrace trace("blitToMemory");
 
     ogrePixelBuffer->blitToMemory(srcBox, dstBox);
 
@@ -337,6 +705,37 @@ bool ServerState::retrieveCurrentView()
 }
 
 
+void ServerState::waitForTeacher()
+{
+    // Only the thread calling post() reads or writes the flag: asking the
+    // worker whether it is busy would race with the job completing
+    if (!m_bTeacherJobPending)
+        return;
+
+    static LatencyHistogram& histogram = Statistics::histogram("phase.teacher");
+
+    m_teacherThread.wait();
+    m_bTeacherJobPending = false;
+
+    // The histograms aren't thread-safe: the duration measured by the
+    // thread is recorded here
+    if (Statistics::enabled)
+        histogram.record(m_teacherDuration);
+}
+
+
+void ServerState::updateTeacher(void* pArgument)
+{
+    ServerState* pState = (ServerState*) pArgument;
+
+    unsigned long long start = (Statistics::enabled ? Statistics::now() : 0);
+
+    pState->m_pTeacher->processView(pState->m_teacherPosition);
+
+    pState->m_teacherDuration = (Statistics::enabled ? Statistics::now() - start : 0);
+}
+
+
 /************************ METHODS TO BE OVERRIDEN BY EACH STATE ************************/
 
 void ServerState::enter()
@@ -361,14 +760,49 @@ void ServerState::resume()
 
 void ServerState::process()
 {
-    m_result = m_pGoal->process(m_fReward, m_pTeacher);
+    static LatencyHistogram& goalHistogram = Statistics::histogram("phase.goal");
+    static LatencyHistogram& teacherHistogram = Statistics::histogram("phase.teacher");
 
-    if (m_pTeacher)
+    ScopedTrace trace("ServerState::process");
+
+    // process() can be called several times without performAction()
+    // (during the initialization of the goal)
+    waitForTeacher();
+
+    unsigned long long start = (Statistics::enabled ? Statistics::now() : 0);
+
+    m_bViewOutdated = !m_bRenderingEnabled;
+
+    {
+        ScopedLatency latency(goalHistogram);
+
+        float reward = 0.0f;
+        m_result = m_pGoal->process(reward, m_pTeacher);
+        m_fReward += reward;
+    }
+
+    if (m_pTeacher && m_bAsyncTeacher)
+    {
+        // Only the camera is read now: the grid of the teacher is updated
+        // while the frame is rendered
+        m_pTeacher->captureView();
+        m_teacherPosition = m_pAvatar->getTransforms()->getWorldPosition();
+        m_teacherThread.post(&ServerState::updateTeacher, this);
+        m_bTeacherJobPending = true;
+    }
+    else if (m_pTeacher)
     {
+        ScopedLatency latency(teacherHistogram);
         m_pTeacher->update(m_pAvatar->getTransforms()->getWorldPosition(),
                            m_pAvatar->getTransforms()->getWorldOrientation());
     }
 
+    // Only the rooms seen through the doors are rendered by Ogre
+    if (m_renderer == RENDERER_OGRE)
+        m_pMap->updateVisibility(m_pCamera->getOgreCamera());
+
+    m_lastProcessDuration = (Statistics::enabled ? Statistics::now() - start : 0);
+
     if ((m_result != RESULT_NONE) && !m_pOverlay)
     {
         m_pOverlay = Ogre::OverlayManager::getSingletonPtr()->getByName(
@@ -31,6 +31,7 @@
 #include <mash-utils/random_number_generator.h>
 #include <Ogre/OgreWindowEventUtilities.h>
 #include <assert.h>
+#include <algorithm>
 
 using namespace std;
 using namespace Mash;
@@ -39,12 +40,21 @@ using Ogre::WindowEventUtilities;
 
 
 bool SimulationServer::bEnableSecrets = false;
+bool SimulationServer::bAsyncTeacher = false;
+bool SimulationServer::bPrebuildEpisodes = false;
+std::string SimulationServer::strLayoutsFolder = "";
+tRenderer SimulationServer::renderer = RENDERER_OGRE;
+Simulator* SimulationServer::pWarmSimulator = 0;
+
+// The state is sent as an array of 32-bit floats (in the byte order of the
+// server)
+static const char* STATE_MIMETYPE = "application/x-float32";
 
 
 /************************* CONSTRUCTION / DESTRUCTION *************************/
 
 SimulationServer::SimulationServer()
-: m_pSimulator(0)
+: m_pSimulator(0), m_bAvatarViewUsed(false)
 {
     setGlobalSeed(time(0));
 }
@@ -52,7 +62,11 @@ SimulationServer::SimulationServer()
 
 SimulationServer::~SimulationServer()
 {
-    delete m_pSimulator;
+    // The pre-initialized simulator is kept for the next session
+    if (m_pSimulator && (m_pSimulator == pWarmSimulator))
+        m_pSimulator->reset();
+    else
+        delete m_pSimulator;
 }
 
 
@@ -64,6 +78,23 @@ IApplicationServer* SimulationServer::create()
 }
 
 
+bool SimulationServer::warmUp()
+{
+    if (pWarmSimulator)
+        return true;
+
+    pWarmSimulator = new Simulator();
+    if (!pWarmSimulator->init(false, "", "", SimulationServer::bEnableSecrets))
+    {
+        delete pWarmSimulator;
+        pWarmSimulator = 0;
+        return false;
+    }
+
+    return true;
+}
+
+
 /********************************** METHODS ***********************************/
 
 void SimulationServer::setGlobalSeed(unsigned int seed)
@@ -122,6 +153,20 @@ tViewsList SimulationServer::getViews(const std::string& goal,
 
     views.push_back(view);
 
+    // Ground-truth state, as a vector of floats (see Declarations.h)
+    view.name = "state";
+    view.width = STATE_SIZE;
+    view.height = 1;
+
+    views.push_back(view);
+
+    // Top-down view of the grid (see TopDownView)
+    view.name = "topdown";
+    view.width = TOPDOWN_SIZE;
+    view.height = TOPDOWN_SIZE;
+
+    views.push_back(view);
+
     return views;
 }
 
@@ -139,13 +184,98 @@ bool SimulationServer::initializeTask(const std::string& goal,
                                       const std::string& environment,
                                       const IApplicationServer::tSettingsList& settings)
 {
-    // Cleanup the previous world, if any
-    if (m_pSimulator)
-        delete m_pSimulator;
+    // Use the pre-initialized simulator if available (the previous world is
+    // cleaned up by the setup)
+    if (pWarmSimulator)
+    {
+        m_pSimulator = pWarmSimulator;
+    }
+    else
+    {
+        // Cleanup the previous world, if any
+        if (m_pSimulator)
+            delete m_pSimulator;
+
+        // Create the simulator
+        m_pSimulator = new Simulator();
+        m_pSimulator->init(false, "", "", SimulationServer::bEnableSecrets);
+    }
+
+    m_pSimulator->setAsyncTeacher(SimulationServer::bAsyncTeacher);
+    m_pSimulator->setLayoutsFolder(SimulationServer::strLayoutsFolder);
+
+    // The renderer can be selected by the client ('RENDERER ogre|raycast')
+    tRenderer sessionRenderer = SimulationServer::renderer;
+
+    IApplicationServer::tSettingsList::const_iterator iter = settings.find("RENDERER");
+    if ((iter != settings.end()) && (iter->second.size() == 1))
+    {
+        if (!parseRenderer(iter->second.getString(0), sessionRenderer))
+            return false;
+    }
+
+    // The timing of the actions too ('ACTION_DURATION <ms>', 'PHYSICS_STEPS <nb>',
+    // 'PHYSICS_TIMESTEP <ms>' and 'FAST_FORWARD on|off')
+    tTiming timing;
+
+    iter = settings.find("ACTION_DURATION");
+    if ((iter != settings.end()) && (iter->second.size() == 1))
+        timing.actionDuration = iter->second.getFloat(0);
+
+    iter = settings.find("PHYSICS_STEPS");
+    if ((iter != settings.end()) && (iter->second.size() == 1))
+        timing.nbSteps = (unsigned int) std::max(iter->second.getInt(0), 0);
+
+    iter = settings.find("PHYSICS_TIMESTEP");
+    if ((iter != settings.end()) && (iter->second.size() == 1))
+        timing.stepDuration = iter->second.getFloat(0);
+
+    iter = settings.find("FAST_FORWARD");
+    if ((iter != settings.end()) && (iter->second.size() == 1))
+    {
+        if (iter->second.getString(0) == "on")
+            timing.bFastForward = true;
+        else if (iter->second.getString(0) != "off")
+            return false;
+    }
+
+    // The steps must fit in the ones of the physics world, and add up to the
+    // duration of an action (unless the default timing is used)
+    if (!timing.isValid(m_pSimulator->getPhysicsLimits()))
+        return false;
+
+    // And the content of the 'topdown' view ('TOPDOWN_SOURCE map|teacher' and
+    // 'TOPDOWN_EGOCENTRIC on|off')
+    tTopDownSource topdownSource = TOPDOWN_MAP;
+    bool bTopdownEgocentric = false;
+
+    iter = settings.find("TOPDOWN_SOURCE");
+    if ((iter != settings.end()) && (iter->second.size() == 1))
+    {
+        if (iter->second.getString(0) == "teacher")
+            topdownSource = TOPDOWN_TEACHER;
+        else if (iter->second.getString(0) != "map")
+            return false;
+    }
+
+    iter = settings.find("TOPDOWN_EGOCENTRIC");
+    if ((iter != settings.end()) && (iter->second.size() == 1))
+    {
+        if (iter->second.getString(0) == "on")
+            bTopdownEgocentric = true;
+        else if (iter->second.getString(0) != "off")
+            return false;
+    }
+
+    m_pSimulator->setRenderer(sessionRenderer);
+    m_pSimulator->setTiming(timing);
+    m_pSimulator->setTopDownOptions(topdownSource, bTopdownEgocentric);
+
+    // The frames are only rendered once the client retrieved the view of the
+    // avatar (the clients only using the 'state' view never render anything)
+    m_bAvatarViewUsed = false;
+    m_pSimulator->setOnDemandRendering(true);
 
-    // Create the simulator
-    m_pSimulator = new Simulator();
-    m_pSimulator->init(false, "", "", SimulationServer::bEnableSecrets);
     m_pSimulator->setup(goal, environment, m_globalSeed);
 
     return true;
@@ -164,6 +294,38 @@ bool SimulationServer::resetTask()
 unsigned char* SimulationServer::getView(const std::string& view, size_t &nbBytes,
                                          std::string &mimetype)
 {
+    if (view == "state")
+    {
+        mimetype = STATE_MIMETYPE;
+        nbBytes = STATE_SIZE * sizeof(float);
+
+        float state[STATE_SIZE];
+        if (!m_pSimulator->getStateInto(state))
+            return 0;
+
+        // Our caller releases the memory with delete[] on an unsigned char*
+        unsigned char* pState = new unsigned char[nbBytes];
+        memcpy(pState, state, nbBytes);
+
+        return pState;
+    }
+    else if (view == "topdown")
+    {
+        mimetype = "raw";
+        nbBytes = TOPDOWN_SIZE * TOPDOWN_SIZE * 3;
+
+        unsigned char* pImage = new unsigned char[nbBytes];
+        if (!m_pSimulator->getTopDownViewInto(pImage))
+        {
+            delete[] pImage;
+            return 0;
+        }
+
+        return pImage;
+    }
+
+    useAvatarView();
+
     mimetype = "raw";
 
     // Retrieve the image of the view
@@ -180,6 +342,48 @@ unsigned char* SimulationServer::getView(const std::string& view, size_t &nbByte
 }
 
 
+bool SimulationServer::getViewInto(const std::string& view, unsigned char* pBuffer,
+                                   size_t maxNbBytes, size_t &nbBytes,
+                                   std::string &mimetype)
+{
+    if (view == "state")
+    {
+        mimetype = STATE_MIMETYPE;
+        nbBytes = STATE_SIZE * sizeof(float);
+
+        if (nbBytes > maxNbBytes)
+            return false;
+
+        float state[STATE_SIZE];
+        if (!m_pSimulator->getStateInto(state))
+            return false;
+
+        memcpy(pBuffer, state, nbBytes);
+        return true;
+    }
+    else if (view == "topdown")
+    {
+        mimetype = "raw";
+        nbBytes = TOPDOWN_SIZE * TOPDOWN_SIZE * 3;
+
+        if (nbBytes > maxNbBytes)
+            return false;
+
+        return m_pSimulator->getTopDownViewInto(pBuffer);
+    }
+
+    mimetype = "raw";
+    nbBytes = VIEW_WIDTH * VIEW_HEIGHT * 3;
+
+    if (nbBytes > maxNbBytes)
+        return false;
+
+    useAvatarView();
+
+    return m_pSimulator->getAvatarViewInto(pBuffer);
+}
+
+
 bool SimulationServer::performAction(const std::string& action, float &reward,
                                      bool &finished, bool &failed,
                                      std::string &event)
@@ -246,7 +450,31 @@ tStringList SimulationServer::notRecommendedActions()
 }
 
 
+void SimulationServer::useAvatarView()
+{
+    // The client uses the images: the frames are rendered as they are
+    // simulated from now on
+    if (!m_bAvatarViewUsed)
+    {
+        m_bAvatarViewUsed = true;
+        m_pSimulator->setOnDemandRendering(false);
+    }
+}
+
+
 void SimulationServer::onTimeout()
 {
     WindowEventUtilities::messagePump();
 }
+
+
+bool SimulationServer::onIdle()
+{
+    // Build the next episode while the client processes the responses, one
+    // stage at a time: a command arriving during the build only waits for
+    // the current stage, and RESET_TASK completes the remaining ones
+    if (SimulationServer::bPrebuildEpisodes && m_pSimulator)
+        return m_pSimulator->prepareNextEpisodeStage();
+
+    return false;
+}
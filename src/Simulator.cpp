@@ -32,8 +32,14 @@
 #include <Athena-Inputs/InputsUnit.h>
 #include <Athena/Tasks/TaskManager.h>
 #include <Athena/GameStates/GameStateManager.h>
+#include <mash-utils/statistics.h>
+#include <mash-utils/tracer.h>
 #include <Ogre/OgreException.h>
+#include <Ogre/OgreRoot.h>
 #include <Ogre/OgreWindowEventUtilities.h>
+#include <fstream>
+#include <sstream>
+#include <stdlib.h>
 
 #if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
 #   define WIN32_LEAN_AND_MEAN
@@ -45,19 +51,70 @@ using namespace Athena::Inputs;
 using namespace Athena::GameStates;
 using namespace Mash;
 
+using Ogre::Root;
 using Ogre::WindowEventUtilities;
 
 
+/********************************** FUNCTIONS *********************************/
+
+static bool readNumber(const std::string& strContent, size_t start,
+                       const std::string& strKey, double& value)
+{
+    size_t pos = strContent.find("\"" + strKey + "\"", start);
+    if (pos == std::string::npos)
+        return false;
+
+    pos = strContent.find(':', pos);
+    if (pos == std::string::npos)
+        return false;
+
+    value = strtod(strContent.c_str() + pos + 1, 0);
+
+    return true;
+}
+
+
+// Retrieve the limits of the physics world from the configuration file given to
+// Athena, which applies them to the whole process (the defaults are kept if
+// they aren't found)
+static void readPhysicsLimits(const std::string& strFileName, tPhysicsLimits& limits)
+{
+    std::ifstream file(strFileName.c_str());
+    if (!file.is_open())
+        return;
+
+    std::stringstream content;
+    content << file.rdbuf();
+
+    std::string strContent = content.str();
+
+    size_t section = strContent.find("\"physics\"");
+    if (section == std::string::npos)
+        return;
+
+    double value;
+
+    if (readNumber(strContent, section, "fixedTimeStep", value) && (value > 0.0))
+        limits.fixedTimeStep = (float) (value * 1000.0);
+
+    if (readNumber(strContent, section, "nbMaxSubSteps", value) && (value >= 1.0))
+        limits.nbMaxSubSteps = (unsigned int) value;
+}
+
+
 /***************************** CONSTRUCTION / DESTRUCTION ******************************/
 
 Simulator::Simulator()
-: m_pController(0), m_bGame(false), m_pServerState(0)
+: m_pController(0), m_bGame(false), m_pServerState(0), m_renderStart(0),
+  m_renderDuration(0), m_bOnDemandRendering(false)
 {
 }
 
 
 Simulator::~Simulator()
 {
+    if (m_pServerState && Root::getSingletonPtr())
+        Root::getSingletonPtr()->removeFrameListener(this);
 }
 
 
@@ -102,6 +159,7 @@ bool Simulator::init(bool bGame, const std::string& goal, const std::string& env
 
             // Initialize Athena
             m_engine.setup(std::string("athena.cfg"));
+            readPhysicsLimits("athena.cfg", m_physicsLimits);
 
             // Create the main window
             m_engine.createRenderWindow("MainWindow", "MASH Simulator", VIEW_WIDTH, VIEW_HEIGHT, false);
@@ -146,6 +204,7 @@ bool Simulator::init(bool bGame, const std::string& goal, const std::string& env
         {
             // Initialize Athena
             m_engine.setup(std::string("athena.cfg"));
+            readPhysicsLimits("athena.cfg", m_physicsLimits);
 
             // Create the main window
             m_engine.createRenderWindow("MainWindow", "MASH Simulator", VIEW_WIDTH, VIEW_HEIGHT, false);
@@ -157,6 +216,8 @@ bool Simulator::init(bool bGame, const std::string& goal, const std::string& env
 
             pGameStateManager->registerState(STATE_SERVER, m_pServerState);
             pGameStateManager->pushState(STATE_SERVER);
+
+            Root::getSingletonPtr()->addFrameListener(this);
         }
     }
     catch (Ogre::Exception& e)
@@ -318,15 +379,25 @@ void Simulator::setup(const std::string& goal, const std::string& environment,
 
     m_pServerState->setup(goal, environment, globalSeed);
 
+    // The avatar starts on the floor, so the goal is usually initialized after
+    // one step. The frames aren't rendered: the view is only rendered if it is
+    // retrieved.
+    m_pServerState->enableRendering(false);
+
     try
     {
          while (!m_pServerState->getGoal()->isInitialized())
-             m_engine.getTaskManager()->step(1e5);
+         {
+             ScopedTrace trace("TaskManager::step");
+             m_engine.getTaskManager()->step(m_timing.stepDuration * 1000);
+         }
     }
     catch (Ogre::Exception& e)
     {
          std::cerr << "An exception has occured: " << e.getFullDescription().c_str() << std::endl;
     }
+
+    m_pServerState->enableRendering(!m_bOnDemandRendering);
 }
 
 
@@ -334,13 +405,23 @@ tResult Simulator::performAction(tAction action, float &fReward, std::string &st
 {
     assert(m_pServerState);
 
-    if (!m_pServerState->performAction(action, 100.0))
+    if (!m_pServerState->performAction(action, m_timing.actionDuration))
     {
         fReward = -1000.0f;
         return m_pServerState->result();
     }
 
-    if (!stepOneFrame())
+    // Simulate the action, stopping as soon as the episode is finished
+    for (unsigned int i = 1; i < m_timing.nbSteps; ++i)
+    {
+        if (!stepOneFrame(!m_timing.bFastForward))
+            return RESULT_NONE;
+
+        if (m_pServerState->result() != RESULT_NONE)
+            break;
+    }
+
+    if ((m_pServerState->result() == RESULT_NONE) && !stepOneFrame())
         return RESULT_NONE;
 
     fReward = m_pServerState->getLastReward();
@@ -358,6 +439,14 @@ unsigned char* Simulator::getAvatarView(size_t &nbBytes)
 }
 
 
+bool Simulator::getAvatarViewInto(unsigned char* pBuffer)
+{
+    assert(m_pServerState);
+
+    return m_pServerState->getAvatarViewInto(pBuffer);
+}
+
+
 tAction Simulator::getTeacherAction()
 {
     assert(m_pServerState);
@@ -374,12 +463,46 @@ tActionsList Simulator::getNotRecommendedActions()
 }
 
 
-bool Simulator::stepOneFrame()
+bool Simulator::stepOneFrame(bool bRender)
 {
+    static LatencyHistogram& frameHistogram = Statistics::histogram("phase.frame");
+    static LatencyHistogram& physicsHistogram = Statistics::histogram("phase.physics");
+
+    ScopedTrace trace("Simulator::stepOneFrame");
+
     try
     {
+        unsigned long long start = (Statistics::enabled ? Statistics::now() : 0);
+
         WindowEventUtilities::messagePump();
-        m_engine.getTaskManager()->step(1e5);
+
+        m_renderDuration = 0;
+
+        // With on-demand rendering, the frames are never rendered here
+        bool bSkipRendering = !bRender && !m_bOnDemandRendering;
+
+        if (bSkipRendering)
+            m_pServerState->enableRendering(false);
+
+        {
+            ScopedTrace trace2("TaskManager::step");
+            m_engine.getTaskManager()->step(m_timing.stepDuration * 1000);
+        }
+
+        if (bSkipRendering)
+            m_pServerState->enableRendering(true);
+
+        if (Statistics::enabled)
+        {
+            unsigned long long duration = Statistics::now() - start;
+            frameHistogram.record(duration);
+
+            // The physics simulation isn't directly observable: it accounts
+            // for what remains once the rendering and the processing of the
+            // state are removed
+            unsigned long long others = m_renderDuration + m_pServerState->getLastProcessDuration();
+            physicsHistogram.record(duration > others ? duration - others : 0);
+        }
     }
     catch (Ogre::Exception& e)
     {
@@ -389,3 +512,34 @@ bool Simulator::stepOneFrame()
 
     return true;
 }
+
+
+/**************************** IMPLEMENTATION OF FrameListener **************************/
+
+bool Simulator::frameStarted(const Ogre::FrameEvent& evt)
+{
+    if (Statistics::enabled || Tracer::isEnabled())
+        m_renderStart = Statistics::now();
+
+    return true;
+}
+
+
+bool Simulator::frameEnded(const Ogre::FrameEvent& evt)
+{
+    static LatencyHistogram& histogram = Statistics::histogram("phase.render");
+
+    if (m_renderStart > 0)
+    {
+        m_renderDuration = Statistics::now() - m_renderStart;
+
+        if (Statistics::enabled)
+            histogram.record(m_renderDuration);
+
+        Tracer::record("render", m_renderStart, m_renderDuration);
+
+        m_renderStart = 0;
+    }
+
+    return true;
+}
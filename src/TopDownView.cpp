@@ -0,0 +1,166 @@
+/*******************************************************************************
+* MASH 3D simulator
+* 
+* Copyright (c) 2014 Idiap Research Institute, http://www.idiap.ch/
+* Written by Philip Abbet <philip.abbet@idiap.ch>
+* 
+* This file is part of mash-simulator.
+* 
+* mash-simulator is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 3 as
+* published by the Free Software Foundation.
+* 
+* mash-simulator is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+* 
+* You should have received a copy of the GNU General Public License
+* along with mash-simulator. If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+
+#include <TopDownView.h>
+#include <mash-utils/tracer.h>
+#include <string.h>
+#include <assert.h>
+
+
+/***************************** CONSTRUCTION / DESTRUCTION ******************************/
+
+TopDownView::TopDownView()
+: m_pMap(0), m_pTeacher(0), m_source(TOPDOWN_MAP), m_bEgocentric(false),
+  m_nbKnownMapChanges(0), m_nbKnownTeacherChanges(0)
+{
+}
+
+
+TopDownView::~TopDownView()
+{
+}
+
+
+/************************************** METHODS ****************************************/
+
+void TopDownView::setMap(Map* pMap, Teacher* pTeacher)
+{
+    m_pMap     = pMap;
+    m_pTeacher = pTeacher;
+
+    m_image.clear();
+    m_nbKnownMapChanges     = 0;
+    m_nbKnownTeacherChanges = 0;
+
+    if (!m_pMap)
+        return;
+
+    m_image.resize(m_pMap->width * m_pMap->height * 3);
+
+    for (unsigned int i = 0; i < m_pMap->grid.size(); ++i)
+        drawCell(i);
+
+    m_nbKnownMapChanges = m_pMap->changed_cells.size();
+
+    if (m_pTeacher)
+        m_nbKnownTeacherChanges = m_pTeacher->getChangedCells().size();
+}
+
+
+void TopDownView::setSource(tTopDownSource source)
+{
+    m_source = source;
+
+    // Redraw the whole image
+    if (m_pMap)
+        setMap(m_pMap, m_pTeacher);
+}
+
+
+void TopDownView::render(int x, int y, unsigned char* pBuffer)
+{
+    // Assertions
+    assert(m_pMap);
+
+    Mash::ScopedTrace trace("TopDownView::render");
+
+    update();
+
+    const unsigned int width  = m_pMap->width;
+    const unsigned int height = m_pMap->height;
+
+    Map::tColor background = Map::COLORS[CELL_UNREACHEABLE];
+    Map::tColor robot = Map::COLORS[CELL_ROBOT];
+
+    unsigned char* pDst = pBuffer;
+
+    for (unsigned int j = 0; j < TOPDOWN_SIZE; ++j)
+    {
+        for (unsigned int i = 0; i < TOPDOWN_SIZE; ++i)
+        {
+            int cx, cy;
+
+            if (m_bEgocentric)
+            {
+                cx = x - (int) TOPDOWN_SIZE / 2 + (int) i;
+                cy = y - (int) TOPDOWN_SIZE / 2 + (int) j;
+            }
+            else
+            {
+                cx = i * width / TOPDOWN_SIZE;
+                cy = j * height / TOPDOWN_SIZE;
+            }
+
+            if ((cx < 0) || (cx >= (int) width) || (cy < 0) || (cy >= (int) height))
+            {
+                pDst[0] = background.r;
+                pDst[1] = background.g;
+                pDst[2] = background.b;
+            }
+            else if ((cx == x) && (cy == y))
+            {
+                pDst[0] = robot.r;
+                pDst[1] = robot.g;
+                pDst[2] = robot.b;
+            }
+            else
+            {
+                memcpy(pDst, &m_image[(cy * width + cx) * 3], 3);
+            }
+
+            pDst += 3;
+        }
+    }
+}
+
+
+void TopDownView::update()
+{
+    const std::vector<unsigned int>& mapChanges = m_pMap->changed_cells;
+
+    for (; m_nbKnownMapChanges < mapChanges.size(); ++m_nbKnownMapChanges)
+        drawCell(mapChanges[m_nbKnownMapChanges]);
+
+    if (m_pTeacher)
+    {
+        const std::vector<unsigned int>& teacherChanges = m_pTeacher->getChangedCells();
+
+        for (; m_nbKnownTeacherChanges < teacherChanges.size(); ++m_nbKnownTeacherChanges)
+            drawCell(teacherChanges[m_nbKnownTeacherChanges]);
+    }
+}
+
+
+void TopDownView::drawCell(unsigned int index)
+{
+    tCellType type = m_pMap->grid.type(index);
+
+    if ((m_source == TOPDOWN_TEACHER) && m_pTeacher && !m_pTeacher->isExplored(index))
+        type = CELL_UNKNOWN;
+
+    Map::tColor color = Map::COLORS[type];
+
+    unsigned char* pDst = &m_image[index * 3];
+    pDst[0] = color.r;
+    pDst[1] = color.g;
+    pDst[2] = color.b;
+}
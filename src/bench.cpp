@@ -0,0 +1,774 @@
+/*******************************************************************************
+* MASH 3D simulator
+* 
+* Copyright (c) 2014 Idiap Research Institute, http://www.idiap.ch/
+* Written by Philip Abbet <philip.abbet@idiap.ch>
+* 
+* This file is part of mash-simulator.
+* 
+* mash-simulator is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 3 as
+* published by the Free Software Foundation.
+* 
+* mash-simulator is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+* 
+* You should have received a copy of the GNU General Public License
+* along with mash-simulator. If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+
+#include <Simulator.h>
+#include <Declarations.h>
+#include <mash-utils/stringutils.h>
+#include <mash-utils/statistics.h>
+#include <mash-utils/latency_histogram.h>
+#include <mash-utils/random_number_generator.h>
+#include <SimpleOpt.h>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <stdlib.h>
+#include <math.h>
+
+using namespace Mash;
+using namespace std;
+
+
+/**************************** COMMAND-LINE PARSING ****************************/
+
+enum tOptions
+{
+    OPT_GOAL,
+    OPT_ENVIRONMENT,
+    OPT_EPISODES,
+    OPT_STEPS,
+    OPT_POLICY,
+    OPT_SEED,
+    OPT_VIEW_SIZE,
+    OPT_NO_VIEW,
+    OPT_SECRET,
+    OPT_ASYNC_TEACHER,
+    OPT_PREBUILD,
+    OPT_LAYOUTS,
+    OPT_RENDERER,
+    OPT_RENDER_DIFF,
+    OPT_ACTION_DURATION,
+    OPT_PHYSICS_STEPS,
+    OPT_TIMESTEP,
+    OPT_FAST_FORWARD,
+    OPT_REFERENCE,
+    OPT_OUTPUT,
+    OPT_HELP,
+};
+
+CSimpleOpt::SOption COMMAND_LINE_OPTIONS[] =
+{
+    { OPT_GOAL,             "--goal",        SO_REQ_CMB },
+    { OPT_ENVIRONMENT,      "--environment", SO_REQ_CMB },
+    { OPT_EPISODES,         "--episodes",    SO_REQ_CMB },
+    { OPT_STEPS,            "--steps",       SO_REQ_CMB },
+    { OPT_POLICY,           "--policy",      SO_REQ_CMB },
+    { OPT_SEED,             "--seed",        SO_REQ_CMB },
+    { OPT_VIEW_SIZE,        "--viewsize",    SO_REQ_CMB },
+    { OPT_NO_VIEW,          "--noview",      SO_NONE    },
+    { OPT_SECRET,           "--secret",      SO_NONE    },
+    { OPT_ASYNC_TEACHER,    "--asyncteacher", SO_NONE   },
+    { OPT_PREBUILD,         "--prebuild",    SO_NONE    },
+    { OPT_LAYOUTS,          "--layouts",     SO_REQ_CMB },
+    { OPT_RENDERER,         "--renderer",    SO_REQ_CMB },
+    { OPT_RENDER_DIFF,      "--renderdiff",  SO_NONE    },
+    { OPT_ACTION_DURATION,  "--actionduration", SO_REQ_CMB },
+    { OPT_PHYSICS_STEPS,    "--physicssteps", SO_REQ_CMB },
+    { OPT_TIMESTEP,         "--timestep",    SO_REQ_CMB },
+    { OPT_FAST_FORWARD,     "--fastforward", SO_NONE    },
+    { OPT_REFERENCE,        "--reference",   SO_REQ_CMB },
+    { OPT_OUTPUT,           "--output",      SO_REQ_CMB },
+    { OPT_HELP,             "--help",        SO_NONE    },
+    { OPT_HELP,             "-h",            SO_NONE    },
+
+    SO_END_OF_OPTIONS
+};
+
+
+/*********************************** TYPES ************************************/
+
+// Positions (x, z) of the avatar after each step of an episode
+typedef std::vector<float>          tTrajectory;
+typedef std::vector<tTrajectory>    tTrajectoriesList;
+
+
+struct tResults
+{
+    std::string         goal;
+    std::string         environment;
+    std::string         policy;
+    unsigned int        nbEpisodes;
+    unsigned int        nbSteps;
+    unsigned int        nbFinished;
+    unsigned int        nbFailed;
+    double              duration;           // Total duration of the steps, in seconds
+    double              stepsPerSecond;
+    double              framesPerSecond;
+    unsigned long long  taskInitLatency;    // In microseconds
+    LatencyHistogram    resetLatencies;
+    LatencyHistogram    stepLatencies;
+
+    // Comparison of the views of both renderers (--renderdiff)
+    unsigned long long  nbComparedPixels;
+    unsigned long long  nbDifferentPixels;  // At least one component differs by more than 32
+    double              totalDifference;    // Sum of the absolute differences of the components
+
+    // Comparison of the trajectories with the ones of a reference timing (--reference)
+    tTrajectoriesList   trajectories;
+    unsigned int        nbComparedPositions;
+    double              totalError;         // Sum of the distances to the reference positions, in meters
+    double              maxError;
+};
+
+
+/********************************** FUNCTIONS *********************************/
+
+void showUsage(const std::string& strApplicationName)
+{
+    cout << "MASH 3D Simulator - Benchmark" << endl
+         << "Usage: " << strApplicationName << " [options]" << endl
+         << endl
+         << "Run some episodes on each pair of goal and environment, and report the performances." << endl
+         << endl
+         << "Options:" << endl
+         << "    --help, -h:                   Display this help" << endl
+         << "    --goal=<goal>:                Only benchmark this goal" << endl
+         << "    --environment=<environment>:  Only benchmark this environment" << endl
+         << "    --episodes=<nb>:              Number of episodes per task (default: 3)" << endl
+         << "    --steps=<nb>:                 Maximum number of steps per episode (default: 200)" << endl
+         << "    --policy=<policy>:            'teacher' (the suggested actions, when available, random" << endl
+         << "                                  otherwise) or 'random' (default: teacher)" << endl
+         << "    --seed=<seed>:                Global seed (default: 0)" << endl
+         << "    --viewsize=<width>x<height>:  Size of the images (default: 320x240)" << endl
+         << "    --noview:                     Don't retrieve the view after each step" << endl
+         << "    --secret:                     Include the secret goals and environments" << endl
+         << "    --asyncteacher:               Update the teacher in a background thread while the frame" << endl
+         << "                                  is rendered" << endl
+         << "    --prebuild:                   Build the next episode at the end of each one (not measured," << endl
+         << "                                  like a client busy with the end of the episode)" << endl
+         << "    --layouts=<path>:             Folder containing the layouts precomputed by" << endl
+         << "                                  'mash-simulator-layouts'" << endl
+         << "    --renderer=<name>:            Renderer of the views: 'ogre' or 'raycast' (default: ogre)" << endl
+         << "    --renderdiff:                 Render each view with both renderers and report their" << endl
+         << "                                  differences (mean absolute difference of the components," << endl
+         << "                                  and percentage of pixels differing by more than 32)" << endl
+         << "    --actionduration=<ms>:        Duration of an action for the goals (default: 100)" << endl
+         << "    --physicssteps=<nb>:          Number of steps of the engine per action (default: 1)" << endl
+         << "    --timestep=<ms>:              Time elapsed during each step of the engine (default: 100)" << endl
+         << "    --fastforward:                Only render the last step of each action" << endl
+         << "    --reference=<nb>:             Also simulate each task with <nb> steps per action (not" << endl
+         << "                                  measured), and report the distance between the positions" << endl
+         << "                                  of the avatar in both simulations (mean and max, in cm)." << endl
+         << "                                  The random policy is used, so the actions are the same" << endl
+         << "                                  in both simulations. The steps of the reference must" << endl
+         << "                                  fit in the fixed steps of the physics world (see" << endl
+         << "                                  'athena.cfg', e.g. 6 steps for 100ms actions)" << endl
+         << "    --output=<path>:              Write the results in a JSON file" << endl
+         << endl;
+}
+
+
+tAction chooseAction(Simulator& simulator, bool bUseTeacher, RandomNumberGenerator& generator)
+{
+    if (bUseTeacher)
+    {
+        tAction action = simulator.getTeacherAction();
+        if (action != ACTIONS_COUNT)
+            return action;
+    }
+
+    return (tAction) generator.randomize(0u, (unsigned int) ACTIONS_COUNT - 1);
+}
+
+
+void compareViews(Simulator& simulator, const unsigned char* pOgreView,
+                  unsigned char* pRaycastView, tResults& results)
+{
+    if (!pOgreView || !simulator.getRaycastViewInto(pRaycastView))
+        return;
+
+    for (unsigned int i = 0; i < VIEW_WIDTH * VIEW_HEIGHT * 3; i += 3)
+    {
+        int maximum = 0;
+
+        for (unsigned int c = 0; c < 3; ++c)
+        {
+            int difference = abs((int) pOgreView[i + c] - (int) pRaycastView[i + c]);
+            results.totalDifference += difference;
+            maximum = std::max(maximum, difference);
+        }
+
+        if (maximum > 32)
+            ++results.nbDifferentPixels;
+    }
+
+    results.nbComparedPixels += VIEW_WIDTH * VIEW_HEIGHT;
+}
+
+
+void benchmarkTask(Simulator& simulator, const std::string& strGoal,
+                   const std::string& strEnvironment, const std::string& strPolicy,
+                   unsigned int nbEpisodes, unsigned int nbMaxSteps, unsigned int seed,
+                   bool bRetrieveView, bool bPrebuild, bool bRenderDiff, const tTiming& timing,
+                   tResults& results)
+{
+    // Declarations
+    RandomNumberGenerator generator;
+    unsigned long long start;
+    unsigned long long totalDuration = 0;
+    size_t nbBytes;
+    float reward;
+    string strEvent;
+
+    bool bUseTeacher = (strPolicy == "teacher") &&
+                       (simulator.capabilities(strGoal, strEnvironment) & IAS_CAP_SUGGESTED_ACTION);
+
+    generator.setSeed(seed);
+
+    results.goal            = strGoal;
+    results.environment     = strEnvironment;
+    results.policy          = (bUseTeacher ? "teacher" : "random");
+    results.nbEpisodes      = nbEpisodes;
+    results.nbSteps         = 0;
+    results.nbFinished      = 0;
+    results.nbFailed        = 0;
+    results.nbComparedPixels  = 0;
+    results.nbDifferentPixels = 0;
+    results.totalDifference   = 0.0;
+    results.nbComparedPositions = 0;
+    results.totalError          = 0.0;
+    results.maxError            = 0.0;
+
+    simulator.setTiming(timing);
+
+    unsigned char* pRaycastView = (bRenderDiff ? new unsigned char[VIEW_WIDTH * VIEW_HEIGHT * 3] : 0);
+
+    // Task initialization
+    start = Statistics::now();
+    simulator.setup(strGoal, strEnvironment, seed);
+    results.taskInitLatency = Statistics::now() - start;
+
+    // Only measure the frames of the episodes
+    Statistics::reset();
+
+    for (unsigned int episode = 0; episode < nbEpisodes; ++episode)
+    {
+        if (episode > 0)
+        {
+            start = Statistics::now();
+            simulator.restart();
+            results.resetLatencies.record(Statistics::now() - start);
+        }
+
+        results.trajectories.push_back(tTrajectory());
+        tTrajectory& trajectory = results.trajectories.back();
+
+        for (unsigned int step = 0; step < nbMaxSteps; ++step)
+        {
+            // The choice of the action is measured too, since it waits for the
+            // update of the teacher when it is done in the background
+            start = Statistics::now();
+
+            tAction action = chooseAction(simulator, bUseTeacher, generator);
+
+            tResult result = simulator.performAction(action, reward, strEvent);
+
+            if (bRetrieveView)
+                simulator.getAvatarView(nbBytes);
+
+            unsigned long long duration = Statistics::now() - start;
+
+            // Not measured
+            if (bRenderDiff)
+                compareViews(simulator, simulator.getAvatarView(nbBytes), pRaycastView, results);
+
+            results.stepLatencies.record(duration);
+            totalDuration += duration;
+            ++results.nbSteps;
+
+            Athena::Math::Vector3 position = simulator.getAvatarPosition();
+            trajectory.push_back(position.x);
+            trajectory.push_back(position.z);
+
+            if (result == RESULT_SUCCESS)
+            {
+                ++results.nbFinished;
+                break;
+            }
+            else if (result == RESULT_FAILED)
+            {
+                ++results.nbFailed;
+                break;
+            }
+        }
+
+        if (bPrebuild && (episode < nbEpisodes - 1))
+            simulator.prepareNextEpisode();
+    }
+
+    delete[] pRaycastView;
+
+    results.duration = totalDuration * 1e-6;
+    results.stepsPerSecond = (totalDuration > 0 ? results.nbSteps / results.duration : 0.0);
+
+    LatencyHistogram& frames = Statistics::histogram("phase.frame");
+    results.framesPerSecond = (frames.mean() > 0 ? 1e6 / frames.mean() : 0.0);
+}
+
+
+void compareTrajectories(const tResults& reference, tResults& results)
+{
+    for (unsigned int i = 0; i < results.trajectories.size(); ++i)
+    {
+        if (i >= reference.trajectories.size())
+            break;
+
+        const tTrajectory& trajectory = results.trajectories[i];
+        const tTrajectory& expected = reference.trajectories[i];
+
+        // The episodes can end at different steps
+        for (unsigned int j = 0; (j < trajectory.size()) && (j < expected.size()); j += 2)
+        {
+            float dx = trajectory[j] - expected[j];
+            float dz = trajectory[j + 1] - expected[j + 1];
+            double error = sqrt(dx * dx + dz * dz);
+
+            results.totalError += error;
+            results.maxError = std::max(results.maxError, error);
+            ++results.nbComparedPositions;
+        }
+    }
+}
+
+
+double meanError(const tResults& results)
+{
+    return (results.nbComparedPositions > 0 ? results.totalError / results.nbComparedPositions : 0.0);
+}
+
+
+double meanDifference(const tResults& results)
+{
+    return (results.nbComparedPixels > 0 ? results.totalDifference / (results.nbComparedPixels * 3) : 0.0);
+}
+
+
+double differentPixelsPercentage(const tResults& results)
+{
+    return (results.nbComparedPixels > 0 ? 100.0 * results.nbDifferentPixels / results.nbComparedPixels : 0.0);
+}
+
+
+void printResults(const tResults& results, bool bRenderDiff, bool bAccuracy)
+{
+    cout << setw(24) << left << results.goal << " "
+         << setw(18) << left << results.environment << " "
+         << setw(8) << left << results.policy << " "
+         << setw(8) << right << fixed << setprecision(1) << results.stepsPerSecond << " "
+         << setw(8) << right << results.framesPerSecond << " "
+         << setw(9) << right << results.taskInitLatency / 1000 << " "
+         << setw(9) << right << results.resetLatencies.percentile(50.0) / 1000 << " "
+         << setw(9) << right << results.stepLatencies.percentile(50.0) << " "
+         << setw(9) << right << results.stepLatencies.percentile(99.0);
+
+    if (bRenderDiff)
+    {
+        cout << " " << setw(6) << right << setprecision(1) << meanDifference(results)
+             << " " << setw(7) << right << differentPixelsPercentage(results);
+    }
+
+    if (bAccuracy)
+    {
+        cout << " " << setw(8) << right << setprecision(2) << meanError(results) * 100.0
+             << " " << setw(8) << right << results.maxError * 100.0;
+    }
+
+    cout << endl;
+}
+
+
+void writeHistogram(std::ostream& stream, const std::string& strName,
+                    const LatencyHistogram& histogram)
+{
+    stream << "\"" << strName << "\": {"
+           << "\"count\": " << histogram.count() << ", "
+           << "\"mean\": " << histogram.mean() << ", "
+           << "\"p50\": " << histogram.percentile(50.0) << ", "
+           << "\"p99\": " << histogram.percentile(99.0) << ", "
+           << "\"max\": " << histogram.max() << "}";
+}
+
+
+bool writeJSON(const std::string& strFileName, const std::vector<tResults*>& results,
+               unsigned long long engineInitLatency, unsigned int seed,
+               unsigned int nbEpisodes, unsigned int nbMaxSteps, bool bRetrieveView,
+               bool bAsyncTeacher, bool bPrebuild, const std::string& strLayouts,
+               const std::string& strRenderer, bool bRenderDiff, const tTiming& timing,
+               unsigned int nbReferenceSteps)
+{
+    ofstream file(strFileName.c_str());
+    if (!file.is_open())
+        return false;
+
+    file << "{" << endl
+         << "  \"view\": \"" << VIEW_WIDTH << "x" << VIEW_HEIGHT << "\"," << endl
+         << "  \"retrieve_view\": " << (bRetrieveView ? "true" : "false") << "," << endl
+         << "  \"async_teacher\": " << (bAsyncTeacher ? "true" : "false") << "," << endl
+         << "  \"prebuild\": " << (bPrebuild ? "true" : "false") << "," << endl
+         << "  \"layouts\": \"" << strLayouts << "\"," << endl
+         << "  \"renderer\": \"" << strRenderer << "\"," << endl
+         << "  \"action_duration_ms\": " << timing.actionDuration << "," << endl
+         << "  \"physics_steps\": " << timing.nbSteps << "," << endl
+         << "  \"timestep_ms\": " << timing.stepDuration << "," << endl
+         << "  \"fast_forward\": " << (timing.bFastForward ? "true" : "false") << "," << endl
+         << "  \"reference_steps\": " << nbReferenceSteps << "," << endl
+         << "  \"seed\": " << seed << "," << endl
+         << "  \"episodes\": " << nbEpisodes << "," << endl
+         << "  \"max_steps\": " << nbMaxSteps << "," << endl
+         << "  \"engine_init_us\": " << engineInitLatency << "," << endl
+         << "  \"tasks\": [" << endl;
+
+    for (unsigned int i = 0; i < results.size(); ++i)
+    {
+        const tResults* pResults = results[i];
+
+        file << "    {"
+             << "\"goal\": \"" << pResults->goal << "\", "
+             << "\"environment\": \"" << pResults->environment << "\", "
+             << "\"policy\": \"" << pResults->policy << "\", "
+             << "\"steps\": " << pResults->nbSteps << ", "
+             << "\"finished\": " << pResults->nbFinished << ", "
+             << "\"failed\": " << pResults->nbFailed << ", "
+             << "\"steps_per_sec\": " << fixed << setprecision(2) << pResults->stepsPerSecond << ", "
+             << "\"frames_per_sec\": " << pResults->framesPerSecond << ", "
+             << "\"task_init_us\": " << pResults->taskInitLatency << ", ";
+
+        writeHistogram(file, "reset_us", pResults->resetLatencies);
+        file << ", ";
+        writeHistogram(file, "step_us", pResults->stepLatencies);
+
+        if (bRenderDiff)
+        {
+            file << ", \"render_diff\": {"
+                 << "\"mean\": " << meanDifference(*pResults) << ", "
+                 << "\"pixels_over_32_pct\": " << differentPixelsPercentage(*pResults) << "}";
+        }
+
+        if (nbReferenceSteps > 0)
+        {
+            file << ", \"position_error_cm\": {"
+                 << "\"count\": " << pResults->nbComparedPositions << ", "
+                 << "\"mean\": " << meanError(*pResults) * 100.0 << ", "
+                 << "\"max\": " << pResults->maxError * 100.0 << "}";
+        }
+
+        file << "}" << (i < results.size() - 1 ? "," : "") << endl;
+    }
+
+    file << "  ]" << endl
+         << "}" << endl;
+
+    return true;
+}
+
+
+int main(int argc, char** argv)
+{
+    // Declarations
+    bool            bRetrieveView   = true;
+    bool            bSecret         = false;
+    bool            bAsyncTeacher   = false;
+    bool            bPrebuild       = false;
+    string          strLayouts      = "";
+    string          strRenderer     = "ogre";
+    tRenderer       renderer        = RENDERER_OGRE;
+    bool            bRenderDiff     = false;
+    tTiming         timing;
+    unsigned int    nbReferenceSteps = 0;
+    string          strGoal         = "";
+    string          strEnvironment  = "";
+    string          strPolicy       = "teacher";
+    string          strOutput       = "";
+    unsigned int    nbEpisodes      = 3;
+    unsigned int    nbMaxSteps      = 200;
+    unsigned int    seed            = 0;
+    unsigned int    width           = VIEW_WIDTH;
+    unsigned int    height          = VIEW_HEIGHT;
+
+    // Parse the command-line arguments
+    CSimpleOpt args(argc, argv, COMMAND_LINE_OPTIONS);
+    while (args.Next())
+    {
+        if (args.LastError() == SO_SUCCESS)
+        {
+            switch (args.OptionId())
+            {
+                case OPT_HELP:
+                    showUsage(argv[0]);
+                    return 0;
+
+                case OPT_GOAL:
+                    strGoal = args.OptionArg();
+                    break;
+
+                case OPT_ENVIRONMENT:
+                    strEnvironment = args.OptionArg();
+                    break;
+
+                case OPT_EPISODES:
+                    nbEpisodes = StringUtils::parseUnsignedInt(args.OptionArg());
+                    break;
+
+                case OPT_STEPS:
+                    nbMaxSteps = StringUtils::parseUnsignedInt(args.OptionArg());
+                    break;
+
+                case OPT_POLICY:
+                    strPolicy = args.OptionArg();
+                    if ((strPolicy != "teacher") && (strPolicy != "random"))
+                    {
+                        cerr << "Unknown policy: " << strPolicy << endl;
+                        return -1;
+                    }
+                    break;
+
+                case OPT_SEED:
+                    seed = StringUtils::parseUnsignedInt(args.OptionArg());
+                    break;
+
+                case OPT_VIEW_SIZE:
+                {
+                    tStringList parts = StringUtils::split(args.OptionArg(), "x");
+                    if ((parts.size() == 2) && !parts[0].empty() && !parts[1].empty())
+                    {
+                        width  = StringUtils::parseUnsignedInt(parts[0]);
+                        height = StringUtils::parseUnsignedInt(parts[1]);
+                    }
+                    break;
+                }
+
+                case OPT_NO_VIEW:
+                    bRetrieveView = false;
+                    break;
+
+                case OPT_SECRET:
+                    bSecret = true;
+                    break;
+
+                case OPT_ASYNC_TEACHER:
+                    bAsyncTeacher = true;
+                    break;
+
+                case OPT_PREBUILD:
+                    bPrebuild = true;
+                    break;
+
+                case OPT_LAYOUTS:
+                    strLayouts = args.OptionArg();
+                    break;
+
+                case OPT_RENDERER:
+                    strRenderer = args.OptionArg();
+                    if (!parseRenderer(strRenderer, renderer))
+                    {
+                        cerr << "Unknown renderer: " << strRenderer << endl;
+                        return -1;
+                    }
+                    break;
+
+                case OPT_RENDER_DIFF:
+                    bRenderDiff = true;
+                    break;
+
+                case OPT_ACTION_DURATION:
+                    timing.actionDuration = StringUtils::parseFloat(args.OptionArg());
+                    break;
+
+                case OPT_PHYSICS_STEPS:
+                    timing.nbSteps = StringUtils::parseUnsignedInt(args.OptionArg());
+                    break;
+
+                case OPT_TIMESTEP:
+                    timing.stepDuration = StringUtils::parseFloat(args.OptionArg());
+                    break;
+
+                case OPT_FAST_FORWARD:
+                    timing.bFastForward = true;
+                    break;
+
+                case OPT_REFERENCE:
+                    nbReferenceSteps = StringUtils::parseUnsignedInt(args.OptionArg());
+                    break;
+
+                case OPT_OUTPUT:
+                    strOutput = args.OptionArg();
+                    break;
+            }
+        }
+        else
+        {
+            cerr << "Invalid argument: " << args.OptionText() << endl;
+            return -1;
+        }
+    }
+
+
+    if ((timing.actionDuration <= 0.0f) || (timing.nbSteps == 0) || (timing.stepDuration <= 0.0f))
+    {
+        cerr << "Invalid timing" << endl;
+        return -1;
+    }
+
+    // The actions must be the same in both simulations
+    if (nbReferenceSteps > 0)
+        strPolicy = "random";
+
+    // The reference simulates the same actions with more (shorter) steps
+    tTiming referenceTiming;
+    referenceTiming.actionDuration = timing.actionDuration;
+    referenceTiming.nbSteps        = std::max(nbReferenceSteps, 1u);
+    referenceTiming.stepDuration   = timing.actionDuration / referenceTiming.nbSteps;
+    referenceTiming.bFastForward   = true;
+
+    setResolution(width, height);
+
+    // The views of Ogre are needed for the comparison
+    if (bRenderDiff)
+    {
+        renderer    = RENDERER_OGRE;
+        strRenderer = "ogre";
+    }
+
+
+    // Initialization of the simulator (done once for all the tasks)
+    Simulator simulator;
+
+    unsigned long long start = Statistics::now();
+
+    if (!simulator.init(false, "", "", bSecret))
+    {
+        cerr << "Failed to initialize the simulator" << endl;
+        return -1;
+    }
+
+    unsigned long long engineInitLatency = Statistics::now() - start;
+
+    // The limits of the physics world are only known once Athena is set up
+    const tPhysicsLimits& physicsLimits = simulator.getPhysicsLimits();
+
+    // Inexact timings are allowed here, to measure how far they drift (see
+    // --reference), but the server and the library reject them
+    if (!timing.isExact(physicsLimits))
+    {
+        cerr << "WARNING - The physics doesn't simulate the whole duration of the actions (the steps"
+             << " must last at most " << physicsLimits.maxStepDuration()
+             << "ms and add up to " << timing.actionDuration << "ms)" << endl;
+    }
+
+    if ((nbReferenceSteps > 0) && !referenceTiming.isExact(physicsLimits))
+    {
+        cerr << "Invalid reference: the steps of " << referenceTiming.stepDuration
+             << "ms are longer than the ones of the physics world (" << physicsLimits.maxStepDuration()
+             << "ms)" << endl;
+        return -1;
+    }
+
+    simulator.setAsyncTeacher(bAsyncTeacher);
+    simulator.setLayoutsFolder(strLayouts);
+    simulator.setRenderer(renderer);
+
+    cout << "********************************************************************************" << endl
+         << "* MASH 3D Simulator - Benchmark" << endl
+         << "********************************************************************************" << endl
+         << endl
+         << "Engine initialization: " << engineInitLatency / 1000 << " ms" << endl
+         << endl
+         << setw(24) << left << "Goal" << " "
+         << setw(18) << left << "Environment" << " "
+         << setw(8) << left << "Policy" << " "
+         << setw(8) << right << "Steps/s" << " "
+         << setw(8) << right << "Frames/s" << " "
+         << setw(9) << right << "Init(ms)" << " "
+         << setw(9) << right << "Reset(ms)" << " "
+         << setw(9) << right << "p50(us)" << " "
+         << setw(9) << right << "p99(us)";
+
+    if (bRenderDiff)
+        cout << " " << setw(6) << right << "Diff" << " " << setw(7) << right << "Diff>32";
+
+    if (nbReferenceSteps > 0)
+        cout << " " << setw(8) << right << "Err(cm)" << " " << setw(8) << right << "Max(cm)";
+
+    cout << endl;
+
+    // Benchmark each task
+    std::vector<tResults*> results;
+
+    tStringList goals = simulator.getGoals();
+    tStringIterator iter, iterEnd;
+    for (iter = goals.begin(), iterEnd = goals.end(); iter != iterEnd; ++iter)
+    {
+        if ((!strGoal.empty() && (*iter != strGoal)) || (!bSecret && simulator.isGoalSecret(*iter)))
+            continue;
+
+        tStringList environments = simulator.getEnvironments(*iter);
+        tStringIterator iter2, iterEnd2;
+        for (iter2 = environments.begin(), iterEnd2 = environments.end(); iter2 != iterEnd2; ++iter2)
+        {
+            if ((!strEnvironment.empty() && (*iter2 != strEnvironment)) ||
+                (!bSecret && simulator.isEnvironmentSecret(*iter2)))
+            {
+                continue;
+            }
+
+            tResults* pResults = new tResults();
+
+            benchmarkTask(simulator, *iter, *iter2, strPolicy, nbEpisodes, nbMaxSteps,
+                          seed, bRetrieveView, bPrebuild, bRenderDiff, timing, *pResults);
+
+            if (nbReferenceSteps > 0)
+            {
+                tResults reference;
+
+                benchmarkTask(simulator, *iter, *iter2, strPolicy, nbEpisodes, nbMaxSteps,
+                              seed, false, bPrebuild, false, referenceTiming, reference);
+
+                compareTrajectories(reference, *pResults);
+            }
+
+            printResults(*pResults, bRenderDiff, (nbReferenceSteps > 0));
+
+            results.push_back(pResults);
+        }
+    }
+
+    simulator.reset();
+
+    bool bResult = true;
+
+    if (!strOutput.empty())
+    {
+        bResult = writeJSON(strOutput, results, engineInitLatency, seed, nbEpisodes,
+                            nbMaxSteps, bRetrieveView, bAsyncTeacher, bPrebuild,
+                            strLayouts, strRenderer, bRenderDiff, timing,
+                            nbReferenceSteps);
+
+        if (!bResult)
+            cerr << "Failed to write the results in '" << strOutput << "'" << endl;
+    }
+
+    for (unsigned int i = 0; i < results.size(); ++i)
+        delete results[i];
+
+    return (bResult ? 0 : -1);
+}
@@ -27,6 +27,7 @@
 #include <Athena-Physics/Body.h>
 #include <Athena-Physics/World.h>
 #include <Athena-Physics/GhostObject.h>
+#include <algorithm>
 
 
 using namespace Athena;
@@ -35,6 +36,29 @@ using namespace Athena::Physics;
 using namespace Athena::Math;
 
 
+// Maximum distance between the feet of the avatar and the ground
+static const float GROUND_TOLERANCE = 0.05f;
+
+
+//-----------------------------------------------------------------------------
+/// @brief  Ray callback only considering the static objects the avatar can
+///         stand on (so not the avatar itself nor the triggers)
+//-----------------------------------------------------------------------------
+struct GroundRayResultCallback: public btCollisionWorld::ClosestRayResultCallback
+{
+    GroundRayResultCallback(const btVector3& from, const btVector3& to)
+    : btCollisionWorld::ClosestRayResultCallback(from, to)
+    {
+    }
+
+    virtual bool needsCollision(btBroadphaseProxy* proxy) const
+    {
+        const btCollisionObject* pObject = (const btCollisionObject*) proxy->m_clientObject;
+        return pObject->isStaticObject() && pObject->hasContactResponse();
+    }
+};
+
+
 /***************************** CONSTRUCTION / DESTRUCTION ******************************/
 
 Goal::Goal()
@@ -66,17 +90,31 @@ void Goal::finalize(Map* pMap)
     m_pAvatar        = m_pMap->pScene->getEntity("Avatar");
     m_pAvatarGhost   = GhostObject::cast(m_pAvatar->getComponent(tComponentID(COMP_PHYSICAL, m_pAvatar->getName(), "Ghost")));
     m_pAvatarBody    = Body::cast(m_pAvatar->getComponent(tComponentID(COMP_PHYSICAL, m_pAvatar->getName(), "Body")));
+
+    // Index the targets by entity, so the trigger touched by the avatar can be
+    // mapped to its target without scanning the list
+    tTargetsIterator iter(m_pMap->targets.begin(), m_pMap->targets.end());
+    while (iter.hasMoreElements())
+    {
+        tTarget* pTarget = iter.peekNextPtr();
+        m_targetsIndex[pTarget->pEntity] = pTarget;
+        iter.moveNext();
+    }
 }
 
 
 tResult Goal::process(float &reward, Teacher* pTeacher)
 {
     // Initialisations
-    m_bFalling = true;
     reward = 0.0f;
     tResult result = RESULT_NONE;
     tContactsList currentContacts;
 
+    currentContacts.reserve(m_pAvatarGhost->getNbOverlappingObjects());
+
+    // Determine if we are falling
+    m_bFalling = !isAvatarOnGround();
+
     // Retrieve the contact points
     for (unsigned int i = 0; i < m_pAvatarGhost->getNbOverlappingObjects(); ++i)
     {
@@ -86,46 +124,12 @@ tResult Goal::process(float &reward, Teacher* pTeacher)
         if (pComponent == m_pAvatarBody)
             continue;
 
-        // Determine if we are falling (if we don't know yet)
-        if (m_bFalling)
-        {
-            Physics::World::tContactPointsList contacts;
-            bool bGhostIsA = m_pPhysicalWorld->getContacts(m_pAvatarGhost, pComponent, contacts);
-
-            for (int j = 0; j < contacts.size(); ++j)
-            {
-                const btManifoldPoint& pt = contacts[j];
-                const btVector3& point = (bGhostIsA ? pt.getPositionWorldOnA() : pt.getPositionWorldOnB());
-
-                const Vector3& offset = fromBullet(point) - m_pAvatarBody->getTransforms()->getWorldPosition();
-
-                if (MathUtils::RealEqual(offset.y, 0.0f, 0.05f) &&
-                    MathUtils::RealEqual(offset.x, 0.0f, 0.1f) &&
-                    MathUtils::RealEqual(offset.z, 0.0f, 0.1f))
-                {
-                    m_bFalling = false;
-                    break;
-                }
-            }
-        }
-
         // Add the physical component to the list of current contacts
         currentContacts.push_back(pComponent);
 
-        // Determine if we were previously already colliding with this physical component
-        tContactsIterator iter(m_contacts.begin(), m_contacts.end());
-        bool bFound = false;
-        while (iter.hasMoreElements())
-        {
-            PhysicalComponent* pTestedComponent = iter.getNext();
-            if (pTestedComponent == pComponent)
-            {
-                bFound = true;
-                break;
-            }
-        }
-
-        if (bFound)
+        // Only the beginning of a contact is processed: skip the components we
+        // were already colliding with during the previous step
+        if (std::binary_search(m_contacts.begin(), m_contacts.end(), pComponent))
             continue;
 
         // Determine the collision group of the physical component
@@ -144,24 +148,17 @@ tResult Goal::process(float &reward, Teacher* pTeacher)
             case GROUP_TRIGGER:
             {
                 // Test if the component belongs to a target
-                tTargetsIterator iter(m_pMap->targets.begin(), m_pMap->targets.end());
-                while (iter.hasMoreElements())
+                tTargetsIndex::iterator iter = m_targetsIndex.find(pComponent->getList()->getEntity());
+                if (iter != m_targetsIndex.end())
                 {
-                    tTarget* pTarget = iter.peekNextPtr();
-
-                    if (pTarget->pEntity == pComponent->getList()->getEntity())
-                    {
-                        float target_reward = 0.0f;
-                        result = onTargetReached(pTarget, target_reward);
-                        reward += target_reward;
+                    tTarget* pTarget = iter->second;
 
-                        if (pTeacher)
-                            pTeacher->onTargetReached(pTarget);
+                    float target_reward = 0.0f;
+                    result = onTargetReached(pTarget, target_reward);
+                    reward += target_reward;
 
-                        break;
-                    }
-
-                    iter.moveNext();
+                    if (pTeacher)
+                        pTeacher->onTargetReached(pTarget);
                 }
 
                 // At this point the only triggers are targets, but additional
@@ -175,7 +172,9 @@ tResult Goal::process(float &reward, Teacher* pTeacher)
         }
     }
 
-    m_contacts = currentContacts;
+    // The contacts that ended are simply not in the new list
+    std::sort(currentContacts.begin(), currentContacts.end());
+    m_contacts.swap(currentContacts);
 
     if (!m_bFalling && (result == RESULT_NONE))
     {
@@ -193,6 +192,25 @@ tResult Goal::process(float &reward, Teacher* pTeacher)
 }
 
 
+bool Goal::isAvatarOnGround() const
+{
+    // Assertions
+    assert(m_pPhysicalWorld);
+    assert(m_pAvatarBody);
+
+    // A single ray cast below the feet of the avatar, against the static objects
+    Vector3 position = m_pAvatarBody->getTransforms()->getWorldPosition();
+
+    btVector3 from = toBullet(position + Vector3(0.0f, GROUND_TOLERANCE, 0.0f));
+    btVector3 to   = toBullet(position - Vector3(0.0f, GROUND_TOLERANCE, 0.0f));
+
+    GroundRayResultCallback callback(from, to);
+    m_pPhysicalWorld->getWorld()->rayTest(from, to, callback);
+
+    return callback.hasHit();
+}
+
+
 bool Goal::updateTimeout(float elapsedMilliseconds)
 {
     if (m_fTimeout > 0.0f)
@@ -61,7 +61,7 @@ tResult GoalFollowTheBlobs::onAvatarMoved(float &reward)
     int robot_position_x = ((int) ((position.x + m_pMap->cell_size * 0.0005f) * 1000.0f)) / m_pMap->cell_size;
     int robot_position_y = ((int) ((position.z + m_pMap->cell_size * 0.0005f) * 1000.0f)) / m_pMap->cell_size;
 
-    if (m_pMap->grid[robot_position_y * m_pMap->width + robot_position_x].type != CELL_SPOT)
+    if (m_pMap->grid.type(robot_position_x, robot_position_y) != CELL_SPOT)
     {
         reward = -10.0f;
         return RESULT_FAILED;
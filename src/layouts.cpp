@@ -0,0 +1,221 @@
+/*******************************************************************************
+* MASH 3D simulator
+* 
+* Copyright (c) 2014 Idiap Research Institute, http://www.idiap.ch/
+* Written by Philip Abbet <philip.abbet@idiap.ch>
+* 
+* This file is part of mash-simulator.
+* 
+* mash-simulator is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 3 as
+* published by the Free Software Foundation.
+* 
+* mash-simulator is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+* 
+* You should have received a copy of the GNU General Public License
+* along with mash-simulator. If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+
+#include <Simulator.h>
+#include <LayoutsFile.h>
+#include <maps.h>
+#include <goals/goals.h>
+#include <mash-utils/stringutils.h>
+#include <mash-utils/statistics.h>
+#include <SimpleOpt.h>
+#include <iostream>
+
+using namespace Mash;
+using namespace std;
+
+
+/**************************** COMMAND-LINE PARSING ****************************/
+
+enum tOptions
+{
+    OPT_GOAL,
+    OPT_ENVIRONMENT,
+    OPT_COUNT,
+    OPT_OUTPUT,
+    OPT_SECRET,
+    OPT_HELP,
+};
+
+CSimpleOpt::SOption COMMAND_LINE_OPTIONS[] =
+{
+    { OPT_GOAL,             "--goal",        SO_REQ_CMB },
+    { OPT_ENVIRONMENT,      "--environment", SO_REQ_CMB },
+    { OPT_COUNT,            "--count",       SO_REQ_CMB },
+    { OPT_OUTPUT,           "--output",      SO_REQ_CMB },
+    { OPT_SECRET,           "--secret",      SO_NONE    },
+    { OPT_HELP,             "--help",        SO_NONE    },
+    { OPT_HELP,             "-h",            SO_NONE    },
+
+    SO_END_OF_OPTIONS
+};
+
+
+/********************************** FUNCTIONS *********************************/
+
+void showUsage(const std::string& strApplicationName)
+{
+    cout << "MASH 3D Simulator - Layouts generator" << endl
+         << "Usage: " << strApplicationName << " [options]" << endl
+         << endl
+         << "Precompute the layouts (positions of the avatar and of the targets) of the episodes" << endl
+         << "of a task. Give the folder containing the file to the simulator with --layouts." << endl
+         << endl
+         << "Options:" << endl
+         << "    --help, -h:                   Display this help" << endl
+         << "    --goal=<goal>:                The goal" << endl
+         << "    --environment=<environment>:  The environment" << endl
+         << "    --count=<nb>:                 Number of layouts (default: 10000). Layout n is always" << endl
+         << "                                  the same, whatever the number of layouts" << endl
+         << "    --output=<path>:              The file to write (default: '<goal>-<environment>.layouts')" << endl
+         << "    --secret:                     Allow the secret goals and environments" << endl
+         << endl;
+}
+
+
+int main(int argc, char** argv)
+{
+    // Declarations
+    bool            bSecret         = false;
+    string          strGoal         = "";
+    string          strEnvironment  = "";
+    string          strOutput       = "";
+    unsigned int    nbLayouts       = 10000;
+
+    // Parse the command-line arguments
+    CSimpleOpt args(argc, argv, COMMAND_LINE_OPTIONS);
+    while (args.Next())
+    {
+        if (args.LastError() == SO_SUCCESS)
+        {
+            switch (args.OptionId())
+            {
+                case OPT_HELP:
+                    showUsage(argv[0]);
+                    return 0;
+
+                case OPT_GOAL:
+                    strGoal = args.OptionArg();
+                    break;
+
+                case OPT_ENVIRONMENT:
+                    strEnvironment = args.OptionArg();
+                    break;
+
+                case OPT_COUNT:
+                    nbLayouts = StringUtils::parseUnsignedInt(args.OptionArg());
+                    break;
+
+                case OPT_OUTPUT:
+                    strOutput = args.OptionArg();
+                    break;
+
+                case OPT_SECRET:
+                    bSecret = true;
+                    break;
+            }
+        }
+        else
+        {
+            cerr << "Invalid argument: " << args.OptionText() << endl;
+            return -1;
+        }
+    }
+
+    if (strGoal.empty() || strEnvironment.empty() || (nbLayouts == 0))
+    {
+        cerr << "You must specify a goal, an environment (using --goal and --environment)" << endl
+             << "and a non-zero number of layouts" << endl;
+        return -1;
+    }
+
+    if (strOutput.empty())
+        strOutput = strGoal + "-" + strEnvironment + ".layouts";
+
+
+    // Initialization of the simulator (the maps need the engine)
+    Simulator simulator;
+
+    if (!simulator.init(false, "", "", bSecret))
+    {
+        cerr << "Failed to initialize the simulator" << endl;
+        return -1;
+    }
+
+    if (!bSecret && (simulator.isGoalSecret(strGoal) || simulator.isEnvironmentSecret(strEnvironment)))
+    {
+        cerr << "Can't use a secret goal or environment without --secret" << endl;
+        return -1;
+    }
+
+    tStringList environments = simulator.getEnvironments(strGoal);
+    tStringIterator iter, iterEnd;
+    bool bFound = false;
+    for (iter = environments.begin(), iterEnd = environments.end(); iter != iterEnd; ++iter)
+    {
+        if (*iter == strEnvironment)
+        {
+            bFound = true;
+            break;
+        }
+    }
+
+    if (!bFound)
+    {
+        cerr << "Environment not suitable for the goal: " << strEnvironment << endl;
+        return -1;
+    }
+
+
+    // Generation of the layouts: layout n is the one of the map of seed n
+    LayoutsFile file;
+    unsigned long long start = Statistics::now();
+
+    for (unsigned int i = 0; i < nbLayouts; ++i)
+    {
+        MapBuilder* pMapBuilder = createMap(strEnvironment, i);
+        Goal* pGoal = createGoal(strGoal);
+        pGoal->setup(pMapBuilder);
+
+        MapBuilder::tLayout layout;
+        pMapBuilder->computeLayout(layout);
+
+        bool bResult = true;
+
+        if (i == 0)
+            bResult = file.create(strOutput, strGoal, strEnvironment, layout.targets.size());
+
+        if (bResult)
+            bResult = file.append(i, layout);
+
+        delete pGoal;
+        delete pMapBuilder->getMap();
+        delete pMapBuilder;
+
+        if (!bResult)
+        {
+            cerr << "Failed to write the layout " << i << " in '" << strOutput << "'" << endl;
+            return -1;
+        }
+
+        if (((i + 1) % 1000 == 0) || (i == nbLayouts - 1))
+        {
+            cout << "\r" << (i + 1) << " / " << nbLayouts << " layouts ("
+                 << (Statistics::now() - start) / 1000000 << " s)" << flush;
+        }
+    }
+
+    cout << endl;
+
+    file.close();
+
+    return 0;
+}
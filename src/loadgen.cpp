@@ -0,0 +1,849 @@
+/*******************************************************************************
+* MASH 3D simulator
+* 
+* Copyright (c) 2014 Idiap Research Institute, http://www.idiap.ch/
+* Written by Philip Abbet <philip.abbet@idiap.ch>
+* 
+* This file is part of mash-simulator.
+* 
+* mash-simulator is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 3 as
+* published by the Free Software Foundation.
+* 
+* mash-simulator is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+* 
+* You should have received a copy of the GNU General Public License
+* along with mash-simulator. If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+
+#include <mash-network/client.h>
+#include <mash-network/shared_frames.h>
+#include <mash-utils/commands_serializer.h>
+#include <mash-utils/stringutils.h>
+#include <mash-utils/statistics.h>
+#include <mash-utils/latency_histogram.h>
+#include <mash-utils/random_number_generator.h>
+#include <SimpleOpt.h>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <map>
+#include <vector>
+#include <memory.h>
+#include <pthread.h>
+#include <unistd.h>
+
+using namespace Mash;
+using namespace std;
+
+
+/**************************** COMMAND-LINE PARSING ****************************/
+
+enum tOptions
+{
+    OPT_HOST,
+    OPT_PORT,
+    OPT_UNIX,
+    OPT_CONNECTIONS,
+    OPT_SESSIONS,
+    OPT_SCRIPT,
+    OPT_THINK,
+    OPT_PIPELINE,
+    OPT_GOAL,
+    OPT_ENVIRONMENT,
+    OPT_EPISODES,
+    OPT_STEPS,
+    OPT_SEED,
+    OPT_OUTPUT,
+    OPT_HELP,
+};
+
+CSimpleOpt::SOption COMMAND_LINE_OPTIONS[] =
+{
+    { OPT_HOST,             "--host",        SO_REQ_CMB },
+    { OPT_PORT,             "--port",        SO_REQ_CMB },
+    { OPT_UNIX,             "--unix",        SO_REQ_CMB },
+    { OPT_CONNECTIONS,      "--connections", SO_REQ_CMB },
+    { OPT_SESSIONS,         "--sessions",    SO_REQ_CMB },
+    { OPT_SCRIPT,           "--script",      SO_REQ_CMB },
+    { OPT_THINK,            "--think",       SO_REQ_CMB },
+    { OPT_PIPELINE,         "--pipeline",    SO_REQ_CMB },
+    { OPT_GOAL,             "--goal",        SO_REQ_CMB },
+    { OPT_ENVIRONMENT,      "--environment", SO_REQ_CMB },
+    { OPT_EPISODES,         "--episodes",    SO_REQ_CMB },
+    { OPT_STEPS,            "--steps",       SO_REQ_CMB },
+    { OPT_SEED,             "--seed",        SO_REQ_CMB },
+    { OPT_OUTPUT,           "--output",      SO_REQ_CMB },
+    { OPT_HELP,             "--help",        SO_NONE    },
+    { OPT_HELP,             "-h",            SO_NONE    },
+
+    SO_END_OF_OPTIONS
+};
+
+
+/*********************************** TYPES ************************************/
+
+typedef std::vector<CommandsSerializer::tCommand>   tScript;
+
+typedef std::map<std::string, LatencyHistogram>     tHistogramsList;
+typedef tHistogramsList::iterator                   tHistogramsIterator;
+typedef tHistogramsList::const_iterator             tHistogramsConstIterator;
+
+
+struct tResults
+{
+    tResults()
+    : nbSessions(0), nbCompletedSessions(0), nbRejectedSessions(0),
+      nbFailedConnections(0), nbDisconnections(0), nbCommands(0), nbErrors(0)
+    {
+    }
+
+    void merge(const tResults& results)
+    {
+        nbSessions          += results.nbSessions;
+        nbCompletedSessions += results.nbCompletedSessions;
+        nbRejectedSessions  += results.nbRejectedSessions;
+        nbFailedConnections += results.nbFailedConnections;
+        nbDisconnections    += results.nbDisconnections;
+        nbCommands          += results.nbCommands;
+        nbErrors            += results.nbErrors;
+
+        connections.merge(results.connections);
+        sessions.merge(results.sessions);
+
+        tHistogramsConstIterator iter, iterEnd;
+        for (iter = results.commands.begin(), iterEnd = results.commands.end(); iter != iterEnd; ++iter)
+            commands[iter->first].merge(iter->second);
+    }
+
+    unsigned int        nbSessions;
+    unsigned int        nbCompletedSessions;
+    unsigned int        nbRejectedSessions;     // Sessions handled by a BusyListener
+    unsigned int        nbFailedConnections;
+    unsigned int        nbDisconnections;       // Connections closed in the middle of a session
+    unsigned long long  nbCommands;
+    unsigned long long  nbErrors;               // Error responses (ERROR, INVALID_ARGUMENTS, ...)
+    LatencyHistogram    connections;            // Connection setup time, in microseconds
+    LatencyHistogram    sessions;               // Duration of the sessions, in microseconds
+    tHistogramsList     commands;               // Latency of each command, in microseconds
+};
+
+
+struct tWorker
+{
+    pthread_t       thread;
+    unsigned int    index;
+    tResults        results;
+};
+
+
+/****************************** GLOBAL VARIABLES ******************************/
+
+string          strHost             = "127.0.0.1";
+string          strUnixSocket       = "";
+unsigned int    port                = 11200;
+unsigned int    thinkTime           = 0;            // In milliseconds
+unsigned int    pipelineDepth       = 1;
+unsigned int    seed                = 0;
+tScript         script;
+volatile int    nbRemainingSessions = 0;
+
+
+/********************************** FUNCTIONS *********************************/
+
+void showUsage(const std::string& strApplicationName)
+{
+    cout << "MASH 3D Simulator - Load generator" << endl
+         << "Usage: " << strApplicationName << " [options]" << endl
+         << endl
+         << "Open a lot of concurrent sessions against a running server, replay a scripted" << endl
+         << "session on each of them, and report the performances of the server." << endl
+         << endl
+         << "Options:" << endl
+         << "    --help, -h:                   Display this help" << endl
+         << "    --host=<host>:                The address of the server (default: 127.0.0.1)" << endl
+         << "    --port=<port>:                The port of the server (default: 11200)" << endl
+         << "    --unix=<path>:                Connect to the Unix domain socket of the server instead" << endl
+         << "    --connections=<nb>:           Number of concurrent connections (default: 10)" << endl
+         << "    --sessions=<nb>:              Total number of sessions (default: the number of" << endl
+         << "                                  connections)" << endl
+         << "    --script=<path>:              File containing the commands of a session (see below)" << endl
+         << "    --think=<ms>:                 Delay between a response and the next command" << endl
+         << "                                  (default: 0)" << endl
+         << "    --pipeline=<nb>:              Number of commands sent without waiting for the" << endl
+         << "                                  responses (default: 1, no pipelining). Limited to the" << endl
+         << "                                  number returned by the PIPELINING command of the server" << endl
+         << "    --seed=<seed>:                Seed used to choose the random actions (default: 0)" << endl
+         << "    --output=<path>:              Write the results in a JSON file" << endl
+         << endl
+         << "Options of the default session (ignored when a script is provided):" << endl
+         << "    --goal=<goal>:                The goal (default: reach_1_flag)" << endl
+         << "    --environment=<environment>:  The environment (default: SingleRoom)" << endl
+         << "    --episodes=<nb>:              Number of episodes (default: 1)" << endl
+         << "    --steps=<nb>:                 Number of steps per episode (default: 100)" << endl
+         << endl
+         << "A script contains one command of the network protocol per line. Lines starting" << endl
+         << "with '#' are ignored. 'ACTION *' performs an action chosen at random among the" << endl
+         << "ones announced by the server, and the commands between 'REPEAT <nb>' and" << endl
+         << "'END_REPEAT' are sent <nb> times." << endl
+         << endl;
+}
+
+
+bool expandScript(CommandsSerializer& serializer, unsigned int& index, tScript& result)
+{
+    while (index < serializer.nbCommands())
+    {
+        CommandsSerializer::tCommand command = serializer.getCommand(index);
+        ++index;
+
+        if (command.strCommand == "REPEAT")
+        {
+            if (command.arguments.size() != 1)
+            {
+                cerr << "Invalid REPEAT command at line " << index << " of the script" << endl;
+                return false;
+            }
+
+            unsigned int firstIndex = index;
+            unsigned int nbRepeats = (unsigned int) command.arguments.getInt(0);
+
+            tScript block;
+            if (!expandScript(serializer, index, block))
+                return false;
+
+            if ((index > serializer.nbCommands()) ||
+                (serializer.getCommand(index - 1).strCommand != "END_REPEAT") ||
+                (index == firstIndex))
+            {
+                cerr << "Missing END_REPEAT command in the script" << endl;
+                return false;
+            }
+
+            for (unsigned int i = 0; i < nbRepeats; ++i)
+                result.insert(result.end(), block.begin(), block.end());
+        }
+        else if (command.strCommand == "END_REPEAT")
+        {
+            return true;
+        }
+        else
+        {
+            result.push_back(command);
+        }
+    }
+
+    return true;
+}
+
+
+bool loadScript(const std::string& strFileName, tScript& result)
+{
+    CommandsSerializer serializer;
+    unsigned int index = 0;
+
+    if (!serializer.deserialize(strFileName))
+    {
+        cerr << "Failed to read the script '" << strFileName << "'" << endl;
+        return false;
+    }
+
+    if (!expandScript(serializer, index, result))
+        return false;
+
+    if (index < serializer.nbCommands())
+    {
+        cerr << "Unexpected END_REPEAT command in the script" << endl;
+        return false;
+    }
+
+    return !result.empty();
+}
+
+
+void createDefaultScript(const std::string& strGoal, const std::string& strEnvironment,
+                         unsigned int nbEpisodes, unsigned int nbSteps, tScript& result)
+{
+    CommandsSerializer::tCommand command;
+
+    command.strCommand = "INITIALIZE_TASK";
+    command.arguments = ArgumentsList(strGoal);
+    command.arguments.add(strEnvironment);
+    result.push_back(command);
+
+    command.strCommand = "BEGIN_TASK_SETUP";
+    command.arguments.clear();
+    result.push_back(command);
+
+    command.strCommand = "END_TASK_SETUP";
+    result.push_back(command);
+
+    for (unsigned int episode = 0; episode < nbEpisodes; ++episode)
+    {
+        for (unsigned int step = 0; step < nbSteps; ++step)
+        {
+            command.strCommand = "ACTION";
+            command.arguments = ArgumentsList("*");
+            result.push_back(command);
+
+            command.strCommand = "GET_VIEW";
+            command.arguments = ArgumentsList("main");
+            result.push_back(command);
+        }
+
+        command.strCommand = "RESET_TASK";
+        command.arguments.clear();
+        result.push_back(command);
+    }
+
+    command.strCommand = "DONE";
+    result.push_back(command);
+}
+
+
+bool isErrorResponse(const std::string& strResponse)
+{
+    return (strResponse == "ERROR") || (strResponse == "INVALID_ARGUMENTS") ||
+           (strResponse == "UNKNOWN_COMMAND") || (strResponse == "UNKNOWN_GOAL") ||
+           (strResponse == "UNKNOWN_ENVIRONMENT") || (strResponse == "UNKNOWN_ACTION") ||
+           (strResponse == "UNKNOWN_VIEW") || (strResponse == "UNKNOWN_TRAJECTORY") ||
+           (strResponse == "NO_TASK_SELECTED") || (strResponse == "NOT_SUPPORTED") ||
+           (strResponse == "GLOBAL_SEED_ALREADY_SET");
+}
+
+
+//------------------------------------------------------------------------------
+/// @brief  Read all the responses to a command, until the last one
+///
+/// @param  client          The client
+/// @param[out] strLast     The last response
+/// @param[out] actions     The list of available actions (only modified in
+///                         response to INITIALIZE_TASK)
+/// @param  data            Buffer used to receive the binary data
+/// @param  frames          Shared memory segment containing the views (opened
+///                         in response to USE_SHARED_FRAMES)
+/// @return                 'false' if the connection was closed
+//------------------------------------------------------------------------------
+bool readResponses(Client& client, std::string& strLast, tStringList& actions,
+                   std::vector<unsigned char>& data, SharedFrames& frames)
+{
+    // Declarations
+    string strResponse;
+    ArgumentsList arguments;
+
+    while (true)
+    {
+        if (!client.waitResponse(&strResponse, &arguments))
+            return false;
+
+        bool bLast = true;
+        int size = 0;
+
+        if (strResponse == "VIEW")
+        {
+            size = arguments.getInt(2);
+        }
+        else if (strResponse == "VIEW_IN_SLOT")
+        {
+            // Copy the view out of its slot (like a real client would do), and
+            // give the slot back to the server
+            unsigned int slot = (unsigned int) arguments.getInt(3);
+
+            if (frames.isOpen() && (slot < frames.nbSlots()))
+            {
+                unsigned int frameSize = frames.frameSize(slot);
+
+                if (data.size() < frameSize)
+                    data.resize(frameSize);
+
+                if (frameSize > 0)
+                    memcpy(&data[0], frames.data(slot), frameSize);
+
+                frames.release(slot);
+            }
+        }
+        else if (strResponse == "SHARED_FRAMES")
+        {
+            frames.open(arguments.getString(0));
+        }
+        else if (strResponse == "TRACE_FILE")
+        {
+            size = arguments.getInt(1);
+        }
+        else if (strResponse == "LOG_FILE")
+        {
+            size = arguments.getInt(1);
+            bLast = false;
+        }
+        else if (strResponse == "AVAILABLE_ACTIONS")
+        {
+            actions.clear();
+            for (int i = 0; i < arguments.size(); ++i)
+                actions.push_back(arguments.getString(i));
+
+            bLast = false;
+        }
+        else if ((strResponse == "TYPE") || (strResponse == "SUBTYPE") ||
+                 (strResponse == "GOAL") || (strResponse == "ENVIRONMENT") ||
+                 (strResponse == "AVAILABLE_VIEWS") || (strResponse == "SUGGESTED_ACTION") ||
+                 (strResponse == "NOT_RECOMMENDED_ACTIONS") || (strResponse == "REWARD") ||
+                 (strResponse == "EVENT") || (strResponse == "STAT"))
+        {
+            bLast = false;
+        }
+
+        if (size > 0)
+        {
+            if (data.size() < (size_t) size)
+                data.resize(size);
+
+            if (!client.waitData(&data[0], size))
+                return false;
+        }
+
+        if (bLast)
+        {
+            strLast = strResponse;
+            return true;
+        }
+    }
+}
+
+
+void runSession(Client& client, RandomNumberGenerator& generator, tResults& results,
+                std::vector<unsigned char>& data)
+{
+    // Declarations
+    tStringList actions;
+    SharedFrames frames;
+    string strResponse;
+    unsigned long long start;
+
+    ++results.nbSessions;
+
+    // Connection
+    start = Statistics::now();
+
+    if (!(strUnixSocket.empty() ? client.connect(strHost, port) : client.connectUnix(strUnixSocket)))
+    {
+        ++results.nbFailedConnections;
+        return;
+    }
+
+    results.connections.record(Statistics::now() - start);
+
+    // Never pipeline more commands than the server accepts (not measured)
+    unsigned int depth = pipelineDepth;
+    if (depth > 1)
+    {
+        ArgumentsList arguments;
+
+        if (!client.sendCommand("PIPELINING", ArgumentsList()) ||
+            !client.waitResponse(&strResponse, &arguments))
+        {
+            ++results.nbDisconnections;
+            client.close();
+            return;
+        }
+
+        if (strResponse == "BUSY")
+        {
+            ++results.nbRejectedSessions;
+            client.close();
+            return;
+        }
+
+        // A server that doesn't support pipelining doesn't know the command
+        if ((strResponse == "PIPELINING") && (arguments.size() == 1) && (arguments.getInt(0) > 0))
+            depth = std::min(depth, (unsigned int) arguments.getInt(0));
+        else
+            depth = 1;
+    }
+
+    unsigned long long sessionStart = Statistics::now();
+
+    // Replay the script, by batches of (at most) 'depth' commands
+    client.setMaxPipelinedCommands(depth);
+
+    size_t index = 0;
+    while (index < script.size())
+    {
+        if ((thinkTime > 0) && (index > 0))
+            usleep(thinkTime * 1000);
+
+        // Send the batch
+        size_t first = index;
+        while ((index < script.size()) && (index - first < depth))
+        {
+            const CommandsSerializer::tCommand& command = script[index];
+
+            // A random action can't be chosen before the available ones are known
+            ArgumentsList arguments = command.arguments;
+            if ((command.strCommand == "ACTION") && (arguments.size() == 1) &&
+                (arguments.getString(0) == "*"))
+            {
+                if (actions.empty() && (index > first))
+                    break;
+
+                if (!actions.empty())
+                    arguments = ArgumentsList(actions[generator.randomize(0u, (unsigned int) actions.size() - 1)]);
+            }
+
+            client.pipelineCommand(command.strCommand, arguments);
+            ++index;
+
+            // The available actions (and the end of the session) must be known
+            // before sending the next commands
+            if ((command.strCommand == "INITIALIZE_TASK") || (command.strCommand == "DONE"))
+                break;
+        }
+
+        start = Statistics::now();
+
+        if (!client.flush())
+        {
+            ++results.nbDisconnections;
+            client.close();
+            return;
+        }
+
+        // Read the responses, in order
+        bool bDone = false;
+        for (size_t i = first; i < index; ++i)
+        {
+            if (!readResponses(client, strResponse, actions, data, frames))
+            {
+                ++results.nbDisconnections;
+                client.close();
+                return;
+            }
+
+            client.commandCompleted();
+
+            results.commands[script[i].strCommand].record(Statistics::now() - start);
+            ++results.nbCommands;
+
+            if (strResponse == "BUSY")
+            {
+                ++results.nbRejectedSessions;
+                client.close();
+                return;
+            }
+            else if (isErrorResponse(strResponse))
+            {
+                ++results.nbErrors;
+            }
+            else if (strResponse == "GOODBYE")
+            {
+                bDone = true;
+            }
+        }
+
+        if (bDone)
+            break;
+    }
+
+    client.close();
+
+    results.sessions.record(Statistics::now() - sessionStart);
+    ++results.nbCompletedSessions;
+}
+
+
+void* workerThread(void* pArgument)
+{
+    tWorker* pWorker = (tWorker*) pArgument;
+
+    RandomNumberGenerator generator;
+    generator.setSeed(seed + pWorker->index);
+
+    std::vector<unsigned char> data;
+
+    while (__sync_sub_and_fetch(&nbRemainingSessions, 1) >= 0)
+    {
+        Client client;
+        runSession(client, generator, pWorker->results, data);
+    }
+
+    return 0;
+}
+
+
+void printHistogram(const std::string& strName, const LatencyHistogram& histogram)
+{
+    cout << std::setw(20) << left << strName << " "
+         << std::setw(9) << right << histogram.count() << " "
+         << std::setw(9) << right << histogram.mean() << " "
+         << std::setw(9) << right << histogram.percentile(50.0) << " "
+         << std::setw(9) << right << histogram.percentile(90.0) << " "
+         << std::setw(9) << right << histogram.percentile(99.0) << " "
+         << std::setw(9) << right << histogram.max() << endl;
+}
+
+
+void writeHistogram(std::ostream& stream, const std::string& strName,
+                    const LatencyHistogram& histogram)
+{
+    stream << "\"" << strName << "\": {"
+           << "\"count\": " << histogram.count() << ", "
+           << "\"mean\": " << histogram.mean() << ", "
+           << "\"p50\": " << histogram.percentile(50.0) << ", "
+           << "\"p90\": " << histogram.percentile(90.0) << ", "
+           << "\"p99\": " << histogram.percentile(99.0) << ", "
+           << "\"max\": " << histogram.max() << "}";
+}
+
+
+bool writeJSON(const std::string& strFileName, const tResults& results,
+               unsigned int nbConnections, double duration)
+{
+    ofstream file(strFileName.c_str());
+    if (!file.is_open())
+        return false;
+
+    file << "{" << endl
+         << "  \"host\": \"" << strHost << "\"," << endl
+         << "  \"port\": " << port << "," << endl
+         << "  \"unix\": \"" << strUnixSocket << "\"," << endl
+         << "  \"connections\": " << nbConnections << "," << endl
+         << "  \"think_ms\": " << thinkTime << "," << endl
+         << "  \"pipeline\": " << pipelineDepth << "," << endl
+         << "  \"duration_s\": " << fixed << std::setprecision(3) << duration << "," << endl
+         << "  \"sessions\": " << results.nbSessions << "," << endl
+         << "  \"completed_sessions\": " << results.nbCompletedSessions << "," << endl
+         << "  \"rejected_sessions\": " << results.nbRejectedSessions << "," << endl
+         << "  \"failed_connections\": " << results.nbFailedConnections << "," << endl
+         << "  \"disconnections\": " << results.nbDisconnections << "," << endl
+         << "  \"commands\": " << results.nbCommands << "," << endl
+         << "  \"errors\": " << results.nbErrors << "," << endl
+         << "  \"commands_per_sec\": " << std::setprecision(2)
+         << (duration > 0.0 ? results.nbCommands / duration : 0.0) << "," << endl
+         << "  \"sessions_per_sec\": "
+         << (duration > 0.0 ? results.nbCompletedSessions / duration : 0.0) << "," << endl
+         << "  ";
+
+    writeHistogram(file, "connect_us", results.connections);
+    file << "," << endl << "  ";
+    writeHistogram(file, "session_us", results.sessions);
+    file << "," << endl
+         << "  \"latencies_us\": {" << endl;
+
+    tHistogramsConstIterator iter, iterEnd;
+    for (iter = results.commands.begin(), iterEnd = results.commands.end(); iter != iterEnd; )
+    {
+        file << "    ";
+        writeHistogram(file, iter->first, iter->second);
+
+        ++iter;
+        file << (iter != iterEnd ? "," : "") << endl;
+    }
+
+    file << "  }" << endl
+         << "}" << endl;
+
+    return true;
+}
+
+
+int main(int argc, char** argv)
+{
+    // Declarations
+    string          strScript       = "";
+    string          strGoal         = "reach_1_flag";
+    string          strEnvironment  = "SingleRoom";
+    string          strOutput       = "";
+    unsigned int    nbConnections   = 10;
+    unsigned int    nbSessions      = 0;
+    unsigned int    nbEpisodes      = 1;
+    unsigned int    nbSteps         = 100;
+
+    // Parse the command-line arguments
+    CSimpleOpt args(argc, argv, COMMAND_LINE_OPTIONS);
+    while (args.Next())
+    {
+        if (args.LastError() == SO_SUCCESS)
+        {
+            switch (args.OptionId())
+            {
+                case OPT_HELP:
+                    showUsage(argv[0]);
+                    return 0;
+
+                case OPT_HOST:
+                    strHost = args.OptionArg();
+                    break;
+
+                case OPT_PORT:
+                    port = StringUtils::parseUnsignedInt(args.OptionArg());
+                    break;
+
+                case OPT_UNIX:
+                    strUnixSocket = args.OptionArg();
+                    break;
+
+                case OPT_CONNECTIONS:
+                    nbConnections = StringUtils::parseUnsignedInt(args.OptionArg());
+                    break;
+
+                case OPT_SESSIONS:
+                    nbSessions = StringUtils::parseUnsignedInt(args.OptionArg());
+                    break;
+
+                case OPT_SCRIPT:
+                    strScript = args.OptionArg();
+                    break;
+
+                case OPT_THINK:
+                    thinkTime = StringUtils::parseUnsignedInt(args.OptionArg());
+                    break;
+
+                case OPT_PIPELINE:
+                    pipelineDepth = StringUtils::parseUnsignedInt(args.OptionArg());
+                    if (pipelineDepth == 0)
+                        pipelineDepth = 1;
+                    break;
+
+                case OPT_GOAL:
+                    strGoal = args.OptionArg();
+                    break;
+
+                case OPT_ENVIRONMENT:
+                    strEnvironment = args.OptionArg();
+                    break;
+
+                case OPT_EPISODES:
+                    nbEpisodes = StringUtils::parseUnsignedInt(args.OptionArg());
+                    break;
+
+                case OPT_STEPS:
+                    nbSteps = StringUtils::parseUnsignedInt(args.OptionArg());
+                    break;
+
+                case OPT_SEED:
+                    seed = StringUtils::parseUnsignedInt(args.OptionArg());
+                    break;
+
+                case OPT_OUTPUT:
+                    strOutput = args.OptionArg();
+                    break;
+            }
+        }
+        else
+        {
+            cerr << "Invalid argument: " << args.OptionText() << endl;
+            return -1;
+        }
+    }
+
+    if (nbConnections == 0)
+        nbConnections = 1;
+
+    if (nbSessions == 0)
+        nbSessions = nbConnections;
+
+    if (nbConnections > nbSessions)
+        nbConnections = nbSessions;
+
+
+    // Retrieve the script of the sessions
+    if (!strScript.empty())
+    {
+        if (!loadScript(strScript, script))
+            return -1;
+    }
+    else
+    {
+        createDefaultScript(strGoal, strEnvironment, nbEpisodes, nbSteps, script);
+    }
+
+
+    cout << "********************************************************************************" << endl
+         << "* MASH 3D Simulator - Load generator" << endl
+         << "********************************************************************************" << endl
+         << endl
+         << "Server:      " << (strUnixSocket.empty() ? strHost + ":" + StringUtils::toString(port) : strUnixSocket) << endl
+         << "Connections: " << nbConnections << endl
+         << "Sessions:    " << nbSessions << " (" << script.size() << " commands each)" << endl
+         << "Think time:  " << thinkTime << " ms" << endl
+         << "Pipeline:    " << pipelineDepth << " command(s)" << endl
+         << endl;
+
+
+    // Start the workers
+    std::vector<tWorker*> workers;
+    nbRemainingSessions = nbSessions;
+
+    unsigned long long start = Statistics::now();
+
+    for (unsigned int i = 0; i < nbConnections; ++i)
+    {
+        tWorker* pWorker = new tWorker();
+        pWorker->index = i;
+
+        if (pthread_create(&pWorker->thread, 0, workerThread, pWorker) != 0)
+        {
+            cerr << "Failed to create the thread #" << i << endl;
+            delete pWorker;
+            break;
+        }
+
+        workers.push_back(pWorker);
+    }
+
+    // Wait for the end of all the sessions, and merge the results
+    tResults results;
+
+    for (unsigned int i = 0; i < workers.size(); ++i)
+    {
+        pthread_join(workers[i]->thread, 0);
+        results.merge(workers[i]->results);
+        delete workers[i];
+    }
+
+    double duration = (Statistics::now() - start) * 1e-6;
+
+
+    // Report the results
+    cout << "Duration:             " << fixed << std::setprecision(2) << duration << " s" << endl
+         << "Completed sessions:   " << results.nbCompletedSessions << " / " << results.nbSessions << endl
+         << "Rejected (BUSY):      " << results.nbRejectedSessions << endl
+         << "Failed connections:   " << results.nbFailedConnections << endl
+         << "Disconnections:       " << results.nbDisconnections << endl
+         << "Error responses:      " << results.nbErrors << endl
+         << "Throughput:           " << (duration > 0.0 ? results.nbCommands / duration : 0.0)
+         << " commands/s, "
+         << (duration > 0.0 ? results.nbCompletedSessions / duration : 0.0) << " sessions/s" << endl
+         << endl
+         << std::setw(20) << left << "Latency (us)" << " "
+         << std::setw(9) << right << "Count" << " "
+         << std::setw(9) << right << "Mean" << " "
+         << std::setw(9) << right << "p50" << " "
+         << std::setw(9) << right << "p90" << " "
+         << std::setw(9) << right << "p99" << " "
+         << std::setw(9) << right << "Max" << endl;
+
+    printHistogram("<connect>", results.connections);
+
+    tHistogramsConstIterator iter, iterEnd;
+    for (iter = results.commands.begin(), iterEnd = results.commands.end(); iter != iterEnd; ++iter)
+        printHistogram(iter->first, iter->second);
+
+    printHistogram("<session>", results.sessions);
+
+    bool bResult = true;
+
+    if (!strOutput.empty())
+    {
+        bResult = writeJSON(strOutput, results, nbConnections, duration);
+
+        if (!bResult)
+            cerr << "Failed to write the results in '" << strOutput << "'" << endl;
+    }
+
+    return (bResult ? 0 : -1);
+}
@@ -25,6 +25,8 @@
 #include <Declarations.h>
 #include <mash-appserver/interactive_application_server.h>
 #include <mash-utils/stringutils.h>
+#include <mash-utils/statistics.h>
+#include <mash-utils/tracer.h>
 #include <Ogre/OgreException.h>
 #include <SimpleOpt.h>
 #include <stdlib.h>
@@ -44,6 +46,7 @@ enum tOptions
     OPT_GAME,
     OPT_VIEW_SIZE,
     OPT_VERBOSE,
+    OPT_TRACE,
     OPT_HELP,
 
     // Game mode
@@ -54,8 +57,17 @@ enum tOptions
     // Server mode
     OPT_HOST,
     OPT_PORT,
+    OPT_UNIX,
+    OPT_FD,
     OPT_LOG_FOLDER,
     OPT_NB_MAX_CLIENTS,
+    OPT_NB_WORKERS,
+    OPT_MAX_SESSIONS,
+    OPT_NO_STATS,
+    OPT_ASYNC_TEACHER,
+    OPT_PREBUILD,
+    OPT_LAYOUTS,
+    OPT_RENDERER,
 
 #if ATHENA_PLATFORM == ATHENA_PLATFORM_LINUX
     OPT_XAUTHORITY,
@@ -70,6 +82,7 @@ CSimpleOpt::SOption COMMAND_LINE_OPTIONS[] =
     { OPT_GAME,             "--game",        SO_NONE    },
     { OPT_VIEW_SIZE,        "--viewsize",    SO_REQ_CMB },
     { OPT_VERBOSE,          "--verbose",     SO_NONE    },
+    { OPT_TRACE,            "--trace",       SO_NONE    },
     { OPT_HELP,             "--help",        SO_NONE    },
     { OPT_HELP,             "-h",            SO_NONE    },
 
@@ -81,8 +94,17 @@ CSimpleOpt::SOption COMMAND_LINE_OPTIONS[] =
     // Server mode
     { OPT_HOST,             "--host",        SO_REQ_CMB },
     { OPT_PORT,             "--port",        SO_REQ_CMB },
+    { OPT_UNIX,             "--unix",        SO_REQ_CMB },
+    { OPT_FD,               "--fd",          SO_REQ_CMB },
     { OPT_LOG_FOLDER,       "--logfolder",   SO_REQ_CMB },
     { OPT_NB_MAX_CLIENTS,   "--maxclients",  SO_REQ_CMB },
+    { OPT_NB_WORKERS,       "--workers",     SO_REQ_CMB },
+    { OPT_MAX_SESSIONS,     "--maxsessions", SO_REQ_CMB },
+    { OPT_NO_STATS,         "--nostats",     SO_NONE },
+    { OPT_ASYNC_TEACHER,    "--asyncteacher", SO_NONE },
+    { OPT_PREBUILD,         "--prebuild",    SO_NONE },
+    { OPT_LAYOUTS,          "--layouts",     SO_REQ_CMB },
+    { OPT_RENDERER,         "--renderer",    SO_REQ_CMB },
 
 #if ATHENA_PLATFORM == ATHENA_PLATFORM_LINUX
     { OPT_XAUTHORITY,       "--xauthority",  SO_REQ_CMB },
@@ -106,6 +128,9 @@ void showUsage(const std::string& strApplicationName)
          << "    --game:                       Don't start a server, act like a game (display, keyboard, ...)." << endl
          << "    --viewsize=<width>x<height>:  Size of the window/images" << endl
          << "    --verbose:                    Verbose output" << endl
+         << "    --trace:                      Record a timeline of the simulation (Chrome trace format)," << endl
+         << "                                  saved in 'trace.json' (game mode) or in the log folder" << endl
+         << "                                  at the end of each session (server mode)" << endl
          << endl
          << "Game mode options:" << endl
          << "    --goal=<goal>:                Name of the goal." << endl
@@ -115,8 +140,28 @@ void showUsage(const std::string& strApplicationName)
          << "    --host=<host>:                The host name or IP address that the server must listen on." << endl
          << "                                  If not specified, the first available is used." << endl
          << "    --port=<port>:                The port that the server must listen on (default: 11200)" << endl
+         << "    --unix=<path>:                Listen on a Unix domain socket instead (for the clients" << endl
+         << "                                  running on the same machine)" << endl
+         << "    --fd=<fd>:                    Use a socket inherited from the parent process instead." << endl
+         << "                                  If it is already connected (like one end of a socketpair)," << endl
+         << "                                  only that connection is handled" << endl
          << "    --logfolder=<path>:           Path to the location of the log files (default: 'logs/')" << endl
          << "    --maxclients=<nb>:            Maximum number of clients allowed (default: 1)" << endl
+         << "    --workers=<nb>:               Number of pre-forked and pre-initialized workers. When used," << endl
+         << "                                  replaces --maxclients (default: 0, no pre-forking)" << endl
+         << "    --maxsessions=<nb>:           Number of sessions handled by a worker before being replaced" << endl
+         << "                                  (default: 0, no limit)" << endl
+         << "    --nostats:                    Don't measure the latencies reported by the STATS command" << endl
+         << "    --asyncteacher:               Update the teacher in a background thread while the frame" << endl
+         << "                                  is rendered (faster on multi-core machines)" << endl
+         << "    --prebuild:                   Build the next episode of the task while waiting for the" << endl
+         << "                                  client, in stages (a command arriving during the build" << endl
+         << "                                  waits for the current stage)" << endl
+         << "    --layouts=<path>:             Folder containing the layouts precomputed by" << endl
+         << "                                  'mash-simulator-layouts' (default: none)" << endl
+         << "    --renderer=<name>:            Renderer of the views: 'ogre' or 'raycast' (on the CPU)." << endl
+         << "                                  The clients can override it with the 'RENDERER' setting" << endl
+         << "                                  (default: 'ogre')" << endl
 
 #if ATHENA_PLATFORM == ATHENA_PLATFORM_LINUX
          << "    --xauthorithy=<path>:         Path to the xauthority file (default: none)" << endl
@@ -134,11 +179,19 @@ int main(int argc, char** argv)
     bool            bGame           = false;
     bool            bVerbose        = false;
     bool            bSecret         = false;
+    bool            bAsyncTeacher   = false;
+    bool            bPrebuild       = false;
+    string          strLayouts      = "";
+    tRenderer       renderer        = RENDERER_OGRE;
     string          strGoal         = "";
     string          strEnvironment  = "";
     string          strHost         = "";
     unsigned int    port            = 11200;
+    string          strUnixSocket   = "";
+    int             fd              = -1;
     unsigned int    nbMaxClients    = 1;
+    unsigned int    nbWorkers       = 0;
+    unsigned int    maxSessions     = 0;
     unsigned int    width           = VIEW_WIDTH;
     unsigned int    height          = VIEW_HEIGHT;
 
@@ -193,6 +246,14 @@ int main(int argc, char** argv)
                     port = StringUtils::parseUnsignedInt(args.OptionArg());
                     break;
 
+                case OPT_UNIX:
+                    strUnixSocket = args.OptionArg();
+                    break;
+
+                case OPT_FD:
+                    fd = StringUtils::parseInt(args.OptionArg());
+                    break;
+
                 case OPT_LOG_FOLDER:
                     Server::strLogFolder = args.OptionArg();
                     if (Server::strLogFolder[Server::strLogFolder.size() - 1] != '/')
@@ -203,6 +264,38 @@ int main(int argc, char** argv)
                     nbMaxClients = StringUtils::parseUnsignedInt(args.OptionArg());
                     break;
 
+                case OPT_NB_WORKERS:
+                    nbWorkers = StringUtils::parseUnsignedInt(args.OptionArg());
+                    break;
+
+                case OPT_MAX_SESSIONS:
+                    maxSessions = StringUtils::parseUnsignedInt(args.OptionArg());
+                    break;
+
+                case OPT_NO_STATS:
+                    Statistics::enabled = false;
+                    break;
+
+                case OPT_ASYNC_TEACHER:
+                    bAsyncTeacher = true;
+                    break;
+
+                case OPT_PREBUILD:
+                    bPrebuild = true;
+                    break;
+
+                case OPT_LAYOUTS:
+                    strLayouts = args.OptionArg();
+                    break;
+
+                case OPT_RENDERER:
+                    if (!parseRenderer(args.OptionArg(), renderer))
+                    {
+                        cerr << "Unknown renderer: " << args.OptionArg() << endl;
+                        return -1;
+                    }
+                    break;
+
 #if ATHENA_PLATFORM == ATHENA_PLATFORM_LINUX
                 case OPT_XAUTHORITY:
                     setenv("XAUTHORITY", args.OptionArg(), 1);
@@ -216,6 +309,10 @@ int main(int argc, char** argv)
                 case OPT_VERBOSE:
                     bVerbose = true;
                     break;
+
+                case OPT_TRACE:
+                    Tracer::enable();
+                    break;
             }
         }
         else
@@ -319,7 +416,12 @@ int main(int argc, char** argv)
             return -1;
 
         // Start the simulator like a game
-        return (simulator.run() ? 0 : -1);
+        bool bResult = simulator.run();
+
+        if (Tracer::isEnabled())
+            Tracer::write("trace.json");
+
+        return (bResult ? 0 : -1);
     }
     else
     {
@@ -332,12 +434,28 @@ int main(int argc, char** argv)
              << endl;
 
         SimulationServer::bEnableSecrets = bSecret;
+        SimulationServer::bAsyncTeacher = bAsyncTeacher;
+        SimulationServer::bPrebuildEpisodes = bPrebuild;
+        SimulationServer::strLayoutsFolder = strLayouts;
+        SimulationServer::renderer = renderer;
 
         struct timeval timeout;
         timeout.tv_sec = 0;
         timeout.tv_usec = 100000;
 
+        if (nbWorkers > 0)
+            server.setWorkerPool(nbWorkers, maxSessions, SimulationServer::warmUp);
+
         // Start the server
-        return (server.listen(strHost, port, SimulationServer::create, bVerbose, &timeout) ? 0 : -1);
+        bool bResult;
+
+        if (fd >= 0)
+            bResult = server.listenOnSocket(fd, SimulationServer::create, bVerbose, &timeout);
+        else if (!strUnixSocket.empty())
+            bResult = server.listenUnix(strUnixSocket, SimulationServer::create, bVerbose, &timeout);
+        else
+            bResult = server.listen(strHost, port, SimulationServer::create, bVerbose, &timeout);
+
+        return (bResult ? 0 : -1);
     }
 }
@@ -24,7 +24,6 @@
 #include <Athena-Math/MathUtils.h>
 #include <Athena-Math/Color.h>
 #include <Athena-Math/Vector2.h>
-#include <Athena-Math/ShuffleBag.h>
 #include <Athena-Core/Utils/StringConverter.h>
 #include <Athena-Entities/Scene.h>
 #include <Athena-Graphics/Visual/World.h>
@@ -39,9 +38,9 @@ using namespace Athena::Graphics;
 #define TO_METERS(dim)  0.001f * ((dim) * pMapBuilder->getMap()->cell_size)
 
 
-MapBuilder* createSingleRoom()
+MapBuilder* createSingleRoom(unsigned int seed)
 {
-    MapBuilder* pMapBuilder = new MapBuilder(200, 100, 100);
+    MapBuilder* pMapBuilder = new MapBuilder(200, 100, 100, seed);
 
     MapBuilder::tRoomAttributes attributes;
 
@@ -66,9 +65,9 @@ MapBuilder* createSingleRoom()
 }
 
 
-MapBuilder* createMediumRoom()
+MapBuilder* createMediumRoom(unsigned int seed)
 {
-    MapBuilder* pMapBuilder = new MapBuilder(200, 80, 80);
+    MapBuilder* pMapBuilder = new MapBuilder(200, 80, 80, seed);
 
     MapBuilder::tRoomAttributes attributes;
 
@@ -93,9 +92,9 @@ MapBuilder* createMediumRoom()
 }
 
 
-MapBuilder* createTwoRooms()
+MapBuilder* createTwoRooms(unsigned int seed)
 {
-    MapBuilder* pMapBuilder = new MapBuilder(200, 100, 100);
+    MapBuilder* pMapBuilder = new MapBuilder(200, 100, 100, seed);
 
     int center_x = 49;
     int center_y = 49;
@@ -163,9 +162,9 @@ MapBuilder* createTwoRooms()
 }
 
 
-MapBuilder* createLShapedCorridor()
+MapBuilder* createLShapedCorridor(unsigned int seed)
 {
-    MapBuilder* pMapBuilder = new MapBuilder(200, 100, 100);
+    MapBuilder* pMapBuilder = new MapBuilder(200, 100, 100, seed);
 
     MapBuilder::tRoomAttributes attributes1, attributes2;
 
@@ -221,9 +220,9 @@ MapBuilder* createLShapedCorridor()
 }
 
 
-MapBuilder* createTShapedCorridor()
+MapBuilder* createTShapedCorridor(unsigned int seed)
 {
-    MapBuilder* pMapBuilder = new MapBuilder(200, 100, 100);
+    MapBuilder* pMapBuilder = new MapBuilder(200, 100, 100, seed);
 
     MapBuilder::tRoomAttributes attributes1, attributes2;
 
@@ -310,9 +309,9 @@ MapBuilder* createTShapedCorridor()
 }
 
 
-MapBuilder* createSecretMap()
+MapBuilder* createSecretMap(unsigned int seed)
 {
-    MapBuilder* pMapBuilder = new MapBuilder(200, 100, 100);
+    MapBuilder* pMapBuilder = new MapBuilder(200, 100, 100, seed);
 
     MapBuilder::tRoomAttributes attributes;
 
@@ -388,9 +387,9 @@ MapBuilder* createSecretMap()
 }
 
 
-MapBuilder* createLightRoom()
+MapBuilder* createLightRoom(unsigned int seed)
 {
-    MapBuilder* pMapBuilder = new MapBuilder(200, 100, 100);
+    MapBuilder* pMapBuilder = new MapBuilder(200, 100, 100, seed);
 
     MapBuilder::tRoomAttributes attributes;
 
@@ -414,14 +413,14 @@ MapBuilder* createLightRoom()
 }
 
 
-MapBuilder* createSimpleLine()
+MapBuilder* createSimpleLine(unsigned int seed)
 {
     const unsigned int CELL_SIZE = 200;
     const unsigned int DECAL_MARGIN_CELLS = 14;
     const unsigned int DECAL_WIDTH_CELLS = 2 * DECAL_MARGIN_CELLS + 1;
     const float DECAL_WIDTH = 0.001f * (DECAL_WIDTH_CELLS * CELL_SIZE);
 
-    MapBuilder* pMapBuilder = new MapBuilder(CELL_SIZE, 200, 200);
+    MapBuilder* pMapBuilder = new MapBuilder(CELL_SIZE, 200, 200, seed);
     Map* pMap = pMapBuilder->getMap();
 
     bool haxis = (pMapBuilder->getRandomNumberGenerator()->randomize(-100.0f, 100.0f) > 0.0f);
@@ -731,9 +730,9 @@ MapBuilder* createSimpleLine()
 }
 
 
-MapBuilder* createHugeRoom()
+MapBuilder* createHugeRoom(unsigned int seed)
 {
-    MapBuilder* pMapBuilder = new MapBuilder(200, 300, 300);
+    MapBuilder* pMapBuilder = new MapBuilder(200, 300, 300, seed);
     Map* pMap = pMapBuilder->getMap();
 
     MapBuilder::tRoomAttributes attributes;
@@ -856,7 +855,7 @@ std::vector<tPathSpot> generatePaintedPath(MapBuilder* pMapBuilder,
 }
 
 
-MapBuilder* createBlobsRoom()
+MapBuilder* createBlobsRoom(unsigned int seed)
 {
     const unsigned int CELL_SIZE = 200;
 
@@ -873,25 +872,15 @@ MapBuilder* createBlobsRoom()
     };
 
 
-    UIntShuffleBag bag;
-    bag.add(0, 10);
-    bag.add(1, 10);
-    bag.add(2, 10);
-
-    unsigned int validMaterial = bag.next();
-
-    unsigned int invalidMaterial = bag.next();
-    while (invalidMaterial == validMaterial)
-        invalidMaterial = bag.next();
-
-    unsigned int floorMaterial = bag.next();
-    while ((floorMaterial == validMaterial) || (floorMaterial == invalidMaterial))
-        floorMaterial = bag.next();
-
-
-    MapBuilder* pMapBuilder = new MapBuilder(CELL_SIZE, 200, 200);
+    MapBuilder* pMapBuilder = new MapBuilder(CELL_SIZE, 200, 200, seed);
     Map* pMap = pMapBuilder->getMap();
 
+    // The materials are chosen with the generator of the map (and not with a
+    // shuffle bag), so they only depend on the seed
+    unsigned int validMaterial = pMapBuilder->getRandomNumberGenerator()->randomize(0, 2);
+    unsigned int invalidMaterial = (validMaterial + 1 + pMapBuilder->getRandomNumberGenerator()->randomize(0, 1)) % 3;
+    unsigned int floorMaterial = 3 - validMaterial - invalidMaterial;
+
     MapBuilder::tRoomAttributes attributes;
 
     attributes.width    = pMapBuilder->getRandomNumberGenerator()->randomize(160, 200);
@@ -996,28 +985,28 @@ MapBuilder* createBlobsRoom()
 }
 
 
-MapBuilder* createMap(const std::string& strName)
+MapBuilder* createMap(const std::string& strName, unsigned int seed)
 {
     if (strName == "SingleRoom")
-        return createSingleRoom();
+        return createSingleRoom(seed);
     else if (strName == "MediumRoom")
-        return createMediumRoom();
+        return createMediumRoom(seed);
     else if (strName == "TwoRooms")
-        return createTwoRooms();
+        return createTwoRooms(seed);
     else if (strName == "L-ShapedCorridor")
-        return createLShapedCorridor();
+        return createLShapedCorridor(seed);
     else if (strName == "T-ShapedCorridor")
-        return createTShapedCorridor();
+        return createTShapedCorridor(seed);
     else if (strName == "Secret")
-        return createSecretMap();
+        return createSecretMap(seed);
     else if (strName == "LightRoom")
-        return createLightRoom();
+        return createLightRoom(seed);
     else if (strName == "Line")
-        return createSimpleLine();
+        return createSimpleLine(seed);
     else if (strName == "HugeRoom")
-        return createHugeRoom();
+        return createHugeRoom(seed);
     else if (strName == "BlobsRoom")
-        return createBlobsRoom();
+        return createBlobsRoom(seed);
 
     return 0;
 }
@@ -0,0 +1,435 @@
+/*******************************************************************************
+* MASH 3D simulator
+* 
+* Copyright (c) 2014 Idiap Research Institute, http://www.idiap.ch/
+* Written by Philip Abbet <philip.abbet@idiap.ch>
+* 
+* This file is part of mash-simulator.
+* 
+* mash-simulator is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 3 as
+* published by the Free Software Foundation.
+* 
+* mash-simulator is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+* 
+* You should have received a copy of the GNU General Public License
+* along with mash-simulator. If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+
+
+/** @file   mashsim.cpp
+    @author Philip Abbet (philip.abbet@idiap.ch)
+
+    Implementation of the C interface of the 'mashsim' library
+*/
+
+#include <mashsim.h>
+#include <Simulator.h>
+#include <Declarations.h>
+#include <unistd.h>
+#include <assert.h>
+#include <sstream>
+
+using namespace Mash;
+using namespace std;
+
+
+/*********************************** TYPES ************************************/
+
+struct mashsim_simulator
+{
+    Simulator       simulator;
+    bool            bEnableSecrets;
+    bool            bTaskInitialized;
+    std::string     strEvent;
+    std::string     strError;
+};
+
+
+/****************************** GLOBAL VARIABLES ******************************/
+
+// The 3D engine is shared by the whole process
+static mashsim_simulator* pInstance = 0;
+
+
+/********************************* FUNCTIONS **********************************/
+
+static bool checkTask(mashsim_simulator* sim)
+{
+    if (!sim->bTaskInitialized)
+    {
+        sim->strError = "No task initialized";
+        return false;
+    }
+
+    return true;
+}
+
+
+static bool contains(const tStringList& list, const std::string& strValue)
+{
+    tStringList::const_iterator iter, iterEnd;
+    for (iter = list.begin(), iterEnd = list.end(); iter != iterEnd; ++iter)
+    {
+        if (*iter == strValue)
+            return true;
+    }
+
+    return false;
+}
+
+
+/******************************** C INTERFACE *********************************/
+
+int mashsim_set_view_size(unsigned int width, unsigned int height)
+{
+    if (pInstance || (width == 0) || (height == 0))
+        return -1;
+
+    setResolution(width, height);
+
+    return 0;
+}
+
+
+void mashsim_get_view_size(unsigned int* width, unsigned int* height)
+{
+    if (width)
+        *width = VIEW_WIDTH;
+
+    if (height)
+        *height = VIEW_HEIGHT;
+}
+
+
+mashsim_simulator* mashsim_create(const char* data_folder, int enable_secrets)
+{
+    if (pInstance)
+        return 0;
+
+    // The configuration of the engine uses paths relative to its location
+    if (data_folder && (chdir(data_folder) != 0))
+        return 0;
+
+    mashsim_simulator* sim = new mashsim_simulator();
+    sim->bEnableSecrets = (enable_secrets != 0);
+    sim->bTaskInitialized = false;
+
+    try
+    {
+        if (!sim->simulator.init(false, "", "", sim->bEnableSecrets))
+        {
+            delete sim;
+            return 0;
+        }
+    }
+    catch (...)
+    {
+        delete sim;
+        return 0;
+    }
+
+    pInstance = sim;
+
+    return sim;
+}
+
+
+void mashsim_destroy(mashsim_simulator* sim)
+{
+    if (!sim)
+        return;
+
+    assert(sim == pInstance);
+
+    delete sim;
+    pInstance = 0;
+}
+
+
+void mashsim_set_async_teacher(mashsim_simulator* sim, int enabled)
+{
+    // Assertions
+    assert(sim);
+
+    sim->simulator.setAsyncTeacher(enabled != 0);
+}
+
+
+void mashsim_set_layouts_folder(mashsim_simulator* sim, const char* folder)
+{
+    // Assertions
+    assert(sim);
+    assert(folder);
+
+    sim->simulator.setLayoutsFolder(folder);
+}
+
+
+int mashsim_set_renderer(mashsim_simulator* sim, int renderer)
+{
+    // Assertions
+    assert(sim);
+
+    if ((renderer != MASHSIM_RENDERER_OGRE) && (renderer != MASHSIM_RENDERER_RAYCAST))
+    {
+        sim->strError = "Unknown renderer";
+        return -1;
+    }
+
+    sim->simulator.setRenderer(renderer == MASHSIM_RENDERER_RAYCAST ? RENDERER_RAYCAST : RENDERER_OGRE);
+
+    return 0;
+}
+
+
+int mashsim_set_timing(mashsim_simulator* sim, float action_duration,
+                       unsigned int nb_steps, float step_duration, int fast_forward)
+{
+    // Assertions
+    assert(sim);
+
+    tTiming timing;
+    timing.actionDuration = action_duration;
+    timing.nbSteps        = nb_steps;
+    timing.stepDuration   = step_duration;
+    timing.bFastForward   = (fast_forward != 0);
+
+    const tPhysicsLimits& limits = sim->simulator.getPhysicsLimits();
+
+    if (!timing.isValid(limits))
+    {
+        std::ostringstream str;
+        str << "Invalid timing: the steps must last at most " << limits.maxStepDuration()
+            << "ms and add up to the duration of an action";
+        sim->strError = str.str();
+        return -1;
+    }
+
+    sim->simulator.setTiming(timing);
+
+    return 0;
+}
+
+
+int mashsim_init_task(mashsim_simulator* sim, const char* goal,
+                      const char* environment, unsigned int seed)
+{
+    // Assertions
+    assert(sim);
+
+    if (!goal || !environment)
+    {
+        sim->strError = "Invalid arguments";
+        return -1;
+    }
+
+    string strGoal = goal;
+    string strEnvironment = environment;
+
+    // Check the goal and the environment
+    if (!contains(sim->simulator.getGoals(), strGoal) ||
+        (!sim->bEnableSecrets && sim->simulator.isGoalSecret(strGoal)))
+    {
+        sim->strError = "Unknown goal: " + strGoal;
+        return -1;
+    }
+
+    if (!contains(sim->simulator.getEnvironments(strGoal), strEnvironment) ||
+        (!sim->bEnableSecrets && sim->simulator.isEnvironmentSecret(strEnvironment)))
+    {
+        sim->strError = "Unknown environment: " + strEnvironment;
+        return -1;
+    }
+
+    try
+    {
+        sim->simulator.setup(strGoal, strEnvironment, seed);
+    }
+    catch (...)
+    {
+        sim->bTaskInitialized = false;
+        sim->strError = "Failed to initialize the task";
+        return -1;
+    }
+
+    sim->bTaskInitialized = true;
+    sim->strEvent = "";
+
+    return 0;
+}
+
+
+int mashsim_reset(mashsim_simulator* sim)
+{
+    // Assertions
+    assert(sim);
+
+    if (!checkTask(sim))
+        return -1;
+
+    try
+    {
+        sim->simulator.restart();
+    }
+    catch (...)
+    {
+        sim->strError = "Failed to reset the task";
+        return -1;
+    }
+
+    sim->strEvent = "";
+
+    return 0;
+}
+
+
+int mashsim_prepare_next_episode(mashsim_simulator* sim)
+{
+    // Assertions
+    assert(sim);
+
+    if (!checkTask(sim))
+        return -1;
+
+    try
+    {
+        sim->simulator.prepareNextEpisode();
+    }
+    catch (...)
+    {
+        sim->strError = "Failed to build the next episode";
+        return -1;
+    }
+
+    return 0;
+}
+
+
+int mashsim_step(mashsim_simulator* sim, int action, float* reward)
+{
+    // Assertions
+    assert(sim);
+
+    if (!checkTask(sim))
+        return MASHSIM_RESULT_ERROR;
+
+    if ((action < 0) || (action >= MASHSIM_NB_ACTIONS))
+    {
+        sim->strError = "Unknown action";
+        return MASHSIM_RESULT_ERROR;
+    }
+
+    float fReward = 0.0f;
+    tResult result;
+
+    sim->strEvent = "";
+
+    try
+    {
+        result = sim->simulator.performAction((tAction) action, fReward, sim->strEvent);
+    }
+    catch (...)
+    {
+        sim->strError = "Failed to perform the action";
+        return MASHSIM_RESULT_ERROR;
+    }
+
+    if (reward)
+        *reward = fReward;
+
+    switch (result)
+    {
+        case RESULT_SUCCESS:    return MASHSIM_RESULT_SUCCESS;
+        case RESULT_FAILED:     return MASHSIM_RESULT_FAILED;
+        default:                return MASHSIM_RESULT_NONE;
+    }
+}
+
+
+const char* mashsim_last_event(mashsim_simulator* sim)
+{
+    // Assertions
+    assert(sim);
+
+    return sim->strEvent.c_str();
+}
+
+
+int mashsim_get_view(mashsim_simulator* sim, unsigned char* buffer, size_t size)
+{
+    // Assertions
+    assert(sim);
+
+    if (!checkTask(sim))
+        return -1;
+
+    if (!buffer || (size < (size_t) VIEW_WIDTH * VIEW_HEIGHT * 3))
+    {
+        sim->strError = "The buffer is too small";
+        return -1;
+    }
+
+    try
+    {
+        if (!sim->simulator.getAvatarViewInto(buffer))
+        {
+            sim->strError = "Failed to retrieve the view";
+            return -1;
+        }
+    }
+    catch (...)
+    {
+        sim->strError = "Failed to retrieve the view";
+        return -1;
+    }
+
+    return 0;
+}
+
+
+int mashsim_teacher_action(mashsim_simulator* sim)
+{
+    // Assertions
+    assert(sim);
+
+    if (!checkTask(sim))
+        return -1;
+
+    tAction action = sim->simulator.getTeacherAction();
+
+    return (action == ACTIONS_COUNT ? -1 : (int) action);
+}
+
+
+int mashsim_not_recommended_actions(mashsim_simulator* sim, int* actions,
+                                    int max_actions)
+{
+    // Assertions
+    assert(sim);
+
+    if (!checkTask(sim) || !actions)
+        return 0;
+
+    tActionsList list = sim->simulator.getNotRecommendedActions();
+
+    int nb = 0;
+    tActionsList::iterator iter, iterEnd;
+    for (iter = list.begin(), iterEnd = list.end(); (iter != iterEnd) && (nb < max_actions); ++iter)
+        actions[nb++] = (int) *iter;
+
+    return nb;
+}
+
+
+const char* mashsim_last_error(mashsim_simulator* sim)
+{
+    // Assertions
+    assert(sim);
+
+    return sim->strError.c_str();
+}
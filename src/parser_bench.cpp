@@ -0,0 +1,209 @@
+/*******************************************************************************
+* MASH 3D simulator
+* 
+* Copyright (c) 2014 Idiap Research Institute, http://www.idiap.ch/
+* Written by Philip Abbet <philip.abbet@idiap.ch>
+* 
+* This file is part of mash-simulator.
+* 
+* mash-simulator is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License version 3 as
+* published by the Free Software Foundation.
+* 
+* mash-simulator is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+* 
+* You should have received a copy of the GNU General Public License
+* along with mash-simulator. If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+
+
+#include <mash-utils/data_buffer.h>
+#include <mash-utils/arguments_list.h>
+#include <mash-utils/stringutils.h>
+#include <mash-utils/statistics.h>
+#include <SimpleOpt.h>
+#include <iostream>
+#include <iomanip>
+#include <string>
+
+using namespace Mash;
+using namespace std;
+
+
+/**************************** COMMAND-LINE PARSING ****************************/
+
+enum tOptions
+{
+    OPT_MESSAGES,
+    OPT_CHUNK,
+    OPT_ITERATIONS,
+    OPT_HELP,
+};
+
+CSimpleOpt::SOption COMMAND_LINE_OPTIONS[] =
+{
+    { OPT_MESSAGES,         "--messages",    SO_REQ_CMB },
+    { OPT_CHUNK,            "--chunk",       SO_REQ_CMB },
+    { OPT_ITERATIONS,       "--iterations",  SO_REQ_CMB },
+    { OPT_HELP,             "--help",        SO_NONE    },
+    { OPT_HELP,             "-h",            SO_NONE    },
+
+    SO_END_OF_OPTIONS
+};
+
+
+/********************************** FUNCTIONS *********************************/
+
+void showUsage(const std::string& strApplicationName)
+{
+    cout << "MASH 3D Simulator - Parser benchmark" << endl
+         << "Usage: " << strApplicationName << " [options]" << endl
+         << endl
+         << "Measure the throughput of the parsing of the messages of the network protocol." << endl
+         << endl
+         << "Options:" << endl
+         << "    --help, -h:                   Display this help" << endl
+         << "    --messages=<nb>:              Number of messages in the input (default: 100000)" << endl
+         << "    --chunk=<size>:               The input is given to the parser by chunks of <size>" << endl
+         << "                                  bytes, 0 to give it at once (default: 65536)" << endl
+         << "    --iterations=<nb>:            Number of times the input is parsed (default: 10)" << endl
+         << endl;
+}
+
+
+//------------------------------------------------------------------------------
+/// @brief  Build the input: a mix of the messages exchanged during a session,
+///         as received when they are pipelined
+//------------------------------------------------------------------------------
+std::string createInput(unsigned int nbMessages)
+{
+    const char* MESSAGES[] = {
+        "ACTION GO_FORWARD\n",
+        "GET_VIEW main\n",
+        "REWARD 0.5\n",
+        "VIEW main image/mash 230400\n",
+        "STATE_UPDATED\n",
+        "AVAILABLE_ACTIONS GO_FORWARD GO_BACKWARD TURN_LEFT TURN_RIGHT\n",
+        "SUGGESTED_ACTION TURN_LEFT\n",
+    };
+
+    const unsigned int NB_MESSAGES = sizeof(MESSAGES) / sizeof(const char*);
+
+    string strInput;
+    string strEvent = "EVENT '" + DataBuffer::encodeArgument("The robot's target was reached") + "'\n";
+
+    for (unsigned int i = 0; i < nbMessages; ++i)
+    {
+        if (i % (NB_MESSAGES + 1) == NB_MESSAGES)
+            strInput += strEvent;
+        else
+            strInput += MESSAGES[i % (NB_MESSAGES + 1)];
+    }
+
+    return strInput;
+}
+
+
+int main(int argc, char** argv)
+{
+    // Declarations
+    unsigned int nbMessages   = 100000;
+    unsigned int chunkSize    = 65536;
+    unsigned int nbIterations = 10;
+
+    // Parse the command-line arguments
+    CSimpleOpt args(argc, argv, COMMAND_LINE_OPTIONS);
+    while (args.Next())
+    {
+        if (args.LastError() == SO_SUCCESS)
+        {
+            switch (args.OptionId())
+            {
+                case OPT_HELP:
+                    showUsage(argv[0]);
+                    return 0;
+
+                case OPT_MESSAGES:
+                    nbMessages = StringUtils::parseUnsignedInt(args.OptionArg());
+                    break;
+
+                case OPT_CHUNK:
+                    chunkSize = StringUtils::parseUnsignedInt(args.OptionArg());
+                    break;
+
+                case OPT_ITERATIONS:
+                    nbIterations = StringUtils::parseUnsignedInt(args.OptionArg());
+                    break;
+            }
+        }
+        else
+        {
+            cerr << "Invalid argument: " << args.OptionText() << endl;
+            return -1;
+        }
+    }
+
+    if (nbMessages == 0)
+        nbMessages = 1;
+
+    string strInput = createInput(nbMessages);
+
+    if ((chunkSize == 0) || (chunkSize > strInput.size()))
+        chunkSize = strInput.size();
+
+    // Parsing (the buffer, the message and the list of arguments are reused,
+    // like in NetworkUtils::waitMessage())
+    DataBuffer buffer;
+    string strMessage;
+    ArgumentsList arguments;
+    unsigned long long nbParsed = 0;
+    unsigned long long nbArguments = 0;
+
+    unsigned long long start = Statistics::now();
+
+    for (unsigned int iteration = 0; iteration < nbIterations; ++iteration)
+    {
+        for (unsigned int offset = 0; offset < strInput.size(); offset += chunkSize)
+        {
+            unsigned int size = chunkSize;
+            if (offset + size > strInput.size())
+                size = strInput.size() - offset;
+
+            buffer.add((const unsigned char*) strInput.data() + offset, size);
+
+            arguments.clear();
+            while (buffer.extractMessage(&strMessage, &arguments))
+            {
+                ++nbParsed;
+                nbArguments += arguments.size();
+                arguments.clear();
+            }
+        }
+    }
+
+    double duration = (Statistics::now() - start) * 1e-6;
+
+    if (nbParsed != (unsigned long long) nbMessages * nbIterations)
+    {
+        cerr << "ERROR - " << nbParsed << " messages parsed instead of "
+             << (unsigned long long) nbMessages * nbIterations << endl;
+        return -1;
+    }
+
+    double nbMegabytes = (double) strInput.size() * nbIterations / (1024.0 * 1024.0);
+
+    cout << "Input:      " << nbMessages << " messages, " << strInput.size() << " bytes" << endl
+         << "Chunks:     " << chunkSize << " bytes" << endl
+         << "Iterations: " << nbIterations << endl
+         << "Arguments:  " << nbArguments << endl
+         << "Duration:   " << fixed << std::setprecision(3) << duration << " s" << endl
+         << "Throughput: " << std::setprecision(0) << (duration > 0.0 ? nbParsed / duration : 0.0)
+         << " messages/s, " << std::setprecision(1) << (duration > 0.0 ? nbMegabytes / duration : 0.0)
+         << " MB/s" << endl;
+
+    return 0;
+}
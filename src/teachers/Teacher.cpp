@@ -26,9 +26,11 @@
 #include <Athena-Entities/Transforms.h>
 #include <Athena-Graphics/Visual/World.h>
 #include <Athena-Graphics/Conversions.h>
+#include <Ogre/OgreCamera.h>
 #include <Ogre/OgreSceneManager.h>
 #include <Ogre/OgreSubMesh.h>
 #include <Ogre/OgreSubEntity.h>
+#include <mash-utils/tracer.h>
 #include <vector>
 
 using namespace Athena::Math;
@@ -64,7 +66,8 @@ bool sortByDistanceWithReferencePoint(tPoint i, tPoint j)
 /***************************** CONSTRUCTION / DESTRUCTION ******************************/
 
 Teacher::Teacher(Map* pMap, Athena::Graphics::Visual::Camera* pCamera)
-: m_pMap(pMap), m_grid(0), m_pCamera(pCamera), m_nextAction(ACTIONS_COUNT)
+: m_pMap(pMap), m_pCamera(pCamera), m_nextAction(ACTIONS_COUNT),
+  m_bInfiniteFarPlane(false)
 {
     assert(pMap);
 
@@ -74,20 +77,18 @@ Teacher::Teacher(Map* pMap, Athena::Graphics::Visual::Camera* pCamera)
     m_robot_position_f.x = 0.001f *  (pMap->width + 1) * m_pMap->cell_size;
     m_robot_position_f.y = 0.001f *  (pMap->height + 1) * m_pMap->cell_size;
 
-    // Create the grid
-    m_grid = new tCellType[pMap->width * pMap->height];
+    // Create the mask of the explored cells (the unreachable ones don't need
+    // to be explored)
+    m_explored.resize(pMap->width * pMap->height, false);
 
-    for (unsigned int y = 0; y < pMap->height; ++y)
-    {
-        for (unsigned int x = 0; x < pMap->width; ++x)
-            m_grid[y * pMap->width + x] = (pMap->grid[y * pMap->width + x].type != CELL_UNREACHEABLE ? CELL_UNKNOWN : CELL_UNREACHEABLE);
-    }
+    const unsigned char* types = pMap->grid.types();
+    for (unsigned int i = 0; i < pMap->width * pMap->height; ++i)
+        m_explored[i] = (types[i] == CELL_UNREACHEABLE);
 }
 
 
 Teacher::~Teacher()
 {
-    delete[] m_grid;
 }
 
 
@@ -95,9 +96,40 @@ Teacher::~Teacher()
 
 void Teacher::update(const Vector3& position, const Quaternion& orientation)
 {
+    captureView();
+    processView(position);
+}
+
+
+void Teacher::captureView()
+{
+    // Assertions
+    assert(m_pCamera);
+
+    // Copy the frustum of the camera, so the visibility of the cells can be
+    // tested without touching the scene
+    Ogre::Camera* pOgreCamera = m_pCamera->getOgreCamera();
+    const Ogre::Plane* planes = pOgreCamera->getFrustumPlanes();
+
+    for (unsigned int i = 0; i < 6; ++i)
+    {
+        m_frustumPlanes[i][0] = planes[i].normal.x;
+        m_frustumPlanes[i][1] = planes[i].normal.y;
+        m_frustumPlanes[i][2] = planes[i].normal.z;
+        m_frustumPlanes[i][3] = planes[i].d;
+    }
+
+    m_bInfiniteFarPlane = (pOgreCamera->getFarClipDistance() == 0.0f);
+}
+
+
+void Teacher::processView(const Vector3& position)
+{
+    Mash::ScopedTrace trace("Teacher::update");
+
     // Robot
     if (m_robot_position.x < m_pMap->width)
-        m_grid[m_robot_position.y * m_pMap->width + m_robot_position.x] = m_pMap->grid[m_robot_position.y * m_pMap->width + m_robot_position.x].type;
+        setExplored(m_robot_position.y * m_pMap->width + m_robot_position.x, true);
 
     m_robot_position.x = ((int) ((position.x + m_pMap->cell_size * 0.0005f) * 1000.0f)) / m_pMap->cell_size;
     m_robot_position.y = ((int) ((position.z + m_pMap->cell_size * 0.0005f) * 1000.0f)) / m_pMap->cell_size;
@@ -105,7 +137,7 @@ void Teacher::update(const Vector3& position, const Quaternion& orientation)
     m_robot_position_f.x = position.x;
     m_robot_position_f.y = position.z;
 
-    m_grid[m_robot_position.y * m_pMap->width + m_robot_position.x] = CELL_ROBOT;
+    setExplored(m_robot_position.y * m_pMap->width + m_robot_position.x, true);
 
     // View area
     std::vector<tPoint> new_visible_cells;
@@ -116,11 +148,10 @@ void Teacher::update(const Vector3& position, const Quaternion& orientation)
         {
             int index = j * m_pMap->width + i;
 
-            if ((m_grid[index] == CELL_UNKNOWN) && isCellVisible(i, j))
+            if (!m_explored[index] && isCellVisible(i, j))
             {
-                if (m_pMap->grid[index].type == CELL_FLOOR)
+                if (m_pMap->grid.type(index) == CELL_FLOOR)
                 {
-                    Vector3 cameraPos = m_pCamera->getTransforms()->getWorldPosition();
                     Vector3 targetPos(TO_METERS(i) + m_pMap->cell_size * 0.0005f, 0.0f,
                                       TO_METERS(j) + m_pMap->cell_size * 0.0005f);
 
@@ -171,8 +202,10 @@ void Teacher::update(const Vector3& position, const Quaternion& orientation)
 
                 unsigned int index = point.y * m_pMap->width + point.x;
 
-                if ((m_pMap->grid[index].type == CELL_WALL) ||
-                    ((m_pMap->grid[index].type == CELL_TARGET) && (m_pMap->targets[m_pMap->grid[index].infos_index].type == TARGET_FLAG)))
+                tCellType type = m_pMap->grid.type(index);
+
+                if ((type == CELL_WALL) ||
+                    ((type == CELL_TARGET) && (m_pMap->targets[m_pMap->grid.infos(index).infos_index].type == TARGET_FLAG)))
                 {
                     bVisible = false;
                     break;
@@ -194,8 +227,10 @@ void Teacher::update(const Vector3& position, const Quaternion& orientation)
 
                 unsigned int index = point.y * m_pMap->width + point.x;
 
-                if ((m_pMap->grid[index].type == CELL_WALL) ||
-                    ((m_pMap->grid[index].type == CELL_TARGET) && (m_pMap->targets[m_pMap->grid[index].infos_index].type == TARGET_FLAG)))
+                tCellType type = m_pMap->grid.type(index);
+
+                if ((type == CELL_WALL) ||
+                    ((type == CELL_TARGET) && (m_pMap->targets[m_pMap->grid.infos(index).infos_index].type == TARGET_FLAG)))
                 {
                     bVisible = false;
                     break;
@@ -206,17 +241,19 @@ void Teacher::update(const Vector3& position, const Quaternion& orientation)
         if (bVisible)
         {
             unsigned int index = cell.y * m_pMap->width + cell.x;
-            m_grid[index] = m_pMap->grid[index].type;
+            setExplored(index, true);
 
-            if (m_pMap->grid[index].type == CELL_WAYPOINT)
+            if (m_pMap->grid.type(index) == CELL_WAYPOINT)
             {
                 m_new_waypoints.push_back(cell);
             }
-            else if (m_pMap->grid[index].type == CELL_TARGET)
+            else if (m_pMap->grid.type(index) == CELL_TARGET)
             {
+                const tCellInfos& infos = m_pMap->grid.infos(index);
+
                 tPoint point;
-                point.x = m_pMap->grid[index].main_x;
-                point.y = m_pMap->grid[index].main_y;
+                point.x = infos.main_x;
+                point.y = infos.main_y;
 
                 bool found = false;
 
@@ -267,7 +304,13 @@ unsigned char* Teacher::getImageOfGrid(unsigned int &width, unsigned int &height
     {
         for (unsigned int x = 0; x < width; ++x)
         {
-            Map::tColor color = Map::COLORS[ m_grid[y * m_pMap->width + x] ];
+            tCellType type = CELL_UNKNOWN;
+            if (((int) x == m_robot_position.x) && ((int) y == m_robot_position.y))
+                type = CELL_ROBOT;
+            else if (m_explored[y * m_pMap->width + x])
+                type = m_pMap->grid.type(x, y);
+
+            Map::tColor color = Map::COLORS[type];
             pDst[0] = color.r;
             pDst[1] = color.g;
             pDst[2] = color.b;
@@ -286,10 +329,29 @@ bool Teacher::isCellVisible(unsigned int x, unsigned int y)
     float cell_left = x * cell_size;
     float cell_top  = y * cell_size;
 
-    AxisAlignedBox bound(cell_left, 0.0f, cell_top, cell_left + cell_size, 3.0f,
-                         cell_top + cell_size);
+    // Same test as Ogre::Frustum::isVisible(), using the captured planes
+    const float centre[3]   = { cell_left + 0.5f * cell_size, 1.5f, cell_top + 0.5f * cell_size };
+    const float halfSize[3] = { 0.5f * cell_size, 1.5f, 0.5f * cell_size };
+
+    for (unsigned int i = 0; i < 6; ++i)
+    {
+        if ((i == Ogre::FRUSTUM_PLANE_FAR) && m_bInfiniteFarPlane)
+            continue;
+
+        const float* plane = m_frustumPlanes[i];
+
+        float dist = plane[0] * centre[0] + plane[1] * centre[1] +
+                     plane[2] * centre[2] + plane[3];
+
+        float maxAbsDist = MathUtils::Abs(plane[0] * halfSize[0]) +
+                           MathUtils::Abs(plane[1] * halfSize[1]) +
+                           MathUtils::Abs(plane[2] * halfSize[2]);
+
+        if (dist < -maxAbsDist)
+            return false;
+    }
 
-    return m_pCamera->isVisible(bound);
+    return true;
 }
 
 
@@ -38,7 +38,7 @@ static Debug::Axes* pAxes = 0;
 /***************************** CONSTRUCTION / DESTRUCTION ******************************/
 
 TeacherEatAllTargets::TeacherEatAllTargets(Map* pMap, Athena::Graphics::Visual::Camera* pCamera)
-: Teacher(pMap, pCamera), current_target(-1)
+: Teacher(pMap, pCamera), current_target(-1), nb_known_changes(pMap->changed_cells.size())
 {
 }
 
@@ -128,9 +128,7 @@ void TeacherEatAllTargets::onTargetReached(tTarget* pTarget)
 
     current_target = -1;
 
-    for (unsigned int i = 0; i < m_pMap->width * m_pMap->height; ++i)
-    {
-        if ((m_grid[i] != CELL_UNKNOWN) && (m_grid[i] != m_pMap->grid[i].type))
-            m_grid[i] = CELL_UNKNOWN;
-    }
+    // The cells modified since they were seen must be explored again
+    for (; nb_known_changes < m_pMap->changed_cells.size(); ++nb_known_changes)
+        setExplored(m_pMap->changed_cells[nb_known_changes], false);
 }
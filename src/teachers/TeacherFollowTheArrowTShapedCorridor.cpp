@@ -59,7 +59,7 @@ tAction TeacherFollowTheArrowTShapedCorridor::computeNextAction()
             {
                 tPoint target_pos = m_detected_targets[i];
 
-                if (m_pMap->targets[m_pMap->grid[target_pos.y * m_pMap->width + target_pos.x].infos_index].goal_specific == 1)
+                if (m_pMap->targets[m_pMap->grid.infos(m_pMap->grid.index(target_pos.x, target_pos.y)).infos_index].goal_specific == 1)
                 {
                     target = target_pos;
                     state = STATE_GO_TOWARD_FLAG;
@@ -83,7 +83,7 @@ tAction TeacherFollowTheArrowTShapedCorridor::computeNextAction()
         else
         {
             int index_robot = m_robot_position.y * m_pMap->width + m_robot_position.x;
-            if (m_pMap->grid[index_robot].type == CELL_SPOT)
+            if (m_pMap->grid.type(index_robot) == CELL_SPOT)
             {
                 target.x = -1;
                 target.y = -1;
@@ -101,7 +101,7 @@ tAction TeacherFollowTheArrowTShapedCorridor::computeNextAction()
         {
             tPoint target_pos = m_detected_targets[i];
 
-            if (m_pMap->targets[m_pMap->grid[target_pos.y * m_pMap->width + target_pos.x].infos_index].goal_specific == 1)
+            if (m_pMap->targets[m_pMap->grid.infos(m_pMap->grid.index(target_pos.x, target_pos.y)).infos_index].goal_specific == 1)
             {
                 target = target_pos;
                 break;
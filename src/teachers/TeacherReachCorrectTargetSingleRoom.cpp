@@ -53,7 +53,7 @@ tAction TeacherReachCorrectTargetSingleRoom::computeNextAction()
         for (unsigned int i = 0; i < m_detected_targets.size(); ++i)
         {
             tPoint point = m_detected_targets[i];
-            unsigned int index = m_pMap->grid[point.y * m_pMap->width + point.x].infos_index;
+            unsigned int index = m_pMap->grid.infos(m_pMap->grid.index(point.x, point.y)).infos_index;
 
             if (m_pMap->targets[index].goal_specific == 1)
             {
@@ -61,8 +61,8 @@ tAction TeacherReachOneFlagTwoRooms::computeNextAction()
         if (!m_new_waypoints.empty())
         {
             int index = m_new_waypoints[0].y * m_pMap->width + m_new_waypoints[0].x;
-            door.x = m_pMap->grid[index].main_x;
-            door.y = m_pMap->grid[index].main_y;
+            door.x = m_pMap->grid.infos(index).main_x;
+            door.y = m_pMap->grid.infos(index).main_y;
             m_new_waypoints.clear();
         }
     }
@@ -75,14 +75,14 @@ tAction TeacherReachOneFlagTwoRooms::computeNextAction()
         int index_flag = m_detected_targets[0].y * m_pMap->width + m_detected_targets[0].x;
         int index_robot = m_robot_position.y * m_pMap->width + m_robot_position.x;
 
-        if ((m_pMap->grid[index_robot].type == CELL_WAYPOINT) || (m_pMap->grid[index_flag].room == m_pMap->grid[index_robot].room))
+        if ((m_pMap->grid.type(index_robot) == CELL_WAYPOINT) || (m_pMap->grid.room(index_flag) == m_pMap->grid.room(index_robot)))
             target = m_detected_targets[0];
     }
 
     if ((target.x < 0) && (door.x >= 0))
     {
         int index_robot = m_robot_position.y * m_pMap->width + m_robot_position.x;
-        if (m_pMap->grid[index_robot].type == CELL_WAYPOINT)
+        if (m_pMap->grid.type(index_robot) == CELL_WAYPOINT)
         {
             door.x = -1;
             door.y = -1;